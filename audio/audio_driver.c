@@ -43,6 +43,7 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 #include "../list_special.h"
+#include "../performance_counters.h"
 
 #define AUDIO_BUFFER_FREE_SAMPLES_COUNT (8 * 1024)
 
@@ -561,6 +562,8 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
    if (!audio_driver_active || !audio_driver_input_data)
       return false;
 
+   performance_trace_stage_begin(PERF_TRACE_STAGE_AUDIO_FLUSH);
+
    convert_s16_to_float(audio_driver_input_data, data, samples,
          audio_volume_gain);
 
@@ -656,12 +659,11 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
 
    if (current_audio->write(audio_driver_context_audio_data,
             output_data, output_frames * 2) < 0)
-   {
       audio_driver_active = false;
-      return false;
-   }
 
-   return true;
+   performance_trace_stage_end(PERF_TRACE_STAGE_AUDIO_FLUSH);
+
+   return audio_driver_active;
 }
 
 /**
@@ -746,6 +748,20 @@ size_t audio_driver_sample_batch_rewind(const int16_t *data, size_t frames)
 
 void audio_driver_dsp_filter_free(void)
 {
+   unsigned i;
+   struct retro_dsp_plug_stats stats;
+
+   /* Share of real time each plug needed, to tell whether a
+    * chain fits on the machine. */
+   for (i = 0; retro_dsp_filter_get_stats(audio_driver_dsp, i, &stats); i++)
+   {
+      if (stats.frames && audio_driver_input > 0.0f)
+         RARCH_LOG("[DSP]: %s: %.2f %% of real time, %.2f us per 1000 frames.\n",
+               stats.ident,
+               100.0 * stats.usec * audio_driver_input / (1000000.0 * stats.frames),
+               1000.0 * stats.usec / stats.frames);
+   }
+
    if (audio_driver_dsp)
       retro_dsp_filter_free(audio_driver_dsp);
    audio_driver_dsp = NULL;
@@ -2275,6 +2275,8 @@ bool cheevos_unload(void)
    cheevos_locals.unofficial.cheevos = NULL;
    cheevos_locals.unofficial.count = 0;
 
+   cheevos_var_free_banks();
+
    cheevos_loaded = 0;
 
    return true;
@@ -2444,6 +2446,8 @@ void cheevos_test(void)
       cheevos_locals.addrs_patched = true;
    }
 
+   cheevos_var_update_banks();
+
    cheevos_test_cheevo_set(&cheevos_locals.core);
 
    if (settings->bools.cheevos_test_unofficial)
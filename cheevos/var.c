@@ -15,6 +15,7 @@
 
 #include <ctype.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include <libretro.h>
 
@@ -337,6 +338,89 @@ uint8_t* cheevos_var_get_memory(const cheevos_var_t* var)
    return memory;
 }
 
+/* Base pointers of every memory bank, resolved once per frame by
+ * cheevos_var_update_banks so that reading a variable doesn't have to query
+ * the core for each condition. */
+static uint8_t** cheevos_var_banks       = NULL;
+static unsigned  cheevos_var_bank_count  = 0;
+static unsigned  cheevos_var_bank_cap    = 0;
+
+/* Shift and mask applied to the first byte read, indexed by variable size. */
+static const uint8_t cheevos_var_shift[] =
+{
+   0, 1, 2, 3, 4, 5, 6, 7, /* BIT_0 .. BIT_7 */
+   0, 4,                   /* NIBBLE_LOWER, NIBBLE_UPPER */
+   0, 0, 0                 /* EIGHT_BITS, SIXTEEN_BITS, THIRTYTWO_BITS */
+};
+
+static const uint8_t cheevos_var_mask[] =
+{
+   0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+   0x0f, 0x0f,
+   0xff, 0xff, 0xff
+};
+
+void cheevos_var_update_banks(void)
+{
+   rarch_system_info_t* system = runloop_get_system_info();
+   unsigned count              = system->mmaps.num_descriptors;
+   unsigned i;
+
+   if (count == 0)
+      count = 4;
+
+   if (count > cheevos_var_bank_cap)
+   {
+      uint8_t** banks = (uint8_t**)realloc(cheevos_var_banks,
+            count * sizeof(*banks));
+
+      if (!banks)
+      {
+         cheevos_var_bank_count = 0;
+         return;
+      }
+
+      cheevos_var_banks    = banks;
+      cheevos_var_bank_cap = count;
+   }
+
+   if (system->mmaps.num_descriptors != 0)
+   {
+      for (i = 0; i < count; i++)
+         cheevos_var_banks[i] = (uint8_t*)system->mmaps.descriptors[i].core.ptr;
+   }
+   else
+   {
+      static const unsigned ids[] =
+      {
+         RETRO_MEMORY_SYSTEM_RAM,
+         RETRO_MEMORY_SAVE_RAM,
+         RETRO_MEMORY_VIDEO_RAM,
+         RETRO_MEMORY_RTC
+      };
+
+      for (i = 0; i < count; i++)
+      {
+         retro_ctx_memory_info_t meminfo = {NULL, 0, 0};
+
+         meminfo.id = ids[i];
+         core_get_memory(&meminfo);
+         cheevos_var_banks[i] = (uint8_t*)meminfo.data;
+      }
+   }
+
+   cheevos_var_bank_count = count;
+}
+
+void cheevos_var_free_banks(void)
+{
+   free(cheevos_var_banks);
+
+   cheevos_var_banks      = NULL;
+   cheevos_var_bank_count = 0;
+   cheevos_var_bank_cap   = 0;
+}
+
 unsigned cheevos_var_get_value(cheevos_var_t* var)
 {
    const uint8_t* memory = NULL;
@@ -347,58 +431,27 @@ unsigned cheevos_var_get_value(cheevos_var_t* var)
       case CHEEVOS_VAR_TYPE_VALUE_COMP:
          value = var->value;
          break;
-      
+
       case CHEEVOS_VAR_TYPE_ADDRESS:
       case CHEEVOS_VAR_TYPE_DELTA_MEM:
-         memory = cheevos_var_get_memory(var);
+         if (var->bank_id >= 0 && (unsigned)var->bank_id < cheevos_var_bank_count)
+         {
+            memory = cheevos_var_banks[var->bank_id];
+
+            if (memory)
+               memory += var->value;
+         }
 
          if (memory)
          {
             value = memory[0];
 
-            switch (var->size)
-            {
-               case CHEEVOS_VAR_SIZE_BIT_0:
-                  value &= 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_1:
-                  value = (value >> 1) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_2:
-                  value = (value >> 2) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_3:
-                  value = (value >> 3) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_4:
-                  value = (value >> 4) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_5:
-                  value = (value >> 5) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_6:
-                  value = (value >> 6) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_BIT_7:
-                  value = (value >> 7) & 1;
-                  break;
-               case CHEEVOS_VAR_SIZE_NIBBLE_LOWER:
-                  value &= 0x0f;
-                  break;
-               case CHEEVOS_VAR_SIZE_NIBBLE_UPPER:
-                  value = (value >> 4) & 0x0f;
-                  break;
-               case CHEEVOS_VAR_SIZE_EIGHT_BITS:
-                  break;
-               case CHEEVOS_VAR_SIZE_SIXTEEN_BITS:
-                  value |= memory[1] << 8;
-                  break;
-               case CHEEVOS_VAR_SIZE_THIRTYTWO_BITS:
-                  value |= memory[1] << 8;
-                  value |= memory[2] << 16;
-                  value |= memory[3] << 24;
-                  break;
-            }
+            if (var->size == CHEEVOS_VAR_SIZE_SIXTEEN_BITS)
+               value |= memory[1] << 8;
+            else if (var->size == CHEEVOS_VAR_SIZE_THIRTYTWO_BITS)
+               value |= (memory[1] << 8) | (memory[2] << 16) | ((unsigned)memory[3] << 24);
+            else
+               value = (value >> cheevos_var_shift[var->size]) & cheevos_var_mask[var->size];
          }
 
          if (var->type == CHEEVOS_VAR_TYPE_DELTA_MEM)
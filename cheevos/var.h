@@ -71,6 +71,11 @@ void cheevos_var_parse(cheevos_var_t* var, const char** memaddr);
 void cheevos_var_patch_addr(cheevos_var_t* var, cheevos_console_t console);
 
 uint8_t* cheevos_var_get_memory(const cheevos_var_t* var);
+
+/* Resolves the base pointer of every memory bank; must be called once per
+ * frame before cheevos_var_get_value. */
+void     cheevos_var_update_banks(void);
+void     cheevos_var_free_banks(void);
 unsigned cheevos_var_get_value(cheevos_var_t* var);
 
 RETRO_END_DECLS
@@ -125,9 +125,11 @@ struct command
 
 static bool command_read_ram(const char *arg);
 static bool command_write_ram(const char *arg);
+static bool command_seek_movie(const char *arg);
 
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER",      command_set_shader,  "<shader path>" },
+   { "SEEK_MOVIE",      command_seek_movie,  "<frame>" },
 #ifdef HAVE_CHEEVOS
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
    { "WRITE_CORE_RAM",  command_write_ram,   "<address> <byte1> <byte2> ..." },
@@ -246,6 +248,17 @@ bool command_set_shader(const char *arg)
    return video_driver_set_shader(type, arg);
 }
 
+static bool command_seek_movie(const char *arg)
+{
+   unsigned frame = (unsigned)strtoul(arg, NULL, 10);
+
+   if (!bsv_movie_seek(frame))
+      return false;
+
+   RARCH_LOG("Seeking movie to frame %u.\n", frame);
+   return true;
+}
+
 static bool command_read_ram(const char *arg)
 {
 #if defined(HAVE_COMMAND) && defined(HAVE_CHEEVOS)
@@ -2762,6 +2775,8 @@ TODO: Add a setting for these tweaks */
          break;
       case CMD_EVENT_PERFCNT_REPORT_FRONTEND_LOG:
          rarch_perf_log();
+         performance_trace_log();
+         performance_trace_free();
          break;
       case CMD_EVENT_VOLUME_UP:
          command_event_set_volume(0.5f);
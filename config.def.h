@@ -397,6 +397,10 @@ static const bool gpu_screenshot = true;
 /* Screenshots named automatically. */
 static const bool auto_screenshot_filename = true;
 
+/* Screenshots and savestate thumbnails are compressed with the
+ * fastest zlib level instead of the smallest. */
+static const bool screenshot_fast_compression = false;
+
 /* Record post-shaded GPU output instead of raw game footage if available. */
 static const bool gpu_record = false;
 
@@ -489,6 +493,9 @@ static const bool fps_show = false;
 /* Show frame count on FPS display */
 static const bool framecount_show = true;
 
+/* Show the menu's draw calls and vertices on FPS display */
+static const bool menu_stats_show = false;
+
 /* Enables use of rewind. This will incur some memory footprint
  * depending on the save state buffer. */
 static const bool rewind_enable = false;
@@ -538,6 +545,10 @@ static const int netplay_check_frames = 600;
 
 static const bool netplay_use_mitm_server = false;
 
+/* Also send input over UDP, so a lost packet only costs
+ * prediction instead of stalling on a TCP retransmit. */
+static const bool netplay_udp_input = true;
+
 /* On save state load, block SRAM from being overwritten.
  * This could potentially lead to buggy games. */
 static const bool block_sram_overwrite = false;
@@ -557,6 +568,10 @@ static const bool savestate_auto_load = false;
 
 static const bool savestate_thumbnail_enable = false;
 
+/* Save states compressed, with a header describing them.
+ * States saved either way can still be loaded. */
+static const bool savestate_file_compression = false;
+
 /* Slowmotion ratio. */
 static const float slowmotion_ratio = 3.0;
 
@@ -624,6 +639,10 @@ static const unsigned input_bind_timeout = 5;
 
 static const unsigned menu_thumbnails_default = 3;
 
+/* Texture memory (in MB) kept for recently shown
+ * and prefetched thumbnails. */
+static const unsigned menu_thumbnail_cache_size = 32;
+
 #ifdef IOS
 static const bool ui_companion_start_on_boot = false;
 #else
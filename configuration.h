@@ -84,6 +84,7 @@ typedef struct settings
       bool video_force_srgb_disable;
       bool video_fps_show;
       bool video_framecount_show;
+      bool video_menu_stats_show;
       bool video_msg_bgcolor_enable;
 
       /* Audio */
@@ -169,6 +170,7 @@ typedef struct settings
       bool netplay_swap_input;
       bool netplay_nat_traversal;
       bool netplay_use_mitm_server;
+      bool netplay_udp_input;
 
       /* Network */
       bool network_buildbot_auto_extract_archive;
@@ -208,6 +210,7 @@ typedef struct settings
       bool threaded_data_runloop_enable;
       bool set_supports_no_game_enable;
       bool auto_screenshot_filename;
+      bool screenshot_fast_compression;
       bool history_list_enable;
       bool playlist_entry_remove;
       bool playlist_entry_rename;
@@ -218,6 +221,7 @@ typedef struct settings
       bool savestate_auto_save;
       bool savestate_auto_load;
       bool savestate_thumbnail_enable;
+      bool savestate_file_compression;
       bool network_cmd_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
@@ -333,6 +337,7 @@ typedef struct settings
       unsigned video_msg_bgcolor_blue;
 
       unsigned menu_thumbnails;
+      unsigned menu_thumbnail_cache_size;
       unsigned menu_dpi_override_value;
       unsigned menu_entry_normal_color;
       unsigned menu_entry_hover_color;
@@ -400,6 +405,7 @@ typedef struct settings
       char netplay_password[128];
       char netplay_spectate_password[128];
       char netplay_server[255];
+      char netplay_relay_server[255];
       char network_buildbot_url[255];
       char network_buildbot_assets_url[255];
       char browse_url[4096];
@@ -30,6 +30,21 @@
 
 RETRO_BEGIN_DECLS
 
+/* What a savestate file says about itself, read from its header alone */
+typedef struct content_state_info
+{
+   bool compressed;
+   bool has_thumbnail;
+   uint32_t size;                  /* Size of the state, uncompressed */
+   uint32_t stored_size;           /* Size of the state in the file */
+   uint32_t crc;                   /* CRC32 of the uncompressed state */
+   uint32_t content_crc;
+   int64_t timestamp;              /* Seconds since the epoch */
+   char core_name[64];
+   char core_version[32];
+   char content_name[128];
+} content_state_info_t;
+
 typedef struct content_ctx_info
 {
    int argc;                       /* Argument count. */
@@ -50,6 +65,13 @@ bool content_load_state(const char* path, bool load_to_backup_buffer, bool autol
 /* Save a state from memory to disk. */
 bool content_save_state(const char *path, bool save_to_disk, bool autosave);
 
+/* Read the header of a savestate file. Returns false for states saved
+ * without one. */
+bool content_get_state_info(const char *path, content_state_info_t *info);
+
+/* Changes whenever a state has been saved, loaded or restored. */
+unsigned content_get_state_serial(void);
+
 /* Copy a save state. */
 bool content_rename_state(const char *origin, const char *dest);
 
@@ -159,6 +159,8 @@ bool core_set_default_callbacks(struct retro_callbacks *cbs);
 
 bool core_set_rewind_callbacks(void);
 
+bool core_set_silent_callbacks(bool silent);
+
 #ifdef HAVE_NETWORKING
 bool core_set_netplay_callbacks(void);
 
@@ -60,6 +60,16 @@ static void retro_input_poll_null(void)
 {
 }
 
+static void retro_audio_sample_null(int16_t left, int16_t right)
+{
+}
+
+static size_t retro_audio_sample_batch_null(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
 static void core_input_state_poll_maybe(void)
 {
    if (current_core.poll_type == POLL_TYPE_NORMAL)
@@ -173,6 +183,40 @@ bool core_set_rewind_callbacks(void)
    return true;
 }
 
+/**
+ * core_set_silent_callbacks:
+ * @silent         : drop the core's video and audio if true
+ *
+ * For running frames which shouldn't be seen or heard, such as when
+ * seeking in a movie.
+ **/
+bool core_set_silent_callbacks(bool silent)
+{
+   struct retro_callbacks cbs;
+
+   if (silent)
+   {
+      current_core.retro_set_video_refresh(retro_frame_null);
+      current_core.retro_set_audio_sample(retro_audio_sample_null);
+      current_core.retro_set_audio_sample_batch(retro_audio_sample_batch_null);
+      return true;
+   }
+
+   if (!core_set_default_callbacks(&cbs))
+      return false;
+
+   current_core.retro_set_video_refresh(cbs.frame_cb);
+   current_core.retro_set_audio_sample(cbs.sample_cb);
+   current_core.retro_set_audio_sample_batch(cbs.sample_batch_cb);
+
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_DATA_INITED, NULL))
+      core_set_netplay_callbacks();
+#endif
+
+   return true;
+}
+
 #ifdef HAVE_NETWORKING
 /**
  * core_set_netplay_callbacks:
@@ -15,16 +15,24 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "retroarch.h"
 #include "verbosity.h"
 
@@ -33,6 +41,20 @@
 #include "configuration.h"
 #include "file_path_special.h"
 #include "list_special.h"
+#include "paths.h"
+
+#define CORE_INFO_CACHE_MAGIC       "RACINFO"
+#define CORE_INFO_CACHE_VERSION     1
+#define CORE_INFO_CACHE_NULL        0xffffffff
+
+#define CORE_INFO_CACHE_HAS_INFO    (1 << 0)
+#define CORE_INFO_CACHE_NO_GAME     (1 << 1)
+#define CORE_INFO_CACHE_MATCH_MEMBER (1 << 2)
+
+/* Below this many stale .info files it is cheaper to
+ * parse them on the calling thread than to spawn workers. */
+#define CORE_INFO_THREAD_MIN_FILES  8
+#define CORE_INFO_MAX_THREADS       4
 
 static const char *core_info_tmp_path               = NULL;
 static const struct string_list *core_info_tmp_list = NULL;
@@ -80,102 +102,52 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+static void core_info_free(core_info_t *info)
 {
-   size_t i;
-   unsigned c;
-
-   for (i = 0; i < core_info_list->count; i++)
+   size_t j;
+
+   free(info->path);
+   free(info->core_name);
+   free(info->systemname);
+   free(info->system_manufacturer);
+   free(info->display_name);
+   free(info->supported_extensions);
+   free(info->authors);
+   free(info->permissions);
+   free(info->licenses);
+   free(info->categories);
+   free(info->databases);
+   free(info->notes);
+   string_list_free(info->supported_extensions_list);
+   string_list_free(info->authors_list);
+   string_list_free(info->note_list);
+   string_list_free(info->permissions_list);
+   string_list_free(info->licenses_list);
+   string_list_free(info->categories_list);
+   string_list_free(info->databases_list);
+
+   if (info->firmware)
    {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
-
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
-
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
-
-      if (!firmware)
-         continue;
-
-      info->firmware = firmware;
-
-      for (c = 0; c < count; c++)
+      for (j = 0; j < info->firmware_count; j++)
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
-         tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
+         free(info->firmware[j].path);
+         free(info->firmware[j].desc);
       }
+      free(info->firmware);
    }
+
+   memset(info, 0, sizeof(*info));
 }
 
 static void core_info_list_free(core_info_list_t *core_info_list)
 {
-   size_t i, j;
+   size_t i;
 
    if (!core_info_list)
       return;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      core_info_t *info = (core_info_t*)&core_info_list->list[i];
-
-      free(info->path);
-      free(info->core_name);
-      free(info->systemname);
-      free(info->system_manufacturer);
-      free(info->display_name);
-      free(info->supported_extensions);
-      free(info->authors);
-      free(info->permissions);
-      free(info->licenses);
-      free(info->categories);
-      free(info->databases);
-      free(info->notes);
-      string_list_free(info->supported_extensions_list);
-      string_list_free(info->authors_list);
-      string_list_free(info->note_list);
-      string_list_free(info->permissions_list);
-      string_list_free(info->licenses_list);
-      string_list_free(info->categories_list);
-      string_list_free(info->databases_list);
-      config_file_free((config_file_t*)info->config_data);
-
-      for (j = 0; j < info->firmware_count; j++)
-      {
-         free(info->firmware[j].path);
-         free(info->firmware[j].desc);
-      }
-      free(info->firmware);
-   }
+      core_info_free(&core_info_list->list[i]);
 
    free(core_info_list->all_ext);
    free(core_info_list->list);
@@ -226,11 +198,558 @@ error:
    return false;
 }
 
-static core_info_list_t *core_info_list_new(const char *path)
+static char *core_info_get_string(config_file_t *conf, const char *key)
+{
+   char *tmp = NULL;
+
+   if (config_get_string(conf, key, &tmp) && !string_is_empty(tmp))
+      return tmp;
+
+   free(tmp);
+   return NULL;
+}
+
+/* Reads one .info file into *info. Only touches *info,
+ * so several cores can be parsed concurrently. */
+static bool core_info_parse(core_info_t *info, const char *info_path)
+{
+   unsigned c;
+   unsigned count      = 0;
+   bool tmp_bool       = false;
+   config_file_t *conf = config_file_new(info_path);
+
+   if (!conf)
+      return false;
+
+   info->display_name         = core_info_get_string(conf, "display_name");
+   info->core_name            = core_info_get_string(conf, "corename");
+   info->systemname           = core_info_get_string(conf, "systemname");
+   info->system_manufacturer  = core_info_get_string(conf, "manufacturer");
+   info->supported_extensions = core_info_get_string(conf,
+         "supported_extensions");
+   info->authors              = core_info_get_string(conf, "authors");
+   info->permissions          = core_info_get_string(conf, "permissions");
+   info->licenses             = core_info_get_string(conf, "license");
+   info->categories           = core_info_get_string(conf, "categories");
+   info->databases            = core_info_get_string(conf, "database");
+   info->notes                = core_info_get_string(conf, "notes");
+
+   if (config_get_bool(conf, "supports_no_game",
+            &tmp_bool))
+      info->supports_no_game = tmp_bool;
+
+   if (config_get_bool(conf, "database_match_archive_member",
+            &tmp_bool))
+      info->database_match_archive_member = tmp_bool;
+
+   if (config_get_uint(conf, "firmware_count", &count) && count)
+      info->firmware = (core_info_firmware_t*)
+         calloc(count, sizeof(*info->firmware));
+
+   if (info->firmware)
+   {
+      info->firmware_count = count;
+
+      for (c = 0; c < count; c++)
+      {
+         char key[64];
+
+         key[0] = '\0';
+
+         snprintf(key, sizeof(key), "firmware%u_path", c);
+         info->firmware[c].path = core_info_get_string(conf, key);
+         snprintf(key, sizeof(key), "firmware%u_desc", c);
+         info->firmware[c].desc = core_info_get_string(conf, key);
+         snprintf(key, sizeof(key), "firmware%u_opt",  c);
+         if (config_get_bool(conf, key, &tmp_bool))
+            info->firmware[c].optional = tmp_bool;
+      }
+   }
+
+   info->has_info = true;
+
+   config_file_free(conf);
+   return true;
+}
+
+static void core_info_resolve_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list     = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list    = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list  = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list   = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list        = string_split(info->notes, "|");
+}
+
+typedef struct core_info_parse_state
+{
+   core_info_t *list;
+   char **info_paths;
+   size_t count;
+   size_t next;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} core_info_parse_state_t;
+
+static void core_info_parse_worker(void *data)
+{
+   core_info_parse_state_t *state = (core_info_parse_state_t*)data;
+
+   for (;;)
+   {
+      size_t i;
+
+#ifdef HAVE_THREADS
+      slock_lock(state->lock);
+#endif
+      i = state->next++;
+#ifdef HAVE_THREADS
+      slock_unlock(state->lock);
+#endif
+
+      if (i >= state->count)
+         break;
+
+      if (state->info_paths[i])
+         core_info_parse(&state->list[i], state->info_paths[i]);
+   }
+}
+
+/* Parses every entry of info_paths that is not NULL.
+ * Large batches are spread across worker threads, with
+ * the calling thread pulling from the same queue. */
+static void core_info_parse_all(core_info_t *list,
+      char **info_paths, size_t count, size_t num_paths)
+{
+   core_info_parse_state_t state;
+#ifdef HAVE_THREADS
+   unsigned i;
+   sthread_t *threads[CORE_INFO_MAX_THREADS];
+   unsigned num_threads = 0;
+#endif
+
+   state.list       = list;
+   state.info_paths = info_paths;
+   state.count      = count;
+   state.next       = 0;
+
+#ifdef HAVE_THREADS
+   state.lock       = NULL;
+
+   if (num_paths >= CORE_INFO_THREAD_MIN_FILES)
+      state.lock    = slock_new();
+
+   if (state.lock)
+   {
+      unsigned cpus = cpu_features_get_core_amount();
+
+      while (num_threads + 1 < cpus
+            && num_threads < CORE_INFO_MAX_THREADS)
+      {
+         threads[num_threads] = sthread_create(
+               core_info_parse_worker, &state);
+         if (!threads[num_threads])
+            break;
+         num_threads++;
+      }
+   }
+#endif
+
+   core_info_parse_worker(&state);
+
+#ifdef HAVE_THREADS
+   for (i = 0; i < num_threads; i++)
+      sthread_join(threads[i]);
+
+   if (state.lock)
+      slock_free(state.lock);
+#endif
+}
+
+/* The cache is a flat dump of the parsed core_info_t
+ * fields, keyed by core path and the mtime of the .info
+ * file it came from. It is only ever read back on the
+ * machine that wrote it, so values are stored in host
+ * byte order. */
+
+typedef struct core_info_cache_entry
+{
+   core_info_t info;
+   /* Of the .info file, -1 when there was none. */
+   int64_t mtime;
+} core_info_cache_entry_t;
+
+typedef struct core_info_cache_buf
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+   size_t pos;
+   bool error;
+} core_info_cache_buf_t;
+
+static void core_info_cache_put(core_info_cache_buf_t *buf,
+      const void *data, size_t len)
+{
+   if (buf->error)
+      return;
+
+   if (buf->size + len > buf->capacity)
+   {
+      uint8_t *new_data = NULL;
+      size_t capacity   = buf->capacity ? buf->capacity : 4096;
+
+      while (capacity < buf->size + len)
+         capacity *= 2;
+
+      new_data = (uint8_t*)realloc(buf->data, capacity);
+      if (!new_data)
+      {
+         buf->error = true;
+         return;
+      }
+
+      buf->data     = new_data;
+      buf->capacity = capacity;
+   }
+
+   memcpy(buf->data + buf->size, data, len);
+   buf->size += len;
+}
+
+static void core_info_cache_put_u32(core_info_cache_buf_t *buf,
+      uint32_t val)
+{
+   core_info_cache_put(buf, &val, sizeof(val));
+}
+
+static void core_info_cache_put_string(core_info_cache_buf_t *buf,
+      const char *s)
+{
+   uint32_t len = s ? (uint32_t)strlen(s) : CORE_INFO_CACHE_NULL;
+
+   core_info_cache_put_u32(buf, len);
+   if (s)
+      core_info_cache_put(buf, s, len);
+}
+
+static void core_info_cache_get(core_info_cache_buf_t *buf,
+      void *data, size_t len)
+{
+   if (buf->error || len > buf->size - buf->pos)
+   {
+      buf->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, buf->data + buf->pos, len);
+   buf->pos += len;
+}
+
+static uint32_t core_info_cache_get_u32(core_info_cache_buf_t *buf)
+{
+   uint32_t val = 0;
+   core_info_cache_get(buf, &val, sizeof(val));
+   return val;
+}
+
+static char *core_info_cache_get_string(core_info_cache_buf_t *buf)
+{
+   char *s      = NULL;
+   uint32_t len = core_info_cache_get_u32(buf);
+
+   if (buf->error || len == CORE_INFO_CACHE_NULL)
+      return NULL;
+
+   if (len > buf->size - buf->pos)
+   {
+      buf->error = true;
+      return NULL;
+   }
+
+   s = (char*)malloc(len + 1);
+   if (!s)
+   {
+      buf->error = true;
+      return NULL;
+   }
+
+   memcpy(s, buf->data + buf->pos, len);
+   s[len]    = '\0';
+   buf->pos += len;
+
+   return s;
+}
+
+static bool core_info_cache_get_path(char *s, size_t len)
+{
+   char *config_dir = NULL;
+
+   if (path_is_empty(RARCH_PATH_CONFIG))
+      return false;
+
+   config_dir    = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+   if (!config_dir)
+      return false;
+
+   config_dir[0] = '\0';
+
+   fill_pathname_basedir(config_dir, path_get(RARCH_PATH_CONFIG),
+         PATH_MAX_LENGTH * sizeof(char));
+   fill_pathname_join(s, config_dir,
+         file_path_str(FILE_PATH_CORE_INFO_CACHE), len);
+
+   free(config_dir);
+   return true;
+}
+
+static core_info_cache_entry_t *core_info_cache_read(
+      const char *cache_path, const char *cores_dir,
+      const char *info_dir, size_t *num_entries)
+{
+   size_t i, j;
+   char magic[sizeof(CORE_INFO_CACHE_MAGIC)];
+   core_info_cache_buf_t buf;
+   void *data                       = NULL;
+   ssize_t len                      = 0;
+   char *dir                        = NULL;
+   bool dirs_match                  = false;
+   uint32_t count                   = 0;
+   core_info_cache_entry_t *entries = NULL;
+
+   *num_entries = 0;
+
+   if (!path_is_valid(cache_path)
+         || !filestream_read_file(cache_path, &data, &len))
+      return NULL;
+
+   memset(&buf, 0, sizeof(buf));
+   buf.data = (uint8_t*)data;
+   buf.size = len;
+
+   core_info_cache_get(&buf, magic, sizeof(magic));
+   if (     memcmp(magic, CORE_INFO_CACHE_MAGIC, sizeof(magic))
+         || core_info_cache_get_u32(&buf) != CORE_INFO_CACHE_VERSION)
+      goto end;
+
+   count      = core_info_cache_get_u32(&buf);
+
+   /* The cache only applies to the directories it was built from. */
+   dir        = core_info_cache_get_string(&buf);
+   dirs_match = string_is_equal(dir, cores_dir);
+   free(dir);
+   dir        = core_info_cache_get_string(&buf);
+   dirs_match = dirs_match && string_is_equal(dir, info_dir);
+   free(dir);
+
+   /* Every entry takes at least this many bytes. */
+   if (buf.error || !dirs_match || !count
+         || count > (buf.size - buf.pos) / 64)
+      goto end;
+
+   entries = (core_info_cache_entry_t*)calloc(count, sizeof(*entries));
+   if (!entries)
+      goto end;
+
+   for (i = 0; i < count && !buf.error; i++)
+   {
+      uint32_t flags, fw_count;
+      core_info_t *info = &entries[i].info;
+
+      info->path = core_info_cache_get_string(&buf);
+      core_info_cache_get(&buf, &entries[i].mtime,
+            sizeof(entries[i].mtime));
+      flags      = core_info_cache_get_u32(&buf);
+
+      info->has_info                      =
+         !!(flags & CORE_INFO_CACHE_HAS_INFO);
+      info->supports_no_game              =
+         !!(flags & CORE_INFO_CACHE_NO_GAME);
+      info->database_match_archive_member =
+         !!(flags & CORE_INFO_CACHE_MATCH_MEMBER);
+
+      info->display_name         = core_info_cache_get_string(&buf);
+      info->core_name            = core_info_cache_get_string(&buf);
+      info->systemname           = core_info_cache_get_string(&buf);
+      info->system_manufacturer  = core_info_cache_get_string(&buf);
+      info->supported_extensions = core_info_cache_get_string(&buf);
+      info->authors              = core_info_cache_get_string(&buf);
+      info->permissions          = core_info_cache_get_string(&buf);
+      info->licenses             = core_info_cache_get_string(&buf);
+      info->categories           = core_info_cache_get_string(&buf);
+      info->databases            = core_info_cache_get_string(&buf);
+      info->notes                = core_info_cache_get_string(&buf);
+
+      fw_count = core_info_cache_get_u32(&buf);
+
+      if (!fw_count || buf.error)
+         continue;
+
+      if (fw_count > buf.size - buf.pos)
+      {
+         buf.error = true;
+         break;
+      }
+
+      info->firmware = (core_info_firmware_t*)
+         calloc(fw_count, sizeof(*info->firmware));
+      if (!info->firmware)
+      {
+         buf.error = true;
+         break;
+      }
+
+      info->firmware_count = fw_count;
+
+      for (j = 0; j < fw_count; j++)
+      {
+         info->firmware[j].path     = core_info_cache_get_string(&buf);
+         info->firmware[j].desc     = core_info_cache_get_string(&buf);
+         info->firmware[j].optional = !!core_info_cache_get_u32(&buf);
+      }
+   }
+
+   if (buf.error)
+   {
+      for (i = 0; i < count; i++)
+         core_info_free(&entries[i].info);
+      free(entries);
+      entries = NULL;
+      goto end;
+   }
+
+   *num_entries = count;
+
+end:
+   free(data);
+   return entries;
+}
+
+static void core_info_cache_write(const char *cache_path,
+      const char *cores_dir, const char *info_dir,
+      const core_info_list_t *list, const int64_t *mtimes)
+{
+   size_t i, j;
+   char tmp_path[PATH_MAX_LENGTH];
+   core_info_cache_buf_t buf;
+   bool written = false;
+
+   memset(&buf, 0, sizeof(buf));
+
+   core_info_cache_put(&buf, CORE_INFO_CACHE_MAGIC,
+         sizeof(CORE_INFO_CACHE_MAGIC));
+   core_info_cache_put_u32(&buf, CORE_INFO_CACHE_VERSION);
+   core_info_cache_put_u32(&buf, (uint32_t)list->count);
+   core_info_cache_put_string(&buf, cores_dir);
+   core_info_cache_put_string(&buf, info_dir);
+
+   for (i = 0; i < list->count; i++)
+   {
+      const core_info_t *info = &list->list[i];
+      uint32_t flags          = 0;
+
+      if (info->has_info)
+         flags |= CORE_INFO_CACHE_HAS_INFO;
+      if (info->supports_no_game)
+         flags |= CORE_INFO_CACHE_NO_GAME;
+      if (info->database_match_archive_member)
+         flags |= CORE_INFO_CACHE_MATCH_MEMBER;
+
+      core_info_cache_put_string(&buf, info->path);
+      core_info_cache_put(&buf, &mtimes[i], sizeof(mtimes[i]));
+      core_info_cache_put_u32(&buf, flags);
+      core_info_cache_put_string(&buf, info->display_name);
+      core_info_cache_put_string(&buf, info->core_name);
+      core_info_cache_put_string(&buf, info->systemname);
+      core_info_cache_put_string(&buf, info->system_manufacturer);
+      core_info_cache_put_string(&buf, info->supported_extensions);
+      core_info_cache_put_string(&buf, info->authors);
+      core_info_cache_put_string(&buf, info->permissions);
+      core_info_cache_put_string(&buf, info->licenses);
+      core_info_cache_put_string(&buf, info->categories);
+      core_info_cache_put_string(&buf, info->databases);
+      core_info_cache_put_string(&buf, info->notes);
+      core_info_cache_put_u32(&buf, (uint32_t)info->firmware_count);
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         core_info_cache_put_string(&buf, info->firmware[j].path);
+         core_info_cache_put_string(&buf, info->firmware[j].desc);
+         core_info_cache_put_u32(&buf, info->firmware[j].optional);
+      }
+   }
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+
+   if (!buf.error && filestream_write_file(tmp_path, buf.data, buf.size))
+   {
+#ifdef _WIN32
+      /* rename() won't replace an existing file here */
+      path_file_remove(cache_path);
+#endif
+      written = (rename(tmp_path, cache_path) == 0);
+   }
+
+   if (!written)
+   {
+      path_file_remove(tmp_path);
+      RARCH_WARN("[Core Info]: Could not write cache \"%s\".\n",
+            cache_path);
+   }
+
+   free(buf.data);
+}
+
+static core_info_cache_entry_t *core_info_cache_find(
+      core_info_cache_entry_t *entries, size_t num_entries,
+      size_t hint, const char *core_path)
 {
    size_t i;
+
+   if (!core_path)
+      return NULL;
+
+   /* The directory listing rarely changes order between runs. */
+   if (hint < num_entries
+         && string_is_equal(entries[hint].info.path, core_path))
+      return &entries[hint];
+
+   for (i = 0; i < num_entries; i++)
+      if (string_is_equal(entries[i].info.path, core_path))
+         return &entries[i];
+
+   return NULL;
+}
+
+static core_info_list_t *core_info_list_new(const char *path)
+{
+   size_t i, j;
+   char *cache_path                 = NULL;
+   char **info_paths                = NULL;
+   int64_t *mtimes                  = NULL;
+   size_t num_cached                = 0;
+   size_t num_hits                  = 0;
+   size_t num_parse                 = 0;
+   core_info_cache_entry_t *cached  = NULL;
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
+   settings_t *settings             = config_get_ptr();
+   const char *info_dir             =
+      (!string_is_empty(settings->paths.path_libretro_info)) ?
+      settings->paths.path_libretro_info :
+      settings->paths.directory_libretro;
    struct string_list *contents     = dir_list_new_special(
                                       path, DIR_LIST_CORES, NULL);
 
@@ -248,174 +767,89 @@ static core_info_list_t *core_info_list_new(const char *path)
    core_info_list->list  = core_info;
    core_info_list->count = contents->size;
 
+   info_paths = (char**)calloc(contents->size, sizeof(*info_paths));
+   mtimes     = (int64_t*)calloc(contents->size, sizeof(*mtimes));
+   cache_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+   if (!info_paths || !mtimes || !cache_path)
+      goto error;
+
+   cache_path[0] = '\0';
+
+   if (core_info_cache_get_path(cache_path, PATH_MAX_LENGTH * sizeof(char)))
+      cached = core_info_cache_read(cache_path, path, info_dir, &num_cached);
+
    for (i = 0; i < contents->size; i++)
    {
-      size_t info_path_size = PATH_MAX_LENGTH * sizeof(char);
-      char *info_path       = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+      char info_path[PATH_MAX_LENGTH];
+      core_info_cache_entry_t *entry = NULL;
+      const char *core_path          = contents->elems[i].data;
 
-      info_path[0]          = '\0';
+      info_path[0] = '\0';
+      mtimes[i]    = -1;
 
-      if ( 
-            core_info_list_iterate(info_path, info_path_size,
-            contents, i) 
-            && path_is_valid(info_path))
-      {
-         char *tmp           = NULL;
-         bool tmp_bool       = false;
-         unsigned count      = 0;
-         config_file_t *conf = config_file_new(info_path);
+      if (core_info_list_iterate(info_path, sizeof(info_path),
+               contents, i))
+         mtimes[i] = path_get_mtime(info_path);
 
-         free(info_path);
+      /* An mtime of 0 means the platform can't tell us
+       * whether the file changed, so always reparse. */
+      entry = core_info_cache_find(cached, num_cached, i, core_path);
+      if (entry && entry->mtime == mtimes[i] && mtimes[i] != 0)
+      {
+         core_info[i] = entry->info;
+         memset(&entry->info, 0, sizeof(entry->info));
+         num_hits++;
+         continue;
+      }
 
-         if (!conf)
-            continue;
+      if (!string_is_empty(core_path))
+         core_info[i].path = strdup(core_path);
 
-         if (config_get_string(conf, "display_name", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "corename", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].core_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemname", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].systemname = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "manufacturer", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_manufacturer = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         config_get_uint(conf, "firmware_count", &count);
-
-         core_info[i].firmware_count = count;
-
-         if (config_get_string(conf, "supported_extensions", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "authors", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "permissions", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "license", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "categories", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "database", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "notes", &tmp) 
-               && !string_is_empty(tmp))
-         {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (tmp)
-            free(tmp);
-         tmp    = NULL;
-
-         if (config_get_bool(conf, "supports_no_game",
-               &tmp_bool))
-            core_info[i].supports_no_game = tmp_bool;
-
-         if (config_get_bool(conf, "database_match_archive_member",
-               &tmp_bool))
-            core_info[i].database_match_archive_member = tmp_bool;
-
-         core_info[i].config_data = conf;
+      if (mtimes[i] >= 0)
+      {
+         info_paths[i] = strdup(info_path);
+         num_parse++;
       }
-      else
-         free(info_path);
+   }
 
-      if (!string_is_empty(contents->elems[i].data))
-         core_info[i].path = strdup(contents->elems[i].data);
+   if (num_parse)
+      core_info_parse_all(core_info, info_paths,
+            contents->size, num_parse);
 
+   for (i = 0; i < contents->size; i++)
+   {
       if (!core_info[i].display_name)
          core_info[i].display_name =
             strdup(path_basename(core_info[i].path));
-   }
 
-   if (core_info_list)
-   {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
+      core_info_resolve_lists(&core_info[i]);
    }
 
+   RARCH_LOG("[Core Info]: %u of %u cores loaded from cache.\n",
+         (unsigned)num_hits, (unsigned)contents->size);
+
+   if (!string_is_empty(cache_path)
+         && (num_hits != contents->size || num_cached != contents->size))
+      core_info_cache_write(cache_path, path, info_dir,
+            core_info_list, mtimes);
+
+   core_info_list_resolve_all_extensions(core_info_list);
+
+   for (j = 0; j < num_cached; j++)
+      core_info_free(&cached[j].info);
+   for (i = 0; i < contents->size; i++)
+      free(info_paths[i]);
+   free(cached);
+   free(info_paths);
+   free(mtimes);
+   free(cache_path);
    dir_list_free(contents);
    return core_info_list;
 
 error:
+   free(info_paths);
+   free(mtimes);
+   free(cache_path);
    if (contents)
       dir_list_free(contents);
    core_info_list_free(core_info_list);
@@ -755,7 +1189,23 @@ void core_info_get_name(const char *path, char *s, size_t len)
 {
    size_t i;
    settings_t             *settings = config_get_ptr();
-   struct string_list *contents     = dir_list_new_special(
+   struct string_list *contents     = NULL;
+
+   /* Already parsed when the core list was loaded. */
+   if (core_info_curr_list)
+   {
+      const core_info_t *info = core_info_find_internal(
+            core_info_curr_list, path);
+
+      if (info)
+      {
+         if (info->core_name)
+            strlcpy(s, info->core_name, len);
+         return;
+      }
+   }
+
+   contents = dir_list_new_special(
          settings->paths.directory_libretro,
          DIR_LIST_CORES, NULL);
 
@@ -819,9 +1269,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
 
    for (i = 0; i < core_info_list->count; i++)
    {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
+      num += core_info_list->list[i].has_info;
    }
 
    return num;
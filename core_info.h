@@ -39,9 +39,11 @@ typedef struct
 {
    bool supports_no_game;
    bool database_match_archive_member;
+   /* Set when an .info file was found and parsed
+    * for this core. */
+   bool has_info;
    size_t firmware_count;
    char *path;
-   void *config_data;
    char *display_name;
    char *core_name;
    char *system_manufacturer;
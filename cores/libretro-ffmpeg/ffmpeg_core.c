@@ -21,6 +21,8 @@ extern "C" {
 #include <libavutil/imgutils.h>
 #include <libavutil/time.h>
 #include <libavutil/opt.h>
+#include <libavutil/cpu.h>
+#include <libavutil/pixdesc.h>
 #include <libavdevice/avdevice.h>
 #ifdef HAVE_SWRESAMPLE
 #include <libswresample/swresample.h>
@@ -45,6 +47,7 @@ extern "C" {
 #include <rthreads/rthreads.h>
 #include <queues/fifo_queue.h>
 #include <string/stdstring.h>
+#include <retro_miscellaneous.h>
 
 #include <libretro.h>
 #ifdef RARCH_INTERNAL
@@ -126,19 +129,145 @@ static uint64_t frame_cnt;
 static uint64_t audio_frames;
 static double pts_bias;
 
-/* Threaded FIFOs. */
+/* Threaded pipeline.
+ *
+ * The demux thread reads packets and hands them to the video
+ * and audio decode threads through packet queues. Decoded video
+ * frames go on to the convert thread, which converts them into
+ * buffers from a fixed pool, splitting every frame into
+ * horizontal slices for a small pool of slice workers. Those
+ * buffers are given to video_cb without another copy. Audio is
+ * resampled into a sample FIFO.
+ *
+ * Every packet carries the seek serial it was read under, so
+ * anything still in flight when a seek happens can be told
+ * apart and dropped further down the pipeline. */
+
+/* Bounded FIFO of pointers between two pipeline stages.
+ * Push waits while the queue holds limit items, unless it has
+ * been made unbounded; pop waits while it is empty. Both fail
+ * once the queue is aborted. */
+struct ptr_queue
+{
+   void **items;
+   size_t head;
+   size_t count;
+   size_t capacity;
+   size_t limit;
+   bool unbounded;
+   bool aborted;
+   slock_t *lock;
+   scond_t *cond;
+};
+
+struct packet
+{
+   AVPacket pkt;
+   unsigned serial;
+   int stream_ptr;
+   /* No data, the demuxer reached the end of the file. */
+   bool eof;
+};
+
+struct decoded_frame
+{
+   /* NULL marks the end of the stream. */
+   AVFrame *frame;
+   unsigned serial;
+};
+
+struct video_buffer
+{
+   uint8_t *data;
+   int64_t pts;
+   unsigned serial;
+   /* Only needed when the GPU does the YUV conversion. */
+   enum AVColorSpace color;
+   bool full_range;
+};
+
+struct stage_stats
+{
+   uint64_t frames;
+   int64_t busy_us;
+};
+
+#define VIDEO_PACKET_QUEUE_SIZE 128
+#define AUDIO_PACKET_QUEUE_SIZE 256
+#define VIDEO_FRAME_QUEUE_SIZE  4
+#define VIDEO_BUFFER_COUNT      6
+
 static volatile bool decode_thread_dead;
-static fifo_buffer_t *video_decode_fifo;
+static struct ptr_queue video_packet_queue;
+static struct ptr_queue audio_packet_queue;
+static struct ptr_queue video_frame_queue;
+static struct ptr_queue video_ready_queue;
+static struct ptr_queue video_free_queue;
+static struct video_buffer video_buffers[VIDEO_BUFFER_COUNT];
+static struct video_buffer *video_buffer_shown;
 static fifo_buffer_t *audio_decode_fifo;
 static scond_t *fifo_cond;
 static scond_t *fifo_decode_cond;
 static slock_t *fifo_lock;
 static slock_t *decode_thread_lock;
-static sthread_t *decode_thread_handle;
+#ifdef HAVE_SSA
+static slock_t *ass_lock;
+#endif
+static sthread_t *demux_thread_handle;
+static sthread_t *video_decode_thread_handle;
+static sthread_t *convert_thread_handle;
+static sthread_t *audio_decode_thread_handle;
 static double decode_last_video_time;
 static double decode_last_audio_time;
+static unsigned seek_serial;
+static bool video_eof;
+static bool audio_eof;
+
+/* Time spent in the decoder and in sws_scale per frame,
+ * logged on unload as the throughput each stage could reach. */
+static struct stage_stats video_decode_stats;
+static struct stage_stats convert_stats;
+
+/* What the convert thread produces. RGB565 halves the memory
+ * traffic of XRGB8888; YUV420 is a quarter smaller still and
+ * leaves the conversion to the fragment shader, so it is only
+ * used with a hardware context. */
+enum output_format
+{
+   OUTPUT_XRGB8888 = 0,
+   OUTPUT_RGB565,
+   OUTPUT_YUV420
+};
+
+static enum output_format output_format;
+
+/* Slice workers of the convert thread. Slice 0 is converted by
+ * the convert thread itself, the others wait for a new
+ * generation, convert their rows and count down pending. */
+#define MAX_CONVERT_SLICES     8
+#define MIN_CONVERT_SLICE_ROWS 64
+
+struct convert_slice
+{
+   sthread_t *thread;
+   struct SwsContext *sws;
+   unsigned y;
+   unsigned height;
+};
 
-static uint32_t *video_frame_temp_buffer;
+static struct
+{
+   struct convert_slice slices[MAX_CONVERT_SLICES];
+   unsigned count;
+   unsigned generation;
+   unsigned pending;
+   bool quit;
+   const AVFrame *frame;
+   struct video_buffer *buf;
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done_cond;
+} convert_pool;
 
 static bool main_sleeping;
 
@@ -150,12 +279,16 @@ static double seek_time;
 struct frame
 {
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
-   GLuint tex;
+   /* Y, U and V planes with OUTPUT_YUV420, otherwise only the
+    * first one is used. */
+   GLuint tex[3];
 #if !defined(HAVE_OPENGLES)
    GLuint pbo;
 #endif
 #endif
    double pts;
+   enum AVColorSpace color;
+   bool full_range;
 };
 
 static struct frame frames[2];
@@ -169,6 +302,8 @@ static GLuint vbo;
 static GLint vertex_loc;
 static GLint tex_loc;
 static GLint mix_loc;
+static GLint yuv_matrix_loc;
+static GLint yuv_offset_loc;
 #endif
 
 static struct
@@ -279,6 +414,11 @@ void CORE_PREFIX(retro_set_environment)(retro_environment_t cb)
 #endif
 #endif
       { "ffmpeg_color_space", "Colorspace; auto|BT.709|BT.601|FCC|SMPTE240M" },
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+      { "ffmpeg_output_format", "Output Format (Restart); XRGB8888|RGB565|YUV420" },
+#else
+      { "ffmpeg_output_format", "Output Format (Restart); XRGB8888|RGB565" },
+#endif
       { NULL, NULL },
    };
    struct retro_log_callback log;
@@ -387,6 +527,344 @@ static void check_variables(void)
    }
 }
 
+/* The pixel format can only be set while loading the game,
+ * so unlike the other variables this is not re-read on change. */
+static void check_output_format(void)
+{
+   struct retro_variable var = {0};
+
+   var.key       = "ffmpeg_output_format";
+   output_format = OUTPUT_XRGB8888;
+
+   if (CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (string_is_equal(var.value, "RGB565"))
+         output_format = OUTPUT_RGB565;
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+      else if (string_is_equal(var.value, "YUV420"))
+         output_format = OUTPUT_YUV420;
+#endif
+   }
+}
+
+static enum AVPixelFormat output_pix_fmt(void)
+{
+   switch (output_format)
+   {
+      case OUTPUT_RGB565:
+#if defined(HAVE_OPENGLES)
+         /* The ES shader swizzles to .bgr for the RGB32 upload,
+          * so hand it the red and blue swapped variant as well. */
+         if (use_gl)
+            return AV_PIX_FMT_BGR565;
+#endif
+         return AV_PIX_FMT_RGB565;
+      case OUTPUT_YUV420:
+         return AV_PIX_FMT_YUV420P;
+      default:
+         break;
+   }
+
+   return PIX_FMT_RGB32;
+}
+
+/* Bytes per row of the first plane. */
+static unsigned video_buffer_pitch(void)
+{
+   switch (output_format)
+   {
+      case OUTPUT_RGB565:
+         return media.width * sizeof(uint16_t);
+      case OUTPUT_YUV420:
+         return media.width;
+      default:
+         break;
+   }
+
+   return media.width * sizeof(uint32_t);
+}
+
+static size_t video_buffer_size(void)
+{
+   size_t size = (size_t)video_buffer_pitch() * media.height;
+
+   /* Both chroma planes follow the luma plane. */
+   if (output_format == OUTPUT_YUV420)
+      size += 2 * (size_t)((media.width + 1) / 2) * ((media.height + 1) / 2);
+
+   return size;
+}
+
+/* Plane pointers into a video buffer, starting at row y. */
+static void video_buffer_planes(uint8_t *data, unsigned y,
+      uint8_t *dst[4], int dst_stride[4])
+{
+   unsigned pitch = video_buffer_pitch();
+
+   memset(dst, 0, 4 * sizeof(*dst));
+   memset(dst_stride, 0, 4 * sizeof(*dst_stride));
+
+   dst[0]        = data + (size_t)y * pitch;
+   dst_stride[0] = pitch;
+
+   if (output_format == OUTPUT_YUV420)
+   {
+      unsigned chroma_pitch  = (media.width + 1) / 2;
+      size_t chroma_size     = (size_t)chroma_pitch * ((media.height + 1) / 2);
+      uint8_t *u             = data + (size_t)pitch * media.height;
+
+      dst[1]        = u + (size_t)(y / 2) * chroma_pitch;
+      dst[2]        = u + chroma_size + (size_t)(y / 2) * chroma_pitch;
+      dst_stride[1] = chroma_pitch;
+      dst_stride[2] = chroma_pitch;
+   }
+}
+
+static bool ptr_queue_init(struct ptr_queue *q, size_t limit)
+{
+   memset(q, 0, sizeof(*q));
+
+   q->items    = (void**)calloc(limit, sizeof(*q->items));
+   q->capacity = limit;
+   q->limit    = limit;
+   q->lock     = slock_new();
+   q->cond     = scond_new();
+
+   return q->items && q->lock && q->cond;
+}
+
+static void ptr_queue_flush(struct ptr_queue *q, void (*free_cb)(void*))
+{
+   if (!q->lock)
+      return;
+
+   slock_lock(q->lock);
+   while (q->count)
+   {
+      void *item = q->items[q->head];
+
+      q->head    = (q->head + 1) % q->capacity;
+      q->count--;
+
+      if (free_cb)
+         free_cb(item);
+   }
+   scond_broadcast(q->cond);
+   slock_unlock(q->lock);
+}
+
+static void ptr_queue_free(struct ptr_queue *q, void (*free_cb)(void*))
+{
+   ptr_queue_flush(q, free_cb);
+
+   if (q->cond)
+      scond_free(q->cond);
+   if (q->lock)
+      slock_free(q->lock);
+   free(q->items);
+
+   memset(q, 0, sizeof(*q));
+}
+
+static bool ptr_queue_push(struct ptr_queue *q, void *item)
+{
+   slock_lock(q->lock);
+
+   while (!q->aborted && !q->unbounded && q->count >= q->limit)
+      scond_wait(q->cond, q->lock);
+
+   if (q->aborted)
+   {
+      slock_unlock(q->lock);
+      return false;
+   }
+
+   if (q->count == q->capacity)
+   {
+      size_t i;
+      size_t capacity = q->capacity * 2;
+      void **items    = (void**)malloc(capacity * sizeof(*items));
+
+      if (!items)
+      {
+         slock_unlock(q->lock);
+         return false;
+      }
+
+      for (i = 0; i < q->count; i++)
+         items[i] = q->items[(q->head + i) % q->capacity];
+
+      free(q->items);
+      q->items    = items;
+      q->head     = 0;
+      q->capacity = capacity;
+   }
+
+   q->items[(q->head + q->count) % q->capacity] = item;
+   q->count++;
+
+   scond_broadcast(q->cond);
+   slock_unlock(q->lock);
+   return true;
+}
+
+static bool ptr_queue_pop(struct ptr_queue *q, void **item, bool block)
+{
+   slock_lock(q->lock);
+
+   while (block && !q->aborted && !q->count)
+      scond_wait(q->cond, q->lock);
+
+   if (q->aborted || !q->count)
+   {
+      slock_unlock(q->lock);
+      return false;
+   }
+
+   *item   = q->items[q->head];
+   q->head = (q->head + 1) % q->capacity;
+   q->count--;
+
+   scond_broadcast(q->cond);
+   slock_unlock(q->lock);
+   return true;
+}
+
+static void ptr_queue_set_unbounded(struct ptr_queue *q, bool unbounded)
+{
+   if (!q->lock)
+      return;
+
+   slock_lock(q->lock);
+   q->unbounded = unbounded;
+   scond_broadcast(q->cond);
+   slock_unlock(q->lock);
+}
+
+static void ptr_queue_abort(struct ptr_queue *q)
+{
+   if (!q->lock)
+      return;
+
+   slock_lock(q->lock);
+   q->aborted = true;
+   scond_broadcast(q->cond);
+   slock_unlock(q->lock);
+}
+
+static void packet_free(void *data)
+{
+   struct packet *p = (struct packet*)data;
+
+   if (!p->eof)
+      av_free_packet(&p->pkt);
+   av_free(p);
+}
+
+/* Takes ownership of pkt. A NULL pkt queues an end of
+ * stream marker. */
+static bool packet_push(struct ptr_queue *q, AVPacket *pkt,
+      unsigned serial, int stream_ptr)
+{
+   struct packet *p = (struct packet*)av_mallocz(sizeof(*p));
+
+   if (!p)
+   {
+      if (pkt)
+         av_free_packet(pkt);
+      return false;
+   }
+
+   if (pkt)
+   {
+      p->pkt = *pkt;
+      av_dup_packet(&p->pkt);
+   }
+   else
+      p->eof = true;
+
+   p->serial     = serial;
+   p->stream_ptr = stream_ptr;
+
+   if (!ptr_queue_push(q, p))
+   {
+      packet_free(p);
+      return false;
+   }
+
+   return true;
+}
+
+static void decoded_frame_free(void *data)
+{
+   struct decoded_frame *f = (struct decoded_frame*)data;
+
+   av_frame_free(&f->frame);
+   av_free(f);
+}
+
+static void video_buffer_release(struct video_buffer *buf)
+{
+   ptr_queue_push(&video_free_queue, buf);
+}
+
+/* While the main thread waits on one stream, the demuxer must
+ * not stall on the other stream's full packet queue. */
+static void packet_queues_set_unbounded(bool unbounded)
+{
+   ptr_queue_set_unbounded(&video_packet_queue, unbounded);
+   ptr_queue_set_unbounded(&audio_packet_queue, unbounded);
+}
+
+static void pipeline_abort(void)
+{
+   ptr_queue_abort(&video_packet_queue);
+   ptr_queue_abort(&audio_packet_queue);
+   ptr_queue_abort(&video_frame_queue);
+   ptr_queue_abort(&video_ready_queue);
+   ptr_queue_abort(&video_free_queue);
+}
+
+/* Next converted frame for the main thread, skipping frames
+ * that were decoded before the last seek. Returns NULL once
+ * the pipeline shuts down. */
+static struct video_buffer *video_buffer_get(void)
+{
+   for (;;)
+   {
+      struct video_buffer *buf = NULL;
+      void *item               = NULL;
+
+      if (!ptr_queue_pop(&video_ready_queue, &item, false))
+      {
+         bool ret;
+
+         packet_queues_set_unbounded(true);
+         ret = ptr_queue_pop(&video_ready_queue, &item, true);
+         packet_queues_set_unbounded(false);
+
+         if (!ret)
+            return NULL;
+      }
+
+      buf = (struct video_buffer*)item;
+      if (buf->serial == seek_serial)
+         return buf;
+
+      video_buffer_release(buf);
+   }
+}
+
+static void log_stage_stats(const char *stage, struct stage_stats *stats)
+{
+   if (stats->frames && stats->busy_us > 0)
+      log_cb(RETRO_LOG_INFO, "[FFmpeg]: %s: %u frames, %.1f fps.\n",
+            stage, (unsigned)stats->frames,
+            stats->frames * 1000000.0 / stats->busy_us);
+
+   memset(stats, 0, sizeof(*stats));
+}
+
 static void seek_frame(int seek_frames)
 {
    char msg[256];
@@ -415,17 +893,138 @@ static void seek_frame(int seek_frames)
    }
    audio_frames = frame_cnt * media.sample_rate / media.interpolate_fps;
 
-   if (video_decode_fifo)
-      fifo_clear(video_decode_fifo);
+   /* Queued video frames are dropped by serial instead. */
    if (audio_decode_fifo)
       fifo_clear(audio_decode_fifo);
-   scond_signal(fifo_decode_cond);
+   scond_broadcast(fifo_decode_cond);
 
+   packet_queues_set_unbounded(true);
    while (!decode_thread_dead && do_seek)
       scond_wait(fifo_cond, fifo_lock);
+   packet_queues_set_unbounded(false);
    slock_unlock(fifo_lock);
 }
 
+#if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
+/* Column-major matrix and offset for the YUV shader, matching
+ * the coefficients set_colorspace picks for swscale. */
+static void yuv_to_rgb_matrix(enum AVColorSpace color, bool full_range,
+      GLfloat matrix[9], GLfloat offset[3])
+{
+   float kr, kb, kg, y_scale, c_scale;
+
+   switch (color)
+   {
+      case AVCOL_SPC_BT709:
+         kr = 0.2126f;
+         kb = 0.0722f;
+         break;
+      case AVCOL_SPC_FCC:
+         kr = 0.30f;
+         kb = 0.11f;
+         break;
+      case AVCOL_SPC_SMPTE240M:
+         kr = 0.212f;
+         kb = 0.087f;
+         break;
+      default:
+         kr = 0.299f;
+         kb = 0.114f;
+         break;
+   }
+
+   kg        = 1.0f - kr - kb;
+   y_scale   = full_range ? 1.0f : 255.0f / 219.0f;
+   c_scale   = full_range ? 1.0f : 255.0f / 224.0f;
+
+   offset[0] = full_range ? 0.0f : 16.0f / 255.0f;
+   offset[1] = 128.0f / 255.0f;
+   offset[2] = 128.0f / 255.0f;
+
+   /* Y column. */
+   matrix[0] = y_scale;
+   matrix[1] = y_scale;
+   matrix[2] = y_scale;
+   /* U column. */
+   matrix[3] = 0.0f;
+   matrix[4] = -2.0f * kb * (1.0f - kb) / kg * c_scale;
+   matrix[5] = 2.0f * (1.0f - kb) * c_scale;
+   /* V column. */
+   matrix[6] = 2.0f * (1.0f - kr) * c_scale;
+   matrix[7] = -2.0f * kr * (1.0f - kr) / kg * c_scale;
+   matrix[8] = 0.0f;
+}
+
+/* Uploads a converted frame into the textures of frame.
+ * Through the PBO, the plane pointers become buffer offsets. */
+static void upload_frame(struct frame *frame, const uint8_t *data)
+{
+   unsigned i;
+   size_t offset   = 0;
+   unsigned planes = output_format == OUTPUT_YUV420 ? 3 : 1;
+#ifndef HAVE_OPENGLES
+   void *mapped    = NULL;
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame->pbo);
+#ifdef __MACH__
+   mapped = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+#else
+   mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+         0, video_buffer_size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+#endif
+
+   memcpy(mapped, data, video_buffer_size());
+
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+#endif
+
+   /* Rows of odd-width RGB565 and chroma planes are not
+    * 4-byte aligned. */
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+   for (i = 0; i < planes; i++)
+   {
+      unsigned width      = i ? (media.width  + 1) / 2 : media.width;
+      unsigned height     = i ? (media.height + 1) / 2 : media.height;
+#ifdef HAVE_OPENGLES
+      const GLvoid *pixels = data + offset;
+#else
+      const GLvoid *pixels = (const GLvoid*)offset;
+#endif
+
+      glBindTexture(GL_TEXTURE_2D, frame->tex[i]);
+
+      switch (output_format)
+      {
+         case OUTPUT_YUV420:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE,
+                  width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels);
+            offset += (size_t)width * height;
+            break;
+         case OUTPUT_RGB565:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB,
+                  width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, pixels);
+            break;
+         default:
+#if defined(HAVE_OPENGLES)
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                  width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+#else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                  width, height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+#endif
+            break;
+      }
+   }
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+   glBindTexture(GL_TEXTURE_2D, 0);
+#ifndef HAVE_OPENGLES
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+}
+#endif
+
 void CORE_PREFIX(retro_run)(void)
 {
    static bool last_left;
@@ -564,12 +1163,17 @@ void CORE_PREFIX(retro_run)(void)
       to_read_bytes = to_read_frames * sizeof(int16_t) * 2;
 
       slock_lock(fifo_lock);
-      while (!decode_thread_dead && fifo_read_avail(audio_decode_fifo) < to_read_bytes)
+      if (!decode_thread_dead && fifo_read_avail(audio_decode_fifo) < to_read_bytes)
       {
-         main_sleeping = true;
-         scond_signal(fifo_decode_cond);
-         scond_wait(fifo_cond, fifo_lock);
-         main_sleeping = false;
+         packet_queues_set_unbounded(true);
+         while (!decode_thread_dead && fifo_read_avail(audio_decode_fifo) < to_read_bytes)
+         {
+            main_sleeping = true;
+            scond_broadcast(fifo_decode_cond);
+            scond_wait(fifo_cond, fifo_lock);
+            main_sleeping = false;
+         }
+         packet_queues_set_unbounded(false);
       }
 
       reading_pts  = decode_last_audio_time -
@@ -587,7 +1191,7 @@ void CORE_PREFIX(retro_run)(void)
 
       if (!decode_thread_dead)
          fifo_read(audio_decode_fifo, audio_buffer, to_read_bytes);
-      scond_signal(fifo_decode_cond);
+      scond_broadcast(fifo_decode_cond);
 
       slock_unlock(fifo_lock);
       audio_frames += to_read_frames;
@@ -609,65 +1213,32 @@ void CORE_PREFIX(retro_run)(void)
 
       while (!decode_thread_dead && min_pts > frames[1].pts)
       {
-         size_t to_read_frame_bytes;
-         int64_t pts = 0;
+         int64_t pts;
+         struct video_buffer *buf = video_buffer_get();
 
-         slock_lock(fifo_lock);
-         to_read_frame_bytes = media.width * media.height * sizeof(uint32_t) + sizeof(int64_t);
+         if (!buf)
+            break;
 
-         while (!decode_thread_dead && fifo_read_avail(video_decode_fifo) < to_read_frame_bytes)
-         {
-            main_sleeping = true;
-            scond_signal(fifo_decode_cond);
-            scond_wait(fifo_cond, fifo_lock);
-            main_sleeping = false;
-         }
+         pts = buf->pts;
 
-         if (!decode_thread_dead)
-         {
-            uint32_t *data = video_frame_temp_buffer;
-            fifo_read(video_decode_fifo, &pts, sizeof(int64_t));
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
-            if (use_gl)
-            {
-#ifndef HAVE_OPENGLES
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
-#ifdef __MACH__
-               data = (uint32_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
-#else
-               data = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
-                     0, media.width * media.height * sizeof(uint32_t), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-#endif
+         if (use_gl)
+         {
+            upload_frame(&frames[1], buf->data);
+            frames[1].color      = buf->color;
+            frames[1].full_range = buf->full_range;
+            video_buffer_release(buf);
+         }
+         else
 #endif
-
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
-
-#ifndef HAVE_OPENGLES
-               glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-#endif
-               glBindTexture(GL_TEXTURE_2D, frames[1].tex);
-#if defined(HAVE_OPENGLES)
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-#else
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
-#endif
-               glBindTexture(GL_TEXTURE_2D, 0);
-#ifndef HAVE_OPENGLES
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-#endif
-            }
-            else
-#endif
-            {
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
-               dupe = false;
-            }
-         }
-
-         scond_signal(fifo_decode_cond);
-         slock_unlock(fifo_lock);
+         {
+            /* Handed to video_cb as is, so hold on to it
+             * until the next frame replaces it. */
+            if (video_buffer_shown)
+               video_buffer_release(video_buffer_shown);
+            video_buffer_shown = buf;
+            dupe               = false;
+         }
 
          frames[1].pts = av_q2d(fctx->streams[video_stream]->time_base) * pts;
       }
@@ -687,10 +1258,28 @@ void CORE_PREFIX(retro_run)(void)
          glUseProgram(prog);
          
          glUniform1f(mix_loc, mix_factor);
+         if (output_format == OUTPUT_YUV420)
+         {
+            GLfloat matrix[9], offset[3];
+
+            yuv_to_rgb_matrix(frames[1].color, frames[1].full_range,
+                  matrix, offset);
+            glUniformMatrix3fv(yuv_matrix_loc, 1, GL_FALSE, matrix);
+            glUniform3fv(yuv_offset_loc, 1, offset);
+
+            glActiveTexture(GL_TEXTURE5);
+            glBindTexture(GL_TEXTURE_2D, frames[1].tex[2]);
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, frames[1].tex[1]);
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, frames[0].tex[2]);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, frames[0].tex[1]);
+         }
          glActiveTexture(GL_TEXTURE1);
-         glBindTexture(GL_TEXTURE_2D, frames[1].tex);
+         glBindTexture(GL_TEXTURE_2D, frames[1].tex[0]);
          glActiveTexture(GL_TEXTURE0);
-         glBindTexture(GL_TEXTURE_2D, frames[0].tex);
+         glBindTexture(GL_TEXTURE_2D, frames[0].tex[0]);
          
          
          glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -707,6 +1296,16 @@ void CORE_PREFIX(retro_run)(void)
          glDisableVertexAttribArray(tex_loc);
          
          glUseProgram(0);
+         if (output_format == OUTPUT_YUV420)
+         {
+            int i;
+
+            for (i = 5; i >= 2; i--)
+            {
+               glActiveTexture(GL_TEXTURE0 + i);
+               glBindTexture(GL_TEXTURE_2D, 0);
+            }
+         }
          glActiveTexture(GL_TEXTURE1);
          glBindTexture(GL_TEXTURE_2D, 0);
          glActiveTexture(GL_TEXTURE0);
@@ -718,8 +1317,8 @@ void CORE_PREFIX(retro_run)(void)
       else
 #endif
       {
-         CORE_PREFIX(video_cb)(dupe ? NULL : video_frame_temp_buffer,
-               media.width, media.height, media.width * sizeof(uint32_t));
+         CORE_PREFIX(video_cb)(dupe ? NULL : video_buffer_shown->data,
+               media.width, media.height, video_buffer_pitch());
       }
    }
 #if defined(HAVE_GL_FFT) && (defined(HAVE_OPENGL) || defined(HAVE_OPENGLES))
@@ -764,6 +1363,17 @@ static bool open_codec(AVCodecContext **ctx, unsigned index)
    }
 
    *ctx = fctx->streams[index]->codec;
+
+   if ((*ctx)->codec_type == AVMEDIA_TYPE_VIDEO)
+   {
+      /* Let libavcodec pick a thread count and decode several
+       * frames at once. Frames are reference counted so they
+       * can be handed to the convert thread. */
+      (*ctx)->thread_count      = 0;
+      (*ctx)->thread_type       = FF_THREAD_FRAME | FF_THREAD_SLICE;
+      (*ctx)->refcounted_frames = 1;
+   }
+
    if (avcodec_open2(*ctx, codec, NULL) < 0)
       return false;
 
@@ -957,68 +1567,49 @@ static bool init_media_info(void)
    return true;
 }
 
-static void set_colorspace(struct SwsContext *sws,
-      unsigned width, unsigned height,
-      enum AVColorSpace default_color, int in_range)
+static enum AVColorSpace resolve_colorspace(
+      unsigned width, unsigned height, enum AVColorSpace default_color)
 {
-   const int *coeffs = NULL;
-
-   if (colorspace == AVCOL_SPC_UNSPECIFIED)
-   {
-      if (default_color != AVCOL_SPC_UNSPECIFIED)
-         coeffs = sws_getCoefficients(default_color);
-      else if (width >= 1280 || height > 576)
-         coeffs = sws_getCoefficients(AVCOL_SPC_BT709);
-      else
-         coeffs = sws_getCoefficients(AVCOL_SPC_BT470BG);
-   }
-   else
-      coeffs = sws_getCoefficients(colorspace);
+   if (colorspace != AVCOL_SPC_UNSPECIFIED)
+      return colorspace;
+   if (default_color != AVCOL_SPC_UNSPECIFIED)
+      return default_color;
+   if (width >= 1280 || height > 576)
+      return AVCOL_SPC_BT709;
+   return AVCOL_SPC_BT470BG;
+}
 
-   if (coeffs)
-   {
-      int in_full, out_full, brightness, contrast, saturation;
-      const int *inv_table, *table;
+/* Returns whether the input is full range. YUV output keeps the
+ * input range as is, the shader expands it later. */
+static bool set_colorspace(struct SwsContext *sws,
+      enum AVColorSpace color, int in_range)
+{
+   int in_full, out_full, brightness, contrast, saturation;
+   const int *inv_table, *table;
+   const int *coeffs = sws_getCoefficients(color);
 
-      sws_getColorspaceDetails(sws, (int**)&inv_table, &in_full,
-            (int**)&table, &out_full,
-            &brightness, &contrast, &saturation);
+   sws_getColorspaceDetails(sws, (int**)&inv_table, &in_full,
+         (int**)&table, &out_full,
+         &brightness, &contrast, &saturation);
 
-      if (in_range != AVCOL_RANGE_UNSPECIFIED)
-         in_full = in_range == AVCOL_RANGE_JPEG;
+   if (in_range != AVCOL_RANGE_UNSPECIFIED)
+      in_full = in_range == AVCOL_RANGE_JPEG;
 
+   if (coeffs)
       inv_table = coeffs;
-      sws_setColorspaceDetails(sws, inv_table, in_full,
-            table, out_full,
-            brightness, contrast, saturation);
-   }
-}
+   if (output_format == OUTPUT_YUV420)
+      out_full = in_full;
 
-static bool decode_video(AVPacket *pkt, AVFrame *frame,
-      AVFrame *conv, struct SwsContext *sws)
-{
-   int got_ptr = 0;
-   int ret     = avcodec_decode_video2(vctx, frame, &got_ptr, pkt);
+   sws_setColorspaceDetails(sws, inv_table, in_full,
+         table, out_full,
+         brightness, contrast, saturation);
 
-   if (ret < 0)
-      return false;
-
-   if (got_ptr)
-   {
-      set_colorspace(sws, media.width, media.height,
-            av_frame_get_colorspace(frame), av_frame_get_color_range(frame));
-      sws_scale(sws, (const uint8_t * const*)frame->data,
-            frame->linesize, 0, media.height,
-            conv->data, conv->linesize);
-      return true;
-   }
-
-   return false;
+   return in_full;
 }
 
 static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
       AVFrame *frame, int16_t *buffer, size_t *buffer_cap,
-      SwrContext *swr)
+      SwrContext *swr, int stream_ptr, unsigned serial)
 {
    AVPacket pkt_tmp = *pkt;
    int got_ptr      = 0;
@@ -1054,7 +1645,8 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
       pts = av_frame_get_best_effort_timestamp(frame);
       slock_lock(fifo_lock);
 
-      while (!decode_thread_dead && fifo_write_avail(audio_decode_fifo) < required_buffer)
+      while (!decode_thread_dead && serial == seek_serial
+            && fifo_write_avail(audio_decode_fifo) < required_buffer)
       {
          if (!main_sleeping)
             scond_wait(fifo_decode_cond, fifo_lock);
@@ -1066,8 +1658,15 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
          }
       }
 
+      /* Decoded before the last seek, drop it. */
+      if (serial != seek_serial)
+      {
+         slock_unlock(fifo_lock);
+         continue;
+      }
+
       decode_last_audio_time = pts * av_q2d(
-            fctx->streams[audio_streams[audio_streams_ptr]]->time_base);
+            fctx->streams[audio_streams[stream_ptr]]->time_base);
 
       if (!decode_thread_dead)
          fifo_write(audio_decode_fifo, buffer, required_buffer);
@@ -1087,96 +1686,502 @@ static void decode_thread_seek(double time)
    if (seek_to < 0)
       seek_to = 0;
 
-   decode_last_video_time = time;
-   decode_last_audio_time = time;
-
    ret = avformat_seek_file(fctx, -1, INT64_MIN, seek_to, INT64_MAX, 0);
    if (ret < 0)
       log_cb(RETRO_LOG_ERROR, "av_seek_frame() failed.\n");
 
-   if (actx[audio_streams_ptr])
-      avcodec_flush_buffers(actx[audio_streams_ptr]);
-   if (vctx)
-      avcodec_flush_buffers(vctx);
+   /* The audio and video decoders belong to their own threads,
+    * which flush them once packets with a new serial arrive. */
    if (sctx[subtitle_streams_ptr])
       avcodec_flush_buffers(sctx[subtitle_streams_ptr]);
 #ifdef HAVE_SSA
    if (ass_track[subtitle_streams_ptr])
+   {
+      slock_lock(ass_lock);
       ass_flush_events(ass_track[subtitle_streams_ptr]);
+      slock_unlock(ass_lock);
+   }
 #endif
 }
 
 #ifdef HAVE_SSA
 /* Straight CPU alpha blending.
  * Should probably do in GL. */
-static void render_ass_img(AVFrame *conv_frame, ASS_Image *img)
+static void render_ass_img(uint8_t *frame, ASS_Image *img)
 {
-   uint32_t *frame = (uint32_t*)conv_frame->data[0];
-   int      stride = conv_frame->linesize[0] / sizeof(uint32_t);
+   uint8_t *planes[4];
+   int strides[4];
+   bool swap_rb = output_pix_fmt() == AV_PIX_FMT_BGR565;
+
+   video_buffer_planes(frame, 0, planes, strides);
 
    for (; img; img = img->next)
    {
       int x, y;
       unsigned r, g, b, a;
-      uint32_t *dst         = NULL;
+      int luma, cb, cr;
       const uint8_t *bitmap = NULL;
 
       if (img->w == 0 && img->h == 0)
          continue;
 
       bitmap = img->bitmap;
-      dst    = frame + img->dst_x + img->dst_y * stride;
 
       r      = (img->color >> 24) & 0xff;
       g      = (img->color >> 16) & 0xff;
       b      = (img->color >>  8) & 0xff;
       a      = 255 - (img->color & 0xff);
 
-      for (y = 0; y < img->h; y++,
-            bitmap += img->stride, dst += stride)
+      if (swap_rb)
+      {
+         unsigned tmp = r;
+         r            = b;
+         b            = tmp;
+      }
+
+      /* BT.601 limited range, close enough for subtitles. */
+      luma   = (( 66 * (int)r + 129 * (int)g +  25 * (int)b + 128) >> 8) +  16;
+      cb     = ((-38 * (int)r -  74 * (int)g + 112 * (int)b + 128) >> 8) + 128;
+      cr     = ((112 * (int)r -  94 * (int)g -  18 * (int)b + 128) >> 8) + 128;
+
+      for (y = 0; y < img->h; y++, bitmap += img->stride)
       {
+         int dst_y    = img->dst_y + y;
+         uint8_t *row = planes[0] + dst_y * strides[0];
+
          for (x = 0; x < img->w; x++)
          {
+            int dst_x          = img->dst_x + x;
             unsigned src_alpha = ((bitmap[x] * (a + 1)) >> 8) + 1;
             unsigned dst_alpha = 256 - src_alpha;
 
-            uint32_t dst_color = dst[x];
-            unsigned dst_r     = (dst_color >> 16) & 0xff;
-            unsigned dst_g     = (dst_color >>  8) & 0xff;
-            unsigned dst_b     = (dst_color >>  0) & 0xff;
+            switch (output_format)
+            {
+               case OUTPUT_YUV420:
+                  row[dst_x] = (luma * src_alpha + row[dst_x] * dst_alpha) >> 8;
+
+                  /* One chroma sample covers a 2x2 block. */
+                  if (!(dst_x & 1) && !(dst_y & 1))
+                  {
+                     uint8_t *u = planes[1] + (dst_y / 2) * strides[1] + dst_x / 2;
+                     uint8_t *v = planes[2] + (dst_y / 2) * strides[2] + dst_x / 2;
+
+                     *u = (cb * src_alpha + *u * dst_alpha) >> 8;
+                     *v = (cr * src_alpha + *v * dst_alpha) >> 8;
+                  }
+                  break;
+               case OUTPUT_RGB565:
+                  {
+                     uint16_t *dst  = (uint16_t*)row + dst_x;
+                     unsigned dst_r = (*dst >> 11) & 0x1f;
+                     unsigned dst_g = (*dst >>  5) & 0x3f;
+                     unsigned dst_b = (*dst >>  0) & 0x1f;
+
+                     dst_r = (dst_r << 3) | (dst_r >> 2);
+                     dst_g = (dst_g << 2) | (dst_g >> 4);
+                     dst_b = (dst_b << 3) | (dst_b >> 2);
+
+                     dst_r = (r * src_alpha + dst_r * dst_alpha) >> 8;
+                     dst_g = (g * src_alpha + dst_g * dst_alpha) >> 8;
+                     dst_b = (b * src_alpha + dst_b * dst_alpha) >> 8;
+
+                     *dst  = ((dst_r >> 3) << 11) |
+                        ((dst_g >> 2) << 5) | (dst_b >> 3);
+                  }
+                  break;
+               default:
+                  {
+                     uint32_t *dst      = (uint32_t*)row + dst_x;
+                     uint32_t dst_color = *dst;
+                     unsigned dst_r     = (dst_color >> 16) & 0xff;
+                     unsigned dst_g     = (dst_color >>  8) & 0xff;
+                     unsigned dst_b     = (dst_color >>  0) & 0xff;
+
+                     dst_r = (r * src_alpha + dst_r * dst_alpha) >> 8;
+                     dst_g = (g * src_alpha + dst_g * dst_alpha) >> 8;
+                     dst_b = (b * src_alpha + dst_b * dst_alpha) >> 8;
+
+                     *dst  = (0xffu << 24) | (dst_r << 16) | 
+                        (dst_g << 8) | (dst_b << 0);
+                  }
+                  break;
+            }
+         }
+      }
+   }
+}
+#endif
+
+static void stream_finished(bool *eof, unsigned serial)
+{
+   slock_lock(fifo_lock);
+   if (serial == seek_serial)
+      *eof = true;
+   scond_broadcast(fifo_decode_cond);
+   slock_unlock(fifo_lock);
+}
+
+static void video_frame_push(AVFrame *frame, unsigned serial)
+{
+   struct decoded_frame *f = (struct decoded_frame*)
+      av_mallocz(sizeof(*f));
 
-            dst_r = (r * src_alpha + dst_r * dst_alpha) >> 8;
-            dst_g = (g * src_alpha + dst_g * dst_alpha) >> 8;
-            dst_b = (b * src_alpha + dst_b * dst_alpha) >> 8;
+   if (!f)
+      return;
 
-            dst[x] = (0xffu << 24) | (dst_r << 16) | 
-               (dst_g << 8) | (dst_b << 0);
-         }
+   f->serial = serial;
+
+   if (frame)
+   {
+      f->frame = av_frame_alloc();
+      if (!f->frame)
+      {
+         av_free(f);
+         return;
       }
+      av_frame_move_ref(f->frame, frame);
+   }
+
+   if (!ptr_queue_push(&video_frame_queue, f))
+      decoded_frame_free(f);
+}
+
+static void video_decode_thread(void *data)
+{
+   unsigned serial = 0;
+   void *item      = NULL;
+   AVFrame *frame  = av_frame_alloc();
+
+   (void)data;
+
+   while (frame && ptr_queue_pop(&video_packet_queue, &item, true))
+   {
+      AVPacket pkt;
+      int got_ptr      = 0;
+      struct packet *p = (struct packet*)item;
+
+      if (p->serial != serial)
+      {
+         avcodec_flush_buffers(vctx);
+         serial = p->serial;
+      }
+
+      if (p->eof)
+      {
+         av_init_packet(&pkt);
+         pkt.data = NULL;
+         pkt.size = 0;
+      }
+      else
+         pkt = p->pkt;
+
+      /* With frame threading the decoder holds frames back,
+       * feeding it empty packets at the end drains them. */
+      do
+      {
+         int64_t start = av_gettime();
+
+         got_ptr = 0;
+         if (avcodec_decode_video2(vctx, frame, &got_ptr, &pkt) < 0)
+            break;
+
+         video_decode_stats.busy_us += av_gettime() - start;
+
+         if (got_ptr)
+         {
+            video_decode_stats.frames++;
+            video_frame_push(frame, serial);
+         }
+      } while (p->eof && got_ptr);
+
+      if (p->eof)
+         video_frame_push(NULL, serial);
+
+      packet_free(p);
+   }
+
+   av_frame_free(&frame);
+}
+
+/* Converts rows [y, y + height) of frame into buf. Every slice
+ * keeps its own context, set up as if the slice was an image of
+ * its own, so slices can be converted independently. Returns
+ * whether the input is full range. */
+static bool convert_slice(struct convert_slice *slice,
+      const AVFrame *frame, struct video_buffer *buf)
+{
+   unsigned i;
+   bool full_range;
+   const uint8_t *src[4];
+   uint8_t *dst[4];
+   int dst_stride[4];
+   const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(
+         (enum AVPixelFormat)frame->format);
+
+   if (!slice->height || !desc)
+      return false;
+
+   for (i = 0; i < 4; i++)
+   {
+      unsigned shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+
+      src[i] = frame->data[i]
+         ? frame->data[i] + (slice->y >> shift) * frame->linesize[i]
+         : NULL;
+   }
+
+   video_buffer_planes(buf->data, slice->y, dst, dst_stride);
+
+   slice->sws = sws_getCachedContext(slice->sws,
+         media.width, slice->height, (enum AVPixelFormat)frame->format,
+         media.width, slice->height, output_pix_fmt(),
+         SWS_POINT, NULL, NULL, NULL);
+
+   if (!slice->sws)
+      return false;
+
+   full_range = set_colorspace(slice->sws, buf->color,
+         av_frame_get_color_range(frame));
+   sws_scale(slice->sws, src, frame->linesize,
+         0, slice->height, dst, dst_stride);
+
+   return full_range;
+}
+
+static void convert_slice_thread(void *data)
+{
+   struct convert_slice *slice = (struct convert_slice*)data;
+   unsigned generation         = 0;
+
+   slock_lock(convert_pool.lock);
+
+   for (;;)
+   {
+      while (!convert_pool.quit && convert_pool.generation == generation)
+         scond_wait(convert_pool.cond, convert_pool.lock);
+
+      if (convert_pool.quit)
+         break;
+
+      generation = convert_pool.generation;
+      slock_unlock(convert_pool.lock);
+
+      convert_slice(slice, convert_pool.frame, convert_pool.buf);
+
+      slock_lock(convert_pool.lock);
+      if (--convert_pool.pending == 0)
+         scond_signal(convert_pool.done_cond);
    }
+
+   slock_unlock(convert_pool.lock);
 }
+
+/* One slice per core, but not so thin that the per-slice
+ * overhead wins. Falls back to a single slice if the workers
+ * cannot be started. */
+static void convert_pool_init(void)
+{
+   unsigned i;
+   unsigned count = av_cpu_count();
+
+   memset(&convert_pool, 0, sizeof(convert_pool));
+
+   if (count > MAX_CONVERT_SLICES)
+      count = MAX_CONVERT_SLICES;
+   if (count > media.height / MIN_CONVERT_SLICE_ROWS)
+      count = media.height / MIN_CONVERT_SLICE_ROWS;
+
+   convert_pool.count = 1;
+
+   if (count < 2)
+      return;
+
+   convert_pool.lock      = slock_new();
+   convert_pool.cond      = scond_new();
+   convert_pool.done_cond = scond_new();
+
+   if (!convert_pool.lock || !convert_pool.cond || !convert_pool.done_cond)
+      return;
+
+   for (i = 1; i < count; i++)
+   {
+      convert_pool.slices[i].thread = sthread_create(convert_slice_thread,
+            &convert_pool.slices[i]);
+      if (!convert_pool.slices[i].thread)
+         break;
+      convert_pool.count++;
+   }
+}
+
+static void convert_pool_free(void)
+{
+   unsigned i;
+
+   if (convert_pool.lock)
+   {
+      slock_lock(convert_pool.lock);
+      convert_pool.quit = true;
+      scond_broadcast(convert_pool.cond);
+      slock_unlock(convert_pool.lock);
+   }
+
+   for (i = 0; i < MAX_CONVERT_SLICES; i++)
+   {
+      if (convert_pool.slices[i].thread)
+         sthread_join(convert_pool.slices[i].thread);
+      if (convert_pool.slices[i].sws)
+         sws_freeContext(convert_pool.slices[i].sws);
+   }
+
+   if (convert_pool.done_cond)
+      scond_free(convert_pool.done_cond);
+   if (convert_pool.cond)
+      scond_free(convert_pool.cond);
+   if (convert_pool.lock)
+      slock_free(convert_pool.lock);
+
+   memset(&convert_pool, 0, sizeof(convert_pool));
+}
+
+static void convert_frame(const AVFrame *frame, struct video_buffer *buf)
+{
+   unsigned i, rows;
+   unsigned align                 = 1;
+   unsigned count                 = convert_pool.count;
+   const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(
+         (enum AVPixelFormat)frame->format);
+
+   /* Palette and bitstream formats can't be split by rows. */
+   if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM)))
+      count = 1;
+
+   /* Slices start on a chroma row of both the input and
+    * the YUV420 output. */
+   if (desc)
+      align = 1 << desc->log2_chroma_h;
+   if (output_format == OUTPUT_YUV420 && align < 2)
+      align = 2;
+
+   rows  = (media.height + count - 1) / count;
+   rows  = (rows + align - 1) & ~(align - 1);
+
+   for (i = 0; i < MAX_CONVERT_SLICES; i++)
+   {
+      struct convert_slice *slice = &convert_pool.slices[i];
+
+      slice->y      = MIN(i * rows, media.height);
+      slice->height = i < count
+         ? MIN(rows, media.height - slice->y) : 0;
+   }
+
+   if (convert_pool.count > 1)
+   {
+      slock_lock(convert_pool.lock);
+      convert_pool.frame   = frame;
+      convert_pool.buf     = buf;
+      convert_pool.pending = convert_pool.count - 1;
+      convert_pool.generation++;
+      scond_broadcast(convert_pool.cond);
+      slock_unlock(convert_pool.lock);
+   }
+
+   buf->full_range = convert_slice(&convert_pool.slices[0], frame, buf);
+
+   if (convert_pool.count > 1)
+   {
+      slock_lock(convert_pool.lock);
+      while (convert_pool.pending)
+         scond_wait(convert_pool.done_cond, convert_pool.lock);
+      slock_unlock(convert_pool.lock);
+   }
+}
+
+static void convert_thread(void *data)
+{
+   void *item              = NULL;
+
+   (void)data;
+
+   convert_pool_init();
+
+   while (ptr_queue_pop(&video_frame_queue, &item, true))
+   {
+      int64_t start;
+      struct video_buffer *buf = NULL;
+      struct decoded_frame *f  = (struct decoded_frame*)item;
+      AVFrame *frame           = f->frame;
+#ifdef HAVE_SSA
+      ASS_Track *ass_track_active = NULL;
+#endif
+
+      if (!frame)
+      {
+         stream_finished(&video_eof, f->serial);
+         decoded_frame_free(f);
+         continue;
+      }
+
+      if (!ptr_queue_pop(&video_free_queue, &item, true))
+      {
+         decoded_frame_free(f);
+         break;
+      }
+
+      buf         = (struct video_buffer*)item;
+      buf->pts    = av_frame_get_best_effort_timestamp(frame);
+      buf->serial = f->serial;
+      buf->color  = resolve_colorspace(media.width, media.height,
+            av_frame_get_colorspace(frame));
+
+      start       = av_gettime();
+
+      convert_frame(frame, buf);
+
+#ifdef HAVE_SSA
+      slock_lock(decode_thread_lock);
+      ass_track_active = ass_track[subtitle_streams_ptr];
+      slock_unlock(decode_thread_lock);
+
+      if (ass_render && ass_track_active)
+      {
+         int change        = 0;
+         double video_time = buf->pts *
+            av_q2d(fctx->streams[video_stream]->time_base);
+         ASS_Image *img    = NULL;
+
+         /* Do it on CPU for now.
+          * We're in a thread anyways, so shouldn't really matter. */
+         slock_lock(ass_lock);
+         img = ass_render_frame(ass_render, ass_track_active,
+               1000 * video_time, &change);
+         render_ass_img(buf->data, img);
+         slock_unlock(ass_lock);
+      }
 #endif
 
-static void decode_thread(void *data)
+      convert_stats.busy_us += av_gettime() - start;
+      convert_stats.frames++;
+
+      decoded_frame_free(f);
+
+      if (!ptr_queue_push(&video_ready_queue, buf))
+         break;
+   }
+
+   convert_pool_free();
+}
+
+static void audio_decode_thread(void *data)
 {
    unsigned i;
-   SwrContext *swr[audio_streams_num];
-   AVFrame *aud_frame      = NULL;
-   AVFrame *vid_frame      = NULL;
-   void *conv_frame_buf    = NULL;
-   size_t frame_size       = 0;
+   SwrContext *swr[MAX_STREAMS];
+   unsigned serial         = 0;
+   void *item              = NULL;
    int16_t *audio_buffer   = NULL;
    size_t audio_buffer_cap = 0;
-   AVFrame *conv_frame     = NULL;
-   struct SwsContext *sws  = NULL;
+   AVFrame *frame          = av_frame_alloc();
 
    (void)data;
-   
-   if (video_stream >= 0)
-      sws = sws_getCachedContext(NULL,
-            media.width, media.height, vctx->pix_fmt,
-            media.width, media.height, PIX_FMT_RGB32,
-            SWS_POINT, NULL, NULL, NULL);
 
    for (i = 0; (int)i < audio_streams_num; i++)
    {
@@ -1191,18 +2196,41 @@ static void decode_thread(void *data)
       swr_init(swr[i]);
    }
 
-   aud_frame = av_frame_alloc();
-   vid_frame = av_frame_alloc();
-
-   if (video_stream >= 0)
+   while (frame && ptr_queue_pop(&audio_packet_queue, &item, true))
    {
-      frame_size = avpicture_get_size(PIX_FMT_RGB32, media.width, media.height);
-      conv_frame = av_frame_alloc();
-      conv_frame_buf = av_malloc(frame_size);
-      avpicture_fill((AVPicture*)conv_frame, (const uint8_t*)conv_frame_buf,
-            PIX_FMT_RGB32, media.width, media.height);
+      struct packet *p    = (struct packet*)item;
+      AVCodecContext *ctx = actx[p->stream_ptr];
+
+      if (p->serial != serial)
+      {
+         avcodec_flush_buffers(ctx);
+         serial = p->serial;
+      }
+
+      if (p->eof)
+         stream_finished(&audio_eof, p->serial);
+      else
+         audio_buffer = decode_audio(ctx, &p->pkt, frame,
+               audio_buffer, &audio_buffer_cap,
+               swr[p->stream_ptr], p->stream_ptr, p->serial);
+
+      packet_free(p);
    }
 
+   for (i = 0; (int)i < audio_streams_num; i++)
+      swr_free(&swr[i]);
+
+   av_frame_free(&frame);
+   av_freep(&audio_buffer);
+}
+
+static void demux_thread(void *data)
+{
+   unsigned serial = 0;
+   bool eof        = false;
+
+   (void)data;
+
    while (!decode_thread_dead)
    {
       bool seek;
@@ -1225,22 +2253,57 @@ static void decode_thread(void *data)
       {
          decode_thread_seek(seek_time_thread);
 
+         /* Whatever is still queued was read before the seek. */
+         ptr_queue_flush(&video_packet_queue, packet_free);
+         ptr_queue_flush(&audio_packet_queue, packet_free);
+         ptr_queue_flush(&video_frame_queue, decoded_frame_free);
+
          slock_lock(fifo_lock);
-         do_seek = false;
-         seek_time = 0.0;
+         do_seek                = false;
+         seek_time              = 0.0;
+         serial                 = ++seek_serial;
+         decode_last_video_time = seek_time_thread;
+         decode_last_audio_time = seek_time_thread;
+         video_eof              = video_stream < 0;
+         audio_eof              = audio_streams_num <= 0;
+         eof                    = false;
 
-         if (video_decode_fifo)
-            fifo_clear(video_decode_fifo);
          if (audio_decode_fifo)
             fifo_clear(audio_decode_fifo);
 
          scond_signal(fifo_cond);
+         scond_broadcast(fifo_decode_cond);
+         slock_unlock(fifo_lock);
+      }
+
+      if (eof)
+      {
+         bool finished;
+
+         /* Keep serving seeks until the decoders run dry. */
+         slock_lock(fifo_lock);
+         while (!decode_thread_dead && !do_seek
+               && !(video_eof && audio_eof))
+            scond_wait(fifo_decode_cond, fifo_lock);
+         finished = !do_seek;
          slock_unlock(fifo_lock);
+
+         if (finished)
+            break;
+         continue;
       }
 
       memset(&pkt, 0, sizeof(pkt));
       if (av_read_frame(fctx, &pkt) < 0)
-         break;
+      {
+         eof = true;
+
+         if (video_stream >= 0)
+            packet_push(&video_packet_queue, NULL, serial, 0);
+         if (audio_streams_num > 0)
+            packet_push(&audio_packet_queue, NULL, serial, 0);
+         continue;
+      }
 
       slock_lock(decode_thread_lock);
       audio_stream                = audio_streams[audio_streams_ptr];
@@ -1254,113 +2317,54 @@ static void decode_thread(void *data)
       slock_unlock(decode_thread_lock);
 
       if (pkt.stream_index == video_stream)
+         packet_push(&video_packet_queue, &pkt, serial, 0);
+      else if (pkt.stream_index == audio_stream && actx_active)
+         packet_push(&audio_packet_queue, &pkt, serial, audio_stream_ptr);
+      else
       {
-         if (decode_video(&pkt, vid_frame, conv_frame, sws))
+         if (pkt.stream_index == subtitle_stream && sctx_active)
          {
-            size_t decoded_size;
-            int64_t pts       = av_frame_get_best_effort_timestamp(vid_frame);
-            double video_time = pts * av_q2d(fctx->streams[video_stream]->time_base);
+            AVSubtitle sub;
+            int finished = 0;
 
-#ifdef HAVE_SSA
-            if (ass_render && ass_track_active)
-            {
-               int change     = 0;
-               ASS_Image *img = ass_render_frame(ass_render, ass_track_active,
-                     1000 * video_time, &change);
-
-               /* Do it on CPU for now.
-                * We're in a thread anyways, so shouldn't really matter. */
-               render_ass_img(conv_frame, img);
-            }
-#endif
-
-            decoded_size = frame_size + sizeof(pts);
-            slock_lock(fifo_lock);
+            memset(&sub, 0, sizeof(sub));
 
-            while (!decode_thread_dead  && (video_decode_fifo != NULL)
-                  && fifo_write_avail(video_decode_fifo) < decoded_size)
+            while (!finished)
             {
-               if (!main_sleeping)
-                  scond_wait(fifo_decode_cond, fifo_lock);
-               else
+               if (avcodec_decode_subtitle2(sctx_active, &sub, &finished, &pkt) < 0)
                {
-                  fifo_clear(video_decode_fifo);
+                  log_cb(RETRO_LOG_ERROR, "Decode subtitles failed.\n");
                   break;
                }
             }
 
-            decode_last_video_time = video_time;
-            if (!decode_thread_dead)
-            {
-               int stride;
-               unsigned y;
-               const uint8_t *src = NULL;
-               
-               fifo_write(video_decode_fifo, &pts, sizeof(pts));
-               src    = conv_frame->data[0];
-               stride = conv_frame->linesize[0];
-
-               for (y = 0; y < media.height; y++, src += stride)
-                  fifo_write(video_decode_fifo, src, media.width * sizeof(uint32_t));
-            }
-            scond_signal(fifo_cond);
-            slock_unlock(fifo_lock);
-         }
-      }
-      else if (pkt.stream_index == audio_stream && actx_active)
-      {
-         audio_buffer = decode_audio(actx_active, &pkt, aud_frame,
-               audio_buffer, &audio_buffer_cap,
-               swr[audio_stream_ptr]);
-      }
-      else if (pkt.stream_index == subtitle_stream && sctx_active)
-      {
-         AVSubtitle sub;
-         int finished = 0;
-
-         memset(&sub, 0, sizeof(sub));
-
-         while (!finished)
-         {
-            if (avcodec_decode_subtitle2(sctx_active, &sub, &finished, &pkt) < 0)
+#ifdef HAVE_SSA
+            slock_lock(ass_lock);
             {
-               log_cb(RETRO_LOG_ERROR, "Decode subtitles failed.\n");
-               break;
+               unsigned i;
+               for (i = 0; i < sub.num_rects; i++)
+               {
+                  if (sub.rects[i]->ass && ass_track_active)
+                     ass_process_data(ass_track_active,
+                           sub.rects[i]->ass, strlen(sub.rects[i]->ass));
+               }
             }
-         }
+            slock_unlock(ass_lock);
+#endif
 
-#ifdef HAVE_SSA
-         for (i = 0; i < sub.num_rects; i++)
-         {
-            if (sub.rects[i]->ass && ass_track_active)
-               ass_process_data(ass_track_active,
-                     sub.rects[i]->ass, strlen(sub.rects[i]->ass));
+            avsubtitle_free(&sub);
          }
-#endif
 
-         avsubtitle_free(&sub);
+         av_free_packet(&pkt);
       }
-
-      av_free_packet(&pkt);
    }
 
-   if (sws)
-      sws_freeContext(sws);
-   sws = NULL;
-
-   for (i = 0; (int)i < audio_streams_num; i++)
-      swr_free(&swr[i]);
-
-   av_frame_free(&aud_frame);
-   av_frame_free(&vid_frame);
-   av_frame_free(&conv_frame);
-   av_freep(&conv_frame_buf);
-   av_freep(&audio_buffer);
-
    slock_lock(fifo_lock);
    decode_thread_dead = true;
    scond_signal(fifo_cond);
    slock_unlock(fifo_lock);
+
+   pipeline_abort();
 }
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
@@ -1385,6 +2389,7 @@ static void context_destroy(void)
 #else
 #include "gl_shaders/ffmpeg.glsl.frag.h"
 #endif
+#include "gl_shaders/ffmpeg_yuv.glsl.frag.h"
 
 static void context_reset(void)
 {
@@ -1415,7 +2420,8 @@ static void context_reset(void)
    frag = glCreateShader(GL_FRAGMENT_SHADER);
 
    glShaderSource(vert, 1, &vertex_source, NULL);
-   glShaderSource(frag, 1, &fragment_source, NULL);
+   glShaderSource(frag, 1, output_format == OUTPUT_YUV420
+         ? &fragment_yuv_source : &fragment_source, NULL);
    glCompileShader(vert);
    glCompileShader(frag);
    glAttachShader(prog, vert);
@@ -1426,27 +2432,38 @@ static void context_reset(void)
 
    glUniform1i(glGetUniformLocation(prog, "sTex0"), 0);
    glUniform1i(glGetUniformLocation(prog, "sTex1"), 1);
-   vertex_loc = glGetAttribLocation(prog, "aVertex");
-   tex_loc    = glGetAttribLocation(prog, "aTexCoord");
-   mix_loc    = glGetUniformLocation(prog, "uMix");
+   glUniform1i(glGetUniformLocation(prog, "sTexU0"), 2);
+   glUniform1i(glGetUniformLocation(prog, "sTexV0"), 3);
+   glUniform1i(glGetUniformLocation(prog, "sTexU1"), 4);
+   glUniform1i(glGetUniformLocation(prog, "sTexV1"), 5);
+   vertex_loc     = glGetAttribLocation(prog, "aVertex");
+   tex_loc        = glGetAttribLocation(prog, "aTexCoord");
+   mix_loc        = glGetUniformLocation(prog, "uMix");
+   yuv_matrix_loc = glGetUniformLocation(prog, "uYuvMatrix");
+   yuv_offset_loc = glGetUniformLocation(prog, "uYuvOffset");
 
    glUseProgram(0);
 
    for (i = 0; i < 2; i++)
    {
-      glGenTextures(1, &frames[i].tex);
+      unsigned j;
 
-      glBindTexture(GL_TEXTURE_2D, frames[i].tex);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glGenTextures(3, frames[i].tex);
+
+      for (j = 0; j < 3; j++)
+      {
+         glBindTexture(GL_TEXTURE_2D, frames[i].tex[j]);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      }
 
 #if !defined(HAVE_OPENGLES)
       glGenBuffers(1, &frames[i].pbo);
       glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[i].pbo);
-      glBufferData(GL_PIXEL_UNPACK_BUFFER, media.width 
-            * media.height * sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, video_buffer_size(),
+            NULL, GL_STREAM_DRAW);
       glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 #endif
    }
@@ -1465,15 +2482,31 @@ void CORE_PREFIX(retro_unload_game)(void)
 {
    unsigned i;
 
-   if (decode_thread_handle)
+   if (demux_thread_handle)
    {
       slock_lock(fifo_lock);
       decode_thread_dead = true;
-      scond_signal(fifo_decode_cond);
+      scond_broadcast(fifo_decode_cond);
       slock_unlock(fifo_lock);
-      sthread_join(decode_thread_handle);
    }
-   decode_thread_handle = NULL;
+
+   pipeline_abort();
+
+   if (demux_thread_handle)
+      sthread_join(demux_thread_handle);
+   if (video_decode_thread_handle)
+      sthread_join(video_decode_thread_handle);
+   if (convert_thread_handle)
+      sthread_join(convert_thread_handle);
+   if (audio_decode_thread_handle)
+      sthread_join(audio_decode_thread_handle);
+   demux_thread_handle        = NULL;
+   video_decode_thread_handle = NULL;
+   convert_thread_handle      = NULL;
+   audio_decode_thread_handle = NULL;
+
+   log_stage_stats("Video decode", &video_decode_stats);
+   log_stage_stats("Video convert", &convert_stats);
 
    if (fifo_cond)
       scond_free(fifo_cond);
@@ -1483,9 +2516,22 @@ void CORE_PREFIX(retro_unload_game)(void)
       slock_free(fifo_lock);
    if (decode_thread_lock)
       slock_free(decode_thread_lock);
+#ifdef HAVE_SSA
+   if (ass_lock)
+      slock_free(ass_lock);
+   ass_lock = NULL;
+#endif
+
+   ptr_queue_free(&video_packet_queue, packet_free);
+   ptr_queue_free(&audio_packet_queue, packet_free);
+   ptr_queue_free(&video_frame_queue, decoded_frame_free);
+   ptr_queue_free(&video_ready_queue, NULL);
+   ptr_queue_free(&video_free_queue, NULL);
+
+   for (i = 0; i < VIDEO_BUFFER_COUNT; i++)
+      av_freep(&video_buffers[i].data);
+   video_buffer_shown = NULL;
 
-   if (video_decode_fifo)
-      fifo_free(video_decode_fifo);
    if (audio_decode_fifo)
       fifo_free(audio_decode_fifo);
 
@@ -1493,8 +2539,8 @@ void CORE_PREFIX(retro_unload_game)(void)
    fifo_decode_cond = NULL;
    fifo_lock = NULL;
    decode_thread_lock = NULL;
-   video_decode_fifo = NULL;
    audio_decode_fifo = NULL;
+   seek_serial = 0;
 
    decode_last_video_time = 0.0;
    decode_last_audio_time = 0.0;
@@ -1549,8 +2595,27 @@ void CORE_PREFIX(retro_unload_game)(void)
    ass_render = NULL;
    ass = NULL;
 #endif
+}
+
+static bool init_video_pipeline(void)
+{
+   unsigned i;
+
+   if (     !ptr_queue_init(&video_packet_queue, VIDEO_PACKET_QUEUE_SIZE)
+         || !ptr_queue_init(&video_frame_queue, VIDEO_FRAME_QUEUE_SIZE)
+         || !ptr_queue_init(&video_ready_queue, VIDEO_BUFFER_COUNT)
+         || !ptr_queue_init(&video_free_queue, VIDEO_BUFFER_COUNT))
+      return false;
 
-   av_freep(&video_frame_temp_buffer);
+   for (i = 0; i < VIDEO_BUFFER_COUNT; i++)
+   {
+      video_buffers[i].data = (uint8_t*)av_malloc(video_buffer_size());
+      if (!video_buffers[i].data)
+         return false;
+      video_buffer_release(&video_buffers[i]);
+   }
+
+   return true;
 }
 
 bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
@@ -1573,6 +2638,10 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
 
    CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, desc);
 
+   check_output_format();
+   if (output_format == OUTPUT_RGB565)
+      fmt = RETRO_PIXEL_FORMAT_RGB565;
+
    if (!CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
    {
       LOG_ERR("Cannot set pixel format.");
@@ -1611,9 +2680,6 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
 
    if (video_stream >= 0 || is_fft)
    {
-      video_decode_fifo = fifo_new(media.width 
-            * media.height * sizeof(uint32_t) * 32);
-
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
       use_gl = true;
       hw_render.context_reset      = context_reset;
@@ -1631,28 +2697,56 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
          use_gl = false;
          LOG_ERR("Cannot initialize HW render.");
       }
+
+      /* Without a hardware context there is no shader to do the
+       * conversion, and XRGB8888 was what got set above. */
+      if (!use_gl && output_format == OUTPUT_YUV420)
+         output_format = OUTPUT_XRGB8888;
 #endif
    }
+
+   if (video_stream >= 0 && !init_video_pipeline())
+   {
+      LOG_ERR("Failed to init video pipeline.");
+      goto error;
+   }
+
    if (audio_streams_num > 0)
    {
       unsigned buffer_seconds = video_stream >= 0 ? 20 : 1;
       audio_decode_fifo = fifo_new(buffer_seconds * media.sample_rate * sizeof(int16_t) * 2);
+
+      if (!ptr_queue_init(&audio_packet_queue, AUDIO_PACKET_QUEUE_SIZE))
+      {
+         LOG_ERR("Failed to init audio pipeline.");
+         goto error;
+      }
    }
 
    fifo_cond        = scond_new();
    fifo_decode_cond = scond_new();
    fifo_lock        = slock_new();
+#ifdef HAVE_SSA
+   ass_lock         = slock_new();
+#endif
 
    slock_lock(fifo_lock);
    decode_thread_dead = false;
+   seek_serial        = 0;
+   video_eof          = video_stream < 0;
+   audio_eof          = audio_streams_num <= 0;
    slock_unlock(fifo_lock);
 
    check_variables();
 
-   decode_thread_handle = sthread_create(decode_thread, NULL);
-
-   video_frame_temp_buffer = (uint32_t*)
-      av_malloc(media.width * media.height * sizeof(uint32_t));
+   if (video_stream >= 0)
+   {
+      video_decode_thread_handle = sthread_create(video_decode_thread, NULL);
+      convert_thread_handle      = sthread_create(convert_thread, NULL);
+   }
+   if (audio_streams_num > 0)
+      audio_decode_thread_handle = sthread_create(audio_decode_thread, NULL);
+   demux_thread_handle = sthread_create(demux_thread, NULL);
 
    pts_bias = 0.0;
 
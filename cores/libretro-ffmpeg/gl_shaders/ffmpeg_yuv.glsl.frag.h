@@ -0,0 +1,23 @@
+#include "shaders_common.h"
+
+static const char *fragment_yuv_source = GLSL(
+      varying vec2 vTex;
+      uniform sampler2D sTex0;
+      uniform sampler2D sTex1;
+      uniform sampler2D sTexU0;
+      uniform sampler2D sTexV0;
+      uniform sampler2D sTexU1;
+      uniform sampler2D sTexV1;
+      uniform mat3 uYuvMatrix;
+      uniform vec3 uYuvOffset;
+      uniform float uMix;
+
+      vec3 yuv_to_rgb(sampler2D y, sampler2D u, sampler2D v) {
+         vec3 yuv = vec3(texture2D(y, vTex).r, texture2D(u, vTex).r, texture2D(v, vTex).r);
+         return clamp(uYuvMatrix * (yuv - uYuvOffset), 0.0, 1.0);
+      }
+
+      void main() {
+         gl_FragColor = vec4(pow(mix(pow(yuv_to_rgb(sTex0, sTexU0, sTexV0), vec3(2.2)), pow(yuv_to_rgb(sTex1, sTexU1, sTexV1), vec3(2.2)), uMix), vec3(1.0 / 2.2)), 1.0);
+      }
+);
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <compat/strl.h>
 #include <retro_endianness.h>
@@ -217,10 +218,7 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       return -1;
 
    if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
       return 1;
-   }
 
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
@@ -340,7 +338,14 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
             db_info->size                    = (unsigned)val->val.uint_;
             break;
          case DB_CURSOR_CHECKSUM_CRC32:
-            db_info->crc32 = swap_if_little32(*(uint32_t*)val->val.binary.buff);
+            /* The buffer points into the document as read, so it needn't
+             * be aligned for a uint32_t */
+            if (val->val.binary.len >= sizeof(uint32_t))
+            {
+               uint32_t crc32;
+               memcpy(&crc32, val->val.binary.buff, sizeof(crc32));
+               db_info->crc32 = swap_if_little32(crc32);
+            }
             break;
          case DB_CURSOR_CHECKSUM_SHA1:
             db_info->sha1 = bin_to_hex_alloc((uint8_t*)val->val.binary.buff, val->val.binary.len);
@@ -354,8 +359,6 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       }
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
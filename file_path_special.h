@@ -42,6 +42,7 @@ enum file_path_enum
    FILE_PATH_TTF_FONT,
    FILE_PATH_MAIN_CONFIG,
    FILE_PATH_CORE_OPTIONS_CONFIG,
+   FILE_PATH_CORE_INFO_CACHE,
    FILE_PATH_ASSETS_ZIP,
    FILE_PATH_AUTOCONFIG_ZIP,
    FILE_PATH_CORE_INFO_ZIP,
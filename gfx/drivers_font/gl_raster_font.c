@@ -20,6 +20,7 @@
 #include <encodings/utf.h>
 #include <string/stdstring.h>
 #include <retro_math.h>
+#include <retro_miscellaneous.h>
 
 #include "../common/gl_common.h"
 #include "../font_driver.h"
@@ -47,6 +48,7 @@ typedef struct
    gl_t *gl;
    GLuint tex;
    unsigned tex_width, tex_height;
+   bool tex_resized;
 
    const font_renderer_driver_t *font_driver;
    void *font_data;
@@ -108,13 +110,9 @@ static bool gl_raster_font_upload_atlas_components_4(gl_raster_t *font)
 }
 #endif
 
-static bool gl_raster_font_upload_atlas(gl_raster_t *font)
+static size_t gl_raster_font_get_format(gl_raster_t *font,
+      GLint *gl_internal, GLenum *gl_format)
 {
-   unsigned i, j;
-   GLint  gl_internal                   = GL_LUMINANCE_ALPHA;
-   GLenum gl_format                     = GL_LUMINANCE_ALPHA;
-   size_t ncomponents                   = 2;
-   uint8_t       *tmp                   = NULL;
 #if defined(GL_VERSION_3_0)
    struct retro_hw_render_callback *hwr = video_driver_get_hw_context();
 
@@ -122,42 +120,75 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
         (hwr->context_type == RETRO_HW_CONTEXT_OPENGL &&
          hwr->version_major >= 3))
    {
-      GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
-      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
-
-      gl_internal = GL_R8;
-      gl_format   = GL_RED;
-      ncomponents = 1;
+      *gl_internal = GL_R8;
+      *gl_format   = GL_RED;
+      return 1;
    }
 #endif
 
-   tmp = (uint8_t*)calloc(font->tex_height, font->tex_width * ncomponents);
+   *gl_internal    = GL_LUMINANCE_ALPHA;
+   *gl_format      = GL_LUMINANCE_ALPHA;
+   return 2;
+}
+
+/* Converts a part of the atlas to the texture format,
+ * @pitch is in texels. */
+static void gl_raster_font_convert_atlas(gl_raster_t *font,
+      uint8_t *dst, unsigned pitch, size_t ncomponents,
+      unsigned x, unsigned y, unsigned width, unsigned height)
+{
+   unsigned i, j;
 
    switch (ncomponents)
    {
       case 1:
-         for (i = 0; i < font->atlas->height; ++i)
+         for (i = 0; i < height; ++i)
          {
-            const uint8_t *src = &font->atlas->buffer[i * font->atlas->width];
-            uint8_t       *dst = &tmp[i * font->tex_width * ncomponents];
+            const uint8_t *src = &font->atlas->buffer[(y + i) * font->atlas->width + x];
+            uint8_t       *row = &dst[i * pitch * ncomponents];
 
-            memcpy(dst, src, font->atlas->width);
+            memcpy(row, src, width);
          }
          break;
       case 2:
-         for (i = 0; i < font->atlas->height; ++i)
+         for (i = 0; i < height; ++i)
          {
-            const uint8_t *src = &font->atlas->buffer[i * font->atlas->width];
-            uint8_t       *dst = &tmp[i * font->tex_width * ncomponents];
+            const uint8_t *src = &font->atlas->buffer[(y + i) * font->atlas->width + x];
+            uint8_t       *row = &dst[i * pitch * ncomponents];
 
-            for (j = 0; j < font->atlas->width; ++j)
+            for (j = 0; j < width; ++j)
             {
-               *dst++ = 0xff;
-               *dst++ = *src++;
+               *row++ = 0xff;
+               *row++ = *src++;
             }
          }
          break;
    }
+}
+
+static bool gl_raster_font_upload_atlas(gl_raster_t *font)
+{
+   GLint  gl_internal;
+   GLenum gl_format;
+   uint8_t       *tmp                   = NULL;
+   size_t ncomponents                   = gl_raster_font_get_format(font,
+         &gl_internal, &gl_format);
+
+#if defined(GL_VERSION_3_0)
+   if (ncomponents == 1)
+   {
+      GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+   }
+#endif
+
+   tmp = (uint8_t*)calloc(font->tex_height, font->tex_width * ncomponents);
+
+   if (!tmp)
+      return false;
+
+   gl_raster_font_convert_atlas(font, tmp, font->tex_width, ncomponents,
+         0, 0, font->atlas->width, font->atlas->height);
 
    glTexImage2D(GL_TEXTURE_2D, 0, gl_internal, font->tex_width, font->tex_height,
          0, gl_format, GL_UNSIGNED_BYTE, tmp);
@@ -167,6 +198,80 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
    return true;
 }
 
+/* Uploads only the area the font renderer marked dirty,
+ * falls back to the whole atlas if it doesn't track it. */
+static bool gl_raster_font_upload_atlas_dirty(gl_raster_t *font)
+{
+   GLint  gl_internal;
+   GLenum gl_format;
+   size_t ncomponents;
+   uint8_t *tmp    = NULL;
+   unsigned width  = font->atlas->dirty_width;
+   unsigned height = font->atlas->dirty_height;
+
+   if (font->tex_resized || !width || !height)
+      return gl_raster_font_upload_atlas(font);
+
+   ncomponents = gl_raster_font_get_format(font, &gl_internal, &gl_format);
+   tmp         = (uint8_t*)malloc(width * height * ncomponents);
+
+   if (!tmp)
+      return gl_raster_font_upload_atlas(font);
+
+   gl_raster_font_convert_atlas(font, tmp, width, ncomponents,
+         font->atlas->dirty_x, font->atlas->dirty_y, width, height);
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexSubImage2D(GL_TEXTURE_2D, 0,
+         font->atlas->dirty_x, font->atlas->dirty_y, width, height,
+         gl_format, GL_UNSIGNED_BYTE, tmp);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   free(tmp);
+
+   return true;
+}
+
+/* Follows the renderer growing its atlas. Texture coordinates emitted
+ * so far, in @tex_coords and the bound block, are rescaled to the new
+ * texture size, glyphs keep their atlas offsets. */
+static void gl_raster_font_resize_texture(gl_raster_t *font,
+      GLfloat *tex_coords, unsigned vertices)
+{
+   unsigned i;
+   GLfloat scale_x;
+   GLfloat scale_y;
+   unsigned tex_width  = next_pow2(font->atlas->width);
+   unsigned tex_height = next_pow2(font->atlas->height);
+
+   if (tex_width == font->tex_width && tex_height == font->tex_height)
+      return;
+
+   scale_x = (GLfloat)font->tex_width  / tex_width;
+   scale_y = (GLfloat)font->tex_height / tex_height;
+
+   for (i = 0; i < vertices; i++)
+   {
+      tex_coords[2 * i + 0] *= scale_x;
+      tex_coords[2 * i + 1] *= scale_y;
+   }
+
+   if (font->block)
+   {
+      GLfloat *block_coords = (GLfloat*)font->block->carr.coords.tex_coord;
+
+      for (i = 0; i < font->block->carr.coords.vertices; i++)
+      {
+         block_coords[2 * i + 0] *= scale_x;
+         block_coords[2 * i + 1] *= scale_y;
+      }
+   }
+
+   font->tex_width   = tex_width;
+   font->tex_height  = tex_height;
+   font->tex_resized = true;
+}
+
 static void *gl_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -194,6 +299,16 @@ static void *gl_raster_font_init_font(void *data,
    gl_bind_texture(font->tex, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
 
    font->atlas      = font->font_driver->get_atlas(font->font_data);
+
+   {
+      GLint max_size = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+      /* Let the renderer grow the atlas instead of evicting glyphs */
+      font->atlas->max_width  = MIN(max_size, 4096);
+      font->atlas->max_height = MIN(max_size, 4096);
+   }
+
    font->tex_width  = next_pow2(font->atlas->width);
    font->tex_height = next_pow2(font->atlas->height);
 
@@ -251,8 +366,11 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font, const video_coords_t
 
    if (font->atlas->dirty)
    {
-      gl_raster_font_upload_atlas(font);
+      /* Glyphs may have been added outside of render_line */
+      gl_raster_font_resize_texture(font, NULL, 0);
+      gl_raster_font_upload_atlas_dirty(font);
       font->atlas->dirty   = false;
+      font->tex_resized    = false;
    }
 
    coords_data.handle_data = NULL;
@@ -315,6 +433,13 @@ static void gl_raster_font_render_line(
          if (!glyph)
             continue;
 
+         if (font->atlas->dirty)
+         {
+            gl_raster_font_resize_texture(font, font_tex_coords, i * 6);
+            inv_tex_size_x = 1.0f / font->tex_width;
+            inv_tex_size_y = 1.0f / font->tex_height;
+         }
+
          off_x  = glyph->draw_offset_x;
          off_y  = glyph->draw_offset_y;
          tex_x  = glyph->atlas_offset_x;
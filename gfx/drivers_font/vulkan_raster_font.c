@@ -103,16 +103,31 @@ static void vulkan_raster_font_free_font(void *data, bool is_threaded)
    free(font);
 }
 
-static INLINE void vulkan_raster_font_update_glyph(vulkan_raster_t *font, const struct font_glyph *glyph)
+/* Copies the area the font renderer changed to the staging texture.
+ * The atlas never grows here, as the texture is not re-created. */
+static INLINE void vulkan_raster_font_update_atlas(vulkan_raster_t *font)
 {
    if(font->atlas->dirty)
    {
-      int row;
-      for(row = glyph->atlas_offset_y; row < (glyph->atlas_offset_y + glyph->height); row++)
+      unsigned row;
+      unsigned x      = font->atlas->dirty_x;
+      unsigned y      = font->atlas->dirty_y;
+      unsigned width  = font->atlas->dirty_width;
+      unsigned height = font->atlas->dirty_height;
+
+      if (!width || !height)
+      {
+         x      = 0;
+         y      = 0;
+         width  = font->atlas->width;
+         height = font->atlas->height;
+      }
+
+      for(row = y; row < y + height; row++)
       {
-         uint8_t* src = font->atlas->buffer + row * font->atlas->width + glyph->atlas_offset_x;
-         uint8_t* dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + glyph->atlas_offset_x;
-         memcpy(dst, src, glyph->width);
+         uint8_t* src = font->atlas->buffer + row * font->atlas->width + x;
+         uint8_t* dst = (uint8_t*)font->texture.mapped + row * font->texture.stride + x;
+         memcpy(dst, src, width);
       }
 
       font->atlas->dirty = false;
@@ -141,7 +156,7 @@ static int vulkan_get_message_width(void *data, const char *msg,
 
       if (glyph)
       {
-         vulkan_raster_font_update_glyph(font, glyph);
+         vulkan_raster_font_update_atlas(font);
          delta_x += glyph->advance_x;
       }
    }
@@ -193,7 +208,7 @@ static void vulkan_raster_font_render_line(
       if (!glyph)
          continue;
 
-      vulkan_raster_font_update_glyph(font, glyph);
+      vulkan_raster_font_update_atlas(font);
 
       off_x  = glyph->draw_offset_x;
       off_y  = glyph->draw_offset_y;
@@ -430,7 +445,7 @@ static const struct font_glyph *vulkan_raster_font_get_glyph(
    glyph = font->font_driver->get_glyph((void*)font->font_driver, code);
 
    if(glyph)
-      vulkan_raster_font_update_glyph(font, glyph);
+      vulkan_raster_font_update_atlas(font);
 
    return glyph;
 }
@@ -14,7 +14,8 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <file/file_path.h>
 #include <streams/file_stream.h>
@@ -40,16 +41,40 @@
 
 #define STB_UNICODE_ATLAS_ROWS 16
 #define STB_UNICODE_ATLAS_COLS 16
-#define STB_UNICODE_ATLAS_SIZE (STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS)
+
+/* Number of hash buckets glyphs are looked up in */
+#define STB_UNICODE_MAP_SIZE 0x400
+
+/* Glyph slots are allocated this many at a time and never moved,
+ * so the glyphs handed out stay valid. */
+#define STB_UNICODE_SLOT_BLOCK_SIZE 256
+
+/* Texels left empty right of and below each glyph,
+ * so linear filtering doesn't pick up the next one. */
+#define STB_UNICODE_ATLAS_PADDING 1
 
 typedef struct stb_unicode_atlas_slot
 {
    struct font_glyph glyph;
    unsigned charcode;
-   unsigned last_used;
    struct stb_unicode_atlas_slot* next;
 }stb_unicode_atlas_slot_t;
 
+typedef struct stb_unicode_slot_block
+{
+   stb_unicode_atlas_slot_t slots[STB_UNICODE_SLOT_BLOCK_SIZE];
+   struct stb_unicode_slot_block* next;
+}stb_unicode_slot_block_t;
+
+/* Glyphs are packed left to right into shelves,
+ * which are stacked top to bottom in the atlas. */
+typedef struct
+{
+   unsigned y;
+   unsigned height;
+   unsigned used;
+}stb_unicode_atlas_shelf_t;
+
 typedef struct
 {
    uint8_t *font_data;
@@ -61,9 +86,16 @@ typedef struct
    float scale_factor;
 
    struct font_atlas atlas;
-   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
-   stb_unicode_atlas_slot_t* uc_map[0x100];
-   unsigned usage_counter;
+
+   stb_unicode_atlas_shelf_t *shelves;
+   unsigned shelf_count;
+   unsigned shelf_capacity;
+   unsigned shelf_bottom;
+
+   stb_unicode_slot_block_t *slot_blocks;
+   stb_unicode_slot_block_t *slot_block;
+   unsigned slot_block_used;
+   stb_unicode_atlas_slot_t* uc_map[STB_UNICODE_MAP_SIZE];
 } stb_unicode_font_renderer_t;
 
 static struct font_atlas *font_renderer_stb_unicode_get_atlas(void *data)
@@ -76,34 +108,171 @@ static void font_renderer_stb_unicode_free(void *data)
 {
    stb_unicode_font_renderer_t *self = (stb_unicode_font_renderer_t*)data;
 
+   while (self->slot_blocks)
+   {
+      stb_unicode_slot_block_t *next = self->slot_blocks->next;
+      free(self->slot_blocks);
+      self->slot_blocks = next;
+   }
+
+   free(self->shelves);
    free(self->atlas.buffer);
    free(self->font_data);
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
+static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(
+      stb_unicode_font_renderer_t *handle)
 {
-   int i, map_id;
-   unsigned oldest = 0;
-
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
-
-   /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if(handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
-   else if (handle->uc_map[map_id])
+   stb_unicode_slot_block_t *block = handle->slot_block;
+
+   if (!block || handle->slot_block_used == STB_UNICODE_SLOT_BLOCK_SIZE)
    {
-      stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while(ptr->next && ptr->next != &handle->atlas_slots[oldest])
-         ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
+      /* Blocks are kept around when the atlas is cleared */
+      if (block && block->next)
+         block = block->next;
+      else if (!block && handle->slot_blocks)
+         block = handle->slot_blocks;
+      else
+      {
+         stb_unicode_slot_block_t *new_block = (stb_unicode_slot_block_t*)
+            calloc(1, sizeof(*new_block));
+
+         if (!new_block)
+            return NULL;
+
+         if (block)
+            block->next         = new_block;
+         else
+            handle->slot_blocks = new_block;
+         block                  = new_block;
+      }
+
+      handle->slot_block      = block;
+      handle->slot_block_used = 0;
    }
 
-   return &handle->atlas_slots[oldest];
+   return &block->slots[handle->slot_block_used++];
+}
+
+static bool font_renderer_stb_unicode_pack(
+      stb_unicode_font_renderer_t *handle, unsigned width, unsigned height,
+      unsigned *x, unsigned *y)
+{
+   unsigned i;
+   stb_unicode_atlas_shelf_t *shelf = NULL;
+   stb_unicode_atlas_shelf_t *loose = NULL;
+
+   width  += STB_UNICODE_ATLAS_PADDING;
+   height += STB_UNICODE_ATLAS_PADDING;
+
+   /* Prefer the lowest shelf that isn't much taller than the glyph */
+   for (i = 0; i < handle->shelf_count; i++)
+   {
+      stb_unicode_atlas_shelf_t *s = &handle->shelves[i];
+
+      if (s->height < height || s->used + width > handle->atlas.width)
+         continue;
+
+      if (2 * s->height <= 3 * height)
+      {
+         if (!shelf || s->height < shelf->height)
+            shelf = s;
+      }
+      else if (!loose || s->height < loose->height)
+         loose = s;
+   }
+
+   if (!shelf && handle->shelf_bottom + height <= handle->atlas.height
+         && width <= handle->atlas.width)
+   {
+      if (handle->shelf_count == handle->shelf_capacity)
+      {
+         unsigned capacity = handle->shelf_capacity
+            ? handle->shelf_capacity * 2 : 32;
+         stb_unicode_atlas_shelf_t *shelves = (stb_unicode_atlas_shelf_t*)
+            realloc(handle->shelves, capacity * sizeof(*shelves));
+
+         if (!shelves)
+            return false;
+
+         handle->shelves        = shelves;
+         handle->shelf_capacity = capacity;
+      }
+
+      shelf                 = &handle->shelves[handle->shelf_count++];
+      shelf->y              = handle->shelf_bottom;
+      shelf->height         = height;
+      shelf->used           = 0;
+      handle->shelf_bottom += height;
+   }
+
+   if (!shelf)
+      shelf = loose;
+   if (!shelf)
+      return false;
+
+   *x            = shelf->used;
+   *y            = shelf->y;
+   shelf->used  += width;
+   return true;
+}
+
+/* Doubles the smaller side of the atlas, as far as the font driver
+ * allows. Glyphs keep their offsets, the new area is to the right
+ * of the shelves or below them. */
+static bool font_renderer_stb_unicode_grow(stb_unicode_font_renderer_t *handle)
+{
+   unsigned y;
+   uint8_t *buffer;
+   struct font_atlas *atlas = &handle->atlas;
+   unsigned width           = atlas->width;
+   unsigned height          = atlas->height;
+
+   if (height <= width && height < atlas->max_height)
+      height = MIN(height * 2, atlas->max_height);
+   else if (width < atlas->max_width)
+      width  = MIN(width * 2, atlas->max_width);
+   else if (height < atlas->max_height)
+      height = MIN(height * 2, atlas->max_height);
+   else
+      return false;
+
+   buffer = (uint8_t*)calloc(width * height, 1);
+
+   if (!buffer)
+      return false;
+
+   for (y = 0; y < atlas->height; y++)
+      memcpy(buffer + y * width,
+            atlas->buffer + y * atlas->width, atlas->width);
+
+   free(atlas->buffer);
+   atlas->buffer = buffer;
+   atlas->width  = width;
+   atlas->height = height;
+
+   /* The font driver has to re-create its texture anyway */
+   atlas->dirty  = false;
+   font_atlas_mark_dirty(atlas, 0, 0, atlas->width, atlas->height);
+   return true;
+}
+
+/* Drops every glyph once the atlas can't grow any further. */
+static void font_renderer_stb_unicode_clear(stb_unicode_font_renderer_t *handle)
+{
+   struct font_atlas *atlas = &handle->atlas;
+
+   memset(handle->uc_map, 0, sizeof(handle->uc_map));
+   memset(atlas->buffer, 0, atlas->width * atlas->height);
+
+   handle->shelf_count     = 0;
+   handle->shelf_bottom    = 0;
+   handle->slot_block      = NULL;
+   handle->slot_block_used = 0;
+
+   atlas->dirty            = false;
+   font_atlas_mark_dirty(atlas, 0, 0, atlas->width, atlas->height);
 }
 
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
@@ -111,66 +280,94 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
 {
    int glyph_index                      = 0;
    int x0                               = 0;
+   int y0                               = 0;
+   int x1                               = 0;
    int y1                               = 0;
    int advance_width                    = 0;
    int left_side_bearing                = 0;
+   unsigned width                       = 0;
+   unsigned height                      = 0;
+   unsigned atlas_x                     = 0;
+   unsigned atlas_y                     = 0;
    unsigned map_id                      = 0;
-   uint8_t *dst                         = NULL;
    stb_unicode_atlas_slot_t* atlas_slot = NULL;
    stb_unicode_font_renderer_t *self    = (stb_unicode_font_renderer_t*)data;
 
    if(!self)
       return NULL;
 
-   map_id                               = charcode & 0xFF;
+   map_id                               = charcode & (STB_UNICODE_MAP_SIZE - 1);
    atlas_slot                           = self->uc_map[map_id];
 
    while(atlas_slot)
    {
       if(atlas_slot->charcode == charcode)
-      {
-         atlas_slot->last_used = self->usage_counter++;
          return &atlas_slot->glyph;
-      }
       atlas_slot = atlas_slot->next;
    }
 
-   atlas_slot             = font_renderer_stb_unicode_get_slot(self);
+   glyph_index = stbtt_FindGlyphIndex(&self->info, charcode);
+
+   stbtt_GetGlyphBitmapBox(&self->info, glyph_index,
+         self->scale_factor, self->scale_factor, &x0, &y0, &x1, &y1);
+
+   /* Blank glyphs don't take any space */
+   if (x1 > x0 && y1 > y0)
+   {
+      width  = x1 - x0;
+      height = y1 - y0;
+
+      while (!font_renderer_stb_unicode_pack(self,
+               width, height, &atlas_x, &atlas_y))
+      {
+         if (font_renderer_stb_unicode_grow(self))
+            continue;
+
+         /* Already cleared, the glyph is larger than the atlas */
+         if (!self->shelf_count)
+            return NULL;
+
+         font_renderer_stb_unicode_clear(self);
+      }
+   }
+
+   if (!(atlas_slot = font_renderer_stb_unicode_get_slot(self)))
+      return NULL;
+
    atlas_slot->charcode   = charcode;
    atlas_slot->next       = self->uc_map[map_id];
-   self->uc_map[map_id] = atlas_slot;
-
-   glyph_index              = stbtt_FindGlyphIndex(&self->info, charcode);
+   self->uc_map[map_id]   = atlas_slot;
 
-   dst = (uint8_t*)self->atlas.buffer + atlas_slot->glyph.atlas_offset_x
-         + atlas_slot->glyph.atlas_offset_y * self->atlas.width;
+   if (width)
+   {
+      uint8_t *dst = (uint8_t*)self->atlas.buffer + atlas_x
+         + atlas_y * self->atlas.width;
 
+      stbtt_MakeGlyphBitmap(&self->info, dst, width, height,
+            self->atlas.width, self->scale_factor, self->scale_factor,
+            glyph_index);
 
-   stbtt_MakeGlyphBitmap(&self->info, dst, self->max_glyph_width, self->max_glyph_height,
-         self->atlas.width, self->scale_factor, self->scale_factor, glyph_index);
+      font_atlas_mark_dirty(&self->atlas, atlas_x, atlas_y, width, height);
+   }
 
    stbtt_GetGlyphHMetrics(&self->info, glyph_index, &advance_width, &left_side_bearing);
-   stbtt_GetGlyphBox(&self->info, glyph_index, &x0, NULL, NULL, &y1);
 
-   atlas_slot->glyph.width          = self->max_glyph_width;
-   atlas_slot->glyph.height         = self->max_glyph_height;
+   atlas_slot->glyph.atlas_offset_x = atlas_x;
+   atlas_slot->glyph.atlas_offset_y = atlas_y;
+   atlas_slot->glyph.width          = width;
+   atlas_slot->glyph.height         = height;
    atlas_slot->glyph.advance_x      = advance_width * self->scale_factor;
-   /* atlas_slot->glyph.advance_y   = 0 ; */
-   atlas_slot->glyph.draw_offset_x  = x0 * self->scale_factor;
-   atlas_slot->glyph.draw_offset_y  = -y1 * self->scale_factor;
-
+   atlas_slot->glyph.advance_y      = 0;
+   atlas_slot->glyph.draw_offset_x  = x0;
+   atlas_slot->glyph.draw_offset_y  = y0;
 
-   self->atlas.dirty = true;
-   atlas_slot->last_used = self->usage_counter++;
    return &atlas_slot->glyph;
-
 }
 
 static bool font_renderer_stb_unicode_create_atlas(
       stb_unicode_font_renderer_t *self, float font_size)
 {
-   unsigned i, x, y;
-   stb_unicode_atlas_slot_t* slot = NULL;
+   unsigned i;
 
    self->max_glyph_width  = font_size < 0 ? -font_size : font_size;
    self->max_glyph_height = font_size < 0 ? -font_size : font_size;
@@ -184,27 +381,9 @@ static bool font_renderer_stb_unicode_create_atlas(
    if (!self->atlas.buffer)
       return false;
 
-   slot = self->atlas_slots;
-
-   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
-   {
-      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++)
-      {
-         slot->glyph.atlas_offset_x = x * self->max_glyph_width;
-         slot->glyph.atlas_offset_y = y * self->max_glyph_height;
-         slot++;
-      }
-   }
-
    for (i = 0; i < 256; i++)
       font_renderer_stb_unicode_get_glyph(self, i);
 
-   for (i = 0; i < 256; i++)
-   {
-      if(isalnum(i))
-         font_renderer_stb_unicode_get_glyph(self, i);
-   }
-
    return true;
 }
 
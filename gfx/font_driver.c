@@ -26,6 +26,8 @@
 
 #include <stdlib.h>
 
+#include <retro_miscellaneous.h>
+
 static const font_renderer_driver_t *font_backends[] = {
 #ifdef HAVE_FREETYPE
    &freetype_font_renderer,
@@ -46,6 +48,37 @@ static const font_renderer_driver_t *font_backends[] = {
 
 static void *video_font_driver = NULL;
 
+void font_atlas_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height)
+{
+   unsigned x1, y1;
+
+   if (!width || !height)
+      return;
+
+   if (!atlas->dirty)
+   {
+      atlas->dirty_x      = x;
+      atlas->dirty_y      = y;
+      atlas->dirty_width  = width;
+      atlas->dirty_height = height;
+      atlas->dirty        = true;
+      return;
+   }
+
+   /* Already dirty as a whole */
+   if (!atlas->dirty_width || !atlas->dirty_height)
+      return;
+
+   x1 = MAX(x + width,  atlas->dirty_x + atlas->dirty_width);
+   y1 = MAX(y + height, atlas->dirty_y + atlas->dirty_height);
+
+   atlas->dirty_x      = MIN(x, atlas->dirty_x);
+   atlas->dirty_y      = MIN(y, atlas->dirty_y);
+   atlas->dirty_width  = x1 - atlas->dirty_x;
+   atlas->dirty_height = y1 - atlas->dirty_y;
+}
+
 int font_renderer_create_default(const void **data, void **handle,
       const char *font_path, unsigned font_size)
 {
@@ -449,7 +482,10 @@ void font_driver_bind_block(void *font_data, void *block)
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
 
    if (font && font->renderer && font->renderer->bind_block)
+   {
       font->renderer->bind_block(font->renderer_data, block);
+      font->block = block;
+   }
 }
 
 void font_driver_flush(unsigned width, unsigned height, void *font_data,
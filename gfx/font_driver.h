@@ -79,6 +79,22 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+
+   /* Area changed since dirty was last cleared, see
+    * font_atlas_mark_dirty(). Empty if the renderer doesn't track it,
+    * in which case the whole atlas has to be uploaded. */
+   unsigned dirty_x;
+   unsigned dirty_y;
+   unsigned dirty_width;
+   unsigned dirty_height;
+
+   /* Size the renderer may grow the atlas to once it is full, instead
+    * of evicting glyphs. Set by font drivers which re-create their
+    * texture when the atlas size changes, 0 keeps the initial size.
+    * Glyph offsets stay valid when the atlas grows. */
+   unsigned max_width;
+   unsigned max_height;
+
    bool dirty;
 };
 
@@ -142,8 +158,15 @@ typedef struct
    const font_renderer_t *renderer;
    void *renderer_data;
    float size;
+   /* Raster block text is queued in, NULL if it's drawn right away */
+   void *block;
 } font_data_t;
 
+/* Adds a rectangle to the dirty area of @atlas and sets its dirty
+ * flag. The area starts over once the font driver cleared the flag. */
+void font_atlas_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height);
+
 /* font_path can be NULL for default font. */
 int font_renderer_create_default(const void **driver,
       void **handle, const char *font_path, unsigned font_size);
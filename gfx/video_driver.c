@@ -64,6 +64,7 @@
 #include "../core.h"
 #include "../command.h"
 #include "../msg_hash.h"
+#include "../performance_counters.h"
 #include "../verbosity.h"
 
 #define MEASURE_FRAME_TIME_SAMPLES_COUNT (2 * 1024)
@@ -1338,6 +1339,13 @@ void video_driver_set_aspect_ratio_value(float value)
    video_driver_aspect_ratio = value;
 }
 
+static void video_driver_swap_buffers_traced(void *data, void *data2)
+{
+   performance_trace_stage_begin(PERF_TRACE_STAGE_SWAP);
+   current_video_context.swap_buffers(data, data2);
+   performance_trace_stage_end(PERF_TRACE_STAGE_SWAP);
+}
+
 static bool video_driver_frame_filter(
       const void *data,
       video_frame_info_t *video_info,
@@ -1346,6 +1354,8 @@ static bool video_driver_frame_filter(
       unsigned *output_width, unsigned *output_height,
       unsigned *output_pitch)
 {
+   performance_trace_stage_begin(PERF_TRACE_STAGE_VIDEO_FILTER);
+
    rarch_softfilter_get_output_size(video_driver_state_filter,
          output_width, output_height, width, height);
 
@@ -1355,6 +1365,8 @@ static bool video_driver_frame_filter(
          video_driver_state_buffer, *output_pitch,
          data, width, height, pitch);
 
+   performance_trace_stage_end(PERF_TRACE_STAGE_VIDEO_FILTER);
+
    if (video_info->post_filter_record && recording_data)
       recording_dump_frame(video_driver_state_buffer,
             *output_width, *output_height, *output_pitch,
@@ -2250,6 +2262,8 @@ void video_driver_frame(const void *data, unsigned width,
    if (!video_driver_active)
       return;
 
+   performance_trace_stage_begin(PERF_TRACE_STAGE_VIDEO_FRAME);
+
    if (video_driver_scaler_ptr && data &&
          (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555) &&
          (data != RETRO_HW_FRAME_BUFFER_VALID))
@@ -2343,6 +2357,22 @@ void video_driver_frame(const void *data, unsigned width,
                   "FPS: %6.1f",
                   last_fps);
          }
+
+#ifdef HAVE_MENU
+         /* What the menu's last frame cost the display driver */
+         if (video_info.menu_stats_show && video_info.menu_is_alive)
+         {
+            char batch_text[64];
+            menu_display_batch_stats_t batch;
+
+            menu_display_get_batch_stats(&batch);
+            snprintf(batch_text, sizeof(batch_text),
+                  " || Menu: %u draws, %u vertices",
+                  batch.draw_calls, batch.vertices);
+            strlcat(video_info.fps_text, batch_text,
+                  sizeof(video_info.fps_text));
+         }
+#endif
       }
    }
    else
@@ -2412,6 +2442,8 @@ void video_driver_frame(const void *data, unsigned width,
    /* Display the FPS, with a higher priority. */
    if (video_info.fps_show)
       runloop_msg_queue_push(video_info.fps_text, 2, 1, true);
+
+   performance_trace_stage_end(PERF_TRACE_STAGE_VIDEO_FRAME);
 }
 
 void video_driver_display_type_set(enum rarch_display_type type)
@@ -2510,6 +2542,7 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->hard_sync_frames      = settings->uints.video_hard_sync_frames;
    video_info->fps_show              = settings->bools.video_fps_show;
    video_info->framecount_show       = settings->bools.video_framecount_show;
+   video_info->menu_stats_show       = settings->bools.video_menu_stats_show;
    video_info->scale_integer         = settings->bools.video_scale_integer;
    video_info->aspect_ratio_idx      = settings->uints.video_aspect_ratio_idx;
    video_info->post_filter_record    = settings->bools.video_post_filter_record;
@@ -2588,7 +2621,11 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->shader_data            = shader_data;
 
    video_info->cb_update_window_title = current_video_context.update_window_title;
-   video_info->cb_swap_buffers        = current_video_context.swap_buffers;
+   /* The threaded wrapper swaps on its own thread,
+    * which the stage trace can't follow. */
+   video_info->cb_swap_buffers        = video_driver_is_threaded()
+      ? current_video_context.swap_buffers
+      : video_driver_swap_buffers_traced;
    video_info->cb_get_metrics         = current_video_context.get_metrics;
    video_info->cb_set_resize          = current_video_context.set_resize;
 
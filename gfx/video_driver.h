@@ -412,6 +412,7 @@ typedef struct video_frame_info
    bool hard_sync;
    bool fps_show;
    bool framecount_show;
+   bool menu_stats_show;
    bool scale_integer;
    bool post_filter_record;
    bool windowed_fullscreen;
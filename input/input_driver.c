@@ -60,6 +60,7 @@
 #include "../verbosity.h"
 #include "../tasks/tasks_internal.h"
 #include "../command.h"
+#include "../performance_counters.h"
 
 static const input_driver_t *input_drivers[] = {
 #ifdef __CELLOS_LV2__
@@ -549,6 +550,8 @@ void input_poll(void)
    settings_t *settings           = config_get_ptr();
    uint8_t max_users              = (uint8_t)input_driver_max_users;
 
+   performance_trace_stage_begin(PERF_TRACE_STAGE_INPUT_POLL);
+
    current_input->poll(current_input_data);
 
    input_driver_turbo_btns.count++;
@@ -572,7 +575,7 @@ void input_poll(void)
    }
 
    if (input_driver_block_libretro_input)
-      return;
+      goto end;
 
 #ifdef HAVE_OVERLAY
    if (overlay_ptr && input_overlay_is_alive(overlay_ptr))
@@ -597,6 +600,9 @@ void input_poll(void)
    if (input_driver_mapper)
       input_mapper_poll(input_driver_mapper);
 #endif
+
+end:
+   performance_trace_stage_end(PERF_TRACE_STAGE_INPUT_POLL);
 }
 
 /**
@@ -219,7 +219,9 @@ bool input_remote_key_pressed(int key, unsigned port)
 {
    input_remote_state_t *input_state  = input_remote_get_state_ptr();
 
-   if (!input_state)
+   /* Only joypad buttons come over the network. Hotkeys are numbered past
+    * the width of the mask and would otherwise alias them. */
+   if (!input_state || key < 0 || key >= RARCH_FIRST_CUSTOM_BIND)
       return false;
 
    return (input_state->buttons[port] & (UINT64_C(1) << key));
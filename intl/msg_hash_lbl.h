@@ -1075,6 +1075,8 @@ MSG_HASH(MENU_ENUM_LABEL_VIDEO_GPU_RECORD,
       "video_gpu_record")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_GPU_SCREENSHOT,
       "video_gpu_screenshot")
+MSG_HASH(MENU_ENUM_LABEL_SCREENSHOT_FAST_COMPRESSION,
+      "screenshot_fast_compression")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_HARD_SYNC,
       "video_hard_sync")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_HARD_SYNC_FRAMES,
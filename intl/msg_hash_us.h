@@ -1677,6 +1677,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_GPU_RECORD,
       "Use GPU Recording")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_GPU_SCREENSHOT,
       "GPU Screenshot Enable")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_SCREENSHOT_FAST_COMPRESSION,
+      "Fast Screenshot Compression")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_HARD_SYNC,
       "Hard GPU Sync")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_HARD_SYNC_FRAMES,
@@ -2606,6 +2608,10 @@ MSG_HASH(
       MENU_ENUM_SUBLABEL_VIDEO_GPU_SCREENSHOT,
       "Screenshots output of GPU shaded material if available."
       )
+MSG_HASH(
+      MENU_ENUM_SUBLABEL_SCREENSHOT_FAST_COMPRESSION,
+      "Compress screenshots and savestate thumbnails with the fastest zlib level. Files are larger, but take much less time to write."
+      )
 MSG_HASH(
       MENU_ENUM_SUBLABEL_VIDEO_ROTATION,
       "Forces a certain rotation of the screen. The rotation is added to rotations which the core sets."
@@ -3327,6 +3333,8 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_MESSAGE_COLOR_BLUE,
       "Notification Blue Color")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_FRAMECOUNT_SHOW,
       "Show frame count on FPS display")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_MENU_STATS_SHOW,
+      "Show menu draw calls on FPS display")
 MSG_HASH(MSG_CONFIG_OVERRIDE_LOADED,
       "Configuration override loaded.")
 MSG_HASH(MSG_GAME_REMAP_FILE_LOADED,
@@ -48,6 +48,9 @@ struct retro_dsp_instance
 {
    const struct dspfilter_implementation *impl;
    void *impl_data;
+
+   uint64_t frames;
+   retro_time_t usec;
 };
 
 struct retro_dsp_filter
@@ -314,12 +317,29 @@ void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
 
    for (i = 0; i < dsp->num_instances; i++)
    {
+      struct retro_dsp_instance *instance = &dsp->instances[i];
+      retro_time_t start                  = cpu_features_get_time_usec();
+
       input.samples = output.samples;
       input.frames  = output.frames;
-      dsp->instances[i].impl->process(
-            dsp->instances[i].impl_data, &output, &input);
+      instance->impl->process(instance->impl_data, &output, &input);
+
+      instance->usec   += cpu_features_get_time_usec() - start;
+      instance->frames += input.frames;
    }
 
    data->output        = output.samples;
    data->output_frames = output.frames;
 }
+
+bool retro_dsp_filter_get_stats(retro_dsp_filter_t *dsp,
+      unsigned index, struct retro_dsp_plug_stats *stats)
+{
+   if (!dsp || index >= dsp->num_instances)
+      return false;
+
+   stats->ident  = dsp->instances[index].impl->ident;
+   stats->frames = dsp->instances[index].frames;
+   stats->usec   = dsp->instances[index].usec;
+   return true;
+}
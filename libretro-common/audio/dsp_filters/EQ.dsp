@@ -12,6 +12,11 @@ filter0 = eq
 # allows finer-grained control over the spectrum.
 # eq_block_size_log2 = 8
 
+# The filter is applied in partitions of this size.
+# Smaller partitions lower the latency, larger ones cost less CPU.
+# Clamped to eq_block_size_log2.
+# eq_partition_size_log2 = 6
+
 # An array of which frequencies to control.
 # You can create an arbitrary amount of these sampling points.
 # The EQ will try to create a frequency response which fits well to these points.
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
@@ -32,7 +33,8 @@
 
 struct chorus_data
 {
-   float old[2][CHORUS_MAX_DELAY];
+   /* Left and right interleaved. */
+   float old[CHORUS_MAX_DELAY * 2];
    unsigned old_ptr;
 
    float delay;
@@ -42,6 +44,11 @@ struct chorus_data
    float mix_wet;
    unsigned lfo_ptr;
    unsigned lfo_period;
+
+   /* The LFO is a rotating phasor instead of a sin() per frame,
+    * restarted from phase 0 every period so it can't drift. */
+   double lfo_cos, lfo_sin;
+   double lfo_step_cos, lfo_step_sin;
 };
 
 static void chorus_free(void *data)
@@ -50,6 +57,35 @@ static void chorus_free(void *data)
       free(data);
 }
 
+/* Stores the current frame and returns the delay of this frame
+ * in samples, advancing the LFO. */
+static INLINE float chorus_next_delay(struct chorus_data *ch,
+      const float *in, unsigned *delay_int)
+{
+   float delay = (ch->delay + ch->depth * (float)ch->lfo_sin) * ch->input_rate;
+   double c    = ch->lfo_cos;
+
+   ch->lfo_cos = c * ch->lfo_step_cos - ch->lfo_sin * ch->lfo_step_sin;
+   ch->lfo_sin = c * ch->lfo_step_sin + ch->lfo_sin * ch->lfo_step_cos;
+
+   if (++ch->lfo_ptr >= ch->lfo_period)
+   {
+      ch->lfo_ptr = 0;
+      ch->lfo_cos = 1.0;
+      ch->lfo_sin = 0.0;
+   }
+
+   *delay_int = (unsigned)delay;
+
+   if (*delay_int >= CHORUS_MAX_DELAY - 1)
+      *delay_int = CHORUS_MAX_DELAY - 2;
+
+   ch->old[2 * ch->old_ptr + 0] = in[0];
+   ch->old[2 * ch->old_ptr + 1] = in[1];
+
+   return delay - *delay_int;
+}
+
 static void chorus_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -64,34 +100,20 @@ static void chorus_process(void *data, struct dspfilter_output *output,
    for (i = 0; i < input->frames; i++, out += 2)
    {
       unsigned delay_int;
-      float delay_frac, l_a, l_b, r_a, r_b;
+      float delay_frac;
       float chorus_l, chorus_r;
+      const float *a, *b;
       float in[2] = { out[0], out[1] };
-      float delay = ch->delay + ch->depth * sin((2.0 * M_PI * ch->lfo_ptr++) / ch->lfo_period);
-
-      delay *= ch->input_rate;
-      if (ch->lfo_ptr >= ch->lfo_period)
-         ch->lfo_ptr = 0;
 
-      delay_int = (unsigned)delay;
+      delay_frac  = chorus_next_delay(ch, in, &delay_int);
 
-      if (delay_int >= CHORUS_MAX_DELAY - 1)
-         delay_int = CHORUS_MAX_DELAY - 2;
-
-      delay_frac = delay - delay_int;
-
-      ch->old[0][ch->old_ptr] = in[0];
-      ch->old[1][ch->old_ptr] = in[1];
-
-      l_a         = ch->old[0][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      l_b         = ch->old[0][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
-      r_a         = ch->old[1][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      r_b         = ch->old[1][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
+      a           = &ch->old[2 * ((ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK)];
+      b           = &ch->old[2 * ((ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK)];
 
       /* Lerp introduces aliasing of the chorus component, 
        * but doing full polyphase here is probably overkill. */
-      chorus_l    = l_a * (1.0f - delay_frac) + l_b * delay_frac;
-      chorus_r    = r_a * (1.0f - delay_frac) + r_b * delay_frac;
+      chorus_l    = a[0] * (1.0f - delay_frac) + b[0] * delay_frac;
+      chorus_r    = a[1] * (1.0f - delay_frac) + b[1] * delay_frac;
 
       out[0]      = ch->mix_dry * in[0] + ch->mix_wet * chorus_l;
       out[1]      = ch->mix_dry * in[1] + ch->mix_wet * chorus_r;
@@ -133,6 +155,11 @@ static void *chorus_init(const struct dspfilter_info *info,
    ch->input_rate = info->input_rate;
    if (!ch->lfo_period)
       ch->lfo_period = 1;
+
+   ch->lfo_cos      = 1.0;
+   ch->lfo_sin      = 0.0;
+   ch->lfo_step_cos = cos(2.0 * M_PI / ch->lfo_period);
+   ch->lfo_step_sin = sin(2.0 * M_PI / ch->lfo_period);
    return ch;
 }
 
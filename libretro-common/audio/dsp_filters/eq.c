@@ -31,16 +31,32 @@
 
 #include "fft/fft.c"
 
+/* Uniformly partitioned overlap-save convolution.
+ *
+ * The filter is cut into partitions of partition_size taps, each
+ * transformed on its own. Every partition_size input frames, the
+ * last two partitions worth of input are transformed and pushed
+ * into a frequency-domain delay line, and the output is the
+ * inverse transform of the delay line multiplied partition-wise
+ * with the filter. Latency is one partition instead of the whole
+ * filter length, at the cost of a longer multiply-add. */
 struct eq_data
 {
    fft_t *fft;
    float buffer[8 * 1024];
 
-   float *save;
+   /* Two partitions of interleaved input, the older one first. */
    float *block;
+   /* Inverse transform output, one channel. */
+   float *time;
+   /* num_partitions spectra of 2 * partition_size bins each. */
    fft_complex_t *filter;
-   fft_complex_t *fftblock;
-   unsigned block_size;
+   /* Delay line of input spectra, per channel. */
+   fft_complex_t *fdl[2];
+   fft_complex_t *accum;
+   unsigned partition_size;
+   unsigned num_partitions;
+   unsigned fdl_ptr;
    unsigned block_ptr;
 };
 
@@ -57,10 +73,12 @@ static void eq_free(void *data)
       return;
 
    fft_free(eq->fft);
-   free(eq->save);
    free(eq->block);
-   free(eq->fftblock);
+   free(eq->time);
    free(eq->filter);
+   free(eq->fdl[0]);
+   free(eq->fdl[1]);
+   free(eq->accum);
    free(eq);
 }
 
@@ -81,39 +99,53 @@ static void eq_process(void *data, struct dspfilter_output *output,
 
    while (input_frames)
    {
-      unsigned write_avail = eq->block_size - eq->block_ptr;
+      unsigned size        = eq->partition_size;
+      unsigned write_avail = size - eq->block_ptr;
 
       if (input_frames < write_avail)
          write_avail = input_frames;
 
-      memcpy(eq->block + eq->block_ptr * 2, in, write_avail * 2 * sizeof(float));
+      memcpy(eq->block + (size + eq->block_ptr) * 2, in,
+            write_avail * 2 * sizeof(float));
 
       in += write_avail * 2;
       input_frames -= write_avail;
       eq->block_ptr += write_avail;
 
-      // Convolve a new block.
-      if (eq->block_ptr == eq->block_size)
+      /* Convolve a new partition. */
+      if (eq->block_ptr == size)
       {
-         unsigned i, c;
+         unsigned i, c, k;
+         unsigned bins = 2 * size;
 
          for (c = 0; c < 2; c++)
          {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
+            fft_complex_t *fdl = eq->fdl[c];
+
+            fft_process_forward(eq->fft, fdl + eq->fdl_ptr * bins,
+                  eq->block + c, 2);
+
+            memset(eq->accum, 0, bins * sizeof(*eq->accum));
+            for (k = 0; k < eq->num_partitions; k++)
+            {
+               unsigned slot = (eq->fdl_ptr + eq->num_partitions - k)
+                  % eq->num_partitions;
+               fft_complex_mul_accumulate(eq->accum,
+                     fdl + slot * bins, eq->filter + k * bins, bins);
+            }
+
+            /* Overlap-save, only the second half is free of
+             * circular wrap-around. */
+            fft_process_inverse(eq->fft, eq->time, eq->accum, 1);
+            for (i = 0; i < size; i++)
+               out[2 * i + c] = eq->time[size + i];
          }
 
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
-
-         // Save block for later.
-         memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
+         memcpy(eq->block, eq->block + 2 * size, 2 * size * sizeof(float));
+         eq->fdl_ptr = (eq->fdl_ptr + 1) % eq->num_partitions;
 
-         out += eq->block_size * 2;
-         output->frames += eq->block_size;
+         out += size * 2;
+         output->frames += size;
          eq->block_ptr = 0;
       }
    }
@@ -195,22 +227,26 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
       struct eq_gain *gains, unsigned num_gains, double beta, const char *filter_path)
 {
    int i;
-   int half_block_size = eq->block_size >> 1;
-   double window_mod = 1.0 / kaiser_window_function(0.0, beta);
-
-   fft_t *fft = fft_new(size_log2);
-   float *time_filter = (float*)calloc(eq->block_size * 2 + 1, sizeof(*time_filter));
-   if (!fft || !time_filter)
+   unsigned k;
+   unsigned block_size     = 1 << size_log2;
+   int half_block_size     = block_size >> 1;
+   double window_mod       = 1.0 / kaiser_window_function(0.0, beta);
+
+   fft_t *fft              = fft_new(size_log2);
+   float *time_filter      = (float*)calloc(block_size * 2 + 1, sizeof(*time_filter));
+   fft_complex_t *response = (fft_complex_t*)calloc(block_size + 1, sizeof(*response));
+   float *partition        = (float*)calloc(2 * eq->partition_size, sizeof(*partition));
+   if (!fft || !time_filter || !response || !partition)
       goto end;
 
    /* Make sure bands are in correct order. */
    qsort(gains, num_gains, sizeof(*gains), gains_cmp);
 
    /* Compute desired filter response. */
-   generate_response(eq->filter, gains, num_gains, half_block_size);
+   generate_response(response, gains, num_gains, half_block_size);
 
    /* Get equivalent time-domain filter. */
-   fft_process_inverse(fft, time_filter, eq->filter, 1);
+   fft_process_inverse(fft, time_filter, response, 1);
 
    /* ifftshift() to create the correct linear phase filter.
     * The filter response was designed with zero phase, which 
@@ -225,10 +261,10 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
    }
 
    /* Apply a window to smooth out the frequency repsonse. */
-   for (i = 0; i < (int)eq->block_size; i++)
+   for (i = 0; i < (int)block_size; i++)
    {
       /* Kaiser window. */
-      double phase = (double)i / eq->block_size;
+      double phase = (double)i / block_size;
       phase = 2.0 * (phase - 0.5);
       time_filter[i] *= window_mod * kaiser_window_function(phase, beta);
    }
@@ -239,29 +275,37 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
       FILE *file = fopen(filter_path, "w");
       if (file)
       {
-         for (i = 0; i < (int)eq->block_size - 1; i++)
+         for (i = 0; i < (int)block_size - 1; i++)
             fprintf(file, "%.8f\n", time_filter[i + 1]);
          fclose(file);
       }
    }
 
-   /* Padded FFT to create our FFT filter.
+   /* Padded FFT of every partition to create our FFT filter.
     * Make our even-length filter odd by discarding the first coefficient.
     * For some interesting reason, this allows us to design an odd-length linear phase filter.
     */
-   fft_process_forward(eq->fft, eq->filter, time_filter + 1, 1);
+   for (k = 0; k < eq->num_partitions; k++)
+   {
+      memcpy(partition, time_filter + 1 + k * eq->partition_size,
+            eq->partition_size * sizeof(*partition));
+      fft_process_forward(eq->fft, eq->filter + k * 2 * eq->partition_size,
+            partition, 1);
+   }
 
 end:
    fft_free(fft);
    free(time_filter);
+   free(response);
+   free(partition);
 }
 
 static void *eq_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
    float *frequencies, *gain;
-   unsigned num_freq, num_gain, i, size;
-   int size_log2;
+   unsigned num_freq, num_gain, i, size, bins;
+   int size_log2, partition_log2;
    float beta;
    struct eq_gain *gains = NULL;
    char *filter_path = NULL;
@@ -275,7 +319,13 @@ static void *eq_init(const struct dspfilter_info *info,
    config->get_float(userdata, "window_beta", &beta, 4.0f);
 
    config->get_int(userdata, "block_size_log2", &size_log2, 8);
-   size = 1 << size_log2;
+   config->get_int(userdata, "partition_size_log2", &partition_log2, 6);
+   if (partition_log2 > size_log2)
+      partition_log2 = size_log2;
+   if (partition_log2 < 2)
+      partition_log2 = 2;
+   size_log2 = MAX(size_log2, partition_log2);
+   size      = 1 << size_log2;
 
    config->get_float_array(userdata, "frequencies", &frequencies, &num_freq, default_freq, 2);
    config->get_float_array(userdata, "gains", &gain, &num_gain, default_gain, 2);
@@ -300,19 +350,24 @@ static void *eq_init(const struct dspfilter_info *info,
    config->free(frequencies);
    config->free(gain);
 
-   eq->block_size = size;
+   eq->partition_size = 1 << partition_log2;
+   eq->num_partitions = size >> partition_log2;
+   bins               = 2 * eq->partition_size;
 
-   eq->save     = (float*)calloc(    size, 2 * sizeof(*eq->save));
-   eq->block    = (float*)calloc(2 * size, 2 * sizeof(*eq->block));
-   eq->fftblock = (fft_complex_t*)calloc(2 * size, sizeof(*eq->fftblock));
-   eq->filter   = (fft_complex_t*)calloc(2 * size, sizeof(*eq->filter));
+   eq->block    = (float*)calloc(bins, 2 * sizeof(*eq->block));
+   eq->time     = (float*)calloc(bins, sizeof(*eq->time));
+   eq->filter   = (fft_complex_t*)calloc(bins * eq->num_partitions, sizeof(*eq->filter));
+   eq->fdl[0]   = (fft_complex_t*)calloc(bins * eq->num_partitions, sizeof(*eq->fdl[0]));
+   eq->fdl[1]   = (fft_complex_t*)calloc(bins * eq->num_partitions, sizeof(*eq->fdl[1]));
+   eq->accum    = (fft_complex_t*)calloc(bins, sizeof(*eq->accum));
 
-   /* Use an FFT which is twice the block size with zero-padding
+   /* Use an FFT which is twice the partition size with zero-padding
     * to make circular convolution => proper convolution.
     */
-   eq->fft = fft_new(size_log2 + 1);
+   eq->fft = fft_new(partition_log2 + 1);
 
-   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
+   if (!eq->fft || !eq->block || !eq->time || !eq->filter
+         || !eq->fdl[0] || !eq->fdl[1] || !eq->accum)
       goto error;
 
    create_filter(eq, size_log2, gains, num_gain, beta, filter_path);
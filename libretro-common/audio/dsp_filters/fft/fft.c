@@ -27,6 +27,12 @@
 
 #include <retro_miscellaneous.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 struct fft
 {
    fft_complex_t *interleave_buffer;
@@ -140,6 +146,32 @@ static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
    *a  = fft_complex_add(*a, mod);
 }
 
+/* The vector paths work on two complex values per register,
+ * laid out as real, imag, real, imag. */
+#if defined(__SSE__)
+static INLINE __m128 complex_mul_sse(__m128 a, __m128 b)
+{
+   const __m128 sign   = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+   __m128 a_real       = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0));
+   __m128 a_imag       = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1));
+   __m128 b_swap       = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+
+   return _mm_add_ps(_mm_mul_ps(a_real, b),
+         _mm_mul_ps(_mm_mul_ps(a_imag, b_swap), sign));
+}
+#elif defined(__ARM_NEON__)
+static INLINE float32x4_t complex_mul_neon(float32x4_t a, float32x4_t b)
+{
+   static const float sign[4] = { -1.0f, 1.0f, -1.0f, 1.0f };
+   /* val[0] holds the real parts twice, val[1] the imaginary ones. */
+   float32x4x2_t a_split      = vtrnq_f32(a, a);
+   float32x4_t b_swap         = vrev64q_f32(b);
+
+   return vmlaq_f32(vmulq_f32(a_split.val[0], b),
+         vmulq_f32(a_split.val[1], b_swap), vld1q_f32(sign));
+}
+#endif
+
 static void butterflies(fft_complex_t *butterfly_buf,
       const fft_complex_t *phase_lut,
       int phase_dir, unsigned step_size, unsigned samples)
@@ -148,12 +180,73 @@ static void butterflies(fft_complex_t *butterfly_buf,
    for (i = 0; i < samples; i += step_size << 1)
    {
       int phase_step = (int)samples * phase_dir / (int)step_size;
-      for (j = i; j < i + step_size; j++)
+
+      j = i;
+
+#if defined(__SSE__)
+      for (; j + 2 <= i + step_size; j += 2)
+      {
+         const fft_complex_t *mod0 = &phase_lut[phase_step * (int)(j - i)];
+         const fft_complex_t *mod1 = &phase_lut[phase_step * (int)(j - i + 1)];
+         __m128 mod = _mm_loadh_pi(
+               _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)mod0),
+               (const __m64*)mod1);
+         __m128 a   = _mm_loadu_ps(&butterfly_buf[j].real);
+         __m128 b   = _mm_loadu_ps(&butterfly_buf[j + step_size].real);
+
+         mod        = complex_mul_sse(mod, b);
+         _mm_storeu_ps(&butterfly_buf[j + step_size].real, _mm_sub_ps(a, mod));
+         _mm_storeu_ps(&butterfly_buf[j].real, _mm_add_ps(a, mod));
+      }
+#elif defined(__ARM_NEON__)
+      for (; j + 2 <= i + step_size; j += 2)
+      {
+         const fft_complex_t *mod0 = &phase_lut[phase_step * (int)(j - i)];
+         const fft_complex_t *mod1 = &phase_lut[phase_step * (int)(j - i + 1)];
+         float32x4_t mod = vcombine_f32(
+               vld1_f32(&mod0->real), vld1_f32(&mod1->real));
+         float32x4_t a   = vld1q_f32(&butterfly_buf[j].real);
+         float32x4_t b   = vld1q_f32(&butterfly_buf[j + step_size].real);
+
+         mod             = complex_mul_neon(mod, b);
+         vst1q_f32(&butterfly_buf[j + step_size].real, vsubq_f32(a, mod));
+         vst1q_f32(&butterfly_buf[j].real, vaddq_f32(a, mod));
+      }
+#endif
+
+      /* The first pass, and whatever is left over. */
+      for (; j < i + step_size; j++)
          butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size],
                phase_lut[phase_step * (int)(j - i)]);
    }
 }
 
+void fft_complex_mul_accumulate(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples)
+{
+   unsigned i = 0;
+
+#if defined(__SSE__)
+   for (; i + 2 <= samples; i += 2)
+   {
+      __m128 prod = complex_mul_sse(_mm_loadu_ps(&a[i].real),
+            _mm_loadu_ps(&b[i].real));
+      _mm_storeu_ps(&out[i].real,
+            _mm_add_ps(_mm_loadu_ps(&out[i].real), prod));
+   }
+#elif defined(__ARM_NEON__)
+   for (; i + 2 <= samples; i += 2)
+   {
+      float32x4_t prod = complex_mul_neon(vld1q_f32(&a[i].real),
+            vld1q_f32(&b[i].real));
+      vst1q_f32(&out[i].real, vaddq_f32(vld1q_f32(&out[i].real), prod));
+   }
+#endif
+
+   for (; i < samples; i++)
+      out[i] = fft_complex_add(out[i], fft_complex_mul(a[i], b[i]));
+}
+
 void fft_process_forward_complex(fft_t *fft,
       fft_complex_t *out, const fft_complex_t *in, unsigned step)
 {
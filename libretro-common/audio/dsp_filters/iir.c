@@ -28,6 +28,12 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -49,8 +55,9 @@ enum IIRFilter
 
 struct iir_data
 {
+   /* Normalized so that a0 is 1. */
    float b0, b1, b2;
-   float a0, a1, a2;
+   float a1, a2;
 
    struct
    {
@@ -74,7 +81,6 @@ static void iir_process(void *data, struct dspfilter_output *output,
    float b0             = iir->b0;
    float b1             = iir->b1;
    float b2             = iir->b2;
-   float a0             = iir->a0;
    float a1             = iir->a1;
    float a2             = iir->a2;
 
@@ -96,8 +102,8 @@ static void iir_process(void *data, struct dspfilter_output *output,
       float in_l = out[0];
       float in_r = out[1];
 
-      float l    = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r    = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
+      float l    = b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l;
+      float r    = b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r;
 
       xn2_l      = xn1_l;
       xn1_l      = in_l;
@@ -124,6 +130,122 @@ static void iir_process(void *data, struct dspfilter_output *output,
    iir->r.yn2 = yn2_r;
 }
 
+/* Both channels run through the same biquad, so the vector
+ * versions keep left and right in adjacent lanes and process a
+ * whole frame per iteration. */
+#if defined(__SSE__)
+static void iir_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float state[4];
+   struct iir_data *iir = (struct iir_data*)data;
+   float *out           = input->samples;
+
+   __m128 b0            = _mm_set1_ps(iir->b0);
+   __m128 b1            = _mm_set1_ps(iir->b1);
+   __m128 b2            = _mm_set1_ps(iir->b2);
+   __m128 a1            = _mm_set1_ps(iir->a1);
+   __m128 a2            = _mm_set1_ps(iir->a2);
+
+   __m128 xn1           = _mm_setr_ps(iir->l.xn1, iir->r.xn1, 0.0f, 0.0f);
+   __m128 xn2           = _mm_setr_ps(iir->l.xn2, iir->r.xn2, 0.0f, 0.0f);
+   __m128 yn1           = _mm_setr_ps(iir->l.yn1, iir->r.yn1, 0.0f, 0.0f);
+   __m128 yn2           = _mm_setr_ps(iir->l.yn2, iir->r.yn2, 0.0f, 0.0f);
+
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      __m128 in  = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      __m128 res = _mm_add_ps(_mm_mul_ps(b0, in),
+            _mm_add_ps(_mm_mul_ps(b1, xn1), _mm_mul_ps(b2, xn2)));
+
+      res        = _mm_sub_ps(res,
+            _mm_add_ps(_mm_mul_ps(a1, yn1), _mm_mul_ps(a2, yn2)));
+
+      xn2        = xn1;
+      xn1        = in;
+      yn2        = yn1;
+      yn1        = res;
+
+      _mm_storel_pi((__m64*)out, res);
+   }
+
+   _mm_storeu_ps(state, xn1);
+   iir->l.xn1 = state[0];
+   iir->r.xn1 = state[1];
+   _mm_storeu_ps(state, xn2);
+   iir->l.xn2 = state[0];
+   iir->r.xn2 = state[1];
+   _mm_storeu_ps(state, yn1);
+   iir->l.yn1 = state[0];
+   iir->r.yn1 = state[1];
+   _mm_storeu_ps(state, yn2);
+   iir->l.yn2 = state[0];
+   iir->r.yn2 = state[1];
+}
+#elif defined(__ARM_NEON__)
+static void iir_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float state[2];
+   struct iir_data *iir = (struct iir_data*)data;
+   float *out           = input->samples;
+
+   float32x2_t xn1, xn2, yn1, yn2;
+
+   state[0] = iir->l.xn1;
+   state[1] = iir->r.xn1;
+   xn1      = vld1_f32(state);
+   state[0] = iir->l.xn2;
+   state[1] = iir->r.xn2;
+   xn2      = vld1_f32(state);
+   state[0] = iir->l.yn1;
+   state[1] = iir->r.yn1;
+   yn1      = vld1_f32(state);
+   state[0] = iir->l.yn2;
+   state[1] = iir->r.yn2;
+   yn2      = vld1_f32(state);
+
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float32x2_t in  = vld1_f32(out);
+      float32x2_t res = vmul_n_f32(in, iir->b0);
+
+      res             = vmla_n_f32(res, xn1, iir->b1);
+      res             = vmla_n_f32(res, xn2, iir->b2);
+      res             = vmls_n_f32(res, yn1, iir->a1);
+      res             = vmls_n_f32(res, yn2, iir->a2);
+
+      xn2             = xn1;
+      xn1             = in;
+      yn2             = yn1;
+      yn1             = res;
+
+      vst1_f32(out, res);
+   }
+
+   vst1_f32(state, xn1);
+   iir->l.xn1 = state[0];
+   iir->r.xn1 = state[1];
+   vst1_f32(state, xn2);
+   iir->l.xn2 = state[0];
+   iir->r.xn2 = state[1];
+   vst1_f32(state, yn1);
+   iir->l.yn1 = state[0];
+   iir->r.yn1 = state[1];
+   vst1_f32(state, yn2);
+   iir->l.yn2 = state[0];
+   iir->r.yn2 = state[1];
+}
+#endif
+
 #define CHECK(x) if (string_is_equal(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
 {
@@ -317,12 +439,11 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   iir->b0 = b0 / a0;
+   iir->b1 = b1 / a0;
+   iir->b2 = b2 / a0;
+   iir->a1 = a1 / a0;
+   iir->a2 = a2 / a0;
 }
 
 static void *iir_init(const struct dspfilter_info *info,
@@ -358,12 +479,41 @@ static const struct dspfilter_implementation iir_plug = {
    "iir",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation iir_plug_sse = {
+   iir_init,
+   iir_process_sse,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#elif defined(__ARM_NEON__)
+static const struct dspfilter_implementation iir_plug_neon = {
+   iir_init,
+   iir_process_neon,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &iir_plug_sse;
+#elif defined(__ARM_NEON__)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &iir_plug_neon;
+#endif
    (void)mask;
    return &iir_plug;
 }
@@ -27,6 +27,14 @@
 #include <retro_inline.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* Both channels use the same tunings, so the delay lines hold
+ * left and right interleaved and share one index. */
 struct comb
 {
    float *buffer;
@@ -34,7 +42,7 @@ struct comb
    unsigned bufidx;
 
    float feedback;
-   float filterstore;
+   float filterstore[2];
    float damp1, damp2;
 };
 
@@ -46,32 +54,42 @@ struct allpass
    unsigned bufidx;
 };
 
-static INLINE float comb_process(struct comb *c, float input)
+static INLINE void comb_process(struct comb *c,
+      const float *input, float *output)
 {
-   float output         = c->buffer[c->bufidx];
-   c->filterstore       = (output * c->damp2) + (c->filterstore * c->damp1);
-
-   c->buffer[c->bufidx] = input + (c->filterstore * c->feedback);
+   float *buffer     = c->buffer + 2 * c->bufidx;
+   float bufout_l    = buffer[0];
+   float bufout_r    = buffer[1];
+   float store_l     = (bufout_l * c->damp2) + (c->filterstore[0] * c->damp1);
+   float store_r     = (bufout_r * c->damp2) + (c->filterstore[1] * c->damp1);
+
+   buffer[0]         = input[0] + (store_l * c->feedback);
+   buffer[1]         = input[1] + (store_r * c->feedback);
+   c->filterstore[0] = store_l;
+   c->filterstore[1] = store_r;
+   output[0]        += bufout_l;
+   output[1]        += bufout_r;
 
    c->bufidx++;
    if (c->bufidx >= c->bufsize)
       c->bufidx = 0;
-
-   return output;
 }
 
 
-static INLINE float allpass_process(struct allpass *a, float input)
+static INLINE void allpass_process(struct allpass *a, float *samples)
 {
-   float bufout         = a->buffer[a->bufidx];
-   float output         = -input + bufout;
-   a->buffer[a->bufidx] = input + bufout * a->feedback;
+   float *buffer  = a->buffer + 2 * a->bufidx;
+   float bufout_l = buffer[0];
+   float bufout_r = buffer[1];
+
+   buffer[0]      = samples[0] + bufout_l * a->feedback;
+   buffer[1]      = samples[1] + bufout_r * a->feedback;
+   samples[0]     = -samples[0] + bufout_l;
+   samples[1]     = -samples[1] + bufout_r;
 
    a->bufidx++;
    if (a->bufidx >= a->bufsize)
       a->bufidx = 0;
-
-   return output;
 }
 
 #define numcombs 8
@@ -109,19 +127,19 @@ struct revmodel
    struct comb combL[numcombs];
    struct allpass allpassL[numallpasses];
 
-   float bufcombL1[combtuningL1];
-   float bufcombL2[combtuningL2];
-   float bufcombL3[combtuningL3];
-   float bufcombL4[combtuningL4];
-   float bufcombL5[combtuningL5];
-   float bufcombL6[combtuningL6];
-   float bufcombL7[combtuningL7];
-   float bufcombL8[combtuningL8];
+   float bufcombL1[2 * combtuningL1];
+   float bufcombL2[2 * combtuningL2];
+   float bufcombL3[2 * combtuningL3];
+   float bufcombL4[2 * combtuningL4];
+   float bufcombL5[2 * combtuningL5];
+   float bufcombL6[2 * combtuningL6];
+   float bufcombL7[2 * combtuningL7];
+   float bufcombL8[2 * combtuningL8];
 
-   float bufallpassL1[allpasstuningL1];
-   float bufallpassL2[allpasstuningL2];
-   float bufallpassL3[allpasstuningL3];
-   float bufallpassL4[allpasstuningL4];
+   float bufallpassL1[2 * allpasstuningL1];
+   float bufallpassL2[2 * allpasstuningL2];
+   float bufallpassL3[2 * allpasstuningL3];
+   float bufallpassL4[2 * allpasstuningL4];
 
    float gain;
    float roomsize, roomsize1;
@@ -132,22 +150,122 @@ struct revmodel
    float mode;
 };
 
-static float revmodel_process(struct revmodel *rev, float in)
+/* Processes one interleaved frame in place. */
+static void revmodel_process(struct revmodel *rev, float *frame)
 {
    int i;
-   float mono_out = 0.0f;
-   float mono_in  = in;
-   float input    = mono_in * rev->gain;
+   float out[2]   = { 0.0f, 0.0f };
+   float input[2] = { frame[0] * rev->gain, frame[1] * rev->gain };
 
    for (i = 0; i < numcombs; i++)
-      mono_out += comb_process(&rev->combL[i], input);
+      comb_process(&rev->combL[i], input, out);
 
    for (i = 0; i < numallpasses; i++)
-      mono_out = allpass_process(&rev->allpassL[i], mono_out);
+      allpass_process(&rev->allpassL[i], out);
 
-   return mono_in * rev->dry + mono_out * rev->wet1;
+   frame[0] = frame[0] * rev->dry + out[0] * rev->wet1;
+   frame[1] = frame[1] * rev->dry + out[1] * rev->wet1;
 }
 
+#if defined(__SSE__)
+static void revmodel_process_sse(struct revmodel *rev,
+      float *samples, unsigned frames)
+{
+   unsigned n;
+   int i;
+   __m128 gain = _mm_set1_ps(rev->gain);
+   __m128 dry  = _mm_set1_ps(rev->dry);
+   __m128 wet  = _mm_set1_ps(rev->wet1);
+
+   for (n = 0; n < frames; n++, samples += 2)
+   {
+      __m128 in    = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)samples);
+      __m128 input = _mm_mul_ps(in, gain);
+      __m128 out   = _mm_setzero_ps();
+
+      for (i = 0; i < numcombs; i++)
+      {
+         struct comb *c = &rev->combL[i];
+         float *buffer  = c->buffer + 2 * c->bufidx;
+         __m128 bufout  = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)buffer);
+         __m128 store   = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)c->filterstore);
+
+         store          = _mm_add_ps(_mm_mul_ps(bufout, _mm_set1_ps(c->damp2)),
+               _mm_mul_ps(store, _mm_set1_ps(c->damp1)));
+         _mm_storel_pi((__m64*)c->filterstore, store);
+         _mm_storel_pi((__m64*)buffer, _mm_add_ps(input,
+                  _mm_mul_ps(store, _mm_set1_ps(c->feedback))));
+         out            = _mm_add_ps(out, bufout);
+
+         if (++c->bufidx >= c->bufsize)
+            c->bufidx = 0;
+      }
+
+      for (i = 0; i < numallpasses; i++)
+      {
+         struct allpass *a = &rev->allpassL[i];
+         float *buffer     = a->buffer + 2 * a->bufidx;
+         __m128 bufout     = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)buffer);
+
+         _mm_storel_pi((__m64*)buffer, _mm_add_ps(out,
+                  _mm_mul_ps(bufout, _mm_set1_ps(a->feedback))));
+         out               = _mm_sub_ps(bufout, out);
+
+         if (++a->bufidx >= a->bufsize)
+            a->bufidx = 0;
+      }
+
+      _mm_storel_pi((__m64*)samples, _mm_add_ps(_mm_mul_ps(in, dry),
+               _mm_mul_ps(out, wet)));
+   }
+}
+#elif defined(__ARM_NEON__)
+static void revmodel_process_neon(struct revmodel *rev,
+      float *samples, unsigned frames)
+{
+   unsigned n;
+   int i;
+
+   for (n = 0; n < frames; n++, samples += 2)
+   {
+      float32x2_t in    = vld1_f32(samples);
+      float32x2_t input = vmul_n_f32(in, rev->gain);
+      float32x2_t out   = vdup_n_f32(0.0f);
+
+      for (i = 0; i < numcombs; i++)
+      {
+         struct comb *c     = &rev->combL[i];
+         float *buffer      = c->buffer + 2 * c->bufidx;
+         float32x2_t bufout = vld1_f32(buffer);
+         float32x2_t store  = vmul_n_f32(vld1_f32(c->filterstore), c->damp1);
+
+         store              = vmla_n_f32(store, bufout, c->damp2);
+         vst1_f32(c->filterstore, store);
+         vst1_f32(buffer, vmla_n_f32(input, store, c->feedback));
+         out                = vadd_f32(out, bufout);
+
+         if (++c->bufidx >= c->bufsize)
+            c->bufidx = 0;
+      }
+
+      for (i = 0; i < numallpasses; i++)
+      {
+         struct allpass *a  = &rev->allpassL[i];
+         float *buffer      = a->buffer + 2 * a->bufidx;
+         float32x2_t bufout = vld1_f32(buffer);
+
+         vst1_f32(buffer, vmla_n_f32(out, bufout, a->feedback));
+         out                = vsub_f32(bufout, out);
+
+         if (++a->bufidx >= a->bufsize)
+            a->bufidx = 0;
+      }
+
+      vst1_f32(samples, vmla_n_f32(vmul_n_f32(in, rev->dry), out, rev->wet1));
+   }
+}
+#endif
+
 static void revmodel_update(struct revmodel *rev)
 {
    int i;
@@ -241,7 +359,7 @@ static void revmodel_init(struct revmodel *rev)
 
 struct reverb_data
 {
-   struct revmodel left, right;
+   struct revmodel rev;
 };
 
 static void reverb_free(void *data)
@@ -261,13 +379,32 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    out                     = output->samples;
 
    for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in[2] = { out[0], out[1] };
+      revmodel_process(&rev->rev, out);
+}
 
-      out[0] = revmodel_process(&rev->left, in[0]);
-      out[1] = revmodel_process(&rev->right, in[1]);
-   }
+#if defined(__SSE__)
+static void reverb_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples         = input->samples;
+   output->frames          = input->frames;
+
+   revmodel_process_sse(&rev->rev, output->samples, output->frames);
+}
+#elif defined(__ARM_NEON__)
+static void reverb_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples         = input->samples;
+   output->frames          = input->frames;
+
+   revmodel_process_neon(&rev->rev, output->samples, output->frames);
 }
+#endif
 
 static void *reverb_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
@@ -284,20 +421,13 @@ static void *reverb_init(const struct dspfilter_info *info,
    config->get_float(userdata, "roomwidth", &roomwidth, 0.56f);
    config->get_float(userdata, "roomsize", &roomsize, 0.56f);
 
-   revmodel_init(&rev->left);
-   revmodel_init(&rev->right);
-
-   revmodel_setdamp(&rev->left, damping);
-   revmodel_setdry(&rev->left, drytime);
-   revmodel_setwet(&rev->left, wettime);
-   revmodel_setwidth(&rev->left, roomwidth);
-   revmodel_setroomsize(&rev->left, roomsize);
+   revmodel_init(&rev->rev);
 
-   revmodel_setdamp(&rev->right, damping);
-   revmodel_setdry(&rev->right, drytime);
-   revmodel_setwet(&rev->right, wettime);
-   revmodel_setwidth(&rev->right, roomwidth);
-   revmodel_setroomsize(&rev->right, roomsize);
+   revmodel_setdamp(&rev->rev, damping);
+   revmodel_setdry(&rev->rev, drytime);
+   revmodel_setwet(&rev->rev, wettime);
+   revmodel_setwidth(&rev->rev, roomwidth);
+   revmodel_setroomsize(&rev->rev, roomsize);
 
    return rev;
 }
@@ -312,12 +442,41 @@ static const struct dspfilter_implementation reverb_plug = {
    "reverb",
 };
 
+#if defined(__SSE__)
+static const struct dspfilter_implementation reverb_plug_sse = {
+   reverb_init,
+   reverb_process_sse,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb",
+   "reverb",
+};
+#elif defined(__ARM_NEON__)
+static const struct dspfilter_implementation reverb_plug_neon = {
+   reverb_init,
+   reverb_process_neon,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb",
+   "reverb",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation reverb_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if defined(__SSE__)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &reverb_plug_sse;
+#elif defined(__ARM_NEON__)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &reverb_plug_neon;
+#endif
    (void)mask;
    return &reverb_plug;
 }
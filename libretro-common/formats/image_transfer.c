@@ -202,6 +202,26 @@ void image_transfer_set_buffer_ptr(
    }
 }
 
+/* Only a hint, formats that can't decode at
+ * a reduced size ignore it. */
+void image_transfer_set_target_size(void *data,
+      enum image_type_enum type, unsigned width, unsigned height)
+{
+   switch (type)
+   {
+      case IMAGE_TYPE_JPEG:
+#ifdef HAVE_RJPEG
+         rjpeg_set_target_size((rjpeg_t*)data, width, height);
+#endif
+         break;
+      case IMAGE_TYPE_PNG:
+      case IMAGE_TYPE_TGA:
+      case IMAGE_TYPE_BMP:
+      case IMAGE_TYPE_NONE:
+         break;
+   }
+}
+
 int image_transfer_process(
       void *data,
       enum image_type_enum type,
@@ -35,6 +35,10 @@
 #include <formats/rjpeg.h>
 #include <features/features_cpu.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 enum
 {
    RJPEG_DEFAULT = 0, /* only used for req_comp */
@@ -65,9 +69,23 @@ typedef struct
    int ypos;    /* which pre-expansion row we're on */
 } rjpeg__resample;
 
+/* Upper bound of worker threads used to resample and
+ * color-convert a single image. */
+#define RJPEG_MAX_THREADS 8
+
+/* Images with less rows than this per thread are converted
+ * on the calling thread only. */
+#define RJPEG_MIN_THREAD_ROWS 128
+
+/* Scans with restart markers and less MCUs than this per
+ * thread are entropy decoded on the calling thread only. */
+#define RJPEG_MIN_THREAD_MCUS 256
+
 struct rjpeg
 {
    uint8_t *buff_data;
+   unsigned target_width;
+   unsigned target_height;
 };
 
 #ifdef _MSC_VER
@@ -124,6 +142,10 @@ struct rjpeg
 
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 /* ARM NEON */
 #if defined(RJPEG_NO_SIMD) && defined(RJPEG_NEON)
 #undef RJPEG_NEON
@@ -228,6 +250,11 @@ typedef struct
    int scan_n, order[4];
    int restart_interval, todo;
 
+   /* DCT scaling, blocks are decoded to (8 >> idct_shift)^2 pixels
+    * as long as the image still covers target_x by target_y */
+   unsigned target_x, target_y;
+   int idct_shift;
+
    /* kernels */
    void (*idct_block_kernel)(uint8_t *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(uint8_t *out, const uint8_t *y, const uint8_t *pcb,
@@ -775,7 +802,7 @@ static INLINE uint8_t rjpeg__clamp(int x)
 {
    /* trick to use a single test to catch both cases */
    if ((unsigned int) x > 255)
-      return 255;
+      return x < 0 ? 0 : 255;
    return (uint8_t) x;
 }
 
@@ -882,6 +909,75 @@ static void rjpeg__idct_block(uint8_t *out, int out_stride, short data[64])
    }
 }
 
+/* Reduced IDCTs for DCT scaled decoding. Every output pixel is the
+ * n-point IDCT of the lowest n x n frequencies, which approximates
+ * the average of the 8/n x 8/n pixels it stands for. */
+static const int rjpeg__idct_4x4_table[16] =
+{
+   rjpeg__f2f(0.707106781),  rjpeg__f2f(0.923879533),
+   rjpeg__f2f(0.707106781),  rjpeg__f2f(0.382683433),
+   rjpeg__f2f(0.707106781),  rjpeg__f2f(0.382683433),
+   -rjpeg__f2f(0.707106781), -rjpeg__f2f(0.923879533),
+   rjpeg__f2f(0.707106781),  -rjpeg__f2f(0.382683433),
+   -rjpeg__f2f(0.707106781), rjpeg__f2f(0.923879533),
+   rjpeg__f2f(0.707106781),  -rjpeg__f2f(0.923879533),
+   rjpeg__f2f(0.707106781),  -rjpeg__f2f(0.382683433)
+};
+
+static const int rjpeg__idct_2x2_table[4] =
+{
+   rjpeg__f2f(0.707106781),  rjpeg__f2f(0.707106781),
+   rjpeg__f2f(0.707106781),  -rjpeg__f2f(0.707106781)
+};
+
+static void rjpeg__idct_reduced(uint8_t *out, int out_stride,
+      short data[64], const int *table, int n)
+{
+   int i, j, k;
+   int tmp[16];
+
+   /* columns, table entries are scaled by 4096 and the
+    * 1/4 normalization is split over both passes */
+   for (i = 0; i < n; ++i)
+   {
+      for (j = 0; j < n; ++j)
+      {
+         int sum = 0;
+         for (k = 0; k < n; ++k)
+            sum += data[k*8 + i] * table[j*n + k];
+         tmp[j*n + i] = (sum + (1 << 12)) >> 13;
+      }
+   }
+
+   /* rows, also adding back the 128 level shift */
+   for (j = 0; j < n; ++j, out += out_stride)
+   {
+      for (i = 0; i < n; ++i)
+      {
+         int sum = 0;
+         for (k = 0; k < n; ++k)
+            sum += tmp[j*n + k] * table[i*n + k];
+         out[i] = rjpeg__clamp((sum + (1 << 12) + (128 << 13)) >> 13);
+      }
+   }
+}
+
+static void rjpeg__idct_block_4x4(uint8_t *out, int out_stride, short data[64])
+{
+   rjpeg__idct_reduced(out, out_stride, data, rjpeg__idct_4x4_table, 4);
+}
+
+static void rjpeg__idct_block_2x2(uint8_t *out, int out_stride, short data[64])
+{
+   rjpeg__idct_reduced(out, out_stride, data, rjpeg__idct_2x2_table, 2);
+}
+
+/* the DC coefficient alone is the block average */
+static void rjpeg__idct_block_1x1(uint8_t *out, int out_stride, short data[64])
+{
+   out[0] = rjpeg__clamp(((data[0] + 4) >> 3) + 128);
+}
+
 #if defined(__SSE2__)
 /* sse2 integer IDCT. not the fastest possible implementation but it
  * produces bit-identical results to the generic C version so it's
@@ -1312,83 +1408,299 @@ static void rjpeg__jpeg_reset(rjpeg__jpeg *j)
     * since we don't even allow 1<<30 pixels */
 }
 
-static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
+/* number of MCUs in the current scan; every block is an MCU
+ * of its own in a non-interleaved scan */
+static int rjpeg__scan_mcu_count(const rjpeg__jpeg *z)
 {
-   rjpeg__jpeg_reset(z);
+   if (z->scan_n == 1)
+   {
+      int n = z->order[0];
+      return ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   }
+
+   return z->img_mcu_x * z->img_mcu_y;
+}
+
+/* decode the baseline MCUs [first, last) of the current scan,
+ * continuing from the current entropy decoder state */
+static int rjpeg__decode_baseline_mcus(rjpeg__jpeg *z, int first, int last)
+{
+   int m;
+   int bs = 8 >> z->idct_shift;
+   RJPEG_SIMD_ALIGN(short, data[64]);
 
    if (z->scan_n == 1)
    {
-      int i,j;
       int n = z->order[0];
       int w = (z->img_comp[n].x+7) >> 3;
-      int h = (z->img_comp[n].y+7) >> 3;
+      int i = first % w;
+      int j = first / w;
 
       /* non-interleaved data, we just need to process one block at a time,
        * in trivial scanline order
        * number of blocks to do just depends on how many actual "pixels" this
        * component has, independent of interleaved MCU blocking and such */
+      for (m = first; m < last; ++m)
+      {
+         int ha = z->img_comp[n].ha;
+         if (!rjpeg__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd,
+                  z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]))
+            return 0;
+
+         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*bs+i*bs,
+               z->img_comp[n].w2, data);
+
+         if (++i == w)
+         {
+            i = 0;
+            ++j;
+         }
 
-      if (z->progressive)
+         /* every data block is an MCU, so countdown the restart interval */
+         if (--z->todo <= 0)
+         {
+            if (z->code_bits < 24)
+               rjpeg__grow_buffer_unsafe(z);
+
+            /* if it's NOT a restart, then just bail, 
+             * so we get corrupt data rather than no data */
+            if (!RJPEG__RESTART(z->marker))
+               return 1;
+            rjpeg__jpeg_reset(z);
+         }
+      }
+   }
+   else
+   {
+      /* interleaved */
+      int k,x,y;
+      int i = first % z->img_mcu_x;
+      int j = first / z->img_mcu_x;
+
+      for (m = first; m < last; ++m)
       {
-         for (j=0; j < h; ++j)
+         /* scan an interleaved MCU... process scan_n components in order */
+         for (k=0; k < z->scan_n; ++k)
          {
-            for (i=0; i < w; ++i)
+            int n = z->order[k];
+            /* scan out an MCU's worth of this component; that's just determined
+             * by the basic H and V specified for the component */
+            for (y=0; y < z->img_comp[n].v; ++y)
             {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-
-               if (z->spec_start == 0)
-               {
-                  if (!rjpeg__jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
-                     return 0;
-               }
-               else
+               for (x=0; x < z->img_comp[n].h; ++x)
                {
+                  int x2 = (i*z->img_comp[n].h + x)*bs;
+                  int y2 = (j*z->img_comp[n].v + y)*bs;
                   int ha = z->img_comp[n].ha;
-                  if (!rjpeg__jpeg_decode_block_prog_ac(z, data, &z->huff_ac[ha], z->fast_ac[ha]))
-                     return 0;
-               }
 
-               /* every data block is an MCU, so countdown the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg__grow_buffer_unsafe(z);
+                  if (!rjpeg__jpeg_decode_block(z, data,
+                           z->huff_dc+z->img_comp[n].hd,
+                           z->huff_ac+ha, z->fast_ac[ha],
+                           n, z->dequant[z->img_comp[n].tq]))
+                     return 0;
 
-                  if (!RJPEG__RESTART(z->marker))
-                     return 1;
-                  rjpeg__jpeg_reset(z);
+                  z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2,
+                        z->img_comp[n].w2, data);
                }
             }
          }
+
+         if (++i == z->img_mcu_x)
+         {
+            i = 0;
+            ++j;
+         }
+
+         /* after all interleaved components, that's an interleaved MCU,
+          * so now count down the restart interval */
+         if (--z->todo <= 0)
+         {
+            if (z->code_bits < 24)
+               rjpeg__grow_buffer_unsafe(z);
+            if (!RJPEG__RESTART(z->marker))
+               return 1;
+            rjpeg__jpeg_reset(z);
+         }
       }
-      else
+   }
+
+   return 1;
+}
+
+#ifdef HAVE_THREADS
+typedef struct
+{
+   rjpeg__jpeg z;
+   rjpeg__context s;
+   int first;
+   int last;
+   int ret;
+} rjpeg__decode_job;
+
+static void rjpeg__decode_intervals(void *data)
+{
+   rjpeg__decode_job *job = (rjpeg__decode_job*)data;
+
+   job->z.s = &job->s;
+   rjpeg__jpeg_reset(&job->z);
+   job->ret = rjpeg__decode_baseline_mcus(&job->z, job->first, job->last);
+}
+
+/* A restart marker resets the entropy decoder and the DC predictions,
+ * so once the scan has been searched for them, runs of restart intervals
+ * can be decoded independently. Returns -1 if the scan has to be
+ * decoded sequentially instead. */
+static int rjpeg__parse_entropy_coded_data_threaded(rjpeg__jpeg *z)
+{
+   int total, intervals, found;
+   unsigned threads, next, t;
+   uint8_t *p, *end;
+   rjpeg__decode_job *jobs;
+   sthread_t *workers[RJPEG_MAX_THREADS] = {NULL};
+   int ret = 1;
+
+   if (z->progressive || !z->restart_interval)
+      return -1;
+
+   total     = rjpeg__scan_mcu_count(z);
+   intervals = (total + z->restart_interval - 1) / z->restart_interval;
+   threads   = cpu_features_get_core_amount();
+
+   if (threads > RJPEG_MAX_THREADS)
+      threads = RJPEG_MAX_THREADS;
+   if (threads > (unsigned)intervals)
+      threads = intervals;
+   if (threads > (unsigned)(total / RJPEG_MIN_THREAD_MCUS))
+      threads = total / RJPEG_MIN_THREAD_MCUS;
+   if (threads < 2)
+      return -1;
+
+   if (!(jobs = (rjpeg__decode_job*)malloc(threads * sizeof(*jobs))))
+      return -1;
+
+   for (t = 0; t < threads; ++t)
+   {
+      int first      = (int)(((int64_t)intervals * t) / threads);
+      int last       = (int)(((int64_t)intervals * (t + 1)) / threads);
+
+      jobs[t].z      = *z;
+      jobs[t].s      = *z->s;
+      jobs[t].first  = first * z->restart_interval;
+      jobs[t].last   = last  * z->restart_interval;
+      jobs[t].ret    = 0;
+      if (jobs[t].last > total)
+         jobs[t].last = total;
+   }
+
+   /* find the start of the first interval of every job, the scan
+    * ends at the first marker that isn't a restart marker */
+   p     = z->s->img_buffer;
+   end   = z->s->img_buffer_end;
+   found = 0;
+   next  = 1;
+
+   while (p + 1 < end)
+   {
+      if (p[0] != 0xff)
+         p++;
+      else if (p[1] == 0x00)
+         p += 2;
+      else if (p[1] == 0xff) /* fill byte */
+         p++;
+      else if (RJPEG__RESTART(p[1]))
       {
-         RJPEG_SIMD_ALIGN(short, data[64]);
+         p += 2;
+         found++;
+         if (     next < threads
+               && found * z->restart_interval == jobs[next].first)
+            jobs[next++].s.img_buffer = p;
+      }
+      else
+         break;
+   }
+
+   /* missing or extra restart markers, let the sequential decoder
+    * deal with the damage */
+   if (next < threads || found != intervals - 1)
+   {
+      free(jobs);
+      return -1;
+   }
+
+   for (t = 1; t < threads; ++t)
+      workers[t] = sthread_create(rjpeg__decode_intervals, &jobs[t]);
+
+   rjpeg__decode_intervals(&jobs[0]);
+
+   for (t = 1; t < threads; ++t)
+   {
+      /* Thread creation failed, decode these intervals here. */
+      if (!workers[t])
+         rjpeg__decode_intervals(&jobs[t]);
+      else
+         sthread_join(workers[t]);
+   }
+
+   for (t = 0; t < threads; ++t)
+      if (!jobs[t].ret)
+         ret = 0;
+
+   free(jobs);
+
+   /* leave the stream at the marker that ended the scan */
+   z->s->img_buffer = p;
+   z->marker        = RJPEG__MARKER_NONE;
+   return ret;
+}
+#endif
+
+static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
+{
+#ifdef HAVE_THREADS
+   int ret = rjpeg__parse_entropy_coded_data_threaded(z);
+   if (ret >= 0)
+      return ret;
+#endif
 
-         for (j=0; j < h; ++j)
+   rjpeg__jpeg_reset(z);
+
+   if (!z->progressive)
+      return rjpeg__decode_baseline_mcus(z, 0, rjpeg__scan_mcu_count(z));
+
+   if (z->scan_n == 1)
+   {
+      int i,j;
+      int n = z->order[0];
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+
+      for (j=0; j < h; ++j)
+      {
+         for (i=0; i < w; ++i)
          {
-            for (i=0; i < w; ++i)
+            short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+
+            if (z->spec_start == 0)
+            {
+               if (!rjpeg__jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
+                  return 0;
+            }
+            else
             {
                int ha = z->img_comp[n].ha;
-               if (!rjpeg__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd,
-                        z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]))
+               if (!rjpeg__jpeg_decode_block_prog_ac(z, data, &z->huff_ac[ha], z->fast_ac[ha]))
                   return 0;
+            }
 
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
-                     z->img_comp[n].w2, data);
+            /* every data block is an MCU, so countdown the restart interval */
+            if (--z->todo <= 0)
+            {
+               if (z->code_bits < 24)
+                  rjpeg__grow_buffer_unsafe(z);
 
-               /* every data block is an MCU, so countdown the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg__grow_buffer_unsafe(z);
-
-                  /* if it's NOT a restart, then just bail, 
-                   * so we get corrupt data rather than no data */
-                  if (!RJPEG__RESTART(z->marker))
-                     return 1;
-                  rjpeg__jpeg_reset(z);
-               }
+               if (!RJPEG__RESTART(z->marker))
+                  return 1;
+               rjpeg__jpeg_reset(z);
             }
          }
       }
@@ -1398,88 +1710,38 @@ static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
       /* interleaved */
       int i,j,k,x,y;
 
-      if (z->progressive)
+      for (j=0; j < z->img_mcu_y; ++j)
       {
-         for (j=0; j < z->img_mcu_y; ++j)
+         for (i=0; i < z->img_mcu_x; ++i)
          {
-            for (i=0; i < z->img_mcu_x; ++i)
+            /* scan an interleaved MCU... process scan_n components in order */
+            for (k=0; k < z->scan_n; ++k)
             {
-               /* scan an interleaved MCU... process scan_n components in order */
-               for (k=0; k < z->scan_n; ++k)
+               int n = z->order[k];
+               /* scan out an MCU's worth of this component; that's just determined
+                * by the basic H and V specified for the component */
+               for (y=0; y < z->img_comp[n].v; ++y)
                {
-                  int n = z->order[k];
-                  /* scan out an MCU's worth of this component; that's just determined
-                   * by the basic H and V specified for the component */
-                  for (y=0; y < z->img_comp[n].v; ++y)
+                  for (x=0; x < z->img_comp[n].h; ++x)
                   {
-                     for (x=0; x < z->img_comp[n].h; ++x)
-                     {
-                        int x2 = (i*z->img_comp[n].h + x);
-                        int y2 = (j*z->img_comp[n].v + y);
-                        short *data = z->img_comp[n].coeff + 64 * (x2 + y2 * z->img_comp[n].coeff_w);
-                        if (!rjpeg__jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
-                           return 0;
-                     }
+                     int x2 = (i*z->img_comp[n].h + x);
+                     int y2 = (j*z->img_comp[n].v + y);
+                     short *data = z->img_comp[n].coeff + 64 * (x2 + y2 * z->img_comp[n].coeff_w);
+                     if (!rjpeg__jpeg_decode_block_prog_dc(z, data, &z->huff_dc[z->img_comp[n].hd], n))
+                        return 0;
                   }
                }
-
-               /* after all interleaved components, that's an interleaved MCU,
-                * so now count down the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg__grow_buffer_unsafe(z);
-                  if (!RJPEG__RESTART(z->marker))
-                     return 1;
-                  rjpeg__jpeg_reset(z);
-               }
             }
-         }
-      }
-      else
-      {
-         RJPEG_SIMD_ALIGN(short, data[64]);
 
-         for (j=0; j < z->img_mcu_y; ++j)
-         {
-            for (i=0; i < z->img_mcu_x; ++i)
+            /* after all interleaved components, that's an interleaved MCU,
+             * so now count down the restart interval */
+            if (--z->todo <= 0)
             {
-               /* scan an interleaved MCU... process scan_n components in order */
-               for (k=0; k < z->scan_n; ++k)
-               {
-                  int n = z->order[k];
-                  /* scan out an MCU's worth of this component; that's just determined
-                   * by the basic H and V specified for the component */
-                  for (y=0; y < z->img_comp[n].v; ++y)
-                  {
-                     for (x=0; x < z->img_comp[n].h; ++x)
-                     {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-
-                        if (!rjpeg__jpeg_decode_block(z, data,
-                                 z->huff_dc+z->img_comp[n].hd,
-                                 z->huff_ac+ha, z->fast_ac[ha],
-                                 n, z->dequant[z->img_comp[n].tq]))
-                           return 0;
-
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2,
-                              z->img_comp[n].w2, data);
-                     }
-                  }
-               }
-
-               /* after all interleaved components, that's an interleaved MCU,
-                * so now count down the restart interval */
-               if (--z->todo <= 0)
-               {
-                  if (z->code_bits < 24)
-                     rjpeg__grow_buffer_unsafe(z);
-                  if (!RJPEG__RESTART(z->marker))
-                     return 1;
-                  rjpeg__jpeg_reset(z);
-               }
+               if (z->code_bits < 24)
+                  rjpeg__grow_buffer_unsafe(z);
+               if (!RJPEG__RESTART(z->marker))
+                  return 1;
+               rjpeg__jpeg_reset(z);
             }
          }
       }
@@ -1498,6 +1760,7 @@ static void rjpeg__jpeg_dequantize(short *data, uint8_t *dequant)
 static void rjpeg__jpeg_finish(rjpeg__jpeg *z)
 {
    int i,j,n;
+   int bs = 8 >> z->idct_shift;
 
    if (!z->progressive)
       return;
@@ -1513,7 +1776,7 @@ static void rjpeg__jpeg_finish(rjpeg__jpeg *z)
          {
             short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
             rjpeg__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-            z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
+            z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*bs+i*bs,
                   z->img_comp[n].w2, data);
          }
       }
@@ -1791,6 +2054,29 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
    z->img_mcu_x = (s->img_x + z->img_mcu_w-1) / z->img_mcu_w;
    z->img_mcu_y = (s->img_y + z->img_mcu_h-1) / z->img_mcu_h;
 
+   /* pick the smallest DCT scale that still covers the target size */
+   z->idct_shift = 0;
+   if (z->target_x || z->target_y)
+   {
+      while (z->idct_shift < 3
+            && (s->img_x >> (z->idct_shift + 1)) >= z->target_x
+            && (s->img_y >> (z->idct_shift + 1)) >= z->target_y)
+         z->idct_shift++;
+   }
+
+   switch (z->idct_shift)
+   {
+      case 1:
+         z->idct_block_kernel = rjpeg__idct_block_4x4;
+         break;
+      case 2:
+         z->idct_block_kernel = rjpeg__idct_block_2x2;
+         break;
+      case 3:
+         z->idct_block_kernel = rjpeg__idct_block_1x1;
+         break;
+   }
+
    if (z->progressive)
    {
       for (i=0; i < s->img_n; ++i)
@@ -1803,8 +2089,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
           * the bogus oversized data from using interleaved MCUs and their
           * big blocks (e.g. a 16x16 iMCU on an image of width 33); we won't
           * discard the extra data until colorspace conversion */
-         z->img_comp[i].w2       = z->img_mcu_x * z->img_comp[i].h * 8;
-         z->img_comp[i].h2       = z->img_mcu_y * z->img_comp[i].v * 8;
+         z->img_comp[i].w2       = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->idct_shift;
+         z->img_comp[i].h2       = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->idct_shift;
          z->img_comp[i].raw_data = malloc(z->img_comp[i].w2 * z->img_comp[i].h2+15);
 
          /* Out of memory? */
@@ -1822,8 +2108,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
          /* align blocks for IDCT using MMX/SSE */
          z->img_comp[i].data      = (uint8_t*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
          z->img_comp[i].linebuf   = NULL;
-         z->img_comp[i].coeff_w   = (z->img_comp[i].w2 + 7) >> 3;
-         z->img_comp[i].coeff_h   = (z->img_comp[i].h2 + 7) >> 3;
+         z->img_comp[i].coeff_w   = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h   = z->img_mcu_y * z->img_comp[i].v;
          z->img_comp[i].raw_coeff = malloc(z->img_comp[i].coeff_w * 
                                     z->img_comp[i].coeff_h * 64 * sizeof(short) + 15);
          z->img_comp[i].coeff     = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -1841,8 +2127,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
           * the bogus oversized data from using interleaved MCUs and their
           * big blocks (e.g. a 16x16 iMCU on an image of width 33); we won't
           * discard the extra data until colorspace conversion */
-         z->img_comp[i].w2       = z->img_mcu_x * z->img_comp[i].h * 8;
-         z->img_comp[i].h2       = z->img_mcu_y * z->img_comp[i].v * 8;
+         z->img_comp[i].w2       = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->idct_shift;
+         z->img_comp[i].h2       = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->idct_shift;
          z->img_comp[i].raw_data = malloc(z->img_comp[i].w2 * z->img_comp[i].h2+15);
 
          /* Out of memory? */
@@ -2166,6 +2452,72 @@ static uint8_t *rjpeg__resample_row_hv_2_simd(uint8_t *out, uint8_t *in_near,
 }
 #endif
 
+#if defined(__AVX2__)
+/* same filter as the SSE2 version, 16 pixels at a time */
+static uint8_t *rjpeg__resample_row_hv_2_avx2(uint8_t *out, uint8_t *in_near,
+      uint8_t *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+   __m256i bias = _mm256_set1_epi16(8);
+
+   if (w == 1)
+   {
+      out[0] = out[1] = rjpeg__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+
+   for (; i < ((w-1) & ~15); i += 16)
+   {
+      /* vertical pass, 3*x + y = 4*x + (y - x) */
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff);
+
+      /* shift the current row by one pixel across both 128-bit lanes,
+       * filling in the neighbours of this block of 16 pixels */
+      __m256i lo   = _mm256_permute2x128_si256(curr, curr, 0x08);
+      __m256i hi   = _mm256_permute2x128_si256(curr, curr, 0x81);
+      __m256i prev = _mm256_insert_epi16(_mm256_alignr_epi8(curr, lo, 14), t1, 0);
+      __m256i next = _mm256_insert_epi16(_mm256_alignr_epi8(hi, curr, 2),
+            3*in_near[i+16] + in_far[i+16], 15);
+
+      /* horizontal pass, even = cur*4 + (prev - cur), odd = cur*4 + (next - cur) */
+      __m256i curb = _mm256_add_epi16(_mm256_slli_epi16(curr, 2), bias);
+      __m256i even = _mm256_add_epi16(_mm256_sub_epi16(prev, curr), curb);
+      __m256i odd  = _mm256_add_epi16(_mm256_sub_epi16(next, curr), curb);
+
+      /* interleaving and packing both stay within each lane,
+       * which keeps the output in order */
+      __m256i de0  = _mm256_srli_epi16(_mm256_unpacklo_epi16(even, odd), 4);
+      __m256i de1  = _mm256_srli_epi16(_mm256_unpackhi_epi16(even, odd), 4);
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_packus_epi16(de0, de1));
+
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0       = t1;
+   t1       = 3*in_near[i] + in_far[i];
+   out[i*2] = rjpeg__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i)
+   {
+      t0         = t1;
+      t1         = 3*in_near[i]+in_far[i];
+      out[i*2-1] = rjpeg__div16(3*t0 + t1 + 8);
+      out[i*2  ] = rjpeg__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = rjpeg__div4(t1+2);
+
+   (void)hs;
+
+   return out;
+}
+#endif
+
 static uint8_t *rjpeg__resample_row_generic(uint8_t *out,
       uint8_t *in_near, uint8_t *in_far, int w, int hs)
 {
@@ -2201,11 +2553,11 @@ static void rjpeg__YCbCr_to_RGB_row(uint8_t *out, const uint8_t *y,
       g >>= 20;
       b >>= 20;
       if ((unsigned) r > 255)
-         r = 255;
+         r = r < 0 ? 0 : 255;
       if ((unsigned) g > 255)
-         g = 255;
+         g = g < 0 ? 0 : 255;
       if ((unsigned) b > 255)
-         b = 255;
+         b = b < 0 ? 0 : 255;
       out[0] = (uint8_t)r;
       out[1] = (uint8_t)g;
       out[2] = (uint8_t)b;
@@ -2345,11 +2697,11 @@ static void rjpeg__YCbCr_to_RGB_simd(uint8_t *out, const uint8_t *y,
       g >>= 20;
       b >>= 20;
       if ((unsigned) r > 255)
-         r = 255;
+         r = r < 0 ? 0 : 255;
       if ((unsigned) g > 255)
-         g = 255;
+         g = g < 0 ? 0 : 255;
       if ((unsigned) b > 255)
-         b = 255;
+         b = b < 0 ? 0 : 255;
       out[0] = (uint8_t)r;
       out[1] = (uint8_t)g;
       out[2] = (uint8_t)b;
@@ -2359,6 +2711,73 @@ static void rjpeg__YCbCr_to_RGB_simd(uint8_t *out, const uint8_t *y,
 }
 #endif
 
+#if defined(__AVX2__)
+/* same arithmetic as the SSE2 version, 16 pixels at a time,
+ * the rest of the row is left to it */
+static void rjpeg__YCbCr_to_RGB_avx2(uint8_t *out, const uint8_t *y,
+      const uint8_t *pcb, const uint8_t *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4)
+   {
+      __m256i signflip  = _mm256_set1_epi8(-0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias    = _mm256_set1_epi16(128);
+      __m256i xw        = _mm256_set1_epi16(255); /* alpha channel */
+
+      for (; i+15 < count; i += 16)
+      {
+         /* load, widening to (y << 8) + 128 and (c - 128) << 8
+          * as the SSE2 unpacks do */
+         __m256i y_words  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y+i)));
+         __m256i cr_bytes = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i *) (pcr+i)));
+         __m256i cb_bytes = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i *) (pcb+i)));
+         __m256i yw       = _mm256_or_si256(_mm256_slli_epi16(y_words, 8), y_bias);
+         __m256i crw      = _mm256_slli_epi16(_mm256_xor_si256(cr_bytes, signflip), 8);
+         __m256i cbw      = _mm256_slli_epi16(_mm256_xor_si256(cb_bytes, signflip), 8);
+
+         /* color transform */
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         /* descale */
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         /* back to byte and interleave, each lane ends up with
+          * pixels 0-3 | 8-11 and 4-7 | 12-15 */
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0  = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1  = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0  = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1  = _mm256_unpackhi_epi16(t0, t1);
+
+         /* store in pixel order */
+         _mm256_storeu_si256((__m256i *) (out + 0),
+               _mm256_permute2x128_si256(o0, o1, 0x20));
+         _mm256_storeu_si256((__m256i *) (out + 32),
+               _mm256_permute2x128_si256(o0, o1, 0x31));
+         out += 64;
+      }
+   }
+
+   rjpeg__YCbCr_to_RGB_simd(out, y + i, pcb + i, pcr + i, count - i, step);
+}
+#endif
+
 /* set up the kernels */
 static void rjpeg__setup_jpeg(rjpeg__jpeg *j)
 {
@@ -2380,6 +2799,14 @@ static void rjpeg__setup_jpeg(rjpeg__jpeg *j)
    }
 #endif
 
+#if defined(__AVX2__)
+   if (mask & RETRO_SIMD_AVX2)
+   {
+      j->YCbCr_to_RGB_kernel      = rjpeg__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = rjpeg__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef RJPEG_NEON
    j->idct_block_kernel           = rjpeg__idct_simd;
    j->YCbCr_to_RGB_kernel         = rjpeg__YCbCr_to_RGB_simd;
@@ -2415,17 +2842,129 @@ static void rjpeg__cleanup_jpeg(rjpeg__jpeg *j)
    }
 }
 
+typedef struct
+{
+   rjpeg__jpeg *z;
+   rjpeg__resample res_comp[4];
+   uint8_t *linebuf[4];
+   uint8_t *output;
+   int n;
+   int decode_n;
+   unsigned y_start;
+   unsigned y_end;
+} rjpeg__convert_job;
+
+/* Positions the resampler state of every component at output
+ * row y_start, as if rows 0..y_start-1 had been processed. */
+static void rjpeg__convert_job_seek(rjpeg__convert_job *job)
+{
+   int k;
+   rjpeg__jpeg *z = job->z;
+
+   for (k = 0; k < job->decode_n; ++k)
+   {
+      rjpeg__resample *r = &job->res_comp[k];
+      unsigned    total  = (r->vs >> 1) + job->y_start;
+      unsigned    wraps  = total / r->vs;
+      unsigned    last   = z->img_comp[k].y > 0 ? z->img_comp[k].y - 1 : 0;
+      unsigned    pos1   = wraps < last ? wraps : last;
+      unsigned    pos0   = wraps == 0 ? 0 : (wraps - 1 < last ? wraps - 1 : last);
+
+      r->ystep = total % r->vs;
+      r->ypos  = wraps;
+      r->line0 = z->img_comp[k].data + pos0 * z->img_comp[k].w2;
+      r->line1 = z->img_comp[k].data + pos1 * z->img_comp[k].w2;
+   }
+}
+
+/* Resamples and color-converts output rows [y_start, y_end). */
+static void rjpeg__convert_rows(void *data)
+{
+   unsigned i, j;
+   int k;
+   uint8_t *coutput[4]     = {0};
+   rjpeg__convert_job *job = (rjpeg__convert_job*)data;
+   rjpeg__jpeg *z          = job->z;
+   int n                   = job->n;
+
+   rjpeg__convert_job_seek(job);
+
+   for (j = job->y_start; j < job->y_end; ++j)
+   {
+      uint8_t *out = job->output + n * z->s->img_x * j;
+      for (k=0; k < job->decode_n; ++k)
+      {
+         rjpeg__resample *r = &job->res_comp[k];
+         int         y_bot  = r->ystep >= (r->vs >> 1);
+
+         coutput[k]         = r->resample(job->linebuf[k],
+               y_bot ? r->line1 : r->line0,
+               y_bot ? r->line0 : r->line1,
+               r->w_lores, r->hs);
+
+         if (++r->ystep >= r->vs)
+         {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y)
+               r->line1 += z->img_comp[k].w2;
+         }
+      }
+
+      if (n >= 3)
+      {
+         uint8_t *y = coutput[0];
+         if (z->s->img_n == 3)
+            z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+         else
+            for (i=0; i < z->s->img_x; ++i)
+            {
+               out[0] = out[1] = out[2] = y[i];
+               out[3] = 255; /* not used if n==3 */
+               out += n;
+            }
+      }
+      else
+      {
+         uint8_t *y = coutput[0];
+         if (n == 1)
+            for (i=0; i < z->s->img_x; ++i)
+               out[i] = y[i];
+         else
+            for (i=0; i < z->s->img_x; ++i)
+               *out++ = y[i], *out++ = 255;
+      }
+   }
+}
+
+#ifdef HAVE_THREADS
+static unsigned rjpeg__thread_count(const rjpeg__jpeg *z)
+{
+   unsigned threads = cpu_features_get_core_amount();
+   unsigned max     = z->s->img_y / RJPEG_MIN_THREAD_ROWS;
+
+   if (threads > RJPEG_MAX_THREADS)
+      threads = RJPEG_MAX_THREADS;
+   if (threads > max)
+      threads = max;
+
+   return threads ? threads : 1;
+}
+#endif
+
 static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
       unsigned *out_x, unsigned *out_y, int *comp, int req_comp)
 {
    int n, decode_n;
    int k;
-   unsigned int i,j;
-   rjpeg__resample res_comp[4];
-   uint8_t *coutput[4] = {0};
+   unsigned t;
+   unsigned threads    = 1;
+   rjpeg__convert_job jobs[RJPEG_MAX_THREADS];
    uint8_t *output     = NULL;
    z->s->img_n         = 0; /* make rjpeg__cleanup_jpeg safe */
 
+   memset(jobs, 0, sizeof(jobs));
+
    /* validate req_comp */
 
    /* Internal error? */
@@ -2436,6 +2975,21 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
    if (!rjpeg__decode_jpeg_image(z))
       goto error;
 
+   /* the component planes hold the DCT scaled image from here on */
+   if (z->idct_shift)
+   {
+      uint32_t round = (1 << z->idct_shift) - 1;
+
+      z->s->img_x = (z->s->img_x + round) >> z->idct_shift;
+      z->s->img_y = (z->s->img_y + round) >> z->idct_shift;
+
+      for (k = 0; k < z->s->img_n; ++k)
+      {
+         z->img_comp[k].x = (z->s->img_x * z->img_comp[k].h + z->img_h_max-1) / z->img_h_max;
+         z->img_comp[k].y = (z->s->img_y * z->img_comp[k].v + z->img_v_max-1) / z->img_v_max;
+      }
+   }
+
    /* determine actual number of components to generate */
    n = req_comp ? req_comp : z->s->img_n;
 
@@ -2444,10 +2998,14 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
    else
       decode_n = z->s->img_n;
 
+#ifdef HAVE_THREADS
+   threads = rjpeg__thread_count(z);
+#endif
+
    /* resample and color-convert */
    for (k=0; k < decode_n; ++k)
    {
-      rjpeg__resample *r = &res_comp[k];
+      rjpeg__resample *r = &jobs[0].res_comp[k];
 
       /* allocate line buffer big enough for upsampling off the edges
        * with upsample factor of 4 */
@@ -2471,6 +3029,30 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
          r->resample = rjpeg__resample_row_h_2;
       else if (r->hs == 2 && r->vs == 2)
          r->resample = z->resample_row_hv_2_kernel;
+
+      jobs[0].linebuf[k] = z->img_comp[k].linebuf;
+   }
+
+   /* Every extra worker needs its own line buffers,
+    * fall back to fewer workers if we run out of memory. */
+   for (t = 1; t < threads; ++t)
+   {
+      for (k = 0; k < decode_n; ++k)
+      {
+         jobs[t].res_comp[k] = jobs[0].res_comp[k];
+         jobs[t].linebuf[k]  = (uint8_t*)malloc(z->s->img_x + 3);
+         if (!jobs[t].linebuf[k])
+            break;
+      }
+
+      if (k < decode_n)
+      {
+         while (k-- > 0)
+            free(jobs[t].linebuf[k]);
+         memset(jobs[t].linebuf, 0, sizeof(jobs[t].linebuf));
+         threads = t;
+         break;
+      }
    }
 
    /* can't error after this so, this is safe */
@@ -2479,53 +3061,43 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
    if (!output)
       goto error;
 
+   for (t = 0; t < threads; ++t)
+   {
+      jobs[t].z        = z;
+      jobs[t].output   = output;
+      jobs[t].n        = n;
+      jobs[t].decode_n = decode_n;
+      jobs[t].y_start  = (unsigned)(((uint64_t)z->s->img_y * t) / threads);
+      jobs[t].y_end    = (unsigned)(((uint64_t)z->s->img_y * (t + 1)) / threads);
+   }
+
    /* now go ahead and resample */
-   for (j=0; j < z->s->img_y; ++j)
+#ifdef HAVE_THREADS
+   if (threads > 1)
    {
-      uint8_t *out = output + n * z->s->img_x * j;
-      for (k=0; k < decode_n; ++k)
-      {
-         rjpeg__resample *r = &res_comp[k];
-         int         y_bot  = r->ystep >= (r->vs >> 1);
+      sthread_t *workers[RJPEG_MAX_THREADS] = {NULL};
 
-         coutput[k]         = r->resample(z->img_comp[k].linebuf,
-               y_bot ? r->line1 : r->line0,
-               y_bot ? r->line0 : r->line1,
-               r->w_lores, r->hs);
+      for (t = 1; t < threads; ++t)
+         workers[t] = sthread_create(rjpeg__convert_rows, &jobs[t]);
 
-         if (++r->ystep >= r->vs)
-         {
-            r->ystep = 0;
-            r->line0 = r->line1;
-            if (++r->ypos < z->img_comp[k].y)
-               r->line1 += z->img_comp[k].w2;
-         }
-      }
+      rjpeg__convert_rows(&jobs[0]);
 
-      if (n >= 3)
-      {
-         uint8_t *y = coutput[0];
-         if (z->s->img_n == 3)
-            z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-         else
-            for (i=0; i < z->s->img_x; ++i)
-            {
-               out[0] = out[1] = out[2] = y[i];
-               out[3] = 255; /* not used if n==3 */
-               out += n;
-            }
-      }
-      else
+      for (t = 1; t < threads; ++t)
       {
-         uint8_t *y = coutput[0];
-         if (n == 1)
-            for (i=0; i < z->s->img_x; ++i)
-               out[i] = y[i];
+         /* Thread creation failed, convert these rows here. */
+         if (!workers[t])
+            rjpeg__convert_rows(&jobs[t]);
          else
-            for (i=0; i < z->s->img_x; ++i)
-               *out++ = y[i], *out++ = 255;
+            sthread_join(workers[t]);
       }
    }
+   else
+#endif
+      rjpeg__convert_rows(&jobs[0]);
+
+   for (t = 1; t < threads; ++t)
+      for (k = 0; k < decode_n; ++k)
+         free(jobs[t].linebuf[k]);
 
    rjpeg__cleanup_jpeg(z);
    *out_x = z->s->img_x;
@@ -2536,11 +3108,15 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
    return output;
 
 error:
+   for (t = 1; t < RJPEG_MAX_THREADS; ++t)
+      for (k = 0; k < 4; ++k)
+         free(jobs[t].linebuf[k]);
    rjpeg__cleanup_jpeg(z);
    return NULL;
 }
 
 static uint8_t *rjpeg_load_from_memory(const uint8_t *buffer, int len,
+      unsigned target_x, unsigned target_y,
       unsigned *x, unsigned *y, int *comp, int req_comp)
 {
    rjpeg__jpeg j;
@@ -2551,6 +3127,9 @@ static uint8_t *rjpeg_load_from_memory(const uint8_t *buffer, int len,
    s.img_buffer_end      = (uint8_t*)buffer+len;
 
    j.s                   = &s;
+   j.target_x            = target_x;
+   j.target_y            = target_y;
+   j.idct_shift          = 0;
    rjpeg__setup_jpeg(&j);
 
    return rjpeg_load_jpeg_image(&j, x,y,comp,req_comp);
@@ -2561,29 +3140,21 @@ int rjpeg_process_image(rjpeg_t *rjpeg, void **buf_data,
 {
    int comp;
    uint32_t *img         = NULL;
-   uint32_t *pixels      = NULL;
    unsigned size_tex     = 0;
 
    if (!rjpeg)
       return IMAGE_PROCESS_ERROR;
 
-   img   = (uint32_t*)rjpeg_load_from_memory(rjpeg->buff_data, (int)size, width, height, &comp, 4);
+   img   = (uint32_t*)rjpeg_load_from_memory(rjpeg->buff_data, (int)size,
+         rjpeg->target_width, rjpeg->target_height, width, height, &comp, 4);
 
    if (!img)
       return IMAGE_PROCESS_ERROR;
 
    size_tex = (*width) * (*height);
-   pixels   = (uint32_t*)malloc(size_tex * sizeof(uint32_t));
 
-   if (!pixels)
-   {
-      free(img);
-      return IMAGE_PROCESS_ERROR;
-   }
-
-   *buf_data = pixels;
-
-   /* Convert RGBA to ARGB */
+   /* Convert RGBA to ARGB in place, the decoded
+    * buffer is handed over to the caller. */
    while (size_tex--)
    {
       unsigned int texel = img[size_tex];
@@ -2591,10 +3162,10 @@ int rjpeg_process_image(rjpeg_t *rjpeg, void **buf_data,
       unsigned int B     = texel & 0x00FF0000;
       unsigned int G     = texel & 0x0000FF00;
       unsigned int R     = texel & 0x000000FF;
-      ((unsigned int*)pixels)[size_tex] = A | (R << 16) | G | (B >> 16);
+      img[size_tex]      = A | (R << 16) | G | (B >> 16);
    }
 
-   free(img);
+   *buf_data = img;
 
    return IMAGE_PROCESS_END;
 }
@@ -2609,6 +3180,16 @@ bool rjpeg_set_buf_ptr(rjpeg_t *rjpeg, void *data)
    return true;
 }
 
+void rjpeg_set_target_size(rjpeg_t *rjpeg,
+      unsigned width, unsigned height)
+{
+   if (!rjpeg)
+      return;
+
+   rjpeg->target_width  = width;
+   rjpeg->target_height = height;
+}
+
 void rjpeg_free(rjpeg_t *rjpeg)
 {
    if (!rjpeg)
@@ -29,6 +29,14 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SIMD_FILTERS
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_SIMD_FILTERS
+#endif
+
 #include <boolean.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
@@ -74,12 +82,6 @@ struct adam7_pass
    unsigned stride_y;
 };
 
-struct idat_buffer
-{
-   uint8_t *data;
-   size_t size;
-};
-
 struct png_chunk
 {
    uint32_t size;
@@ -92,6 +94,7 @@ struct rpng_process
    bool inflate_initialized;
    bool adam7_pass_initialized;
    bool pass_initialized;
+   bool inflate_rows;
    uint8_t *prev_scanline;
    uint8_t *decoded_scanline;
    uint8_t *inflate_buf;
@@ -112,6 +115,8 @@ struct rpng_process
    unsigned pass_pos;
    uint32_t *data;
    uint32_t *palette;
+   uint8_t *idat_next;
+   const uint8_t *idat_end;
    void *stream;
    const struct trans_stream_backend *stream_backend;
 };
@@ -124,9 +129,13 @@ struct rpng
    bool has_iend;
    bool has_plte;
    bool has_trns;
-   struct idat_buffer idat_buf;
    struct png_ihdr ihdr;
    uint8_t *buff_data;
+   /* IDAT chunks are inflated straight from the file
+    * buffer, from the first IDAT chunk header up to
+    * the end of the last one. */
+   uint8_t *idat_chunk;
+   const uint8_t *idat_end;
    uint32_t palette[256];
 };
 
@@ -159,6 +168,24 @@ static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
    return PNG_CHUNK_NOOP;
 }
 
+static bool read_chunk_header(uint8_t *buf, struct png_chunk *chunk)
+{
+   unsigned i;
+   uint8_t dword[4];
+
+   dword[0] = '\0';
+
+   for (i = 0; i < 4; i++)
+      dword[i] = buf[i];
+
+   chunk->size = dword_be(dword);
+
+   for (i = 0; i < 4; i++)
+      chunk->type[i] = buf[i + 4];
+
+   return true;
+}
+
 static bool png_process_ihdr(struct png_ihdr *ihdr)
 {
    unsigned i;
@@ -555,7 +582,8 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   /* Rows inflated on demand are checked as they are read. */
+   if (!pngp->inflate_rows && pngp->total_out < pass_size)
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -576,10 +604,233 @@ error:
    return -1;
 }
 
+static void png_reverse_filter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+      out[i] = in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = out[i - bpp] + in[i];
+}
+
+static void png_reverse_filter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i < pitch; i++)
+      out[i] = prev[i] + in[i];
+}
+
+static void png_reverse_filter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+   {
+      uint8_t avg = prev[i] >> 1;
+      out[i] = avg + in[i];
+   }
+   for (i = bpp; i < pitch; i++)
+   {
+      uint8_t avg = (out[i - bpp] + prev[i]) >> 1;
+      out[i] = avg + in[i];
+   }
+}
+
+static void png_reverse_filter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+      out[i] = paeth(0, prev[i], 0) + in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
+}
+
+/* 8-bit RGB and RGBA lines are unfiltered one pixel
+ * at a time with all channels in one register. */
+#if defined(__SSE2__)
+static INLINE __m128i png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   int32_t v = 0;
+   memcpy(&v, p, bpp);
+   return _mm_cvtsi32_si128(v);
+}
+
+static INLINE void png_store_pixel(uint8_t *p, __m128i v, unsigned bpp)
+{
+   int32_t out = _mm_cvtsi128_si32(v);
+   memcpy(p, &out, bpp);
+}
+
+static INLINE __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i png_select(__m128i cond, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+
+static void png_reverse_filter_sub_simd(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = _mm_add_epi8(a, png_load_pixel(in + i, bpp));
+      png_store_pixel(out + i, a, bpp);
+   }
+}
+
+static void png_reverse_filter_avg_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i ones = _mm_set1_epi8(1);
+   __m128i a          = _mm_setzero_si128();
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b   = png_load_pixel(prev + i, bpp);
+      /* _mm_avg_epu8 rounds up, PNG rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), ones));
+
+      a = _mm_add_epi8(avg, png_load_pixel(in + i, bpp));
+      png_store_pixel(out + i, a, bpp);
+   }
+}
+
+static void png_reverse_filter_paeth_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   const __m128i zero = _mm_setzero_si128();
+   __m128i a          = zero;
+   __m128i b          = zero;
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i pa, pb, pc, smallest, nearest;
+      __m128i c = b;
+      __m128i d = _mm_unpacklo_epi8(png_load_pixel(in + i, bpp), zero);
+
+      b         = _mm_unpacklo_epi8(png_load_pixel(prev + i, bpp), zero);
+
+      /* p = a + b - c, so p - a = b - c and p - b = a - c */
+      pa        = _mm_sub_epi16(b, c);
+      pb        = _mm_sub_epi16(a, c);
+      pc        = png_abs_epi16(_mm_add_epi16(pa, pb));
+      pa        = png_abs_epi16(pa);
+      pb        = png_abs_epi16(pb);
+
+      smallest  = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      nearest   = png_select(_mm_cmpeq_epi16(smallest, pb), b, c);
+      nearest   = png_select(_mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+      /* The high byte of each lane is zero, so byte-wise
+       * addition wraps the same way the scalar code does. */
+      a         = _mm_add_epi8(nearest, d);
+      png_store_pixel(out + i, _mm_packus_epi16(a, a), bpp);
+   }
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+static INLINE uint8x8_t png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static INLINE void png_store_pixel(uint8_t *p, uint8x8_t v, unsigned bpp)
+{
+   uint32_t out = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+   memcpy(p, &out, bpp);
+}
+
+static void png_reverse_filter_sub_simd(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      a = vadd_u8(a, png_load_pixel(in + i, bpp));
+      png_store_pixel(out + i, a, bpp);
+   }
+}
+
+static void png_reverse_filter_avg_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      /* vhadd truncates, which is what PNG wants. */
+      a = vadd_u8(vhadd_u8(a, png_load_pixel(prev + i, bpp)),
+            png_load_pixel(in + i, bpp));
+      png_store_pixel(out + i, a, bpp);
+   }
+}
+
+static void png_reverse_filter_paeth_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   int16x8_t a = vdupq_n_s16(0);
+   int16x8_t b = a;
+
+   for (i = 0; i < pitch; i += bpp)
+   {
+      int16x8_t pa, pb, pc, smallest, nearest;
+      uint8x8_t x;
+      int16x8_t c = b;
+
+      b         = vreinterpretq_s16_u16(vmovl_u8(
+               png_load_pixel(prev + i, bpp)));
+
+      /* p = a + b - c, so p - a = b - c and p - b = a - c */
+      pa        = vsubq_s16(b, c);
+      pb        = vsubq_s16(a, c);
+      pc        = vabsq_s16(vaddq_s16(pa, pb));
+      pa        = vabsq_s16(pa);
+      pb        = vabsq_s16(pb);
+
+      smallest  = vminq_s16(pc, vminq_s16(pa, pb));
+      nearest   = vbslq_s16(vceqq_s16(smallest, pb), b, c);
+      nearest   = vbslq_s16(vceqq_s16(smallest, pa), a, nearest);
+
+      x         = vadd_u8(vmovn_u16(vreinterpretq_u16_s16(nearest)),
+            png_load_pixel(in + i, bpp));
+      png_store_pixel(out + i, x, bpp);
+      a         = vreinterpretq_s16_u16(vmovl_u8(x));
+   }
+}
+#endif
+
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *swap;
+#if defined(RPNG_SIMD_FILTERS)
+   bool simd;
+#endif
+
+#if defined(RPNG_SIMD_FILTERS)
+   simd = pngp->bpp == 3 || pngp->bpp == 4;
+#endif
 
    switch (filter)
    {
@@ -587,33 +838,44 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+#if defined(RPNG_SIMD_FILTERS)
+         if (simd)
+         {
+            png_reverse_filter_sub_simd(pngp->decoded_scanline,
+                  pngp->inflate_buf, pngp->pitch, pngp->bpp);
+            break;
+         }
+#endif
+         png_reverse_filter_sub(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         png_reverse_filter_up(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
+#if defined(RPNG_SIMD_FILTERS)
+         if (simd)
          {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
+            png_reverse_filter_avg_simd(pngp->decoded_scanline,
+                  pngp->inflate_buf, pngp->prev_scanline, pngp->pitch, pngp->bpp);
+            break;
          }
+#endif
+         png_reverse_filter_avg(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+#if defined(RPNG_SIMD_FILTERS)
+         if (simd)
+         {
+            png_reverse_filter_paeth_simd(pngp->decoded_scanline,
+                  pngp->inflate_buf, pngp->prev_scanline, pngp->pitch, pngp->bpp);
+            break;
+         }
+#endif
+         png_reverse_filter_paeth(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
 
       default:
@@ -641,11 +903,66 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* The line just decoded becomes the previous one,
+    * no need to copy it. */
+   swap                   = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = swap;
 
    return IMAGE_PROCESS_NEXT;
 }
 
+/* Inflates exactly 'len' bytes into 'out', feeding the
+ * IDAT chunks to zlib straight from the file buffer. */
+static bool png_inflate(struct rpng_process *pngp, uint8_t *out, size_t len)
+{
+   pngp->stream_backend->set_out(pngp->stream, out, (uint32_t)len);
+
+   while (len > 0)
+   {
+      uint32_t rd, wn;
+      enum trans_stream_error terror;
+
+      if (pngp->avail_in == 0 && pngp->idat_next < pngp->idat_end)
+      {
+         struct png_chunk chunk;
+         uint8_t *chunk_data = pngp->idat_next + 8;
+
+         read_chunk_header(pngp->idat_next, &chunk);
+         pngp->idat_next += chunk.size + 12;
+
+         if (png_chunk_type(&chunk) == PNG_CHUNK_IDAT)
+         {
+            pngp->stream_backend->set_in(pngp->stream,
+                  chunk_data, chunk.size);
+            pngp->avail_in = chunk.size;
+         }
+         continue;
+      }
+
+      /* zlib may still hold output after the last
+       * input byte, so this also runs once input is
+       * exhausted. No progress means the data is
+       * truncated. */
+      if (!pngp->stream_backend->trans(pngp->stream,
+               false, &rd, &wn, &terror)
+            && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      if (rd == 0 && wn == 0)
+         return false;
+
+      pngp->avail_in  -= rd;
+      pngp->total_out += wn;
+      len             -= wn;
+
+      if (terror == TRANS_STREAM_ERROR_NONE && len > 0)
+         return false;
+   }
+
+   return true;
+}
+
 static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
 {
@@ -653,7 +970,16 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
 
    if (pngp->h < ihdr->height)
    {
-      unsigned filter = *pngp->inflate_buf++;
+      unsigned filter;
+
+      if (pngp->inflate_rows &&
+            !png_inflate(pngp, pngp->inflate_buf, pngp->pitch + 1))
+      {
+         ret = IMAGE_PROCESS_ERROR_END;
+         goto end;
+      }
+
+      filter = *pngp->inflate_buf++;
       pngp->restore_buf_size += 1;
       ret = png_reverse_filter_copy_line(*data,
             ihdr, pngp, filter);
@@ -666,6 +992,13 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
    pngp->inflate_buf           += pngp->pitch;
    pngp->restore_buf_size      += pngp->pitch;
 
+   /* The next row is inflated into the same buffer. */
+   if (pngp->inflate_rows)
+   {
+      pngp->inflate_buf        -= pngp->restore_buf_size;
+      pngp->restore_buf_size    = 0;
+   }
+
    *data                       += ihdr->width;
    pngp->data_restore_buf_size += ihdr->width;
 
@@ -769,31 +1102,20 @@ static int png_reverse_filter_iterate(rpng_t *rpng, uint32_t **data)
 static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng,
       uint32_t **data, unsigned *width, unsigned *height)
 {
-   bool zstatus;
-   enum trans_stream_error terror;
-   uint32_t rd, wn;
    struct rpng_process *process = (struct rpng_process*)rpng->process;
-   bool to_continue        = (process->avail_in > 0
-         && process->avail_out > 0);
 
-   if (!to_continue)
-      goto end;
-
-   zstatus = process->stream_backend->trans(process->stream, false, &rd, &wn, &terror);
-
-   if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
-      goto error;
-
-   process->avail_in -= rd;
-   process->avail_out -= wn;
-   process->total_out += wn;
-
-   if (terror)
-      return 0;
+   /* Adam7 passes are reverse filtered from one buffer
+    * holding the whole image, inflated in one go. Other
+    * images inflate a row at a time as they are filtered. */
+   if (!process->inflate_rows)
+   {
+      if (!png_inflate(process, process->inflate_buf,
+               process->inflate_buf_size))
+         goto error;
 
-end:
-   process->stream_backend->stream_free(process->stream);
-   process->stream = NULL;
+      process->stream_backend->stream_free(process->stream);
+      process->stream = NULL;
+   }
 
    *width  = rpng->ihdr.width;
    *height = rpng->ihdr.height;
@@ -853,15 +1175,31 @@ static bool png_read_trns(uint8_t *buf, uint32_t *palette, unsigned entries)
    return true;
 }
 
-bool png_realloc_idat(const struct png_chunk *chunk, struct idat_buffer *buf)
+/* Size of all Adam7 passes, each row with its filter byte. */
+static size_t png_adam7_size(const struct png_ihdr *ihdr)
 {
-   uint8_t *new_buffer = (uint8_t*)realloc(buf->data, buf->size + chunk->size);
+   unsigned i;
+   size_t size = 0;
 
-   if (!new_buffer)
-      return false;
+   for (i = 0; i < ARRAY_SIZE(passes); i++)
+   {
+      size_t pass_size;
+      struct png_ihdr pass = *ihdr;
 
-   buf->data  = new_buffer;
-   return true;
+      if (ihdr->width <= passes[i].x || ihdr->height <= passes[i].y)
+         continue;
+
+      pass.width  = (ihdr->width - passes[i].x
+            + passes[i].stride_x - 1) / passes[i].stride_x;
+      pass.height = (ihdr->height - passes[i].y
+            + passes[i].stride_y - 1) / passes[i].stride_y;
+
+      png_pass_geom(&pass, pass.width, pass.height,
+            NULL, NULL, &pass_size);
+      size += pass_size;
+   }
+
+   return size;
 }
 
 static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, unsigned *height)
@@ -875,6 +1213,7 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
    process->inflate_initialized    = false;
    process->adam7_pass_initialized = false;
    process->pass_initialized       = false;
+   process->inflate_rows           = !rpng->ihdr.interlace;
    process->prev_scanline          = NULL;
    process->decoded_scanline       = NULL;
    process->inflate_buf            = NULL;
@@ -904,13 +1243,22 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
    process->pass_pos       = 0;
    process->data           = NULL;
    process->palette        = NULL;
+   process->idat_next      = rpng->idat_chunk;
+   process->idat_end       = rpng->idat_end;
    process->stream         = NULL;
    process->stream_backend = trans_stream_get_zlib_inflate_backend();
 
-   png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
-         rpng->ihdr.height, NULL, NULL, &process->inflate_buf_size);
-   if (rpng->ihdr.interlace == 1) /* To be sure. */
-      process->inflate_buf_size *= 2;
+   if (process->inflate_rows)
+   {
+      unsigned pitch;
+
+      /* One filtered row, its filter type byte then pitch bytes. */
+      png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
+            rpng->ihdr.height, NULL, &pitch, NULL);
+      process->inflate_buf_size = pitch + 1;
+   }
+   else
+      process->inflate_buf_size = png_adam7_size(&rpng->ihdr);
 
    process->stream = process->stream_backend->stream_new();
 
@@ -925,17 +1273,9 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
       goto error;
 
    process->inflate_buf = inflate_buf;
-   process->avail_in = rpng->idat_buf.size;
-   process->avail_out = process->inflate_buf_size;
-   process->total_out = 0;
-   process->stream_backend->set_in(
-         process->stream,
-         rpng->idat_buf.data,
-         (uint32_t)rpng->idat_buf.size);
-   process->stream_backend->set_out(
-         process->stream,
-         process->inflate_buf,
-         (uint32_t)process->inflate_buf_size);
+   process->avail_in    = 0;
+   process->avail_out   = process->inflate_buf_size;
+   process->total_out   = 0;
 
    return process;
 
@@ -949,24 +1289,6 @@ error:
    return NULL;
 }
 
-static bool read_chunk_header(uint8_t *buf, struct png_chunk *chunk)
-{
-   unsigned i;
-   uint8_t dword[4];
-
-   dword[0] = '\0';
-
-   for (i = 0; i < 4; i++)
-      dword[i] = buf[i];
-
-   chunk->size = dword_be(dword);
-
-   for (i = 0; i < 4; i++)
-      chunk->type[i] = buf[i + 4];
-
-   return true;
-}
-
 static bool png_parse_ihdr(uint8_t *buf,
       struct png_ihdr *ihdr)
 {
@@ -988,7 +1310,6 @@ static bool png_parse_ihdr(uint8_t *buf,
 
 bool rpng_iterate_image(rpng_t *rpng)
 {
-   unsigned i;
    struct png_chunk chunk;
    uint8_t *buf           = (uint8_t*)rpng->buff_data;
 
@@ -999,13 +1320,6 @@ bool rpng_iterate_image(rpng_t *rpng)
    if (!read_chunk_header(buf, &chunk))
       return false;
 
-#if 0
-   for (i = 0; i < 4; i++)
-   {
-      fprintf(stderr, "chunktype: %c\n", chunk.type[i]);
-   }
-#endif
-
    switch (png_chunk_type(&chunk))
    {
       case PNG_CHUNK_NOOP:
@@ -1077,15 +1391,9 @@ bool rpng_iterate_image(rpng_t *rpng)
          if (!(rpng->has_ihdr) || rpng->has_iend || (rpng->ihdr.color_type == PNG_IHDR_COLOR_PLT && !(rpng->has_plte)))
             goto error;
 
-         if (!png_realloc_idat(&chunk, &rpng->idat_buf))
-            goto error;
-
-         buf += 8;
-
-         for (i = 0; i < chunk.size; i++)
-            rpng->idat_buf.data[i + rpng->idat_buf.size] = buf[i];
-
-         rpng->idat_buf.size += chunk.size;
+         if (!rpng->idat_chunk)
+            rpng->idat_chunk = buf;
+         rpng->idat_end      = buf + chunk.size + 12;
 
          rpng->has_idat = true;
          break;
@@ -1143,6 +1451,7 @@ error:
       if (rpng->process->stream)
          rpng->process->stream_backend->stream_free(rpng->process->stream);
       free(rpng->process);
+      rpng->process = NULL;
    }
    return IMAGE_PROCESS_ERROR;
 }
@@ -1152,8 +1461,6 @@ void rpng_free(rpng_t *rpng)
    if (!rpng)
       return;
 
-   if (rpng->idat_buf.data)
-      free(rpng->idat_buf.data);
    if (rpng->process)
    {
       if (rpng->process->inflate_buf)
@@ -24,12 +24,31 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <retro_inline.h>
 #include <encodings/crc32.h>
 #include <streams/file_stream.h>
 #include <streams/trans_stream.h>
 
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+#include <compat/zlib.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#endif
+
 #include "rpng_internal.h"
 
+/* Upper bound of threads used to filter and
+ * compress a single image. */
+#define RPNG_ENCODE_MAX_THREADS 8
+
+/* Images with less rows than this per thread are
+ * encoded as a single stream. */
+#define RPNG_ENCODE_MIN_THREAD_ROWS 64
+
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
    fprintf(stderr, "[RPNG]: Error in line %d.\n", __LINE__); \
@@ -147,9 +166,25 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
 
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i     = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+#if defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128();
+   __m128i sum        = zero;
+
+   for (; i + 16 <= size; i += 16)
+   {
+      __m128i v   = _mm_loadu_si128((const __m128i*)(data + i));
+      /* abs() of a signed byte, as an unsigned byte */
+      __m128i abs = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+      sum         = _mm_add_epi64(sum, _mm_sad_epu8(abs, zero));
+   }
+
+   cnt = (unsigned)_mm_cvtsi128_si32(sum)
+      + (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+
+   for (; i < size; i++)
       cnt += abs((int8_t)data[i]);
    return cnt;
 }
@@ -157,9 +192,15 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
    width *= bpp;
-   for (i = 0; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)),
+            _mm_loadu_si128((const __m128i*)(prev + i))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - prev[i];
 
    return count_sad(target, width);
@@ -172,7 +213,13 @@ static unsigned filter_sub(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i];
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)),
+            _mm_loadu_si128((const __m128i*)(line + i - bpp))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - line[i - bpp];
 
    return count_sad(target, width);
@@ -182,92 +229,164 @@ static unsigned filter_avg(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
    unsigned i;
+#if defined(__SSE2__)
+   const __m128i ones = _mm_set1_epi8(1);
+#endif
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i a   = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b   = _mm_loadu_si128((const __m128i*)(prev + i));
+      /* _mm_avg_epu8 rounds up, PNG rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), ones));
+
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+            _mm_loadu_si128((const __m128i*)(line + i)), avg));
+   }
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
    return count_sad(target, width);
 }
 
+#if defined(__SSE2__)
+static INLINE __m128i png_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i png_select(__m128i cond, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+#endif
+
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
 {
    unsigned i;
+#if defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128();
+#endif
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   /* Unlike decoding, every predictor input is known up front,
+    * so 8 bytes are filtered per step in 16-bit lanes. */
+   for (; i + 8 <= width; i += 8)
+   {
+      __m128i pa, pb, pc, smallest, nearest;
+      __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(line + i - bpp)), zero);
+      __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prev + i)), zero);
+      __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prev + i - bpp)), zero);
+      __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(line + i)), zero);
+
+      /* p = a + b - c, so p - a = b - c and p - b = a - c */
+      pa        = _mm_sub_epi16(b, c);
+      pb        = _mm_sub_epi16(a, c);
+      pc        = png_abs_epi16(_mm_add_epi16(pa, pb));
+      pa        = png_abs_epi16(pa);
+      pb        = png_abs_epi16(pb);
+
+      smallest  = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      nearest   = png_select(_mm_cmpeq_epi16(smallest, pb), b, c);
+      nearest   = png_select(_mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+      x         = _mm_and_si128(_mm_sub_epi16(x, nearest), _mm_set1_epi16(0xff));
+      _mm_storel_epi64((__m128i*)(target + i), _mm_packus_epi16(x, x));
+   }
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
    return count_sad(target, width);
 }
 
-static bool rpng_save_image(const char *path,
-      const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+struct rpng_encode_job
 {
-   unsigned h;
-   bool ret = true;
-   struct png_ihdr ihdr = {0};
-
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-   RFILE *file             = filestream_open(path, RFILE_MODE_WRITE, -1);
-   if (!file)
-      GOTO_END_ERROR();
-
-   stream_backend = trans_stream_get_zlib_deflate_backend();
+   const uint8_t *data;
+   uint8_t *encode_buf;
+   uint8_t *deflate_buf;
+   uint8_t *rgba_line;
+   uint8_t *up_filtered;
+   uint8_t *sub_filtered;
+   uint8_t *avg_filtered;
+   uint8_t *paeth_filtered;
+   uint8_t *prev_encoded;
+   size_t deflate_buf_size;
+   size_t deflate_size;
+   unsigned width;
+   unsigned pitch;
+   unsigned bpp;
+   unsigned h_start;
+   unsigned h_end;
+   int level;
+   bool last;
+   bool ok;
+};
+
+static void rpng_encode_job_free(struct rpng_encode_job *job)
+{
+   free(job->deflate_buf);
+   free(job->rgba_line);
+   free(job->prev_encoded);
+   free(job->up_filtered);
+   free(job->sub_filtered);
+   free(job->avg_filtered);
+   free(job->paeth_filtered);
+}
 
-   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
+static bool rpng_encode_job_init(struct rpng_encode_job *job)
+{
+   size_t line_size    = job->width * job->bpp;
 
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr(file, &ihdr))
-      GOTO_END_ERROR();
+   job->rgba_line      = (uint8_t*)malloc(line_size);
+   job->prev_encoded   = (uint8_t*)calloc(1, line_size);
+   job->up_filtered    = (uint8_t*)malloc(line_size);
+   job->sub_filtered   = (uint8_t*)malloc(line_size);
+   job->avg_filtered   = (uint8_t*)malloc(line_size);
+   job->paeth_filtered = (uint8_t*)malloc(line_size);
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+   return job->rgba_line && job->prev_encoded && job->up_filtered
+      && job->sub_filtered && job->avg_filtered && job->paeth_filtered;
+}
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+static void rpng_copy_line(const struct rpng_encode_job *job,
+      uint8_t *dst, unsigned h)
+{
+   const uint8_t *src = job->data + (size_t)h * job->pitch;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+   if (job->bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, job->width);
+   else
+      copy_bgr24_line(dst, src, job->width);
+}
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+/* Filters rows [h_start, h_end) into their slice of encode_buf. */
+static void rpng_encode_filter_rows(struct rpng_encode_job *job)
+{
+   unsigned h;
+   unsigned width        = job->width;
+   unsigned bpp          = job->bpp;
+   uint8_t *encode_target = job->encode_buf
+      + (size_t)(width * bpp + 1) * job->h_start;
+
+   /* Rows are filtered against the row above,
+    * which may belong to another job. */
+   if (job->h_start > 0)
+      rpng_copy_line(job, job->prev_encoded, job->h_start - 1);
+
+   for (h = job->h_start; h < job->h_end;
+         h++, encode_target += width * bpp)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      rpng_copy_line(job, job->rgba_line, h);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -276,49 +395,304 @@ static bool rpng_save_image(const char *path,
        * simple to implement.
        */
       {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
-         unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-         unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
+         unsigned none_score  = count_sad(job->rgba_line, width * bpp);
+         unsigned up_score    = filter_up(job->up_filtered, job->rgba_line, job->prev_encoded, width, bpp);
+         unsigned sub_score   = filter_sub(job->sub_filtered, job->rgba_line, width, bpp);
+         unsigned avg_score   = filter_avg(job->avg_filtered, job->rgba_line, job->prev_encoded, width, bpp);
+         unsigned paeth_score = filter_paeth(job->paeth_filtered, job->rgba_line, job->prev_encoded, width, bpp);
 
          uint8_t filter       = 0;
          unsigned min_sad     = none_score;
-         const uint8_t *chosen_filtered = rgba_line;
+         const uint8_t *chosen_filtered = job->rgba_line;
+         uint8_t *swap        = NULL;
 
          if (sub_score < min_sad)
          {
             filter = 1;
-            chosen_filtered = sub_filtered;
+            chosen_filtered = job->sub_filtered;
             min_sad = sub_score;
          }
 
          if (up_score < min_sad)
          {
             filter = 2;
-            chosen_filtered = up_filtered;
+            chosen_filtered = job->up_filtered;
             min_sad = up_score;
          }
 
          if (avg_score < min_sad)
          {
             filter = 3;
-            chosen_filtered = avg_filtered;
+            chosen_filtered = job->avg_filtered;
             min_sad = avg_score;
          }
 
          if (paeth_score < min_sad)
          {
             filter = 4;
-            chosen_filtered = paeth_filtered;
+            chosen_filtered = job->paeth_filtered;
          }
 
          *encode_target++ = filter;
          memcpy(encode_target, chosen_filtered, width * bpp);
 
-         memcpy(prev_encoded, rgba_line, width * bpp);
+         swap              = job->prev_encoded;
+         job->prev_encoded = job->rgba_line;
+         job->rgba_line    = swap;
       }
    }
+}
+
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+/* Filters a band of rows and compresses it as raw deflate data.
+ * Every band but the last ends with a sync flush, so the
+ * bands can simply be concatenated into a single stream. */
+static void rpng_encode_band(void *data)
+{
+   z_stream z;
+   struct rpng_encode_job *job = (struct rpng_encode_job*)data;
+   size_t line_size            = job->width * job->bpp + 1;
+   int zret;
+
+   job->ok                     = false;
+
+   rpng_encode_filter_rows(job);
+
+   memset(&z, 0, sizeof(z));
+
+   if (deflateInit2(&z, job->level, Z_DEFLATED, -MAX_WBITS,
+            8, Z_DEFAULT_STRATEGY) != Z_OK)
+      return;
+
+   job->deflate_buf_size = deflateBound(&z,
+         (uLong)(line_size * (job->h_end - job->h_start))) + 16;
+   job->deflate_buf      = (uint8_t*)malloc(job->deflate_buf_size);
+
+   if (job->deflate_buf)
+   {
+      z.next_in   = job->encode_buf + line_size * job->h_start;
+      z.avail_in  = (uInt)(line_size * (job->h_end - job->h_start));
+      z.next_out  = job->deflate_buf;
+      z.avail_out = (uInt)job->deflate_buf_size;
+
+      for (;;)
+      {
+         zret = deflate(&z, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+         /* deflateBound does not account for the sync flush,
+          * so a full buffer may still hold back output. Grow
+          * it and let deflate finish rather than truncate. */
+         if (z.avail_out == 0 && zret != Z_STREAM_ERROR)
+         {
+            size_t used  = job->deflate_buf_size;
+            uint8_t *buf = (uint8_t*)realloc(job->deflate_buf, used * 2);
+
+            if (!buf)
+               break;
+
+            job->deflate_buf      = buf;
+            job->deflate_buf_size = used * 2;
+            z.next_out            = buf + used;
+            z.avail_out           = (uInt)used;
+            continue;
+         }
+
+         if (z.avail_in == 0 &&
+               (job->last ? zret == Z_STREAM_END : zret == Z_OK))
+         {
+            job->deflate_size = job->deflate_buf_size - z.avail_out;
+            job->ok           = true;
+         }
+         break;
+      }
+   }
+
+   deflateEnd(&z);
+}
+
+static unsigned rpng_encode_thread_count(unsigned height)
+{
+   unsigned threads = cpu_features_get_core_amount();
+   unsigned max     = height / RPNG_ENCODE_MIN_THREAD_ROWS;
+
+   if (threads > RPNG_ENCODE_MAX_THREADS)
+      threads = RPNG_ENCODE_MAX_THREADS;
+   if (threads > max)
+      threads = max;
+
+   return threads;
+}
+
+/* Filters and compresses the image in bands on several threads,
+ * pigz style. Returns false if the image is too small to be worth
+ * it or on any failure, in which case the caller falls back to
+ * the single stream encoder. */
+static bool rpng_save_image_parallel(RFILE *file,
+      const uint8_t *data, uint8_t *encode_buf, size_t encode_buf_size,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      int level)
+{
+   unsigned t;
+   uint8_t header[10];
+   uint8_t trailer[4];
+   uint32_t crc;
+   uint32_t adler;
+   size_t idat_size                  = 2 + 4;
+   bool ret                          = false;
+   unsigned threads                  = rpng_encode_thread_count(height);
+   sthread_t *workers[RPNG_ENCODE_MAX_THREADS];
+   struct rpng_encode_job jobs[RPNG_ENCODE_MAX_THREADS];
+
+   if (threads < 2)
+      return false;
+
+   memset(jobs, 0, sizeof(jobs));
+   memset(workers, 0, sizeof(workers));
+
+   for (t = 0; t < threads; t++)
+   {
+      jobs[t].data       = data;
+      jobs[t].encode_buf = encode_buf;
+      jobs[t].width      = width;
+      jobs[t].pitch      = pitch;
+      jobs[t].bpp        = bpp;
+      jobs[t].level      = level;
+      jobs[t].h_start    = (unsigned)(((uint64_t)height * t) / threads);
+      jobs[t].h_end      = (unsigned)(((uint64_t)height * (t + 1)) / threads);
+      jobs[t].last       = t == threads - 1;
+
+      if (!rpng_encode_job_init(&jobs[t]))
+         goto end;
+   }
+
+   for (t = 1; t < threads; t++)
+      workers[t] = sthread_create(rpng_encode_band, &jobs[t]);
+
+   rpng_encode_band(&jobs[0]);
+
+   for (t = 1; t < threads; t++)
+   {
+      if (workers[t])
+         sthread_join(workers[t]);
+      else
+         rpng_encode_band(&jobs[t]);
+   }
+
+   for (t = 0; t < threads; t++)
+   {
+      if (!jobs[t].ok)
+         goto end;
+      idat_size += jobs[t].deflate_size;
+   }
+
+   adler = adler32(adler32(0, NULL, 0), encode_buf, encode_buf_size);
+
+   /* IDAT chunk header followed by the zlib header. */
+   dword_write_be(header + 0, (uint32_t)idat_size);
+   memcpy(header + 4, "IDAT", 4);
+   header[8]  = 0x78;
+   header[9]  = level <= 1 ? 0x01 : 0xda;
+   dword_write_be(trailer, adler);
+
+   if (filestream_write(file, header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   crc = encoding_crc32(0, header + 4, sizeof(header) - 4);
+
+   for (t = 0; t < threads; t++)
+   {
+      if (filestream_write(file, jobs[t].deflate_buf,
+               jobs[t].deflate_size) != (ssize_t)jobs[t].deflate_size)
+         goto end;
+      crc = encoding_crc32(crc, jobs[t].deflate_buf, jobs[t].deflate_size);
+   }
+
+   if (filestream_write(file, trailer, sizeof(trailer)) != sizeof(trailer))
+      goto end;
+
+   crc = encoding_crc32(crc, trailer, sizeof(trailer));
+   dword_write_be(trailer, crc);
+
+   if (filestream_write(file, trailer, sizeof(trailer)) != sizeof(trailer))
+      goto end;
+
+   ret = true;
+
+end:
+   for (t = 0; t < threads; t++)
+      rpng_encode_job_free(&jobs[t]);
+   return ret;
+}
+#endif
+
+static bool rpng_save_image(const char *path,
+      const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      enum rpng_save_mode mode)
+{
+   bool ret = true;
+   struct png_ihdr ihdr = {0};
+
+   const struct trans_stream_backend *stream_backend = NULL;
+   size_t encode_buf_size  = 0;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *deflate_buf    = NULL;
+   void *stream            = NULL;
+   uint32_t total_in       = 0;
+   uint32_t total_out      = 0;
+   int level               = mode == RPNG_SAVE_MODE_FAST ? 1 : 9;
+   struct rpng_encode_job job;
+   RFILE *file             = filestream_open(path, RFILE_MODE_WRITE, -1);
+
+   memset(&job, 0, sizeof(job));
+
+   if (!file)
+      GOTO_END_ERROR();
+
+   stream_backend = trans_stream_get_zlib_deflate_backend();
+
+   if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
+
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr(file, &ihdr))
+      GOTO_END_ERROR();
+
+   encode_buf_size = (width * bpp + 1) * height;
+   encode_buf = (uint8_t*)malloc(encode_buf_size);
+   if (!encode_buf)
+      GOTO_END_ERROR();
+
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+   if (rpng_save_image_parallel(file, data, encode_buf, encode_buf_size,
+            width, height, pitch, bpp, level))
+   {
+      if (!png_write_iend(file))
+         GOTO_END_ERROR();
+      goto end;
+   }
+
+   /* Nothing written past IHDR yet if the parallel encoder
+    * bailed out before writing IDAT. */
+   if (filestream_tell(file) != (ssize_t)(sizeof(png_magic) + 25))
+      GOTO_END_ERROR();
+#endif
+
+   job.data    = data;
+   job.encode_buf = encode_buf;
+   job.width   = width;
+   job.pitch   = pitch;
+   job.bpp     = bpp;
+   job.h_start = 0;
+   job.h_end   = height;
+
+   if (!rpng_encode_job_init(&job))
+      GOTO_END_ERROR();
+
+   rpng_encode_filter_rows(&job);
 
    deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
    if (!deflate_buf)
@@ -329,6 +703,9 @@ static bool rpng_save_image(const char *path,
    if (!stream)
       GOTO_END_ERROR();
 
+   if (stream_backend->define)
+      stream_backend->define(stream, "level", level);
+
    stream_backend->set_in(
          stream,
          encode_buf,
@@ -355,12 +732,7 @@ end:
    filestream_close(file);
    free(encode_buf);
    free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
+   rpng_encode_job_free(&job);
 
    if (stream_backend)
    {
@@ -377,12 +749,20 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), RPNG_SAVE_MODE_QUALITY);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, RPNG_SAVE_MODE_QUALITY);
+}
+
+bool rpng_save_image_bgr24_mode(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      enum rpng_save_mode mode)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, mode);
 }
@@ -23,7 +23,10 @@
 #ifndef __LIBRETRO_SDK_AUDIO_DSP_FILTER_H
 #define __LIBRETRO_SDK_AUDIO_DSP_FILTER_H
 
+#include <stdint.h>
+
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -47,6 +50,28 @@ struct retro_dsp_data
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data);
 
+/* Cost of one plug in the chain, accumulated by
+ * retro_dsp_filter_process() since the filter was created. */
+struct retro_dsp_plug_stats
+{
+   const char *ident;
+   /* Frames handed to the plug. */
+   uint64_t frames;
+   /* Time spent in its process callback. */
+   int64_t usec;
+};
+
+/**
+ * retro_dsp_filter_get_stats:
+ * @dsp                 : DSP filter handle.
+ * @index               : Position of the plug in the chain.
+ * @stats               : Filled in on success.
+ *
+ * Returns: false if @index is past the end of the chain.
+ **/
+bool retro_dsp_filter_get_stats(retro_dsp_filter_t *dsp,
+      unsigned index, struct retro_dsp_plug_stats *stats);
+
 RETRO_END_DECLS
 
 #endif
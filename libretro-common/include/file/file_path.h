@@ -466,6 +466,16 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Returns: last modification time of @path in seconds,
+ * 0 where the platform does not report one, or -1 if
+ * @path does not exist.
+ */
+int64_t path_get_mtime(const char *path);
+
 bool path_file_remove(const char *path);
 
 bool path_file_rename(const char *old_path, const char *new_path);
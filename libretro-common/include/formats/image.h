@@ -88,6 +88,9 @@ int image_transfer_process(
 
 bool image_transfer_iterate(void *data, enum image_type_enum type);
 
+void image_transfer_set_target_size(void *data,
+      enum image_type_enum type, unsigned width, unsigned height);
+
 bool image_transfer_is_valid(void *data, enum image_type_enum type);
 
 RETRO_END_DECLS
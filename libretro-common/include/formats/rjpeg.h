@@ -39,6 +39,12 @@ int rjpeg_process_image(rjpeg_t *rjpeg, void **buf,
 
 bool rjpeg_set_buf_ptr(rjpeg_t *rjpeg, void *data);
 
+/* Lets the decoder skip detail through DCT scaling: the image
+ * is decoded at 1/2, 1/4 or 1/8 of its size, as long as the
+ * result is still at least width x height. Zero means any size. */
+void rjpeg_set_target_size(rjpeg_t *rjpeg,
+      unsigned width, unsigned height);
+
 void rjpeg_free(rjpeg_t *rjpeg);
 
 rjpeg_t *rjpeg_alloc(void);
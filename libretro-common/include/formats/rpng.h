@@ -34,10 +34,20 @@ RETRO_BEGIN_DECLS
 
 typedef struct rpng rpng_t;
 
+enum rpng_save_mode
+{
+   /* Maximum zlib compression, smallest files. */
+   RPNG_SAVE_MODE_QUALITY = 0,
+   /* Fastest zlib compression, for frequently written images. */
+   RPNG_SAVE_MODE_FAST
+};
+
 rpng_t *rpng_init(const char *path);
 
 bool rpng_is_valid(rpng_t *rpng);
 
+/* Image data is inflated straight from this buffer, so it
+ * has to outlive the last rpng_process_image call. */
 bool rpng_set_buf_ptr(rpng_t *rpng, void *data);
 
 rpng_t *rpng_alloc(void);
@@ -55,6 +65,9 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch);
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
+bool rpng_save_image_bgr24_mode(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch,
+      enum rpng_save_mode mode);
 
 RETRO_END_DECLS
 
@@ -42,12 +42,26 @@ struct item_file
    size_t entry_idx;
    void *userdata;
    void *actiondata;
+   /* Set when actiondata is created on first use,
+    * see file_list_set_actiondata_pending() */
+   bool actiondata_pending;
+   unsigned actiondata_tag;
 };
 
+struct file_list_index;
+
 typedef struct file_list
 {
    struct item_file *list;
 
+   /* Search keys, built by the first search after
+    * the list changed */
+   struct file_list_index *index;
+
+   /* Bumped whenever entries are added, removed,
+    * reordered or relabeled */
+   unsigned generation;
+
    size_t capacity;
    size_t size;
 } file_list_t;
@@ -108,6 +122,18 @@ size_t file_list_get_size(const file_list_t *list);
 
 size_t file_list_get_directory_ptr(const file_list_t *list);
 
+/**
+ * @brief counts the changes made to the list
+ *
+ * Lets callers tell whether a list still holds the
+ * entries they saw, without comparing its contents.
+ *
+ * @param list
+ * @return a value that changes whenever entries are added,
+ * removed, reordered or relabeled
+ */
+unsigned file_list_get_generation(const file_list_t *list);
+
 void file_list_get_at_offset(const file_list_t *list, size_t index,
       const char **path, const char **label,
       unsigned *type, size_t *entry_idx);
@@ -129,6 +155,24 @@ void file_list_set_userdata(const file_list_t *list, size_t idx, void *ptr);
 
 void file_list_set_actiondata(const file_list_t *list, size_t idx, void *ptr);
 
+/**
+ * @brief marks the entry's actiondata as not created yet
+ *
+ * Lets the owner of a long list defer creating actiondata
+ * until an entry is actually used. The tag is kept with the
+ * entry (also across sorting) so the owner can create it later.
+ * Setting or freeing the actiondata clears the mark.
+ *
+ * @param list
+ * @param idx
+ * @param tag
+ */
+void file_list_set_actiondata_pending(file_list_t *list, size_t idx,
+      unsigned tag);
+
+bool file_list_get_actiondata_pending(const file_list_t *list, size_t idx,
+      unsigned *tag);
+
 void file_list_get_alt_at_offset(const file_list_t *list, size_t index,
       const char **alt);
 
@@ -136,7 +180,22 @@ void file_list_sort_on_alt(file_list_t *list);
 
 void file_list_sort_on_type(file_list_t *list);
 
-bool file_list_search(const file_list_t *list, const char *needle,
+/**
+ * @brief finds the entry whose alt best matches needle
+ *
+ * Entries without an alt are matched on their path, and entries
+ * without either on their label, as file_list_sort_on_alt()
+ * orders them. Matches are case insensitive. Entries starting with needle
+ * win over entries containing it, among equals the one listed
+ * first does. Prefix matches are looked up in a sorted key index
+ * that is kept until the list changes.
+ *
+ * @param list
+ * @param needle
+ * @param index   index of the entry found
+ * @return whether an entry matched
+ */
+bool file_list_search(file_list_t *list, const char *needle,
       size_t *index);
 
 RETRO_END_DECLS
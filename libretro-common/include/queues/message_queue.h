@@ -67,6 +67,14 @@ void msg_queue_push(msg_queue_t *queue, const char *msg,
  **/
 const char *msg_queue_pull(msg_queue_t *queue);
 
+/**
+ * msg_queue_size:
+ * @queue             : pointer to queue object
+ *
+ * Returns: number of messages in queue.
+ **/
+size_t msg_queue_size(msg_queue_t *queue);
+
 /**
  * msg_queue_clear:
  * @queue             : pointer to queue object
@@ -22,12 +22,178 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include <ctype.h>
 
 #include <retro_common.h>
 #include <lists/file_list.h>
 #include <string/stdstring.h>
-#include <compat/strcasestr.h>
+
+struct file_list_index
+{
+   /* Case folded keys of all entries, back to back */
+   char *keys;
+   /* The key of entry i starts at keys + offsets[i] */
+   size_t *offsets;
+   /* Entry indices in key order */
+   size_t *sorted;
+   size_t size;
+};
+
+struct file_list_key
+{
+   /* First four bytes of the key, settles most comparisons */
+   uint32_t prefix;
+   const char *key;
+   size_t idx;
+};
+
+static void file_list_free_index(file_list_t *list)
+{
+   if (!list->index)
+      return;
+
+   free(list->index->keys);
+   free(list->index->offsets);
+   free(list->index->sorted);
+   free(list->index);
+   list->index = NULL;
+}
+
+/* Called whenever entries are added, removed,
+ * reordered or relabeled. */
+static void file_list_changed(file_list_t *list)
+{
+   file_list_free_index(list);
+   list->generation++;
+}
+
+/* What an entry is sorted and searched on: its alt, else its path,
+ * else its label, as file_list_get_alt_at_offset() and then the
+ * label have always been searched. */
+static const char *file_list_key_source(const struct item_file *item)
+{
+   if (item->alt)
+      return item->alt;
+   if (item->path)
+      return item->path;
+   if (item->label)
+      return item->label;
+   return "";
+}
+
+static void file_list_fold_key(char *dst, const char *src)
+{
+   while (*src)
+      *dst++ = (char)tolower((unsigned char)*src++);
+   *dst = '\0';
+}
+
+static int file_list_key_cmp(const void *a_, const void *b_)
+{
+   const struct file_list_key *a = (const struct file_list_key*)a_;
+   const struct file_list_key *b = (const struct file_list_key*)b_;
+
+   if (a->prefix != b->prefix)
+      return a->prefix < b->prefix ? -1 : 1;
+   return strcmp(a->key, b->key);
+}
+
+/* Folds the key of every entry once into a single
+ * buffer and returns the keys sorted on it, so sorting never
+ * has to case fold the same string twice. */
+static struct file_list_key *file_list_sorted_keys(
+      const file_list_t *list, char **buf)
+{
+   size_t i;
+   size_t total              = 0;
+   struct file_list_key *out = NULL;
+   char *keys                = NULL;
+
+   for (i = 0; i < list->size; i++)
+      total += strlen(file_list_key_source(&list->list[i])) + 1;
+
+   keys = (char*)malloc(total ? total : 1);
+   out  = (struct file_list_key*)
+      malloc((list->size ? list->size : 1) * sizeof(*out));
+
+   if (!keys || !out)
+   {
+      free(keys);
+      free(out);
+      return NULL;
+   }
+
+   total = 0;
+
+   for (i = 0; i < list->size; i++)
+   {
+      unsigned j;
+      const char *key = keys + total;
+
+      file_list_fold_key(keys + total,
+            file_list_key_source(&list->list[i]));
+      total        += strlen(key) + 1;
+
+      out[i].prefix = 0;
+      out[i].key    = key;
+      out[i].idx    = i;
+
+      for (j = 0; j < 4; j++)
+      {
+         out[i].prefix <<= 8;
+         if (*key)
+            out[i].prefix |= (unsigned char)*key++;
+      }
+   }
+
+   qsort(out, list->size, sizeof(*out), file_list_key_cmp);
+
+   *buf = keys;
+   return out;
+}
+
+/* Takes ownership of keys. If in_order is set, the list was
+ * just sorted on them and entry i has the i-th key. */
+static struct file_list_index *file_list_new_index(size_t size,
+      char *keys, const struct file_list_key *sorted, bool in_order)
+{
+   size_t i;
+   struct file_list_index *index = (struct file_list_index*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      goto error;
+
+   index->keys    = keys;
+   index->size    = size;
+   index->offsets = (size_t*)malloc((size ? size : 1) * sizeof(size_t));
+   index->sorted  = (size_t*)malloc((size ? size : 1) * sizeof(size_t));
+
+   if (!index->offsets || !index->sorted)
+      goto error;
+
+   for (i = 0; i < size; i++)
+   {
+      size_t entry           = in_order ? i : sorted[i].idx;
+
+      index->offsets[entry]  = sorted[i].key - keys;
+      index->sorted[i]       = entry;
+   }
+
+   return index;
+
+error:
+   if (index)
+   {
+      free(index->offsets);
+      free(index->sorted);
+      free(index);
+   }
+   free(keys);
+   return NULL;
+}
 
 bool file_list_reserve(file_list_t *list, size_t nitems)
 {
@@ -64,11 +230,16 @@ static void file_list_add(file_list_t *list, unsigned idx,
    list->list[idx].userdata      = NULL;
    list->list[idx].actiondata    = NULL;
 
+   list->list[idx].actiondata_pending = false;
+   list->list[idx].actiondata_tag     = 0;
+
    if (label)
       list->list[idx].label      = strdup(label);
    if (path)
       list->list[idx].path       = strdup(path);
 
+   file_list_changed(list);
+
    list->size++;
 }
 
@@ -85,23 +256,11 @@ bool file_list_prepend(file_list_t *list,
       unsigned type, size_t directory_ptr,
       size_t entry_idx)
 {
-   unsigned i;
-   
    if (!file_list_expand_if_needed(list))
       return false;
 
-   for (i = (unsigned)list->size; i > 0; i--)
-   {
-      struct item_file *copy = (struct item_file*)
-         calloc(1, sizeof(struct item_file));
-      
-      memcpy(copy, &list->list[i-1], sizeof(struct item_file));
-
-      memcpy(&list->list[i-1], &list->list[i], sizeof(struct item_file));
-      memcpy(&list->list[i],             copy, sizeof(struct item_file));
-
-      free(copy);
-   }
+   memmove(&list->list[1], &list->list[0],
+         list->size * sizeof(struct item_file));
 
    file_list_add(list, 0, path, label, type,
          directory_ptr, entry_idx);
@@ -130,6 +289,13 @@ size_t file_list_get_size(const file_list_t *list)
    return list->size;
 }
 
+unsigned file_list_get_generation(const file_list_t *list)
+{
+   if (!list)
+      return 0;
+   return list->generation;
+}
+
 size_t file_list_get_directory_ptr(const file_list_t *list)
 {
    size_t size = file_list_get_size(list);
@@ -142,6 +308,8 @@ void file_list_pop(file_list_t *list, size_t *directory_ptr)
    if (!list)
       return;
 
+   file_list_changed(list);
+
    if (list->size != 0)
    {
       --list->size;
@@ -185,6 +353,7 @@ void file_list_free(file_list_t *list)
    if (list->list)
       free(list->list);
    list->list = NULL;
+   file_list_free_index(list);
    free(list);
 }
 
@@ -210,6 +379,8 @@ void file_list_clear(file_list_t *list)
       list->list[i].alt = NULL;
    }
 
+   file_list_changed(list);
+
    list->size = 0;
 }
 
@@ -220,6 +391,8 @@ void file_list_copy(const file_list_t *src, file_list_t *dst)
    if (!src || !dst)
       return;
 
+   file_list_changed(dst);
+
    if (dst->list)
    {
       for (item = dst->list; item < &dst->list[dst->size]; ++item)
@@ -274,6 +447,8 @@ void file_list_set_label_at_offset(file_list_t *list, size_t idx,
    if (!list)
       return;
 
+   file_list_changed(list);
+
    if (list->list[idx].label)
       free(list->list[idx].label);
    list->list[idx].alt      = NULL;
@@ -299,6 +474,8 @@ void file_list_set_alt_at_offset(file_list_t *list, size_t idx,
    if (!list || !alt)
       return;
 
+   file_list_changed(list);
+
    if (list->list[idx].alt)
       free(list->list[idx].alt);
    list->list[idx].alt      = NULL;
@@ -341,11 +518,43 @@ static int file_list_type_cmp(const void *a_, const void *b_)
 
 void file_list_sort_on_alt(file_list_t *list)
 {
-   qsort(list->list, list->size, sizeof(list->list[0]), file_list_alt_cmp);
+   size_t i;
+   char *keys                   = NULL;
+   struct item_file *items      = NULL;
+   struct file_list_key *sorted = NULL;
+
+   file_list_changed(list);
+
+   if (list->size < 2)
+      return;
+
+   sorted = file_list_sorted_keys(list, &keys);
+   items  = (struct item_file*)malloc(list->size * sizeof(*items));
+
+   if (!sorted || !items)
+   {
+      free(keys);
+      free(sorted);
+      free(items);
+      qsort(list->list, list->size, sizeof(list->list[0]),
+            file_list_alt_cmp);
+      return;
+   }
+
+   for (i = 0; i < list->size; i++)
+      items[i] = list->list[sorted[i].idx];
+   memcpy(list->list, items, list->size * sizeof(*items));
+
+   /* The keys are in list order now, keep them for searching */
+   list->index = file_list_new_index(list->size, keys, sorted, true);
+
+   free(items);
+   free(sorted);
 }
 
 void file_list_sort_on_type(file_list_t *list)
 {
+   file_list_changed(list);
    qsort(list->list, list->size, sizeof(list->list[0]), file_list_type_cmp);
 }
 
@@ -367,7 +576,27 @@ void file_list_set_actiondata(const file_list_t *list, size_t idx, void *ptr)
 {
    if (!list || !ptr)
       return;
-   list->list[idx].actiondata = ptr;
+   list->list[idx].actiondata         = ptr;
+   list->list[idx].actiondata_pending = false;
+}
+
+void file_list_set_actiondata_pending(file_list_t *list, size_t idx,
+      unsigned tag)
+{
+   if (!list)
+      return;
+   list->list[idx].actiondata_pending = true;
+   list->list[idx].actiondata_tag     = tag;
+}
+
+bool file_list_get_actiondata_pending(const file_list_t *list, size_t idx,
+      unsigned *tag)
+{
+   if (!list || !list->list[idx].actiondata_pending)
+      return false;
+   if (tag)
+      *tag = list->list[idx].actiondata_tag;
+   return true;
 }
 
 void *file_list_get_actiondata_at_offset(const file_list_t *list, size_t idx)
@@ -383,7 +612,8 @@ void file_list_free_actiondata(const file_list_t *list, size_t idx)
       return;
    if (list->list[idx].actiondata)
        free(list->list[idx].actiondata);
-   list->list[idx].actiondata = NULL;
+   list->list[idx].actiondata         = NULL;
+   list->list[idx].actiondata_pending = false;
 }
 
 void file_list_free_userdata(const file_list_t *list, size_t idx)
@@ -430,43 +660,80 @@ void file_list_get_last(const file_list_t *list,
       file_list_get_at_offset(list, list->size - 1, path, label, file_type, entry_idx);
 }
 
-bool file_list_search(const file_list_t *list, const char *needle, size_t *idx)
+bool file_list_search(file_list_t *list, const char *needle, size_t *idx)
 {
-   size_t i;
-   const char *alt = NULL;
-   bool ret        = false;
+   size_t i, lo, hi, len;
+   char *folded                  = NULL;
+   struct file_list_index *index = NULL;
+   bool ret                      = false;
 
-   if (!list)
+   if (!list || !needle)
       return false;
 
-   for (i = 0; i < list->size; i++)
+   if (!list->index)
    {
-      const char *str = NULL;
+      char *keys                   = NULL;
+      struct file_list_key *sorted = file_list_sorted_keys(list, &keys);
 
-      file_list_get_alt_at_offset(list, i, &alt);
-      if (!alt)
-      {
-         file_list_get_label_at_offset(list, i, &alt);
-         if (!alt)
-            continue;
-      }
+      if (!sorted)
+         return false;
 
-      str = (const char *)strcasestr(alt, needle);
-      if (str == alt)
-      {
-         /* Found match with first chars, best possible match. */
-         *idx = i;
-         ret = true;
+      list->index = file_list_new_index(list->size, keys, sorted, false);
+      free(sorted);
+   }
+
+   index  = list->index;
+   len    = strlen(needle);
+   folded = (char*)malloc(len + 1);
+
+   if (!index || !folded)
+   {
+      free(folded);
+      return false;
+   }
+
+   file_list_fold_key(folded, needle);
+
+   /* Keys starting with the needle are next to each other in key
+    * order, right after the last key that sorts before it. */
+   lo = 0;
+   hi = index->size;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (strcmp(index->keys + index->offsets[index->sorted[mid]],
+               folded) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (i = lo; i < index->size; i++)
+   {
+      size_t entry = index->sorted[i];
+
+      if (strncmp(index->keys + index->offsets[entry], folded, len))
          break;
-      }
-      else if (str && !ret)
+
+      /* Found match with first chars, best possible match. */
+      if (!ret || entry < *idx)
+         *idx = entry;
+      ret = true;
+   }
+
+   /* Settle for the first mid-string match otherwise. */
+   for (i = 0; !ret && i < index->size; i++)
+   {
+      if (strstr(index->keys + index->offsets[i], folded))
       {
-         /* Found mid-string match, but try to find a match with 
-          * first characters before we settle. */
          *idx = i;
-         ret = true;
+         ret  = true;
       }
    }
 
+   free(folded);
+
    return ret;
 }
@@ -238,3 +238,16 @@ const char *msg_queue_pull(msg_queue_t *queue)
 
    return queue->tmp_msg;
 }
+
+/**
+ * msg_queue_size:
+ * @queue             : pointer to queue object
+ *
+ * Returns: number of messages in queue.
+ **/
+size_t msg_queue_size(msg_queue_t *queue)
+{
+   if (!queue)
+      return 0;
+   return queue->ptr - 1;
+}
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_IMLIB2
 #include <Imlib2.h>
 #endif
@@ -182,13 +183,60 @@ static int test_rpng(const char *in_path)
    return 0;
 }
 
+/* Decodes every file 'iterations' times and reports
+ * the average decode time per file. */
+static int bench_rpng(char **paths, int count, unsigned iterations)
+{
+   int i;
+   double total_ms = 0.0;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned j;
+      unsigned width  = 0;
+      unsigned height = 0;
+      double ms       = 0.0;
+
+      for (j = 0; j < iterations; j++)
+      {
+         struct timespec start, end;
+         uint32_t *data = NULL;
+
+         clock_gettime(CLOCK_MONOTONIC, &start);
+
+         if (!rpng_load_image_argb(paths[i], &data, &width, &height))
+         {
+            fprintf(stderr, "Failed to decode %s.\n", paths[i]);
+            return 1;
+         }
+
+         clock_gettime(CLOCK_MONOTONIC, &end);
+         free(data);
+
+         ms += (end.tv_sec - start.tv_sec) * 1000.0
+            + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+      }
+
+      fprintf(stderr, "%8.3f ms  %5u x %-5u  %s\n",
+            ms / iterations, width, height, paths[i]);
+      total_ms += ms / iterations;
+   }
+
+   fprintf(stderr, "%8.3f ms  total for %d files.\n", total_ms, count);
+   return 0;
+}
+
 int main(int argc, char *argv[])
 {
    const char *in_path = "/tmp/test.png";
 
+   if (argc > 3 && !strcmp(argv[1], "--bench"))
+      return bench_rpng(argv + 3, argc - 3, (unsigned)strtoul(argv[2], NULL, 0));
+
    if (argc > 2)
    {
       fprintf(stderr, "Usage: %s <png file>\n", argv[0]);
+      fprintf(stderr, "       %s --bench <iterations> <png files...>\n", argv[0]);
       return 1;
    }
 
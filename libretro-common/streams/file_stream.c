@@ -528,10 +528,12 @@ int filestream_eof(RFILE *stream)
 
 ssize_t filestream_tell(RFILE *stream)
 {
+   ssize_t pos = 0;
+
    if (!stream)
       goto error;
 #if  defined(PSP)
-  if (sceIoLseek(stream->fd, 0, SEEK_CUR) < 0)
+  if ((pos = sceIoLseek(stream->fd, 0, SEEK_CUR)) < 0)
      goto error;
 #else
 #if defined(HAVE_BUFFERED_IO)
@@ -544,11 +546,11 @@ ssize_t filestream_tell(RFILE *stream)
    if (stream->mapped && stream->hints & RFILE_HINT_MMAP)
       return stream->mappos;
 #endif
-   if (lseek(stream->fd, 0, SEEK_CUR) < 0)
+   if ((pos = lseek(stream->fd, 0, SEEK_CUR)) < 0)
       goto error;
 #endif
 
-   return 0;
+   return pos;
 
 error:
    return -1;
@@ -24,17 +24,32 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <rhash.h>
 
+#include <memmap.h>
 #include <retro_assert.h>
+#include <rthreads/rthreads.h>
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 
+#ifndef PROT_READ
+#define PROT_READ 0x1
+#endif
+
+#ifndef MAP_PRIVATE
+#define MAP_PRIVATE 0x2
+#endif
+
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void *) -1)
+#endif
+
 static void dat_converter_exit(int rc)
 {
    fflush(stdout);
@@ -49,26 +64,51 @@ typedef enum
 
 typedef enum
 {
-   DAT_CONVERTER_TOKEN_LIST,
    DAT_CONVERTER_STRING_LIST,
    DAT_CONVERTER_MAP_LIST,
    DAT_CONVERTER_LIST_LIST,
 } dat_converter_list_enum;
 
+/* Points into the mapped .dat, the label is not terminated. */
 typedef struct
 {
    const char* label;
+   size_t len;
    int line_no;
    int column;
    const char* fname;
 } dat_converter_token_t;
 
+typedef struct
+{
+   const char* src;
+   const char* end;
+   int line_no;
+   int column;
+   bool quoted;
+   /* label is NULL once the input is exhausted */
+   dat_converter_token_t token;
+} dat_converter_lexer_t;
+
+/* Keeps the labels that make it into the parsed lists,
+ * so the .dat itself doesn't have to stay in memory. */
+typedef struct dat_converter_arena_block_t dat_converter_arena_block_t;
+struct dat_converter_arena_block_t
+{
+   dat_converter_arena_block_t* next;
+   size_t used;
+   size_t size;
+};
+
+#define DAT_CONVERTER_ARENA_BLOCK_SIZE (1 << 20)
+
+/* Map lists up to this size are searched linearly, larger ones get
+ * a hash index. Most lists are the few keys of a single game entry. */
+#define DAT_CONVERTER_LIST_INDEX_MIN 16
 
 typedef struct dat_converter_map_t dat_converter_map_t;
 typedef struct dat_converter_list_t dat_converter_list_t;
 typedef union dat_converter_list_item_t dat_converter_list_item_t;
-typedef struct dat_converter_search_tree_t dat_converter_search_tree_t;
-typedef struct dat_converter_bt_node_t dat_converter_bt_node_t;
 
 struct dat_converter_map_t
 {
@@ -86,7 +126,10 @@ struct dat_converter_list_t
 {
    dat_converter_list_enum type;
    dat_converter_list_item_t* values;
-   dat_converter_bt_node_t* bt_root;
+   /* Open addressing table of value indices + 1, 0 being empty.
+    * NULL while the list is small enough to be scanned. */
+   int* index;
+   int index_size;
    int count;
    int capacity;
 };
@@ -95,19 +138,9 @@ union dat_converter_list_item_t
 {
    const char* string;
    dat_converter_map_t map;
-   dat_converter_token_t token;
    dat_converter_list_t* list;
 };
 
-
-struct dat_converter_bt_node_t
-{
-   int index;
-   uint32_t hash;
-   dat_converter_bt_node_t* right;
-   dat_converter_bt_node_t* left;
-};
-
 static dat_converter_list_t* dat_converter_list_create(
       dat_converter_list_enum type)
 {
@@ -116,23 +149,14 @@ static dat_converter_list_t* dat_converter_list_create(
    list->type                 = type;
    list->count                = 0;
    list->capacity             = (1 << 2);
-   list->bt_root              = NULL;
+   list->index                = NULL;
+   list->index_size           = 0;
    list->values               = (dat_converter_list_item_t*)malloc(
          sizeof(*list->values) * list->capacity);
 
    return list;
 }
 
-static void dat_converter_bt_node_free(dat_converter_bt_node_t* node)
-{
-   if (!node)
-      return;
-
-   dat_converter_bt_node_free(node->left);
-   dat_converter_bt_node_free(node->right);
-   free(node);
-}
-
 static void dat_converter_list_free(dat_converter_list_t* list)
 {
    if (!list)
@@ -149,7 +173,7 @@ static void dat_converter_list_free(dat_converter_list_t* list)
          if (list->values[list->count].map.type == DAT_CONVERTER_LIST_MAP)
             dat_converter_list_free(list->values[list->count].map.value.list);
       }
-      dat_converter_bt_node_free(list->bt_root);
+      free(list->index);
       break;
    default:
       break;
@@ -160,44 +184,85 @@ static void dat_converter_list_free(dat_converter_list_t* list)
 }
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item);
 
-static dat_converter_bt_node_t* dat_converter_bt_node_insert(
-      dat_converter_list_t* list,
-      dat_converter_bt_node_t** node,
-      dat_converter_map_t* map)
+static void dat_converter_list_index_insert(dat_converter_list_t* list,
+      int value_index)
 {
-   retro_assert(map->key);
-   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+   int mask = list->index_size - 1;
+   int slot = list->values[value_index].map.hash & mask;
+
+   while (list->index[slot])
+      slot = (slot + 1) & mask;
+
+   list->index[slot] = value_index + 1;
+}
+
+static void dat_converter_list_index_build(dat_converter_list_t* list,
+      int size)
+{
+   int i;
 
-   if (!*node)
+   free(list->index);
+   list->index      = (int*)calloc(size, sizeof(*list->index));
+   list->index_size = size;
+
+   for (i = 0; i < list->count; i++)
+      if (list->values[i].map.key)
+         dat_converter_list_index_insert(list, i);
+}
+
+/* Returns the position of the value with the key of @map, or -1. */
+static int dat_converter_list_find(dat_converter_list_t* list,
+      const dat_converter_map_t* map)
+{
+   int i;
+   int mask;
+
+   if (!list->index)
    {
-      *node = calloc(1, sizeof(dat_converter_bt_node_t));
-      return *node;
+      for (i = 0; i < list->count; i++)
+      {
+         const dat_converter_map_t* current = &list->values[i].map;
+
+         if (current->key && current->hash == map->hash
+               && string_is_equal(current->key, map->key))
+            return i;
+      }
+      return -1;
    }
 
-   int diff = (*node)->hash - map->hash;
+   mask = list->index_size - 1;
 
-   if (!diff)
-      diff = strcmp(list->values[(*node)->index].map.key, map->key);
+   for (i = map->hash & mask; list->index[i]; i = (i + 1) & mask)
+   {
+      const dat_converter_map_t* current =
+         &list->values[list->index[i] - 1].map;
 
-   if (diff < 0)
-      return dat_converter_bt_node_insert(list, &(*node)->left, map);
-   else if (diff > 0)
-      return dat_converter_bt_node_insert(list, &(*node)->right, map);
+      if (current->hash == map->hash
+            && string_is_equal(current->key, map->key))
+         return list->index[i] - 1;
+   }
 
-   /* found match */
+   return -1;
+}
 
-   if (list->values[(*node)->index].map.type == DAT_CONVERTER_LIST_MAP)
+static void dat_converter_list_merge_map(dat_converter_list_t* list,
+      int index, dat_converter_map_t* map)
+{
+   retro_assert(map->key);
+   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+
+   if (list->values[index].map.type == DAT_CONVERTER_LIST_MAP)
    {
       if (map->type == DAT_CONVERTER_LIST_MAP)
       {
          int i;
 
-         retro_assert(list->values[(*node)->index].map.value.list->type
+         retro_assert(list->values[index].map.value.list->type
                == map->value.list->type);
 
          for (i = 0; i < map->value.list->count; i++)
             dat_converter_list_append(
-                  list->values[(*node)->index].map.value.list,
+                  list->values[index].map.value.list,
                   &map->value.list->values[i]);
 
          /* set count to 0 to prevent freeing the child nodes */
@@ -206,12 +271,9 @@ static dat_converter_bt_node_t* dat_converter_bt_node_insert(
       }
    }
    else
-      list->values[(*node)->index].map = *map;
-
-   return NULL;
+      list->values[index].map = *map;
 }
 
-
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
 {
    if (dst->count == dst->capacity)
@@ -221,12 +283,6 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
    }
    switch (dst->type)
    {
-   case DAT_CONVERTER_TOKEN_LIST:
-   {
-      dat_converter_token_t* token = (dat_converter_token_t*) item;
-      dst->values[dst->count].token = *token;
-      break;
-   }
    case DAT_CONVERTER_STRING_LIST:
    {
       char* str = (char*) item;
@@ -236,20 +292,32 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
    case DAT_CONVERTER_MAP_LIST:
    {
       dat_converter_map_t* map = (dat_converter_map_t*) item;
-      if (!map->key)
-         dst->values[dst->count].map = *map;
-      else
+      if (map->key)
       {
+         int index;
+
          map->hash = djb2_calculate(map->key);
-         dat_converter_bt_node_t* new_node =
-            dat_converter_bt_node_insert(dst, &dst->bt_root, map);
+         index     = dat_converter_list_find(dst, map);
 
-         if (!new_node)
+         if (index >= 0)
+         {
+            dat_converter_list_merge_map(dst, index, map);
             return;
+         }
+      }
+
+      dst->values[dst->count].map = *map;
 
-         dst->values[dst->count].map = *map;
-         new_node->index = dst->count;
-         new_node->hash = map->hash;
+      if (map->key)
+      {
+         if (!dst->index && dst->count >= DAT_CONVERTER_LIST_INDEX_MIN)
+            dat_converter_list_index_build(dst,
+                  DAT_CONVERTER_LIST_INDEX_MIN * 4);
+         else if (dst->index && (dst->count + 1) * 2 > dst->index_size)
+            dat_converter_list_index_build(dst, dst->index_size * 2);
+
+         if (dst->index)
+            dat_converter_list_index_insert(dst, dst->count);
       }
       break;
    }
@@ -265,135 +333,192 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
    dst->count++;
 }
 
-static dat_converter_list_t* dat_converter_lexer(
-      char* src, const char* dat_path)
+static char* dat_converter_arena_strdup(dat_converter_arena_block_t** arena,
+      const char* src, size_t len)
 {
-   dat_converter_list_t* token_list =
-      dat_converter_list_create(DAT_CONVERTER_TOKEN_LIST);
-   dat_converter_token_t token      = {NULL, 1, 1, dat_path};
-   bool quoted_token                = false;
+   char* dst;
+   dat_converter_arena_block_t* block = *arena;
 
-   while (*src)
+   if (!block || block->used + len + 1 > block->size)
    {
-      if ((!quoted_token && (*src == '\t' || *src == ' ')) || (*src == '\r'))
+      size_t size = DAT_CONVERTER_ARENA_BLOCK_SIZE;
+
+      if (len + 1 > size)
+         size = len + 1;
+
+      block        = (dat_converter_arena_block_t*)
+         malloc(sizeof(*block) + size);
+      block->next  = *arena;
+      block->used  = 0;
+      block->size  = size;
+      *arena       = block;
+   }
+
+   dst          = (char*)(block + 1) + block->used;
+   block->used += len + 1;
+
+   memcpy(dst, src, len);
+   dst[len] = '\0';
+
+   return dst;
+}
+
+static void dat_converter_arena_free(dat_converter_arena_block_t* arena)
+{
+   while (arena)
+   {
+      dat_converter_arena_block_t* next = arena->next;
+      free(arena);
+      arena = next;
+   }
+}
+
+static bool dat_converter_token_is(const dat_converter_token_t* token,
+      const char* str)
+{
+   size_t len = strlen(str);
+   return token->label && token->len == len
+      && !memcmp(token->label, str, len);
+}
+
+/* Moves lexer->token to the next token. Whitespace separates tokens
+ * outside of quotes, line breaks and quotes always do. */
+static void dat_converter_lexer_next(dat_converter_lexer_t* lexer)
+{
+   const char* src    = lexer->src;
+
+   lexer->token.label = NULL;
+   lexer->token.len   = 0;
+
+   while (src < lexer->end && *src)
+   {
+      if ((!lexer->quoted && (*src == '\t' || *src == ' ')) || (*src == '\r'))
       {
-         *src = '\0';
          src++;
-         token.column++;
-         token.label = NULL;
-         quoted_token = false;
+         lexer->column++;
+         lexer->quoted = false;
          continue;
       }
 
       if (*src == '\n')
       {
-         *src = '\0';
          src++;
-         token.column = 1;
-         token.line_no++;
-         token.label = NULL;
-         quoted_token = false;
+         lexer->column = 1;
+         lexer->line_no++;
+         lexer->quoted = false;
          continue;
       }
 
       if (*src == '\"')
       {
-         *src = '\0';
          src++;
-         token.column++;
-         quoted_token = !quoted_token;
-         token.label = NULL;
-
-         if (quoted_token)
-         {
-            token.label = src;
-            dat_converter_list_append(token_list, &token);
-         }
+         lexer->column++;
+         lexer->quoted = !lexer->quoted;
 
-         continue;
+         /* an opening quote starts a token, even an empty one */
+         if (!lexer->quoted)
+            continue;
       }
 
-      if (!token.label)
-      {
-         token.label = src;
-         dat_converter_list_append(token_list, &token);
-      }
+      lexer->token.label   = src;
+      lexer->token.line_no = lexer->line_no;
+      lexer->token.column  = lexer->column;
+
+      while (src < lexer->end && *src
+            && *src != '\r' && *src != '\n' && *src != '\"'
+            && (lexer->quoted || (*src != '\t' && *src != ' ')))
+         src++;
 
-      src++;
-      token.column++;
+      lexer->token.len  = src - lexer->token.label;
+      lexer->column    += (int)lexer->token.len;
+      break;
    }
 
-   token.label = NULL;
-   dat_converter_list_append(token_list, &token);
+   lexer->src = src;
+}
 
-   return token_list;
+static void dat_converter_lexer_init(dat_converter_lexer_t* lexer,
+      const char* src, size_t len, const char* dat_path)
+{
+   lexer->src           = src;
+   lexer->end           = src + len;
+   lexer->line_no       = 1;
+   lexer->column        = 1;
+   lexer->quoted        = false;
+   lexer->token.fname   = dat_path;
+   lexer->token.line_no = 1;
+   lexer->token.column  = 1;
+
+   dat_converter_lexer_next(lexer);
 }
 
 static dat_converter_list_t* dat_parser_table(
-      dat_converter_list_item_t** start_token)
+      dat_converter_lexer_t* lexer, dat_converter_arena_block_t** arena)
 {
    dat_converter_list_t* parsed_table =
       dat_converter_list_create(DAT_CONVERTER_MAP_LIST);
    dat_converter_map_t map            = {0};
-   dat_converter_list_item_t* current = *start_token;
+   dat_converter_token_t start_token  = lexer->token;
+   dat_converter_token_t* current     = &lexer->token;
 
-   while (current->token.label)
+   while (current->label)
    {
 
       if (!map.key)
       {
-         if (string_is_equal(current->token.label, ")"))
+         if (dat_converter_token_is(current, ")"))
          {
-            current++;
-            *start_token = current;
+            dat_converter_lexer_next(lexer);
             return parsed_table;
          }
-         else if (string_is_equal(current->token.label, "("))
+         else if (dat_converter_token_is(current, "("))
          {
             printf("%s:%d:%d: fatal error: Unexpected '(' instead of key\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column);
+                   current->fname,
+                   current->line_no,
+                   current->column);
             dat_converter_exit(1);
          }
          else
          {
-            map.key = current->token.label;
-            current++;
+            map.key = dat_converter_arena_strdup(arena,
+                  current->label, current->len);
+            dat_converter_lexer_next(lexer);
          }
       }
       else
       {
-         if (string_is_equal(current->token.label, "("))
+         if (dat_converter_token_is(current, "("))
          {
-            current++;
+            dat_converter_lexer_next(lexer);
             map.type = DAT_CONVERTER_LIST_MAP;
-            map.value.list = dat_parser_table(&current);
+            map.value.list = dat_parser_table(lexer, arena);
             dat_converter_list_append(parsed_table, &map);
          }
-         else if (string_is_equal(current->token.label, ")"))
+         else if (dat_converter_token_is(current, ")"))
          {
             printf("%s:%d:%d: fatal error: Unexpected ')' instead of value\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column);
+                   current->fname,
+                   current->line_no,
+                   current->column);
             dat_converter_exit(1);
          }
          else
          {
             map.type = DAT_CONVERTER_STRING_MAP;
-            map.value.string = current->token.label;
+            map.value.string = dat_converter_arena_strdup(arena,
+                  current->label, current->len);
             dat_converter_list_append(parsed_table, &map);
-            current++;
+            dat_converter_lexer_next(lexer);
          }
          map.key = NULL;
       }
    }
 
    printf("%s:%d:%d: fatal error: Missing ')' for '('\n",
-          (*start_token)->token.fname,
-          (*start_token)->token.line_no,
-          (*start_token)->token.column);
+          start_token.fname,
+          start_token.line_no,
+          start_token.column);
    dat_converter_exit(1);
 
    /* unreached */
@@ -487,11 +612,12 @@ static const char* dat_converter_get_match(
 
 static dat_converter_list_t* dat_converter_parser(
       dat_converter_list_t* target,
-      dat_converter_list_t* lexer_list,
+      dat_converter_lexer_t* lexer,
+      dat_converter_arena_block_t** arena,
       dat_converter_match_key_t* match_key)
 {
    dat_converter_map_t map;
-   dat_converter_list_item_t* current = lexer_list->values;
+   dat_converter_token_t* current     = &lexer->token;
    bool skip                          = true;
 
    map.key                            = NULL;
@@ -507,21 +633,23 @@ static dat_converter_list_t* dat_converter_parser(
       dat_converter_list_append(target, &map);
    }
 
-   while (current->token.label)
+   while (current->label)
    {
       if (!map.key)
       {
-         if (string_is_equal(current->token.label, "game"))
+         if (dat_converter_token_is(current, "game"))
             skip = false;
-         map.key = current->token.label;
-         current++;
+         /* only marks that a key was read, it's replaced
+          * by the match key value before appending */
+         map.key = current->label;
+         dat_converter_lexer_next(lexer);
       }
       else
       {
-         if (string_is_equal(current->token.label, "("))
+         if (dat_converter_token_is(current, "("))
          {
-            current++;
-            map.value.list = dat_parser_table(&current);
+            dat_converter_lexer_next(lexer);
+            map.value.list = dat_parser_table(lexer, arena);
             if (!skip)
             {
                if (match_key)
@@ -530,13 +658,15 @@ static dat_converter_list_t* dat_converter_parser(
                   // If the key is not found, report, and mark it to be skipped.
                   if (!map.key)
                   {
+                     dat_converter_match_key_t* mk = match_key;
+
                      printf("Missing match key '");
-                     while (match_key->next)
+                     while (mk->next)
                      {
-                        printf("%s.", match_key->value);
-                        match_key = match_key->next;
+                        printf("%s.", mk->value);
+                        mk = mk->next;
                      }
-                     printf("%s' on line %d\n", match_key->value, current->token.line_no);
+                     printf("%s' on line %d\n", mk->value, current->line_no);
                      skip = true;
                   }
                }
@@ -548,6 +678,8 @@ static dat_converter_list_t* dat_converter_parser(
                   dat_converter_list_append(target, &map);
                   skip = true;
                }
+               else
+                  dat_converter_list_free(map.value.list);
             }
             else
                dat_converter_list_free(map.value.list);
@@ -556,11 +688,12 @@ static dat_converter_list_t* dat_converter_parser(
          }
          else
          {
-            printf("%s:%d:%d: fatal error: Expected '(' found '%s'\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column,
-                   current->token.label);
+            printf("%s:%d:%d: fatal error: Expected '(' found '%.*s'\n",
+                   current->fname,
+                   current->line_no,
+                   current->column,
+                   (int)current->len,
+                   current->label);
             dat_converter_exit(1);
          }
       }
@@ -740,20 +873,141 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+/* One .dat, parsed on its own so that independent files
+ * can be parsed in parallel and merged afterwards. */
+typedef struct
+{
+   const char* path;
+   dat_converter_match_key_t* match_key;
+   dat_converter_arena_block_t* arena;
+   dat_converter_list_t* list;
+} dat_converter_job_t;
+
+typedef struct
+{
+   dat_converter_job_t* jobs;
+   int count;
+   int next;
+   slock_t* lock;
+} dat_converter_queue_t;
+
+static void dat_converter_parse_file(dat_converter_job_t* job)
+{
+   struct stat st;
+   dat_converter_lexer_t lexer;
+   char* src = NULL;
+   int fd    = open(job->path, O_RDONLY);
+
+   if (fd < 0 || fstat(fd, &st) != 0)
+   {
+      printf("could not open dat file '%s': %s\n",
+            job->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   if (st.st_size > 0)
+   {
+      src = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (src == MAP_FAILED)
+      {
+         printf("could not map dat file '%s': %s\n",
+               job->path, strerror(errno));
+         dat_converter_exit(1);
+      }
+#ifdef MADV_SEQUENTIAL
+      madvise(src, st.st_size, MADV_SEQUENTIAL);
+#endif
+   }
+
+   printf("Parsing dat file '%s'...\n", job->path);
+   dat_converter_lexer_init(&lexer, src, st.st_size, job->path);
+   job->list = dat_converter_parser(NULL, &lexer, &job->arena, job->match_key);
+
+   if (src)
+      munmap(src, st.st_size);
+   close(fd);
+}
+
+static void dat_converter_worker(void* data)
+{
+   dat_converter_queue_t* queue = (dat_converter_queue_t*)data;
+
+   for (;;)
+   {
+      int i;
+
+      slock_lock(queue->lock);
+      i = queue->next++;
+      slock_unlock(queue->lock);
+
+      if (i >= queue->count)
+         break;
+
+      dat_converter_parse_file(&queue->jobs[i]);
+   }
+}
+
+/* Moves the entries of @src into @dst, giving the same result as
+ * parsing both into one list, and frees @src. */
+static void dat_converter_list_merge(dat_converter_list_t* dst,
+      dat_converter_list_t* src)
+{
+   int i;
+
+   /* the first value is the end marker of the value provider */
+   for (i = 1; i < src->count; i++)
+      dat_converter_list_append(dst, &src->values[i].map);
+
+   src->count = 0;
+   dat_converter_list_free(src);
+}
+
+static void dat_converter_usage(const char* name)
+{
+   printf("usage:\n%s [-j <threads>] [-i <index field>]... "
+         "<db file> [match key] <dat file> ...\n", name);
+   dat_converter_exit(1);
+}
+
 int main(int argc, char** argv)
 {
+   int i;
+   int rv;
    const char* rdb_path;
+   const char* name                     = *argv;
    dat_converter_match_key_t* match_key = NULL;
+   dat_converter_job_t* jobs            = NULL;
+   dat_converter_list_t* dat_parser_list = NULL;
+   dat_converter_list_item_t* current_item;
+   dat_converter_queue_t queue;
+   sthread_t** threads;
+   const char** index_fields;
+   unsigned num_index_fields            = 0;
+   int num_threads                      = 0;
+   int dat_count;
    RFILE* rdb_file;
 
-   if (argc < 2)
-   {
-      printf("usage:\n%s <db file> [args ...]\n", *argv);
-      dat_converter_exit(1);
-   }
    argc--;
    argv++;
 
+   index_fields = (const char**)malloc((argc + 1) * sizeof(*index_fields));
+
+   while (argc > 1 && **argv == '-')
+   {
+      if (string_is_equal(*argv, "-j"))
+         num_threads = atoi(argv[1]);
+      else if (string_is_equal(*argv, "-i"))
+         index_fields[num_index_fields++] = argv[1];
+      else
+         dat_converter_usage(name);
+      argc -= 2;
+      argv += 2;
+   }
+
+   if (argc < 2)
+      dat_converter_usage(name);
+
    rdb_path  = *argv;
    argc--;
    argv++;
@@ -765,45 +1019,47 @@ int main(int argc, char** argv)
       argv++;
    }
 
-   int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
-   dat_converter_list_t* dat_parser_list = NULL;
+   dat_count = argc;
+   jobs      = (dat_converter_job_t*)calloc(dat_count, sizeof(*jobs));
 
-   while (argc)
+   for (i = 0; i < dat_count; i++)
    {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
-
-      if (!dat_file)
-      {
-         printf("could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
-      }
-
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
-
-      printf("Parsing dat file '%s'...\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
-
-      dat_converter_list_free(dat_lexer_list);
-
-      argc--;
-      argv++;
-      dat_buffer++;
+      jobs[i].path      = argv[i];
+      jobs[i].match_key = match_key;
    }
 
+#ifdef _SC_NPROCESSORS_ONLN
+   if (num_threads <= 0)
+      num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+   if (num_threads > dat_count)
+      num_threads = dat_count;
+   if (num_threads < 1)
+      num_threads = 1;
+
+   /* The calling thread is the first worker */
+   queue.jobs  = jobs;
+   queue.count = dat_count;
+   queue.next  = 0;
+   queue.lock  = slock_new();
+   threads     = (sthread_t**)calloc(num_threads, sizeof(*threads));
+
+   for (i = 1; i < num_threads; i++)
+      threads[i] = sthread_create(dat_converter_worker, &queue);
+   dat_converter_worker(&queue);
+   for (i = 1; i < num_threads; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+
+   free(threads);
+   slock_free(queue.lock);
+
+   /* Merged in command line order, so later files
+    * still override earlier ones. */
+   dat_parser_list = jobs[0].list;
+   for (i = 1; i < dat_count; i++)
+      dat_converter_list_merge(dat_parser_list, jobs[i].list);
+
    rdb_file = filestream_open(rdb_path, RFILE_MODE_WRITE, -1);
 
    if (!rdb_file)
@@ -816,22 +1072,28 @@ int main(int argc, char** argv)
       dat_converter_exit(1);
    }
 
-   dat_converter_list_item_t* current_item =
-      &dat_parser_list->values[dat_parser_list->count];
+   current_item = &dat_parser_list->values[dat_parser_list->count];
 
    dat_converter_value_provider_init();
-   libretrodb_create(rdb_file,
+   rv = libretrodb_create_indexed(rdb_file,
          (libretrodb_value_provider)&dat_converter_value_provider,
-         &current_item);
+         &current_item, index_fields, num_index_fields);
    dat_converter_value_provider_free();
 
    filestream_close(rdb_file);
 
+   if (rv < 0)
+   {
+      printf("Failed to write '%s'.\n", rdb_path);
+      dat_converter_exit(1);
+   }
+
    dat_converter_list_free(dat_parser_list);
 
-   while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+   for (i = 0; i < dat_count; i++)
+      dat_converter_arena_free(jobs[i].arena);
+   free(jobs);
+   free(index_fields);
 
    dat_converter_match_key_free(match_key);
 
@@ -36,20 +36,26 @@
 #include <retro_endianness.h>
 #include <string/stdstring.h>
 #include <compat/strl.h>
+#include <memmap.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
+/* Index built in bulk: the key of every document followed by its
+ * offset, collected in a flat array and sorted once at the end. */
+struct libretrodb_index_builder
 {
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
+   struct rmsgpack_dom_value key;
+   uint8_t *entries;
+   uint64_t count;
+   uint64_t capacity;
+   uint8_t field_size;
+   int failed;
 };
 
 struct libretrodb
@@ -82,7 +88,12 @@ typedef struct libretrodb_header
 struct libretrodb_cursor
 {
 	int is_valid;
-   RFILE *fd;
+   /* The documents of the database, decoded from it directly */
+   uint8_t *data;
+   const uint8_t *pos;
+   const uint8_t *end;
+   int mapped;
+   struct rmsgpack_dom_arena arena;
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
@@ -135,15 +146,234 @@ static int libretrodb_validate_document(const struct rmsgpack_dom_value *doc)
    return rv;
 }
 
+static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx);
+
+static void libretrodb_builder_init(struct libretrodb_index_builder *builder,
+      const char *field_name)
+{
+   memset(builder, 0, sizeof(*builder));
+   builder->key.type            = RDT_STRING;
+   builder->key.val.string.len  = (uint32_t)strlen(field_name);
+   /* We know we aren't going to change it */
+   builder->key.val.string.buff = (char*)field_name;
+}
+
+static void libretrodb_builder_free(struct libretrodb_index_builder *builder)
+{
+   free(builder->entries);
+   builder->entries  = NULL;
+   builder->count    = 0;
+   builder->capacity = 0;
+}
+
+/* Adds the key of @item stored at @item_loc.
+ * Returns NULL, or why the item can't be indexed. */
+static const char *libretrodb_builder_add(
+      struct libretrodb_index_builder *builder,
+      const struct rmsgpack_dom_value *item, uint64_t item_loc)
+{
+   uint8_t *entry;
+   size_t entry_size;
+   struct rmsgpack_dom_value *field =
+      rmsgpack_dom_value_map_value(item, &builder->key);
+
+   if (!field)
+      return "field not found in item";
+
+   if (field->type != RDT_BINARY)
+      return "field is not binary";
+
+   if (field->val.binary.len == 0)
+      return "field is empty";
+
+   if (builder->field_size == 0 && field->val.binary.len <= UINT8_MAX)
+      builder->field_size = field->val.binary.len;
+
+   if (field->val.binary.len != builder->field_size)
+      return "field is not of correct size";
+
+   entry_size = builder->field_size + sizeof(uint64_t);
+
+   if (builder->count == builder->capacity)
+   {
+      uint64_t capacity = builder->capacity ? builder->capacity * 2 : 1024;
+      uint8_t *entries  = (uint8_t*)realloc(builder->entries,
+            (size_t)capacity * entry_size);
+
+      if (!entries)
+         return "out of memory";
+
+      builder->entries  = entries;
+      builder->capacity = capacity;
+   }
+
+   entry = builder->entries + builder->count * entry_size;
+   memcpy(entry, field->val.binary.buff, builder->field_size);
+   memcpy(entry + builder->field_size, &item_loc, sizeof(uint64_t));
+   builder->count++;
+
+   return NULL;
+}
+
+/* LSD radix sort of the entries by key, one key byte per pass.
+ * Bytes that are the same in every key, like the constant prefix
+ * of a serial, are skipped. Sorted input costs the same as any other. */
+static int libretrodb_builder_sort(struct libretrodb_index_builder *builder)
+{
+   uint64_t i;
+   unsigned pos;
+   size_t entry_size     = builder->field_size + sizeof(uint64_t);
+   uint64_t (*histograms)[256];
+   uint8_t *src          = builder->entries;
+   uint8_t *dst;
+
+   if (builder->count < 2)
+      return 0;
+
+   histograms = (uint64_t(*)[256])calloc(builder->field_size,
+         sizeof(*histograms));
+   dst        = (uint8_t*)malloc((size_t)builder->count * entry_size);
+
+   if (!histograms || !dst)
+   {
+      free(histograms);
+      free(dst);
+      return -ENOMEM;
+   }
+
+   for (i = 0; i < builder->count; i++)
+   {
+      const uint8_t *entry = src + i * entry_size;
+      for (pos = 0; pos < builder->field_size; pos++)
+         histograms[pos][entry[pos]]++;
+   }
+
+   for (pos = builder->field_size; pos-- > 0; )
+   {
+      uint8_t *tmp;
+      uint64_t offsets[256];
+      uint64_t sum = 0;
+      unsigned b;
+
+      if (histograms[pos][src[pos]] == builder->count)
+         continue;
+
+      for (b = 0; b < 256; b++)
+      {
+         offsets[b] = sum;
+         sum       += histograms[pos][b];
+      }
+
+      for (i = 0; i < builder->count; i++)
+      {
+         const uint8_t *entry = src + i * entry_size;
+         memcpy(dst + offsets[entry[pos]]++ * entry_size, entry, entry_size);
+      }
+
+      tmp = src;
+      src = dst;
+      dst = tmp;
+   }
+
+   builder->entries  = src;
+   builder->capacity = builder->count;
+   free(dst);
+   free(histograms);
+   return 0;
+}
+
+/* Returns the first key that is in the sorted entries twice, or NULL. */
+static const uint8_t *libretrodb_builder_find_duplicate(
+      const struct libretrodb_index_builder *builder)
+{
+   uint64_t i;
+   size_t entry_size = builder->field_size + sizeof(uint64_t);
+
+   for (i = 1; i < builder->count; i++)
+   {
+      const uint8_t *entry = builder->entries + i * entry_size;
+      if (memcmp(entry - entry_size, entry, builder->field_size) == 0)
+         return entry;
+   }
+
+   return NULL;
+}
+
+static void libretrodb_builder_print_key(
+      const struct libretrodb_index_builder *builder, const uint8_t *key)
+{
+   struct rmsgpack_dom_value value;
+
+   value.type            = RDT_BINARY;
+   value.val.binary.len  = builder->field_size;
+   value.val.binary.buff = (char*)key;
+   rmsgpack_dom_value_print(&value);
+}
+
+/* Sorts the entries and writes them out as index @name at the
+ * current position of @fd. */
+static int libretrodb_builder_write_index(RFILE *fd,
+      struct libretrodb_index_builder *builder, const char *name)
+{
+   int rv;
+   libretrodb_index_t idx;
+   const uint8_t *duplicate;
+   ssize_t len = (ssize_t)(builder->count
+         * (builder->field_size + sizeof(uint64_t)));
+
+   if (!builder->count)
+      return 0;
+
+   if ((rv = libretrodb_builder_sort(builder)) < 0)
+      return rv;
+
+   if ((duplicate = libretrodb_builder_find_duplicate(builder)))
+   {
+      printf("Value is not unique in index '%s': ", name);
+      libretrodb_builder_print_key(builder, duplicate);
+      printf("\n");
+      return -EINVAL;
+   }
+
+   strlcpy(idx.name, name, sizeof(idx.name));
+   idx.key_size = builder->field_size;
+   idx.next     = len;
+   libretrodb_write_index_header(fd, &idx);
+
+   if (filestream_write(fd, builder->entries, len) != len)
+      return -1;
+   return 0;
+}
+
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
       void *ctx)
+{
+   return libretrodb_create_indexed(fd, value_provider, ctx, NULL, 0);
+}
+
+int libretrodb_create_indexed(RFILE *fd,
+      libretrodb_value_provider value_provider, void *ctx,
+      const char **index_fields, unsigned num_index_fields)
 {
    int rv;
+   unsigned i;
    libretrodb_metadata_t md;
    struct rmsgpack_dom_value item;
    uint64_t item_count        = 0;
    libretrodb_header_t header = {{0}};
-   ssize_t root = filestream_seek(fd, 0, SEEK_CUR);
+   ssize_t root = filestream_tell(fd);
+   struct libretrodb_index_builder *builders = NULL;
+
+   if (num_index_fields)
+   {
+      builders = (struct libretrodb_index_builder*)
+         calloc(num_index_fields, sizeof(*builders));
+      if (!builders)
+         return -ENOMEM;
+   }
+
+   for (i = 0; i < num_index_fields; i++)
+      libretrodb_builder_init(&builders[i], index_fields[i]);
 
    memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
 
@@ -155,9 +385,28 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    item.type = RDT_NULL;
    while ((rv = value_provider(ctx, &item)) == 0)
    {
+      uint64_t item_loc;
+
       if ((rv = libretrodb_validate_document(&item)) < 0)
          goto clean;
 
+      item_loc = filestream_tell(fd);
+
+      for (i = 0; i < num_index_fields; i++)
+      {
+         const char *error;
+
+         if (builders[i].failed)
+            continue;
+
+         if ((error = libretrodb_builder_add(&builders[i], &item, item_loc)))
+         {
+            printf("Skipping index '%s': %s\n", index_fields[i], error);
+            builders[i].failed = 1;
+            libretrodb_builder_free(&builders[i]);
+         }
+      }
+
       if ((rv = rmsgpack_dom_write(fd, &item)) < 0)
          goto clean;
 
@@ -172,13 +421,35 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(fd, 0, SEEK_CUR));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
-   libretrodb_write_metadata(fd, &md);
+   if ((rv = libretrodb_write_metadata(fd, &md)) < 0)
+      goto clean;
+
+   /* Indexes follow the metadata, where libretrodb_find_index() looks.
+    * A key that isn't unique was caught before anything was written, so
+    * that index is just skipped, but any other failure leaves the file
+    * broken. */
+   for (i = 0; i < num_index_fields; i++)
+   {
+      if (builders[i].failed)
+         continue;
+
+      rv = libretrodb_builder_write_index(fd, &builders[i], index_fields[i]);
+      if (rv == -EINVAL)
+         rv = 0;
+      else if (rv < 0)
+         goto clean;
+   }
+
    filestream_seek(fd, root, SEEK_SET);
-   filestream_write(fd, &header, sizeof(header));
+   if (filestream_write(fd, &header, sizeof(header)) != sizeof(header))
+      rv = -1;
 clean:
    rmsgpack_dom_value_free(&item);
+   for (i = 0; i < num_index_fields; i++)
+      libretrodb_builder_free(&builders[i]);
+   free(builders);
    return rv;
 }
 
@@ -226,7 +497,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       free(db->path);
 
    db->path  = strdup(path);
-   db->root  = filestream_seek(fd, 0, SEEK_CUR);
+   db->root  = filestream_tell(fd);
 
    if ((rv = (int)filestream_read(fd, &header, sizeof(header))) == -1)
    {
@@ -234,7 +505,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(header.magic_number)) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -250,7 +521,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
    }
 
    db->count = md.count;
-   db->first_index_offset = filestream_seek(fd, 0, SEEK_CUR);
+   db->first_index_offset = filestream_tell(fd);
    db->fd = fd;
    return 0;
 
@@ -263,18 +534,23 @@ error:
 static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
       libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_seek(db->fd, 0, SEEK_END);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset, SEEK_SET);
+   ssize_t eof, offset;
+
+   filestream_seek(db->fd, 0, SEEK_END);
+   eof    = filestream_tell(db->fd);
+   filestream_seek(db->fd, (ssize_t)db->first_index_offset, SEEK_SET);
+   offset = filestream_tell(db->fd);
 
    while (offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (libretrodb_read_index_header(db->fd, idx) < 0)
+         break;
 
       if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
          return 0;
 
-      offset = filestream_seek(db->fd, (ssize_t)idx->next, SEEK_CUR);
+      filestream_seek(db->fd, (ssize_t)idx->next, SEEK_CUR);
+      offset = filestream_tell(db->fd);
    }
 
    return -1;
@@ -283,25 +559,29 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
 static int binsearch(const void *buff, const void *item,
       uint64_t count, uint8_t field_size, uint64_t *offset)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   size_t item_size = field_size + sizeof(uint64_t);
+   uint64_t low     = 0;
+   uint64_t high    = count;
 
-   if (rv == 0)
+   while (low < high)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
-   }
+      uint64_t mid           = low + (high - low) / 2;
+      const uint8_t *current = (const uint8_t*)buff + mid * item_size;
+      int rv                 = memcmp(current, item, field_size);
 
-   if (count == 0)
-      return -1;
+      if (rv == 0)
+      {
+         memcpy(offset, current + field_size, sizeof(uint64_t));
+         return 0;
+      }
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (rv > 0)
+         high = mid;
+      else
+         low  = mid + 1;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   return -1;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
@@ -324,7 +604,7 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 
    while (nread < bufflen)
    {
-      void *buff_ = (uint64_t *)buff + nread;
+      void *buff_ = (uint8_t *)buff + nread;
       rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
 
       if (rv <= 0)
@@ -335,11 +615,14 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       nread += rv;
    }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
+   rv = binsearch(buff, key, idx.next / (idx.key_size + sizeof(uint64_t)),
+         (uint8_t)idx.key_size, &offset);
    free(buff);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset, SEEK_SET);
+   if (rv != 0)
+      return rv;
+
+   filestream_seek(db->fd, (ssize_t)offset, SEEK_SET);
 
    return rmsgpack_dom_read(db->fd, out);
 }
@@ -354,12 +637,32 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
+   uint64_t root = cursor->db->root + sizeof(libretrodb_header_t);
+
+   rmsgpack_dom_arena_reset(&cursor->arena);
+
+   if (root > (uint64_t)(cursor->end - cursor->data))
+   {
+      cursor->eof = 1;
+      return -EINVAL;
+   }
+
    cursor->eof = 0;
-   return (int)filestream_seek(cursor->fd,
-         (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
-         SEEK_SET);
+   cursor->pos = cursor->data + root;
+   return 0;
 }
 
+/**
+ * libretrodb_cursor_read_item:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Next document matching the query of @cursor.
+ *
+ * @out belongs to @cursor and must not be freed, it is only valid
+ * until the next read, reset or close of @cursor.
+ *
+ * Returns: 0 if successful, EOF at the end of the database,
+ * otherwise negative.
+ **/
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
@@ -369,7 +672,10 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
+   rmsgpack_dom_arena_reset(&cursor->arena);
+
+   rv = rmsgpack_dom_read_buf(&cursor->pos, cursor->end,
+         &cursor->arena, out);
    if (rv < 0)
       return rv;
 
@@ -382,10 +688,7 @@ retry:
    if (cursor->query)
    {
       if (!libretrodb_query_filter(cursor->query, out))
-      {
-         rmsgpack_dom_value_free(out);
          goto retry;
-      }
    }
 
    return 0;
@@ -402,15 +705,26 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (!cursor)
       return;
 
-   if (cursor->fd)
-      filestream_close(cursor->fd);
+   if (cursor->data)
+   {
+#ifdef HAVE_MMAN
+      if (cursor->mapped)
+         munmap(cursor->data, cursor->end - cursor->data);
+      else
+#endif
+         free(cursor->data);
+   }
+
+   rmsgpack_dom_arena_free(&cursor->arena);
 
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
    cursor->is_valid = 0;
    cursor->eof      = 1;
-   cursor->fd       = NULL;
+   cursor->data     = NULL;
+   cursor->pos      = NULL;
+   cursor->end      = NULL;
    cursor->db       = NULL;
    cursor->query    = NULL;
 }
@@ -428,154 +742,107 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
 int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
       libretrodb_query_t *q)
 {
-   if (!db || string_is_empty(db->path))
-      return -errno;
+   uint8_t *data;
+   size_t len;
 
-   cursor->fd = filestream_open(db->path, RFILE_MODE_READ | RFILE_HINT_MMAP, -1);
+   if (!db || !db->fd)
+      return -EINVAL;
 
-   if (!cursor->fd)
-      return -errno;
+   /* Scans touch every document, mapping or reading them all at once
+    * is much cheaper than a read per value. The indexes are left out. */
+   len            = (size_t)db->first_index_offset;
+   data           = NULL;
+   cursor->mapped = 0;
 
-   cursor->db = db;
-   cursor->is_valid = 1;
-   libretrodb_cursor_reset(cursor);
-   cursor->query = q;
+#ifdef HAVE_MMAN
+   data = (uint8_t*)mmap(NULL, len, PROT_READ, MAP_PRIVATE,
+         filestream_get_fd(db->fd), (size_t)db->root);
 
-   if (q)
-      libretrodb_query_inc_ref(q);
+   if (data == (uint8_t*)MAP_FAILED)
+      data = NULL;
+   else
+      cursor->mapped = 1;
+#endif
 
-   return 0;
-}
+   if (!data)
+   {
+      if (!(data = (uint8_t*)malloc(len)))
+         return -ENOMEM;
 
-static int node_iter(void *value, void *ctx)
-{
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+      filestream_seek(db->fd, (ssize_t)db->root, SEEK_SET);
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
-      return 0;
+      if (filestream_read(db->fd, data, len) != (ssize_t)len)
+      {
+         free(data);
+         return -EIO;
+      }
+   }
 
-   return -1;
-}
+   cursor->data       = data;
+   cursor->end        = data + len;
+   cursor->arena.head = NULL;
+   cursor->db         = db;
+   cursor->is_valid   = 1;
+   libretrodb_cursor_reset(cursor);
+   cursor->query      = q;
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_seek(db->fd, 0, SEEK_CUR);
-}
+   if (q)
+      libretrodb_query_inc_ref(q);
 
-static int node_compare(const void *a, const void *b, void *ctx)
-{
-   return memcmp(a, b, *(uint8_t *)ctx);
+   return 0;
 }
 
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
-   libretrodb_index_t idx;
+   struct libretrodb_index_builder builder;
    struct rmsgpack_dom_value item;
-   uint64_t idx_header_offset       = 0;
    libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
+   RFILE *fd                        = NULL;
+   int rv                           = -1;
 
-   item.type                        = RDT_NULL;
+   libretrodb_builder_init(&builder, field_name);
 
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
+   if (libretrodb_cursor_open(db, &cur, NULL) != 0)
       goto clean;
 
-   key.type            = RDT_STRING;
-   key.val.string.len  = (uint32_t)strlen(field_name);
-   key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
-
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   for (;;)
    {
-      if (item.type != RDT_MAP)
-      {
-         printf("Only map keys are supported\n");
-         goto clean;
-      }
-
-      field = rmsgpack_dom_value_map_value(&item, &key);
-
-      if (!field)
-      {
-         printf("field not found in item\n");
-         goto clean;
-      }
-
-      if (field->type != RDT_BINARY)
-      {
-         printf("field is not binary\n");
-         goto clean;
-      }
+      const char *error;
+      uint64_t item_loc = cur.pos - cur.data;
 
-      if (field->val.binary.len == 0)
-      {
-         printf("field is empty\n");
-         goto clean;
-      }
+      if (libretrodb_cursor_read_item(&cur, &item) != 0)
+         break;
 
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      else if (field->val.binary.len != field_size)
+      if (item.type != RDT_MAP)
       {
-         printf("field is not of correct size\n");
+         printf("Only map keys are supported\n");
          goto clean;
       }
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
-
-      memcpy(buff, field->val.binary.buff, field_size);
-
-      buff_u64 = (uint64_t *)buff + field_size;
-
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
-
-      if (bintree_insert(tree, buff) != 0)
+      if ((error = libretrodb_builder_add(&builder, &item, item_loc)))
       {
-         printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
-         printf("\n");
+         printf("%s\n", error);
          goto clean;
       }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
    }
 
-   idx_header_offset = filestream_seek(db->fd, 0, SEEK_END);
-
-   (void)idx_header_offset;
-
-   strncpy(idx.name, name, 50);
-
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   /* db->fd is read only, and buffered read/write would truncate */
+   fd = filestream_open(db->path,
+         RFILE_MODE_READ_WRITE | RFILE_HINT_UNBUFFERED, -1);
+   if (!fd)
+      goto clean;
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   filestream_seek(fd, 0, SEEK_END);
+   rv = libretrodb_builder_write_index(fd, &builder, name);
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
+   if (fd)
+      filestream_close(fd);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   libretrodb_builder_free(&builder);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
@@ -47,6 +47,28 @@ typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *o
 
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void *ctx);
 
+/**
+ * libretrodb_create_indexed:
+ * @fd                  : File to write the database to.
+ * @value_provider      : Called for every document until it returns non-zero.
+ * @ctx                 : Passed to @value_provider.
+ * @index_fields        : Binary fields to build an index on, each index is
+ *                        named after its field.
+ * @num_index_fields    : Number of entries in @index_fields.
+ *
+ * Same as libretrodb_create(), but collects the keys of the requested
+ * indexes while the documents are written, instead of reading the whole
+ * database back once per libretrodb_create_index().
+ * An index whose field is missing, not binary, of varying size or not
+ * unique is skipped with a message, the database itself is still written.
+ *
+ * Returns: 0 if successful, otherwise negative, including when an index
+ * couldn't be written.
+ **/
+int libretrodb_create_indexed(RFILE *fd,
+      libretrodb_value_provider value_provider, void *ctx,
+      const char **index_fields, unsigned num_index_fields);
+
 void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
@@ -102,6 +124,17 @@ void *libretrodb_query_compile(libretrodb_t *db, const char *query,
 
 void libretrodb_query_free(void *q);
 
+/**
+ * libretrodb_cursor_read_item:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Next document matching the query of @cursor.
+ *
+ * @out belongs to @cursor and must not be freed, it is only valid
+ * until the next read, reset or close of @cursor.
+ *
+ * Returns: 0 if successful, EOF at the end of the database,
+ * otherwise negative.
+ **/
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
@@ -158,10 +158,11 @@ static int db_close(lua_State *L)
 static int db_cursor_open(lua_State *L)
 {
    int rv;
-   libretrodb_cursor_t *cursor = NULL;
+   libretrodb_cursor_t **cursor = NULL;
    libretrodb_t *db = checkdb(L);
-   cursor = lua_newuserdata(L, sizeof(libretrodb_t));
-   if ((rv = libretrodb_cursor_open(db, cursor, NULL)) == 0)
+   cursor = lua_newuserdata(L, sizeof(*cursor));
+   *cursor = libretrodb_cursor_new();
+   if ((rv = libretrodb_cursor_open(db, *cursor, NULL)) == 0)
    {
       luaL_getmetatable(L, "RarchDB.Cursor");
       lua_setmetatable(L, -2);
@@ -169,6 +170,7 @@ static int db_cursor_open(lua_State *L)
    }
    else
    {
+      libretrodb_cursor_free(*cursor);
       lua_pop(L, 1);
       lua_pushnil(L);
       lua_pushstring(L, strerror(-rv));
@@ -192,9 +194,11 @@ static int db_query(lua_State *L)
    else
    {
       int rv;
-      libretrodb_cursor_t *cursor = lua_newuserdata(L, sizeof(libretrodb_t));
+      libretrodb_cursor_t **cursor = lua_newuserdata(L, sizeof(*cursor));
 
-      if ((rv = libretrodb_cursor_open(db, cursor, q)) == 0)
+      *cursor = libretrodb_cursor_new();
+
+      if ((rv = libretrodb_cursor_open(db, *cursor, q)) == 0)
       {
          luaL_getmetatable(L, "RarchDB.Cursor");
          lua_setmetatable(L, -2);
@@ -202,6 +206,7 @@ static int db_query(lua_State *L)
       }
       else
       {
+         libretrodb_cursor_free(*cursor);
          lua_pop(L, 1);
          lua_pushnil(L);
          lua_pushstring(L, strerror(-rv));
@@ -211,7 +216,8 @@ static int db_query(lua_State *L)
    return 2;
 }
 
-static libretrodb_cursor_t *checkcursor(lua_State *L)
+/* The cursor struct is opaque, the userdata only holds a pointer to it */
+static libretrodb_cursor_t **checkcursor(lua_State *L)
 {
 	void *ud = luaL_checkudata(L, 1, "RarchDB.Cursor");
 	luaL_argcheck(L, ud != NULL, 1, "`RarchDB.Cursor' expected");
@@ -220,16 +226,18 @@ static libretrodb_cursor_t *checkcursor(lua_State *L)
 
 static int cursor_close(lua_State *L)
 {
-	libretrodb_cursor_t *cursor = checkcursor(L);
-	libretrodb_cursor_close(cursor);
+	libretrodb_cursor_t **cursor = checkcursor(L);
+	libretrodb_cursor_close(*cursor);
+	libretrodb_cursor_free(*cursor);
+	*cursor = NULL;
 	return 0;
 }
 
 static int cursor_read(lua_State *L)
 {
-   libretrodb_cursor_t *cursor = checkcursor(L);
+   libretrodb_cursor_t **cursor = checkcursor(L);
    struct rmsgpack_dom_value value;
-   if (libretrodb_cursor_read_item(cursor, &value) == 0)
+   if (*cursor && libretrodb_cursor_read_item(*cursor, &value) == 0)
       push_rmsgpack_value(L, &value);
    else
       lua_pushnil(L);
@@ -238,7 +246,7 @@ static int cursor_read(lua_State *L)
 
 static int cursor_iter(lua_State *L)
 {
-   libretrodb_cursor_t *cursor = checkcursor(L);
+   libretrodb_cursor_t **cursor = checkcursor(L);
 
    (void)cursor;
 
@@ -140,7 +140,8 @@ static int dom_read_map_start(uint32_t len, void *data)
 
    v->val.map.items = items;
 
-   for (i = 0; i < len; i++)
+   /* Pushed backwards, so the pairs are popped in file order */
+   for (i = len; i-- > 0;)
    {
       if (dom_reader_state_push(dom_state, &items[i].value) < 0)
          return -ENOMEM;
@@ -169,7 +170,7 @@ static int dom_read_array_start(uint32_t len, void *data)
 
 	v->val.array.items = items;
 
-	for (i = 0; i < len; i++)
+	for (i = len; i-- > 0;)
    {
       if (dom_reader_state_push(dom_state, &items[i]) < 0)
          return -ENOMEM;
@@ -418,6 +419,305 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+struct rmsgpack_dom_arena_block
+{
+   struct rmsgpack_dom_arena_block *next;
+   size_t used;
+   size_t size;
+};
+
+#define ARENA_BLOCK_SIZE 0x4000
+
+static void *rmsgpack_dom_arena_alloc(struct rmsgpack_dom_arena *arena,
+      size_t len)
+{
+   uint8_t *ptr;
+   struct rmsgpack_dom_arena_block *block = arena->head;
+
+   /* Keep the pairs and values allocated after strings aligned */
+   len = (len + 7) & ~(size_t)7;
+
+   if (!block || block->used + len > block->size)
+   {
+      size_t size = ARENA_BLOCK_SIZE;
+
+      if (len > size)
+         size = len;
+
+      block = (struct rmsgpack_dom_arena_block*)
+         malloc(sizeof(*block) + size);
+
+      if (!block)
+         return NULL;
+
+      block->next = arena->head;
+      block->used = 0;
+      block->size = size;
+      arena->head = block;
+   }
+
+   ptr          = (uint8_t*)(block + 1) + block->used;
+   block->used += len;
+
+   return ptr;
+}
+
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena)
+{
+   size_t size;
+   struct rmsgpack_dom_arena_block *block = arena->head;
+
+   if (!block)
+      return;
+
+   if (!block->next)
+   {
+      block->used = 0;
+      return;
+   }
+
+   /* The last document did not fit in one block, replace them
+    * with a single one big enough so the next ones won't spill */
+   size = 0;
+   for (; block; block = block->next)
+      size += block->size;
+
+   rmsgpack_dom_arena_free(arena);
+
+   block = (struct rmsgpack_dom_arena_block*)malloc(sizeof(*block) + size);
+
+   if (!block)
+      return;
+
+   block->next = NULL;
+   block->used = 0;
+   block->size = size;
+   arena->head = block;
+}
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block = arena->head;
+
+   while (block)
+   {
+      struct rmsgpack_dom_arena_block *next = block->next;
+      free(block);
+      block = next;
+   }
+
+   arena->head = NULL;
+}
+
+static uint64_t dom_buf_read_uint(const uint8_t *p, unsigned size)
+{
+   unsigned i;
+   uint64_t value = 0;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | p[i];
+
+   return value;
+}
+
+static int dom_buf_read(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_dom_arena *arena, struct rmsgpack_dom_value *out,
+      unsigned depth)
+{
+   int rv;
+   unsigned i;
+   unsigned size;
+   uint64_t len;
+   uint8_t type;
+   const uint8_t *p = *buf;
+
+   out->type = RDT_NULL;
+
+   if (p >= end)
+      return -EINVAL;
+
+   type = *p++;
+
+   if (type < _MPF_FIXMAP)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = type;
+      goto done;
+   }
+   else if (type < _MPF_FIXARRAY)
+   {
+      len = type - _MPF_FIXMAP;
+      goto map;
+   }
+   else if (type < _MPF_FIXSTR)
+   {
+      len = type - _MPF_FIXARRAY;
+      goto array;
+   }
+   else if (type < _MPF_NIL)
+   {
+      len = type - _MPF_FIXSTR;
+      goto string;
+   }
+   else if (type > _MPF_MAP32)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = (int8_t)type;
+      goto done;
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         goto done;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         out->type      = RDT_BOOL;
+         out->val.bool_ = type == _MPF_TRUE;
+         goto done;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+         size = 1 << (type - _MPF_BIN8);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+         len  = dom_buf_read_uint(p, size);
+         p   += size;
+         if ((uint64_t)(end - p) < len)
+            return -EINVAL;
+
+         out->type            = RDT_BINARY;
+         out->val.binary.len  = (uint32_t)len;
+         out->val.binary.buff = (char*)p;
+         p                   += len;
+         goto done;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         size = 1 << (type - _MPF_UINT8);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+
+         out->type      = RDT_UINT;
+         out->val.uint_ = dom_buf_read_uint(p, size);
+         p             += size;
+         goto done;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         size = 1 << (type - _MPF_INT8);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+
+         /* Sign extend from the top bit of the stored size */
+         len           = dom_buf_read_uint(p, size) << (64 - 8 * size);
+         out->type     = RDT_INT;
+         out->val.int_ = (int64_t)len >> (64 - 8 * size);
+         p            += size;
+         goto done;
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         size = 1 << (type - _MPF_STR8);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+         len  = dom_buf_read_uint(p, size);
+         p   += size;
+         goto string;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+         size = 2 << (type - _MPF_ARRAY16);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+         len  = dom_buf_read_uint(p, size);
+         p   += size;
+         goto array;
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         size = 2 << (type - _MPF_MAP16);
+         if ((size_t)(end - p) < size)
+            return -EINVAL;
+         len  = dom_buf_read_uint(p, size);
+         p   += size;
+         goto map;
+   }
+
+   /* Floats and extension types are never written by rmsgpack */
+   return -EINVAL;
+
+string:
+   if ((uint64_t)(end - p) < len)
+      return -EINVAL;
+
+   if (!(out->val.string.buff = (char*)rmsgpack_dom_arena_alloc(arena,
+               (size_t)len + 1)))
+      return -ENOMEM;
+
+   memcpy(out->val.string.buff, p, (size_t)len);
+   out->val.string.buff[len] = '\0';
+   out->val.string.len       = (uint32_t)len;
+   out->type                 = RDT_STRING;
+   p                        += len;
+   goto done;
+
+map:
+   /* Every pair takes at least two bytes, don't trust a larger count */
+   if (depth == MAX_DEPTH || (uint64_t)(end - p) < len * 2)
+      return -EINVAL;
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = 0;
+   out->val.map.items = (struct rmsgpack_dom_pair*)rmsgpack_dom_arena_alloc(
+         arena, (size_t)len * sizeof(struct rmsgpack_dom_pair));
+
+   if (len && !out->val.map.items)
+      return -ENOMEM;
+
+   for (i = 0; i < len; i++)
+   {
+      if ((rv = dom_buf_read(&p, end, arena,
+                  &out->val.map.items[i].key, depth + 1)) < 0)
+         return rv;
+      if ((rv = dom_buf_read(&p, end, arena,
+                  &out->val.map.items[i].value, depth + 1)) < 0)
+         return rv;
+      out->val.map.len++;
+   }
+   goto done;
+
+array:
+   if (depth == MAX_DEPTH || (uint64_t)(end - p) < len)
+      return -EINVAL;
+
+   out->type            = RDT_ARRAY;
+   out->val.array.len   = 0;
+   out->val.array.items = (struct rmsgpack_dom_value*)rmsgpack_dom_arena_alloc(
+         arena, (size_t)len * sizeof(struct rmsgpack_dom_value));
+
+   if (len && !out->val.array.items)
+      return -ENOMEM;
+
+   for (i = 0; i < len; i++)
+   {
+      if ((rv = dom_buf_read(&p, end, arena,
+                  &out->val.array.items[i], depth + 1)) < 0)
+         return rv;
+      out->val.array.len++;
+   }
+
+done:
+   *buf = p;
+   return 0;
+}
+
+int rmsgpack_dom_read_buf(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_dom_arena *arena, struct rmsgpack_dom_value *out)
+{
+   return dom_buf_read(buf, end, arena, out, 0);
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    va_list ap;
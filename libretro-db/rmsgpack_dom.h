@@ -79,6 +79,15 @@ struct rmsgpack_dom_pair
 	struct rmsgpack_dom_value value;
 };
 
+struct rmsgpack_dom_arena_block;
+
+/* Backs the maps, arrays and strings of documents read
+ * with rmsgpack_dom_read_buf(), which are released all at once. */
+struct rmsgpack_dom_arena
+{
+   struct rmsgpack_dom_arena_block *head;
+};
+
 void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj);
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v);
 
@@ -91,6 +100,30 @@ struct rmsgpack_dom_value *rmsgpack_dom_value_map_value(
 
 int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out);
 
+/**
+ * rmsgpack_dom_read_buf:
+ * @buf                 : Position to read from, advanced past the value.
+ * @end                 : End of the buffer.
+ * @arena               : Arena the nodes of @out are allocated from.
+ * @out                 : Value that was read.
+ *
+ * Same as rmsgpack_dom_read(), but decodes a value held in memory.
+ * Binary values point into the buffer and strings are copied to @arena,
+ * so they stay NUL terminated. @out must not be passed to
+ * rmsgpack_dom_value_free(), it stays valid until @arena is reset or
+ * freed, as long as the buffer is kept around too.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_buf(const uint8_t **buf, const uint8_t *end,
+      struct rmsgpack_dom_arena *arena, struct rmsgpack_dom_value *out);
+
+/* Releases every value read into @arena, but keeps its memory
+ * around for the next ones. */
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena);
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena);
+
 int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
@@ -50,7 +50,7 @@ static int action_select_default(const char *path, const char *label, unsigned t
 
    if (selection_buf)
       cbs                     = (menu_file_list_cbs_t*)
-         file_list_get_actiondata_at_offset(selection_buf, idx);
+         menu_entries_get_actiondata_at_offset(selection_buf, idx);
 
    if (!cbs)
    {
@@ -24,7 +24,13 @@
 #include "../../verbosity.h"
 
 #include <string.h>
+#include <time.h>
 #include <string/stdstring.h>
+#include <file/file_path.h>
+
+#include "../../configuration.h"
+#include "../../content.h"
+#include "../../retroarch.h"
 
 #ifndef BIND_ACTION_SUBLABEL
 #define BIND_ACTION_SUBLABEL(cbs, name) \
@@ -158,6 +164,7 @@ default_sublabel_macro(action_bind_sublabel_input_overlay_hide_in_menu,    MENU_
 default_sublabel_macro(action_bind_sublabel_content_collection_list,       MENU_ENUM_SUBLABEL_CONTENT_COLLECTION_LIST)
 default_sublabel_macro(action_bind_sublabel_video_scale_integer,           MENU_ENUM_SUBLABEL_VIDEO_SCALE_INTEGER)
 default_sublabel_macro(action_bind_sublabel_video_gpu_screenshot,          MENU_ENUM_SUBLABEL_VIDEO_GPU_SCREENSHOT)
+default_sublabel_macro(action_bind_sublabel_screenshot_fast_compression,   MENU_ENUM_SUBLABEL_SCREENSHOT_FAST_COMPRESSION)
 default_sublabel_macro(action_bind_sublabel_video_rotation,                MENU_ENUM_SUBLABEL_VIDEO_ROTATION)
 default_sublabel_macro(action_bind_sublabel_video_force_srgb_enable,       MENU_ENUM_SUBLABEL_VIDEO_FORCE_SRGB_DISABLE)
 default_sublabel_macro(action_bind_sublabel_video_fullscreen,              MENU_ENUM_SUBLABEL_VIDEO_FULLSCREEN)
@@ -256,7 +263,6 @@ default_sublabel_macro(action_bind_sublabel_close_content,
 default_sublabel_macro(action_bind_sublabel_load_state,                            MENU_ENUM_SUBLABEL_LOAD_STATE)
 default_sublabel_macro(action_bind_sublabel_save_state,                            MENU_ENUM_SUBLABEL_SAVE_STATE)
 default_sublabel_macro(action_bind_sublabel_resume_content,                        MENU_ENUM_SUBLABEL_RESUME_CONTENT)
-default_sublabel_macro(action_bind_sublabel_state_slot,                            MENU_ENUM_SUBLABEL_STATE_SLOT)
 default_sublabel_macro(action_bind_sublabel_undo_load_state,                       MENU_ENUM_SUBLABEL_UNDO_LOAD_STATE)
 default_sublabel_macro(action_bind_sublabel_undo_save_state,                       MENU_ENUM_SUBLABEL_UNDO_SAVE_STATE)
 default_sublabel_macro(action_bind_sublabel_accounts_retro_achievements,           MENU_ENUM_SUBLABEL_ACCOUNTS_RETRO_ACHIEVEMENTS)
@@ -374,6 +380,83 @@ default_sublabel_macro(action_bind_sublabel_video_viewport_custom_y,
 default_sublabel_macro(action_bind_sublabel_netplay_use_mitm_server,               MENU_ENUM_SUBLABEL_NETPLAY_USE_MITM_SERVER)
 default_sublabel_macro(action_bind_sublabel_core_delete,                           MENU_ENUM_SUBLABEL_CORE_DELETE)
 
+/* The header of the selected state slot, kept so that redrawing the menu
+ * doesn't reread it. Looked at again when the slot changes or a state has
+ * been saved or loaded since. */
+struct state_slot_cache
+{
+   bool valid;
+   bool has_info;
+   unsigned serial;
+   char path[PATH_MAX_LENGTH];
+   content_state_info_t info;
+};
+
+static struct state_slot_cache state_slot_cache;
+
+static int action_bind_sublabel_state_slot(
+      file_list_t *list,
+      unsigned type, unsigned i,
+      const char *label, const char *path,
+      char *s, size_t len)
+{
+   char state_path[PATH_MAX_LENGTH];
+   struct state_slot_cache *cache = &state_slot_cache;
+   settings_t *settings           = config_get_ptr();
+   global_t   *global             = global_get_ptr();
+
+   strlcpy(s, msg_hash_to_str(MENU_ENUM_SUBLABEL_STATE_SLOT), len);
+
+   if (!global || string_is_empty(global->name.savestate))
+      return 0;
+
+   state_path[0] = '\0';
+
+   if (settings->ints.state_slot > 0)
+   {
+      /* A path too long for us is too long to open */
+      if (snprintf(state_path, sizeof(state_path), "%s%d",
+               global->name.savestate, settings->ints.state_slot)
+            >= (int)sizeof(state_path))
+         return 0;
+   }
+   else if (settings->ints.state_slot < 0)
+      fill_pathname_join_delim(state_path,
+            global->name.savestate, "auto", '.', sizeof(state_path));
+   else
+      strlcpy(state_path, global->name.savestate, sizeof(state_path));
+
+   if (!cache->valid || cache->serial != content_get_state_serial() ||
+         !string_is_equal(cache->path, state_path))
+   {
+      /* Only the header is read, never the state itself */
+      cache->has_info = content_get_state_info(state_path, &cache->info);
+      cache->serial   = content_get_state_serial();
+      cache->valid    = true;
+      strlcpy(cache->path, state_path, sizeof(cache->path));
+   }
+
+   if (cache->has_info)
+   {
+      char saved[64];
+      char tmp[256];
+      content_state_info_t *info = &cache->info;
+      time_t timestamp           = (time_t)info->timestamp;
+      struct tm *tm    = localtime(&timestamp);
+
+      saved[0] = '\0';
+      if (tm)
+         strftime(saved, sizeof(saved), "%Y-%m-%d %H:%M", tm);
+
+      snprintf(tmp, sizeof(tmp), "\n%s %s, %s, %u KB",
+            info->core_name, info->core_version, saved,
+            (unsigned)(info->stored_size / 1024));
+      strlcat(s, tmp, len);
+   }
+
+   return 0;
+}
+
 static int action_bind_sublabel_cheevos_entry(
       file_list_t *list,
       unsigned type, unsigned i,
@@ -1094,6 +1177,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_VIDEO_GPU_SCREENSHOT:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_gpu_screenshot);
             break;
+         case MENU_ENUM_LABEL_SCREENSHOT_FAST_COMPRESSION:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_screenshot_fast_compression);
+            break;
          case MENU_ENUM_LABEL_VIDEO_SCALE_INTEGER:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_video_scale_integer);
             break;
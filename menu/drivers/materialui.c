@@ -766,6 +766,10 @@ static void mui_render(void *data, bool is_idle)
       new_accel_val = old_accel_val * 0.96;
 
       menu_input_ctl(MENU_INPUT_CTL_POINTER_ACCEL_WRITE, &new_accel_val);
+
+      /* Keep redrawing while the list still visibly scrolls */
+      if (old_accel_val > 0.1f || old_accel_val < -0.1f)
+         menu_animation_ctl(MENU_ANIMATION_CTL_SET_ACTIVE, NULL);
    }
 
    if (settings->bools.menu_mouse_enable)
@@ -798,6 +802,8 @@ static void mui_render(void *data, bool is_idle)
       mui->scroll_y = 0;
 
    menu_entries_ctl(MENU_ENTRIES_CTL_SET_START, &i);
+
+   menu_animation_ctl(MENU_ANIMATION_CTL_CLEAR_ACTIVE, NULL);
 }
 
 /* Display an entry value on the right of the screen. */
@@ -1490,17 +1496,19 @@ static void mui_frame(void *data, video_frame_info_t *video_info)
    font_driver_bind_block(mui->font, &mui->raster_block);
    font_driver_bind_block(mui->font2, &mui->raster_block2);
 
-   if (menu_display_get_update_pending())
-      mui_render_menu_list(
-            video_info,
-            mui,
-            width,
-            height,
-            font_normal_color,
-            font_hover_color,
-            &active_tab_marker_color[0],
-            sublabel_color
-            );
+   mui_render_menu_list(
+         video_info,
+         mui,
+         width,
+         height,
+         font_normal_color,
+         font_hover_color,
+         &active_tab_marker_color[0],
+         sublabel_color
+         );
+
+   /* Text goes on top of the icons */
+   menu_display_batch_flush();
 
    font_driver_flush(video_info->width, video_info->height, mui->font,
          video_info);
@@ -1510,8 +1518,6 @@ static void mui_frame(void *data, video_frame_info_t *video_info)
          video_info);
    font_driver_bind_block(mui->font2, NULL);
 
-   menu_animation_ctl(MENU_ANIMATION_CTL_SET_ACTIVE, NULL);
-
    /* header */
    menu_display_draw_quad(
       0,
@@ -135,7 +135,7 @@ int generic_menu_iterate(void *data, void *userdata, enum menu_action action)
             file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
             menu_file_list_cbs_t *cbs  = selection_buf ?
                (menu_file_list_cbs_t*)
-			   file_list_get_actiondata_at_offset(selection_buf, selection) 
+			   menu_entries_get_actiondata_at_offset(selection_buf, selection) 
                : NULL;
 
             if (cbs->enum_idx != MSG_UNKNOWN)
@@ -64,6 +64,10 @@ typedef struct
 
 static uint16_t *rgui_framebuf_data      = NULL;
 
+/* Copy of the last framebuffer that was handed to the video driver */
+static uint16_t *rgui_framebuf_shadow    = NULL;
+static bool rgui_framebuf_shadow_valid   = false;
+
 #if defined(GEKKO)|| defined(PSP)
 #define HOVER_COLOR(settings)    ((3 << 0) | (10 << 4) | (3 << 8) | (7 << 12))
 #define NORMAL_COLOR(settings)   0x7FFF
@@ -392,6 +396,38 @@ static void rgui_frame(void *data, video_frame_info_t *video_info)
    rgui->frame_count++;
 }
 
+/* Compares the framebuffer against the last uploaded one row by
+ * row and brings the shadow copy up to date. Returns false if
+ * not a single row changed, in which case nothing needs to be
+ * uploaded or presented. */
+static bool rgui_framebuffer_changed(size_t fb_pitch,
+      unsigned fb_height)
+{
+   unsigned y;
+   bool changed = !rgui_framebuf_shadow_valid;
+
+   if (!rgui_framebuf_data || !rgui_framebuf_shadow)
+      return true;
+
+   for (y = 0; y < fb_height; y++)
+   {
+      size_t offset = y * (fb_pitch >> 1);
+
+      if (rgui_framebuf_shadow_valid && !memcmp(
+               rgui_framebuf_shadow + offset,
+               rgui_framebuf_data   + offset, fb_pitch))
+         continue;
+
+      memcpy(rgui_framebuf_shadow + offset,
+            rgui_framebuf_data + offset, fb_pitch);
+      changed = true;
+   }
+
+   rgui_framebuf_shadow_valid = true;
+
+   return changed;
+}
+
 static void rgui_render(void *data, bool is_idle)
 {
    menu_animation_ctx_ticker_t ticker;
@@ -435,6 +471,8 @@ static void rgui_render(void *data, bool is_idle)
                fb_pitch, 0, fb_height, fb_width, 4, rgui_gray_filler);
       rgui->last_width  = fb_width;
       rgui->last_height = fb_height;
+
+      rgui_framebuf_shadow_valid = false;
    }
 
    menu_display_set_framebuffer_dirty_flag();
@@ -667,13 +705,20 @@ static void rgui_render(void *data, bool is_idle)
          rgui_blit_cursor();
    }
 
+   /* Redrawing the same menu again must not cost an upload */
+   if (!rgui_framebuffer_changed(fb_pitch, fb_height))
+      menu_display_unset_framebuffer_dirty_flag();
 }
 
 static void rgui_framebuffer_free(void)
 {
    if (rgui_framebuf_data)
       free(rgui_framebuf_data);
-   rgui_framebuf_data = NULL;
+   if (rgui_framebuf_shadow)
+      free(rgui_framebuf_shadow);
+   rgui_framebuf_data         = NULL;
+   rgui_framebuf_shadow       = NULL;
+   rgui_framebuf_shadow_valid = false;
 }
 
 static void *rgui_init(void **userdata, bool video_is_threaded)
@@ -701,6 +746,10 @@ static void *rgui_init(void **userdata, bool video_is_threaded)
    if (!rgui_framebuf_data)
       goto error;
 
+   rgui_framebuf_shadow       = (uint16_t*)
+      calloc(400 * 240, sizeof(uint16_t));
+   rgui_framebuf_shadow_valid = false;
+
    fb_width                   = 320;
    fb_height                  = 240;
    fb_pitch                   = fb_width * sizeof(uint16_t);
@@ -769,6 +818,18 @@ static void rgui_set_texture(void)
          false, fb_width, fb_height, 1.0f);
 }
 
+static void rgui_context_reset(void *data, bool is_threaded)
+{
+   /* The video driver lost the texture, upload it again */
+   rgui_framebuf_shadow_valid = false;
+}
+
+static void rgui_toggle(void *userdata, bool menu_on)
+{
+   if (menu_on)
+      rgui_framebuf_shadow_valid = false;
+}
+
 static void rgui_navigation_clear(void *data, bool pending_push)
 {
    size_t start;
@@ -899,10 +960,10 @@ menu_ctx_driver_t menu_ctx_rgui = {
    rgui_frame,
    rgui_init,
    rgui_free,
-   NULL,
+   rgui_context_reset,
    NULL,
    rgui_populate_entries,
-   NULL,
+   rgui_toggle,
    rgui_navigation_clear,
    NULL,
    NULL,
@@ -43,6 +43,7 @@
 
 #include "../menu_driver.h"
 #include "../menu_animation.h"
+#include "../menu_thumbnail_cache.h"
 
 #include "../../core_info.h"
 #include "../../core.h"
@@ -920,23 +921,24 @@ end:
    string_list_free(list);
 }
 
-static void xmb_update_thumbnail_path(void *data, unsigned i)
+/* Builds the thumbnail path of entry i of the current list
+ * into s, for content named 'content'. Returns false if the
+ * entry has no thumbnail. */
+static bool xmb_thumbnail_path_build(xmb_handle_t *xmb, unsigned i,
+      const char *content, char *s, size_t len)
 {
    menu_entry_t entry;
+   bool ret                 = true;
    unsigned entry_type      = 0;
    char *scrub_char_pointer = NULL;
    settings_t     *settings = config_get_ptr();
-   xmb_handle_t     *xmb    = (xmb_handle_t*)data;
    playlist_t     *playlist = NULL;
    const char    *core_name = NULL;
-   char            *tmp_new = (char*)
-      malloc(PATH_MAX_LENGTH * sizeof(char));
+   char            *tmp_new = NULL;
 
-   menu_entry_init(&entry);
-
-   if (!xmb)
-      goto end;
+   s[0] = '\0';
 
+   menu_entry_init(&entry);
    menu_entry_get(&entry, 0, i, NULL, true);
 
    entry_type = menu_entry_get_type_new(&entry);
@@ -950,19 +952,14 @@ static void xmb_update_thumbnail_path(void *data, unsigned i)
       if (node && node->fullpath)
       {
          if (!string_is_empty(entry.path))
-            fill_pathname_join(
-                  xmb->thumbnail_file_path,
-                  node->fullpath,
-                  entry.path,
-                  sizeof(xmb->thumbnail_file_path));
+            fill_pathname_join(s, node->fullpath, entry.path, len);
 
          goto end;
       }
    }
    else if (filebrowser_get_type() != FILEBROWSER_NONE)
    {
-      xmb->thumbnail_file_path[0] = '\0';
-      xmb->thumbnail = 0;
+      ret = false;
       goto end;
    }
 
@@ -976,59 +973,61 @@ static void xmb_update_thumbnail_path(void *data, unsigned i)
       if (string_is_equal(core_name, "imageviewer"))
       {
          if (!string_is_empty(entry.label))
-            strlcpy(xmb->thumbnail_file_path, entry.label,
-                  sizeof(xmb->thumbnail_file_path));
+            strlcpy(s, entry.label, len);
          goto end;
       }
    }
 
    if (!string_is_empty(xmb->thumbnail_system))
-      fill_pathname_join(
-            xmb->thumbnail_file_path,
-            settings->paths.directory_thumbnails,
-            xmb->thumbnail_system,
-            sizeof(xmb->thumbnail_file_path));
+      fill_pathname_join(s, settings->paths.directory_thumbnails,
+            xmb->thumbnail_system, len);
 
-   fill_pathname_join(xmb->thumbnail_file_path, xmb->thumbnail_file_path,
-         xmb_thumbnails_ident(), sizeof(xmb->thumbnail_file_path));
+   fill_pathname_join(s, s, xmb_thumbnails_ident(), len);
 
+   if (!string_is_empty(content))
    {
-      char             *tmp    = NULL;
       /* Scrub characters that are not cross-platform and/or violate the
        * No-Intro filename standard:
        * http://datomatic.no-intro.org/stuff/The%20Official%20No-Intro%20Convention%20(20071030).zip
        * Replace these characters in the entry name with underscores.
        */
-      if (!string_is_empty(xmb->thumbnail_content))
-         tmp = strdup(xmb->thumbnail_content);
+      char *tmp = strdup(content);
 
-      if (!string_is_empty(tmp))
-      {
-         while((scrub_char_pointer = strpbrk(tmp, "&*/:`<>?\\|")))
-            *scrub_char_pointer = '_';
-      }
+      while((scrub_char_pointer = strpbrk(tmp, "&*/:`<>?\\|")))
+         *scrub_char_pointer = '_';
 
       /* Look for thumbnail file with this scrubbed filename */
+      tmp_new = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
       tmp_new[0] = '\0';
 
-      if (!string_is_empty(tmp))
-      {
-         fill_pathname_join(tmp_new,
-               xmb->thumbnail_file_path,
-               tmp, PATH_MAX_LENGTH * sizeof(char));
-         strlcpy(xmb->thumbnail_file_path,
-               tmp_new, sizeof(xmb->thumbnail_file_path));
-      }
+      fill_pathname_join(tmp_new, s, tmp, PATH_MAX_LENGTH * sizeof(char));
+      strlcpy(s, tmp_new, len);
       free(tmp);
    }
 
-   strlcat(xmb->thumbnail_file_path,
-         file_path_str(FILE_PATH_PNG_EXTENSION),
-         sizeof(xmb->thumbnail_file_path));
+   strlcat(s, file_path_str(FILE_PATH_PNG_EXTENSION), len);
 
 end:
    menu_entry_free(&entry);
    free(tmp_new);
+   return ret;
+}
+
+static void xmb_update_thumbnail_path(void *data, unsigned i)
+{
+   xmb_handle_t *xmb = (xmb_handle_t*)data;
+
+   if (!xmb)
+      return;
+
+   if (!xmb_thumbnail_path_build(xmb, i, xmb->thumbnail_content,
+            xmb->thumbnail_file_path, sizeof(xmb->thumbnail_file_path)))
+   {
+      /* Nothing to show, a load still in flight
+       * must not bring the old thumbnail back. */
+      menu_thumbnail_cache_cancel();
+      xmb->thumbnail = 0;
+   }
 }
 
 static void xmb_update_savestate_thumbnail_path(void *data, unsigned i)
@@ -1098,10 +1097,25 @@ static void xmb_update_thumbnail_image(void *data)
       return;
 
    if (path_file_exists(xmb->thumbnail_file_path))
-      task_push_image_load(xmb->thumbnail_file_path,
-            menu_display_handle_thumbnail_upload, NULL);
+   {
+      menu_thumbnail_t thumbnail;
+
+      if (menu_thumbnail_cache_request(xmb->thumbnail_file_path,
+               &thumbnail))
+      {
+         menu_ctx_load_image_t load_image_info;
+
+         load_image_info.data = &thumbnail;
+         load_image_info.type = MENU_IMAGE_THUMBNAIL;
+
+         menu_driver_load_image(&load_image_info);
+      }
+   }
    else
+   {
+      menu_thumbnail_cache_cancel();
       xmb->thumbnail = 0;
+   }
 }
 
 static void xmb_set_thumbnail_system(void *data, char*s, size_t len)
@@ -1158,6 +1172,29 @@ static unsigned xmb_get_system_tab(xmb_handle_t *xmb, unsigned i)
    return UINT_MAX;
 }
 
+/* Starts loading the thumbnail of playlist entry i
+ * into the thumbnail cache, leaving the displayed
+ * thumbnail untouched. */
+static void xmb_prefetch_thumbnail(xmb_handle_t *xmb, unsigned i)
+{
+   menu_entry_t entry;
+   char *path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+   if (!path)
+      return;
+
+   menu_entry_init(&entry);
+   menu_entry_get(&entry, 0, i, NULL, true);
+
+   if (xmb_thumbnail_path_build(xmb, i, entry.path,
+            path, PATH_MAX_LENGTH * sizeof(char))
+         && path_file_exists(path))
+      menu_thumbnail_cache_prefetch(path);
+
+   menu_entry_free(&entry);
+   free(path);
+}
+
 static void xmb_selection_pointer_changed(
       xmb_handle_t *xmb, bool allow_animations)
 {
@@ -1222,6 +1259,12 @@ static void xmb_selection_pointer_changed(
                   xmb_set_thumbnail_content(xmb, entry.path, 0 /* will be ignored */);
                xmb_update_thumbnail_path(xmb, i);
                xmb_update_thumbnail_image(xmb);
+
+               /* Neighbours are likely to be shown next */
+               if (i > 0)
+                  xmb_prefetch_thumbnail(xmb, i - 1);
+               if (i + 1 < end)
+                  xmb_prefetch_thumbnail(xmb, i + 1);
             }
             else if (((entry_type == FILE_TYPE_IMAGE || entry_type == FILE_TYPE_IMAGEVIEWER ||
                         entry_type == FILE_TYPE_RDB || entry_type == FILE_TYPE_RDB_ENTRY)
@@ -2764,6 +2807,9 @@ static void xmb_draw_bg(
       }
 
       menu_display_draw_pipeline(&draw);
+
+      /* The shader animates the background on every frame */
+      menu_animation_ctl(MENU_ANIMATION_CTL_SET_ACTIVE, NULL);
    }
    else
 #endif
@@ -3149,6 +3195,9 @@ static void xmb_frame(void *data, video_frame_info_t *video_info)
             width,
             height);
 
+   /* Text goes on top of the icons */
+   menu_display_batch_flush();
+
    font_driver_flush(video_info->width, video_info->height, xmb->font,
          video_info);
    font_driver_bind_block(xmb->font, NULL);
@@ -3354,6 +3403,9 @@ static void xmb_layout(xmb_handle_t *xmb)
    else
       xmb_layout_psp(xmb, width);
 
+   /* the height follows from the thumbnail's aspect ratio */
+   menu_thumbnail_cache_set_size((unsigned)xmb->thumbnail_width, 0);
+
    current = (unsigned)selection;
    end     = (unsigned)menu_entries_get_size();
 
@@ -3620,12 +3672,11 @@ static bool xmb_load_image(void *userdata, void *data, enum menu_image_type type
          break;
       case MENU_IMAGE_THUMBNAIL:
          {
-            struct texture_image *img  = (struct texture_image*)data;
-            xmb->thumbnail_height      = xmb->thumbnail_width
-               * (float)img->height / (float)img->width;
-            video_driver_texture_unload(&xmb->thumbnail);
-            video_driver_texture_load(data,
-                  TEXTURE_FILTER_MIPMAP_LINEAR, &xmb->thumbnail);
+            /* Owned by the thumbnail cache, don't unload it */
+            menu_thumbnail_t *thumbnail = (menu_thumbnail_t*)data;
+            xmb->thumbnail_height       = xmb->thumbnail_width
+               * (float)thumbnail->height / (float)thumbnail->width;
+            xmb->thumbnail              = thumbnail->texture;
          }
          break;
       case MENU_IMAGE_SAVESTATE_THUMBNAIL:
@@ -3973,7 +4024,7 @@ static void xmb_list_free(file_list_t *list, size_t a, size_t b)
    xmb_list_clear(list);
 }
 
-static void xmb_list_deep_copy(const file_list_t *src, file_list_t *dst,
+static void xmb_list_deep_copy(file_list_t *src, file_list_t *dst,
       size_t first, size_t last)
 {
    size_t i, j = 0;
@@ -3992,10 +4043,12 @@ static void xmb_list_deep_copy(const file_list_t *src, file_list_t *dst,
       struct item_file *d = &dst->list[j];
       struct item_file *s = &src->list[i];
 
+      /* Bind lazy entries while their menu is still on top */
+      void *src_adata = menu_entries_get_actiondata_at_offset(src, i);
       void *src_udata = s->userdata;
-      void *src_adata = s->actiondata;
 
       *d       = *s;
+      d->actiondata_pending = false;
       d->alt   = string_is_empty(d->alt)   ? NULL : strdup(d->alt);
       d->path  = string_is_empty(d->path)  ? NULL : strdup(d->path);
       d->label = string_is_empty(d->label) ? NULL : strdup(d->label);
@@ -4178,7 +4231,8 @@ static void xmb_context_destroy(void *data)
    for (i = 0; i < XMB_TEXTURE_LAST; i++)
       video_driver_texture_unload(&xmb->textures.list[i]);
 
-   video_driver_texture_unload(&xmb->thumbnail);
+   menu_thumbnail_cache_free();
+   xmb->thumbnail = 0;
    video_driver_texture_unload(&xmb->savestate_thumbnail);
 
    xmb_context_destroy_horizontal_list(xmb);
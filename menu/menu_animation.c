@@ -59,6 +59,9 @@ static retro_time_t cur_time    = 0;
 static retro_time_t old_time    = 0;
 static float delta_time         = 0.0f;
 static bool animation_is_active = false;
+/* Like animation_is_active, but only cleared once the menu
+ * checked whether it has to present a new frame */
+static bool animation_redraw    = false;
 
 /* from https://github.com/kikito/tween.lua/blob/master/tween.lua */
 
@@ -539,6 +542,7 @@ bool menu_animation_update(float delta_time)
 
 
    animation_is_active = true;
+   animation_redraw    = true;
 
    return true;
 }
@@ -578,6 +582,7 @@ bool menu_animation_ticker(const menu_animation_ctx_ticker_t *ticker)
          str_len);
 
    animation_is_active = true;
+   animation_redraw    = true;
 
    return true;
 }
@@ -608,6 +613,7 @@ void menu_animation_update_time(bool timedate_enable)
          && timedate_enable)
    {
       animation_is_active   = true;
+      animation_redraw      = true;
       last_clock_update     = cur_time;
    }
 }
@@ -617,6 +623,14 @@ bool menu_animation_is_active(void)
    return animation_is_active;
 }
 
+/* Returns true if anything animated since the last
+ * MENU_ANIMATION_CTL_CLEAR_REDRAW, regardless of
+ * menu drivers clearing the active state themselves. */
+bool menu_animation_needs_redraw(void)
+{
+   return animation_redraw;
+}
+
 bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
 {
    switch (state)
@@ -644,6 +658,10 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
          break;
       case MENU_ANIMATION_CTL_SET_ACTIVE:
          animation_is_active       = true;
+         animation_redraw          = true;
+         break;
+      case MENU_ANIMATION_CTL_CLEAR_REDRAW:
+         animation_redraw          = false;
          break;
       case MENU_ANIMATION_CTL_DELTA_TIME:
          {
@@ -34,6 +34,7 @@ enum menu_animation_ctl_state
    MENU_ANIMATION_CTL_DEINIT,
    MENU_ANIMATION_CTL_CLEAR_ACTIVE,
    MENU_ANIMATION_CTL_SET_ACTIVE,
+   MENU_ANIMATION_CTL_CLEAR_REDRAW,
    MENU_ANIMATION_CTL_DELTA_TIME,
    MENU_ANIMATION_CTL_KILL_BY_TAG,
    MENU_ANIMATION_CTL_KILL_BY_SUBJECT
@@ -130,6 +131,8 @@ void menu_animation_update_time(bool timedate_enable);
 
 bool menu_animation_is_active(void);
 
+bool menu_animation_needs_redraw(void);
+
 bool menu_animation_push(menu_animation_ctx_entry_t *entry);
 
 bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data);
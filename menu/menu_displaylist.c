@@ -401,7 +401,7 @@ static int menu_displaylist_parse_core_info(menu_displaylist_info_t *info)
 
    core_info_get_current_core(&core_info);
 
-   if (!core_info || !core_info->config_data)
+   if (!core_info || !core_info->has_info)
    {
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE_INFORMATION_AVAILABLE),
@@ -1477,8 +1477,13 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
       playlist_t *playlist, const char *path_playlist, bool is_history)
 {
    unsigned i;
-   size_t list_size = 0;
-   size_t selection = menu_navigation_get_selection();
+   size_t list_size                   = 0;
+   size_t selection                   = menu_navigation_get_selection();
+   size_t path_size                   = PATH_MAX_LENGTH * sizeof(char);
+   char *path_copy                    = NULL;
+   char *fill_buf                     = NULL;
+   char *path_short                   = NULL;
+   char *tmp                          = NULL;
 
    if (!playlist)
       return -1;
@@ -1509,11 +1514,17 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
    /* preallocate the file list */
    file_list_reserve(info->list, list_size);
 
+   /* Scratch buffers shared by all entries */
+   path_copy                          = (char*)malloc(path_size);
+   fill_buf                           = (char*)malloc(path_size);
+   path_short                         = (char*)malloc(path_size);
+   tmp                                = (char*)malloc(path_size);
+
+   if (!path_copy || !fill_buf || !path_short || !tmp)
+      goto end;
+
    for (i = 0; i < list_size; i++)
    {
-      char *path_copy                 = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
-      char *fill_buf                  = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
-      size_t path_size                = PATH_MAX_LENGTH * sizeof(char);
       const char *core_name           = NULL;
       const char *path                = NULL;
       const char *label               = NULL;
@@ -1546,8 +1557,6 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
 
       if (path)
       {
-         char *path_short = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
-
          path_short[0] = '\0';
 
          fill_short_pathname_representation(path_short, path,
@@ -1561,35 +1570,31 @@ static int menu_displaylist_parse_playlist(menu_displaylist_info_t *info,
             if (!string_is_equal(core_name,
                      file_path_str(FILE_PATH_DETECT)))
             {
-               char *tmp       = (char*)
-                  malloc(PATH_MAX_LENGTH * sizeof(char));
-
                tmp[0] = '\0';
 
                snprintf(tmp, path_size, " (%s)", core_name);
                strlcat(fill_buf, tmp, path_size);
-
-               free(tmp);
             }
          }
-
-         free(path_short);
       }
 
       if (!path)
-         menu_entries_append_enum(info->list, fill_buf, path_playlist,
+         menu_entries_append_enum_lazy(info->list, fill_buf, path_playlist,
                MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_PLAYLIST_ENTRY, 0, i);
       else if (is_history)
-         menu_entries_append_enum(info->list, fill_buf,
+         menu_entries_append_enum_lazy(info->list, fill_buf,
                path, MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
       else
-         menu_entries_append_enum(info->list, label,
+         menu_entries_append_enum_lazy(info->list, label,
                path, MENU_ENUM_LABEL_PLAYLIST_ENTRY, FILE_TYPE_RPL_ENTRY, 0, i);
-
-      free(path_copy);
-      free(fill_buf);
    }
 
+end:
+   free(path_copy);
+   free(fill_buf);
+   free(path_short);
+   free(tmp);
+
    return 0;
 }
 
@@ -2236,7 +2241,7 @@ static int menu_database_parse_query(file_list_t *list, const char *path,
    for (i = 0; i < db_list->count; i++)
    {
       if (!string_is_empty(db_list->list[i].name))
-         menu_entries_append_enum(list, db_list->list[i].name,
+         menu_entries_append_enum_lazy(list, db_list->list[i].name,
                path, MENU_ENUM_LABEL_RDB_ENTRY, FILE_TYPE_RDB_ENTRY, 0, 0);
    }
 
@@ -3082,7 +3087,7 @@ static int menu_displaylist_parse_information_list(
           !string_is_equal(system->info.library_name,
              msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE))
          )
-         && core_info && core_info->config_data
+         && core_info && core_info->has_info
       )
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_INFORMATION),
@@ -5960,6 +5965,9 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_FRAMECOUNT_SHOW,
                PARSE_ONLY_BOOL, false);
+         menu_displaylist_parse_settings_enum(menu, info,
+               MENU_ENUM_LABEL_MENU_STATS_SHOW,
+               PARSE_ONLY_BOOL, false);
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_SCREEN_RESOLUTION,
                PARSE_ACTION, false);
@@ -6065,6 +6073,9 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type, void *data)
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_VIDEO_GPU_SCREENSHOT,
                PARSE_ONLY_BOOL, false);
+         menu_displaylist_parse_settings_enum(menu, info,
+               MENU_ENUM_LABEL_SCREENSHOT_FAST_COMPRESSION,
+               PARSE_ONLY_BOOL, false);
          menu_displaylist_parse_settings_enum(menu, info,
                MENU_ENUM_LABEL_VIDEO_CROP_OVERSCAN,
                PARSE_ONLY_BOOL, false);
@@ -121,6 +121,21 @@ uintptr_t menu_display_white_texture;
 
 static video_coord_array_t menu_disp_ca;
 
+/* Quads drawn with the same texture between two state changes
+ * are merged into a single draw call, see menu_display_draw(). */
+#define MENU_DISPLAY_BATCH_MAX_VERTICES 64
+
+static struct
+{
+   video_coord_array_t ca;
+   uintptr_t texture;
+   unsigned width;
+   unsigned height;
+   bool active;
+   menu_display_batch_stats_t frame;
+   menu_display_batch_stats_t last_frame;
+} menu_disp_batch;
+
 static enum 
 menu_toggle_reason menu_display_toggle_reason    = MENU_TOGGLE_REASON_NONE;
 
@@ -136,6 +151,7 @@ static bool menu_display_has_windowed            = false;
 static bool menu_display_msg_force               = false;
 static bool menu_display_font_alloc_framebuf     = false;
 static bool menu_display_framebuf_dirty          = false;
+static bool menu_display_idle                    = false;
 static const uint8_t *menu_display_font_framebuf = NULL;
 static menu_display_ctx_driver_t *menu_disp      = NULL;
 
@@ -288,6 +304,7 @@ void menu_display_timedate(menu_display_ctx_datetime_t *datetime)
 /* Begin blending operation */
 void menu_display_blend_begin(void)
 {
+   menu_display_batch_flush();
    if (menu_disp && menu_disp->blend_begin)
       menu_disp->blend_begin();
 }
@@ -295,6 +312,7 @@ void menu_display_blend_begin(void)
 /* End blending operation */
 void menu_display_blend_end(void)
 {
+   menu_display_batch_flush();
    if (menu_disp && menu_disp->blend_end)
       menu_disp->blend_end();
 }
@@ -479,16 +497,36 @@ bool menu_display_get_update_pending(void)
    return false;
 }
 
+/* Batches are only collected between setting and unsetting
+ * the viewport, as they are drawn over all of it. */
 void menu_display_set_viewport(unsigned width, unsigned height)
 {
+   menu_display_batch_flush();
    video_driver_set_viewport(width, height, true, false);
+
+   /* Only the GL backend draws arbitrary vertices
+    * with the viewport and matrix of each draw */
+   menu_disp_batch.active = menu_disp
+      && menu_disp->type == MENU_VIDEO_DRIVER_OPENGL;
+   menu_disp_batch.width  = width;
+   menu_disp_batch.height = height;
 }
 
 void menu_display_unset_viewport(unsigned width, unsigned height)
 {
+   menu_display_batch_flush();
+   menu_disp_batch.active = false;
    video_driver_set_viewport(width, height, false, true);
 }
 
+/* Returns true if the menu skipped presenting its last frame
+ * because nothing changed on screen. The runloop sleeps instead
+ * of iterating at full speed while the menu is idle. */
+bool menu_display_get_idle(void)
+{
+   return menu_driver_alive && menu_display_idle;
+}
+
 /* Checks if the menu framebuffer has its 'dirty flag' set. This
  * means that the current contents of the framebuffer has changed
  * and that it has to be rendered to the screen. */
@@ -561,10 +599,160 @@ bool menu_display_restore_clear_color(void)
 
 void menu_display_clear_color(menu_display_ctx_clearcolor_t *color)
 {
+   menu_display_batch_flush();
    if (menu_disp && menu_disp->clear_color)
       menu_disp->clear_color(color);
 }
 
+/* Draws the vertices batched so far, has to be called before
+ * anything changes the render state or draws to the screen
+ * past menu_display_draw(). */
+void menu_display_batch_flush(void)
+{
+   menu_display_ctx_draw_t draw;
+   struct video_coords coords;
+   video_coord_array_t *ca = &menu_disp_batch.ca;
+
+   if (!ca->coords.vertices)
+      return;
+
+   coords.vertices      = ca->coords.vertices;
+   coords.vertex        = ca->coords.vertex;
+   coords.tex_coord     = ca->coords.tex_coord;
+   coords.lut_tex_coord = ca->coords.lut_tex_coord;
+   coords.color         = ca->coords.color;
+
+   draw.x               = 0;
+   draw.y               = 0;
+   draw.width           = menu_disp_batch.width;
+   draw.height          = menu_disp_batch.height;
+   draw.coords          = &coords;
+   draw.matrix_data     = NULL;
+   draw.texture         = menu_disp_batch.texture;
+   draw.prim_type       = MENU_DISPLAY_PRIM_TRIANGLES;
+   draw.pipeline.id     = 0;
+
+   ca->coords.vertices  = 0;
+
+   if (!menu_disp || !menu_disp->draw)
+      return;
+
+   menu_disp->draw(&draw);
+
+   menu_disp_batch.frame.draw_calls++;
+   menu_disp_batch.frame.vertices += coords.vertices;
+}
+
+/* Transforms the vertices of @draw to the whole viewport and
+ * appends them to the batch as triangles. Returns false if the
+ * draw has to be issued on its own. */
+static bool menu_display_batch_append(menu_display_ctx_draw_t *draw)
+{
+   unsigned i, j, count;
+   struct video_coords coords;
+   float vertex[2 * 3 * MENU_DISPLAY_BATCH_MAX_VERTICES];
+   float tex_coord[2 * 3 * MENU_DISPLAY_BATCH_MAX_VERTICES];
+   float color[4 * 3 * MENU_DISPLAY_BATCH_MAX_VERTICES];
+   const float *src_vertex          = draw->coords->vertex;
+   const float *src_tex_coord       = draw->coords->tex_coord;
+   const float *src_color           = draw->coords->color;
+   const math_matrix_4x4 *mat       = (const math_matrix_4x4*)
+      draw->matrix_data;
+   unsigned vertices                = draw->coords->vertices;
+   float scale_x                    = 0.5f * draw->width
+      / menu_disp_batch.width;
+   float scale_y                    = 0.5f * draw->height
+      / menu_disp_batch.height;
+   float offset_x                   = draw->x / menu_disp_batch.width;
+   float offset_y                   = draw->y / menu_disp_batch.height;
+
+   if (     !menu_disp_batch.active
+         || !menu_disp_batch.width
+         || !menu_disp_batch.height
+         || draw->pipeline.id
+         || vertices < 3
+         || vertices > MENU_DISPLAY_BATCH_MAX_VERTICES)
+      return false;
+
+   switch (draw->prim_type)
+   {
+      case MENU_DISPLAY_PRIM_TRIANGLESTRIP:
+         count = 3 * (vertices - 2);
+         break;
+      case MENU_DISPLAY_PRIM_TRIANGLES:
+         count = vertices - vertices % 3;
+         break;
+      default:
+         return false;
+   }
+
+   if (!src_vertex)
+      src_vertex    = menu_disp->get_default_vertices();
+   if (!src_tex_coord)
+      src_tex_coord = menu_disp->get_default_tex_coords();
+   if (!mat)
+      mat           = (const math_matrix_4x4*)menu_disp->get_default_mvp();
+
+   if (!src_vertex || !src_tex_coord || !mat)
+      return false;
+
+   if (     menu_disp_batch.ca.coords.vertices
+         && menu_disp_batch.texture != draw->texture)
+      menu_display_batch_flush();
+
+   for (i = 0; i < count; i++)
+   {
+      float x, y, w;
+      unsigned k = i;
+
+      /* Unroll strips, keeping the winding of every other triangle */
+      if (draw->prim_type == MENU_DISPLAY_PRIM_TRIANGLESTRIP)
+      {
+         unsigned tri = i / 3;
+         unsigned vtx = i % 3;
+
+         k = tri + vtx;
+         if ((tri & 1) && vtx < 2)
+            k = tri + (vtx ^ 1);
+      }
+
+      x = src_vertex[2 * k + 0];
+      y = src_vertex[2 * k + 1];
+      w = MAT_ELEM_4X4(*mat, 3, 0) * x + MAT_ELEM_4X4(*mat, 3, 1) * y
+         + MAT_ELEM_4X4(*mat, 3, 3);
+
+      if (!w)
+         w = 1.0f;
+
+      /* Clip space of the draw's viewport to [0, 1] of the whole one */
+      vertex[2 * i + 0]    = offset_x + scale_x * (1.0f
+            + (MAT_ELEM_4X4(*mat, 0, 0) * x + MAT_ELEM_4X4(*mat, 0, 1) * y
+               + MAT_ELEM_4X4(*mat, 0, 3)) / w);
+      vertex[2 * i + 1]    = offset_y + scale_y * (1.0f
+            + (MAT_ELEM_4X4(*mat, 1, 0) * x + MAT_ELEM_4X4(*mat, 1, 1) * y
+               + MAT_ELEM_4X4(*mat, 1, 3)) / w);
+
+      tex_coord[2 * i + 0] = src_tex_coord[2 * k + 0];
+      tex_coord[2 * i + 1] = src_tex_coord[2 * k + 1];
+
+      for (j = 0; j < 4; j++)
+         color[4 * i + j]  = src_color ? src_color[4 * k + j] : 1.0f;
+   }
+
+   coords.vertices         = count;
+   coords.vertex           = vertex;
+   coords.tex_coord        = tex_coord;
+   coords.lut_tex_coord    = tex_coord;
+   coords.color            = color;
+
+   if (!video_coord_array_append(&menu_disp_batch.ca, &coords, count))
+      return false;
+
+   menu_disp_batch.texture = draw->texture;
+   menu_disp_batch.frame.batched++;
+   return true;
+}
+
 void menu_display_draw(menu_display_ctx_draw_t *draw)
 {
    if (!menu_disp || !draw || !menu_disp->draw)
@@ -574,11 +762,27 @@ void menu_display_draw(menu_display_ctx_draw_t *draw)
    if (draw->height <= 0)
       draw->height = 1;
 
+   if (menu_display_batch_append(draw))
+      return;
+
+   menu_display_batch_flush();
    menu_disp->draw(draw);
+
+   menu_disp_batch.frame.draw_calls++;
+   menu_disp_batch.frame.vertices += draw->coords->vertices;
+}
+
+/* Returns the number of draw calls the menu issued in its last
+ * frame, and how many of them were saved by batching. */
+void menu_display_get_batch_stats(menu_display_batch_stats_t *stats)
+{
+   if (stats)
+      *stats = menu_disp_batch.last_frame;
 }
 
 void menu_display_draw_pipeline(menu_display_ctx_draw_t *draw)
 {
+   menu_display_batch_flush();
    if (menu_disp && draw && menu_disp->draw_pipeline)
       menu_disp->draw_pipeline(draw);
 }
@@ -647,8 +851,7 @@ void menu_display_draw_quad(
    coords.lut_tex_coord = NULL;
    coords.color         = color;
 
-   if (menu_disp && menu_disp->blend_begin)
-      menu_disp->blend_begin();
+   menu_display_blend_begin();
 
    draw.x           = x;
    draw.y           = (int)height - y - (int)h;
@@ -662,8 +865,7 @@ void menu_display_draw_quad(
 
    menu_display_draw(&draw);
 
-   if (menu_disp && menu_disp->blend_end)
-      menu_disp->blend_end();
+   menu_display_blend_end();
 }
 
 void menu_display_draw_texture(
@@ -1023,22 +1225,6 @@ bool menu_display_get_tex_coords(menu_display_ctx_coord_draw_t *draw)
    return true;
 }
 
-void menu_display_handle_thumbnail_upload(void *task_data,
-      void *user_data, const char *err)
-{
-   menu_ctx_load_image_t load_image_info;
-   struct texture_image *img = (struct texture_image*)task_data;
-
-   load_image_info.data = img;
-   load_image_info.type = MENU_IMAGE_THUMBNAIL;
-
-   menu_driver_load_image(&load_image_info);
-
-   image_texture_free(img);
-   free(img);
-   free(user_data);
-}
-
 void menu_display_handle_savestate_thumbnail_upload(void *task_data,
       void *user_data, const char *err)
 {
@@ -1111,8 +1297,7 @@ void menu_display_draw_cursor(
    coords.lut_tex_coord = NULL;
    coords.color         = (const float*)color;
 
-   if (menu_disp && menu_disp->blend_begin)
-      menu_disp->blend_begin();
+   menu_display_blend_begin();
 
    draw.x               = x - (cursor_size / 2);
    draw.y               = (int)height - y - (cursor_size / 2);
@@ -1125,8 +1310,7 @@ void menu_display_draw_cursor(
 
    menu_display_draw(&draw);
 
-   if (menu_disp && menu_disp->blend_end)
-      menu_disp->blend_end();
+   menu_display_blend_end();
 }
 
 static INLINE float menu_display_scalef(float val,
@@ -1286,6 +1470,10 @@ void menu_display_draw_text(
       params.drop_alpha  = 0.35f;
    }
 
+   /* Text that isn't queued in a raster block is drawn right away */
+   if (!font || !font->block)
+      menu_display_batch_flush();
+
    video_driver_set_osd_msg(text, &params, (void*)font);
 }
 
@@ -1507,7 +1695,10 @@ static void menu_driver_toggle(bool on)
       menu_driver_ctx->toggle(menu_userdata, on);
 
    if (on)
-      menu_driver_alive = true;
+   {
+      menu_driver_alive           = true;
+      menu_display_framebuf_dirty = true;
+   }
    else
       menu_driver_alive = false;
 
@@ -1564,7 +1755,95 @@ const char *menu_driver_ident(void)
 void menu_driver_frame(video_frame_info_t *video_info)
 {
    if (menu_driver_alive && menu_driver_ctx->frame)
+   {
+      memset(&menu_disp_batch.frame, 0, sizeof(menu_disp_batch.frame));
+
       menu_driver_ctx->frame(menu_userdata, video_info);
+
+      menu_display_batch_flush();
+      menu_disp_batch.active     = false;
+      menu_disp_batch.last_frame = menu_disp_batch.frame;
+
+      /* Drivers with a framebuffer clear the flag once they
+       * uploaded it, everything else is drawn by now */
+      if (!menu_driver_ctx->set_texture)
+         menu_display_framebuf_dirty = false;
+   }
+}
+
+/* Frames presented after the last change before the menu goes
+ * idle, so messages that expired while drawing get erased and
+ * framebuffers uploaded after presenting get shown. */
+#define MENU_DISPLAY_IDLE_FRAMES 1
+
+/* Returns true if nothing changed on screen since the last
+ * frame that was presented. */
+static bool menu_display_check_idle(bool rarch_is_inited,
+      bool rarch_is_dummy_core)
+{
+   static unsigned idle_frames   = 0;
+   static unsigned old_width     = 0;
+   static unsigned old_height    = 0;
+   static int16_t old_mouse_x    = 0;
+   static int16_t old_mouse_y    = 0;
+   static int16_t old_pointer_x  = 0;
+   static int16_t old_pointer_y  = 0;
+   unsigned width                = 0;
+   unsigned height               = 0;
+   settings_t *settings          = config_get_ptr();
+   bool changed                  = menu_display_framebuf_dirty
+      || menu_animation_needs_redraw()
+      || runloop_msg_queue_size() > 0
+      || menu_display_libretro_running(
+            rarch_is_inited, rarch_is_dummy_core);
+
+   menu_animation_ctl(MENU_ANIMATION_CTL_CLEAR_REDRAW, NULL);
+
+   video_driver_get_size(&width, &height);
+
+   if (width != old_width || height != old_height)
+   {
+      old_width  = width;
+      old_height = height;
+      changed    = true;
+   }
+
+   if (settings->bools.menu_mouse_enable)
+   {
+      int16_t mouse_x = menu_input_mouse_state(MENU_MOUSE_X_AXIS);
+      int16_t mouse_y = menu_input_mouse_state(MENU_MOUSE_Y_AXIS);
+
+      if (mouse_x != old_mouse_x || mouse_y != old_mouse_y)
+      {
+         old_mouse_x = mouse_x;
+         old_mouse_y = mouse_y;
+         changed     = true;
+      }
+   }
+
+   if (settings->bools.menu_pointer_enable)
+   {
+      int16_t pointer_x = menu_input_pointer_state(MENU_POINTER_X_AXIS);
+      int16_t pointer_y = menu_input_pointer_state(MENU_POINTER_Y_AXIS);
+
+      if (     pointer_x != old_pointer_x
+            || pointer_y != old_pointer_y
+            || menu_input_pointer_state(MENU_POINTER_PRESSED))
+      {
+         old_pointer_x = pointer_x;
+         old_pointer_y = pointer_y;
+         changed       = true;
+      }
+   }
+
+   if (changed)
+      idle_frames = 0;
+   else if (idle_frames < MENU_DISPLAY_IDLE_FRAMES)
+      idle_frames++;
+   else
+      return true;
+
+   return false;
 }
 
 bool menu_driver_render(bool is_idle, bool rarch_is_inited,
@@ -1600,12 +1879,23 @@ bool menu_driver_render(bool is_idle, bool rarch_is_inited,
       settings_t *settings = config_get_ptr();
       menu_animation_update_time(settings->bools.menu_timedate_enable);
 
+      menu_entries_prefetch(menu_driver_selection_ptr);
+
       if (menu_driver_ctx->render)
          menu_driver_ctx->render(menu_userdata, is_idle);
    }
 
+   menu_display_idle = false;
+
    if (menu_driver_alive && !is_idle)
-      menu_display_libretro(is_idle, rarch_is_inited, rarch_is_dummy_core);
+   {
+      /* Skip drawing and presenting frames nothing changed in */
+      menu_display_idle = menu_display_check_idle(
+            rarch_is_inited, rarch_is_dummy_core);
+
+      if (!menu_display_idle)
+         menu_display_libretro(is_idle, rarch_is_inited, rarch_is_dummy_core);
+   }
 
    if (menu_driver_ctx->set_texture)
       menu_driver_ctx->set_texture();
@@ -1763,8 +2053,12 @@ void menu_driver_populate_entries(menu_displaylist_info_t *info)
 bool menu_driver_load_image(menu_ctx_load_image_t *load_image_info)
 {
    if (menu_driver_ctx && menu_driver_ctx->load_image)
+   {
+      /* Thumbnails and wallpapers show up without any input */
+      menu_display_framebuf_dirty = true;
       return menu_driver_ctx->load_image(menu_userdata,
             load_image_info->data, load_image_info->type);
+   }
    return false;
 }
 
@@ -1946,6 +2240,8 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
             }
 
             video_coord_array_free(&menu_disp_ca);
+            video_coord_array_free(&menu_disp_batch.ca);
+            memset(&menu_disp_batch, 0, sizeof(menu_disp_batch));
             menu_display_msg_force       = false;
             menu_display_header_height   = 0;
             menu_disp                    = NULL;
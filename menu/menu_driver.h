@@ -377,6 +377,17 @@ typedef struct menu_display_ctx_draw
    } pipeline;
 } menu_display_ctx_draw_t;
 
+/* Counters of the menu's last frame, see menu_display_get_batch_stats() */
+typedef struct menu_display_batch_stats
+{
+   /* Draw calls issued to the menu display driver */
+   unsigned draw_calls;
+   /* Vertices submitted by those draw calls */
+   unsigned vertices;
+   /* menu_display_draw() calls merged into a batch */
+   unsigned batched;
+} menu_display_batch_stats_t;
+
 typedef struct menu_display_ctx_rotate_draw
 {
    bool scale_enable;
@@ -653,6 +664,7 @@ void menu_display_set_msg_force(bool state);
 bool menu_display_get_font_data_init(void);
 void menu_display_set_font_data_init(bool state);
 bool menu_display_get_update_pending(void);
+bool menu_display_get_idle(void);
 void menu_display_set_viewport(unsigned width, unsigned height);
 void menu_display_unset_viewport(unsigned width, unsigned height);
 bool menu_display_get_framebuffer_dirty_flag(void);
@@ -663,6 +675,8 @@ bool menu_display_init_first_driver(bool video_is_threaded);
 bool menu_display_restore_clear_color(void);
 void menu_display_clear_color(menu_display_ctx_clearcolor_t *color);
 void menu_display_draw(menu_display_ctx_draw_t *draw);
+void menu_display_batch_flush(void);
+void menu_display_get_batch_stats(menu_display_batch_stats_t *stats);
 
 void menu_display_draw_pipeline(menu_display_ctx_draw_t *draw);
 void menu_display_draw_bg(
@@ -689,9 +703,6 @@ void menu_display_timedate(menu_display_ctx_datetime_t *datetime);
 void menu_display_handle_wallpaper_upload(void *task_data,
       void *user_data, const char *err);
 
-void menu_display_handle_thumbnail_upload(void *task_data,
-      void *user_data, const char *err);
-
 void menu_display_handle_savestate_thumbnail_upload(void *task_data,
       void *user_data, const char *err);
 
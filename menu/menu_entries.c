@@ -338,15 +338,123 @@ void menu_entries_append(file_list_t *list, const char *path, const char *label,
    menu_cbs_init(list, cbs, path, label, type, idx);
 }
 
-void menu_entries_append_enum(file_list_t *list, const char *path,
-      const char *label,
+/* Entries around the selection that get their action
+ * callbacks bound before they are drawn. */
+#define MENU_ENTRIES_PREFETCH 64
+
+/* Menu stack the entries appended with menu_entries_append_enum_lazy()
+ * were built for. Callbacks are bound depending on the menu on top
+ * of the stack, so entries are left unbound once the stack changed.
+ * Any push, pop or relabel changes its generation. */
+static const file_list_t *menu_entries_lazy_stack  = NULL;
+static unsigned menu_entries_lazy_generation       = 0;
+
+static void menu_entries_bind_actiondata(file_list_t *list, size_t idx,
+      const char *path, const char *label, unsigned type,
+      enum msg_hash_enums enum_idx)
+{
+   menu_file_list_cbs_t *cbs       = NULL;
+
+   file_list_free_actiondata(list, idx);
+   cbs = (menu_file_list_cbs_t*)
+      calloc(1, sizeof(menu_file_list_cbs_t));
+
+   if (!cbs)
+      return;
+
+   file_list_set_actiondata(list, idx, cbs);
+
+   cbs->enum_idx = enum_idx;
+
+   if (enum_idx != MENU_ENUM_LABEL_PLAYLIST_ENTRY
+       && enum_idx != MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY
+       && enum_idx != MENU_ENUM_LABEL_RDB_ENTRY) {
+      cbs->setting  = menu_setting_find_enum(enum_idx);
+   }
+
+   menu_cbs_init(list, cbs, path, label, type, idx);
+}
+
+/**
+ * menu_entries_get_actiondata_at_offset:
+ * @list                     : File list handle.
+ * @idx                      : Offset index of element.
+ *
+ * Gets the action callbacks of an entry, binding them first
+ * if it was appended with menu_entries_append_enum_lazy().
+ *
+ * Returns: action callbacks of the entry, or NULL if it has none
+ * (yet).
+ **/
+menu_file_list_cbs_t *menu_entries_get_actiondata_at_offset(
+      file_list_t *list, size_t idx)
+{
+   unsigned tag      = 0;
+
+   if (!list)
+      return NULL;
+
+   if (file_list_get_actiondata_pending(list, idx, &tag))
+   {
+      const file_list_t *stack = menu_entries_get_menu_stack_ptr(0);
+
+      if (     stack == menu_entries_lazy_stack
+            && file_list_get_generation(stack)
+               == menu_entries_lazy_generation)
+      {
+         unsigned type     = 0;
+         const char *path  = NULL;
+         const char *label = NULL;
+
+         file_list_get_at_offset(list, idx, &path, &label, &type, NULL);
+         menu_entries_bind_actiondata(list, idx, path, label, type,
+               (enum msg_hash_enums)tag);
+      }
+   }
+
+   return (menu_file_list_cbs_t*)
+      file_list_get_actiondata_at_offset(list, idx);
+}
+
+/**
+ * menu_entries_prefetch:
+ * @idx                      : Offset index of the selection.
+ *
+ * Binds the entries around the selection ahead of drawing
+ * them, so scrolling through a lazily built list binds a
+ * window of entries at a time instead of single ones.
+ **/
+void menu_entries_prefetch(size_t idx)
+{
+   size_t i, first, last;
+   file_list_t *list = menu_entries_get_selection_buf_ptr(0);
+   size_t size       = file_list_get_size(list);
+
+   if (!size)
+      return;
+
+   if (idx >= size)
+      idx = size - 1;
+
+   first = idx > MENU_ENTRIES_PREFETCH ? idx - MENU_ENTRIES_PREFETCH : 0;
+   last  = idx + MENU_ENTRIES_PREFETCH;
+
+   if (last >= size)
+      last = size - 1;
+
+   for (i = first; i <= last; i++)
+      menu_entries_get_actiondata_at_offset(list, i);
+}
+
+static void menu_entries_append_enum_internal(file_list_t *list,
+      const char *path, const char *label,
       enum msg_hash_enums enum_idx,
-      unsigned type, size_t directory_ptr, size_t entry_idx)
+      unsigned type, size_t directory_ptr, size_t entry_idx,
+      bool lazy)
 {
    menu_ctx_list_t list_info;
    size_t idx;
    const char *menu_path           = NULL;
-   menu_file_list_cbs_t *cbs       = NULL;
    if (!list || !label)
       return;
 
@@ -371,24 +479,39 @@ void menu_entries_append_enum(file_list_t *list, const char *path,
    if (list_info.fullpath)
       free(list_info.fullpath);
 
-   file_list_free_actiondata(list, idx);
-   cbs = (menu_file_list_cbs_t*)
-      calloc(1, sizeof(menu_file_list_cbs_t));
-
-   if (!cbs)
-      return;
-
-   file_list_set_actiondata(list, idx, cbs);
-
-   cbs->enum_idx = enum_idx;
+   if (lazy)
+   {
+      file_list_free_actiondata(list, idx);
+      file_list_set_actiondata_pending(list, idx, enum_idx);
 
-   if (enum_idx != MENU_ENUM_LABEL_PLAYLIST_ENTRY
-       && enum_idx != MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY
-       && enum_idx != MENU_ENUM_LABEL_RDB_ENTRY) {
-      cbs->setting  = menu_setting_find_enum(enum_idx);
+      menu_entries_lazy_stack      = menu_entries_get_menu_stack_ptr(0);
+      menu_entries_lazy_generation = file_list_get_generation(
+            menu_entries_lazy_stack);
    }
+   else
+      menu_entries_bind_actiondata(list, idx, path, label, type, enum_idx);
+}
 
-   menu_cbs_init(list, cbs, path, label, type, idx);
+void menu_entries_append_enum(file_list_t *list, const char *path,
+      const char *label,
+      enum msg_hash_enums enum_idx,
+      unsigned type, size_t directory_ptr, size_t entry_idx)
+{
+   menu_entries_append_enum_internal(list, path, label, enum_idx,
+         type, directory_ptr, entry_idx, false);
+}
+
+/* Appends an entry whose action callbacks are only bound once
+ * it is accessed through menu_entries_get_actiondata_at_offset().
+ * Meant for long lists like directories and playlists, where
+ * binding every entry up front stalls the menu. */
+void menu_entries_append_enum_lazy(file_list_t *list, const char *path,
+      const char *label,
+      enum msg_hash_enums enum_idx,
+      unsigned type, size_t directory_ptr, size_t entry_idx)
+{
+   menu_entries_append_enum_internal(list, path, label, enum_idx,
+         type, directory_ptr, entry_idx, true);
 }
 
 void menu_entries_prepend(file_list_t *list, const char *path, const char *label,
@@ -496,7 +619,7 @@ rarch_setting_t *menu_entries_get_setting(uint32_t i)
 {
    file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
    menu_file_list_cbs_t *cbs  = selection_buf ?
-      (menu_file_list_cbs_t*)file_list_get_actiondata_at_offset(selection_buf, i) : NULL;
+      (menu_file_list_cbs_t*)menu_entries_get_actiondata_at_offset(selection_buf, i) : NULL;
 
    if (!cbs)
       return NULL;
@@ -155,6 +155,15 @@ void menu_entries_append_enum(file_list_t *list, const char *path, const char *l
       enum msg_hash_enums enum_idx,
       unsigned type, size_t directory_ptr, size_t entry_idx);
 
+void menu_entries_append_enum_lazy(file_list_t *list, const char *path,
+      const char *label, enum msg_hash_enums enum_idx,
+      unsigned type, size_t directory_ptr, size_t entry_idx);
+
+menu_file_list_cbs_t *menu_entries_get_actiondata_at_offset(
+      file_list_t *list, size_t idx);
+
+void menu_entries_prefetch(size_t idx);
+
 bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data);
 
 RETRO_END_DECLS
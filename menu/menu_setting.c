@@ -918,7 +918,7 @@ int menu_setting_set(unsigned type, const char *label,
    file_list_t *selection_buf = menu_entries_get_selection_buf_ptr(0);
    size_t selection           = menu_navigation_get_selection();
    menu_file_list_cbs_t *cbs  = selection_buf ?
-      (menu_file_list_cbs_t*)file_list_get_actiondata_at_offset(selection_buf, selection) : NULL;
+      (menu_file_list_cbs_t*)menu_entries_get_actiondata_at_offset(selection_buf, selection) : NULL;
 
    if (!cbs)
       return 0;
@@ -3289,6 +3289,22 @@ static bool setting_append_list(
                   general_read_handler,
                   SD_FLAG_NONE);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.video_menu_stats_show,
+                  MENU_ENUM_LABEL_MENU_STATS_SHOW,
+                  MENU_ENUM_LABEL_VALUE_MENU_STATS_SHOW,
+                  menu_stats_show,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+            settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
+
             END_SUB_GROUP(list, list_info, parent_group);
             START_SUB_GROUP(list, list_info, "Platform-specific", &group_info, &subgroup_info, parent_group);
 
@@ -3860,6 +3876,23 @@ static bool setting_append_list(
                   );
             settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.screenshot_fast_compression,
+                  MENU_ENUM_LABEL_SCREENSHOT_FAST_COMPRESSION,
+                  MENU_ENUM_LABEL_VALUE_SCREENSHOT_FAST_COMPRESSION,
+                  screenshot_fast_compression,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE
+                  );
+            settings_data_list_current_add_flags(list, list_info, SD_FLAG_ADVANCED);
+
             CONFIG_BOOL(
                   list, list_info,
                   &settings->bools.video_crop_overscan,
@@ -0,0 +1,390 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <formats/image.h>
+#include <queues/task_queue.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include "menu_driver.h"
+#include "menu_thumbnail_cache.h"
+#include "../configuration.h"
+#include "../gfx/video_driver.h"
+#include "../tasks/tasks_internal.h"
+#include "../verbosity.h"
+
+typedef struct menu_thumbnail_cache_entry
+{
+   char *path;
+   /* user_data of the in-flight load task, NULL once uploaded */
+   void *tag;
+   uintptr_t texture;
+   unsigned width;
+   unsigned height;
+   /* display size the texture was decoded for */
+   unsigned target_width;
+   unsigned target_height;
+   unsigned generation;
+   size_t size;
+   uint64_t last_used;
+} menu_thumbnail_cache_entry_t;
+
+static menu_thumbnail_cache_entry_t
+   menu_thumbnail_cache[MENU_THUMBNAIL_CACHE_MAX_ENTRIES];
+static char menu_thumbnail_cache_wanted[PATH_MAX_LENGTH];
+static int menu_thumbnail_cache_displayed  = -1;
+static unsigned menu_thumbnail_cache_gen   = 0;
+static uint64_t menu_thumbnail_cache_clock = 0;
+static size_t menu_thumbnail_cache_used    = 0;
+static unsigned menu_thumbnail_cache_width  = 0;
+static unsigned menu_thumbnail_cache_height = 0;
+
+static bool menu_thumbnail_cache_task_finder(
+      retro_task_t *task, void *userdata)
+{
+   void **tag = (void**)userdata;
+
+   if (!task || task->user_data != *tag)
+      return false;
+
+   /* task_queue_find holds the queue lock; cancel afterwards */
+   *tag = task;
+   return true;
+}
+
+static void menu_thumbnail_cache_cancel_load(
+      menu_thumbnail_cache_entry_t *entry)
+{
+   task_finder_data_t find_data;
+   void *tag          = entry->tag;
+
+   find_data.func     = menu_thumbnail_cache_task_finder;
+   find_data.userdata = &tag;
+
+   if (task_queue_find(&find_data))
+      task_queue_cancel_task(tag);
+}
+
+static void menu_thumbnail_cache_remove(int i)
+{
+   menu_thumbnail_cache_entry_t *entry = &menu_thumbnail_cache[i];
+
+   if (entry->tag)
+      menu_thumbnail_cache_cancel_load(entry);
+   if (entry->texture)
+      video_driver_texture_unload(&entry->texture);
+
+   menu_thumbnail_cache_used -= entry->size;
+   free(entry->path);
+   memset(entry, 0, sizeof(*entry));
+
+   if (menu_thumbnail_cache_displayed == i)
+      menu_thumbnail_cache_displayed = -1;
+}
+
+static int menu_thumbnail_cache_find(const char *path)
+{
+   unsigned i;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+      if (menu_thumbnail_cache[i].path
+            && string_is_equal(menu_thumbnail_cache[i].path, path))
+         return i;
+
+   return -1;
+}
+
+/* Entries decoded for a smaller display size than the
+ * current one are too blurry to keep. */
+static bool menu_thumbnail_cache_too_small(int i)
+{
+   menu_thumbnail_cache_entry_t *entry = &menu_thumbnail_cache[i];
+
+   return (entry->target_width  < menu_thumbnail_cache_width
+         && entry->width        < menu_thumbnail_cache_width)
+      ||  (entry->target_height < menu_thumbnail_cache_height
+         && entry->height       < menu_thumbnail_cache_height);
+}
+
+static bool menu_thumbnail_cache_evictable(int i)
+{
+   menu_thumbnail_cache_entry_t *entry = &menu_thumbnail_cache[i];
+
+   return entry->path
+      && !entry->tag
+      && i != menu_thumbnail_cache_displayed
+      && !string_is_equal(entry->path, menu_thumbnail_cache_wanted);
+}
+
+static int menu_thumbnail_cache_lru(void)
+{
+   unsigned i;
+   int lru = -1;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+   {
+      if (!menu_thumbnail_cache_evictable(i))
+         continue;
+      if (lru < 0 || menu_thumbnail_cache[i].last_used
+            < menu_thumbnail_cache[lru].last_used)
+         lru = i;
+   }
+
+   return lru;
+}
+
+/* Evicts least recently used textures until the
+ * uploaded thumbnails fit into the configured budget. */
+static void menu_thumbnail_cache_trim(void)
+{
+   settings_t *settings = config_get_ptr();
+   size_t budget        = (size_t)settings->uints.menu_thumbnail_cache_size
+      * 1024 * 1024;
+
+   while (menu_thumbnail_cache_used > budget)
+   {
+      int lru = menu_thumbnail_cache_lru();
+      if (lru < 0)
+         break;
+      menu_thumbnail_cache_remove(lru);
+   }
+}
+
+/* Cancels loads that were neither requested nor
+ * prefetched by the last two selection changes. */
+static void menu_thumbnail_cache_cancel_stale(void)
+{
+   unsigned i;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+   {
+      menu_thumbnail_cache_entry_t *entry = &menu_thumbnail_cache[i];
+
+      if (entry->tag && entry->generation + 1 < menu_thumbnail_cache_gen)
+         menu_thumbnail_cache_remove(i);
+   }
+}
+
+static void menu_thumbnail_cache_handle_upload(void *task_data,
+      void *user_data, const char *err)
+{
+   unsigned i;
+   menu_thumbnail_cache_entry_t *entry = NULL;
+   struct texture_image *img           = (struct texture_image*)task_data;
+   int slot                            = -1;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+   {
+      if (menu_thumbnail_cache[i].tag == user_data)
+      {
+         slot = i;
+         break;
+      }
+   }
+
+   if (slot < 0)
+      goto end;
+
+   entry      = &menu_thumbnail_cache[slot];
+   entry->tag = NULL;
+
+   if (!img || !img->pixels || !img->width || !img->height)
+   {
+      menu_thumbnail_cache_remove(slot);
+      goto end;
+   }
+
+   video_driver_texture_load(img,
+         TEXTURE_FILTER_MIPMAP_LINEAR, &entry->texture);
+
+   entry->width               = img->width;
+   entry->height              = img->height;
+   entry->size                = img->width * img->height * sizeof(uint32_t);
+   entry->last_used           = ++menu_thumbnail_cache_clock;
+   menu_thumbnail_cache_used += entry->size;
+
+   if (string_is_equal(entry->path, menu_thumbnail_cache_wanted))
+   {
+      menu_ctx_load_image_t load_image_info;
+      menu_thumbnail_t thumbnail;
+
+      thumbnail.texture    = entry->texture;
+      thumbnail.width      = entry->width;
+      thumbnail.height     = entry->height;
+
+      load_image_info.data = &thumbnail;
+      load_image_info.type = MENU_IMAGE_THUMBNAIL;
+
+      menu_thumbnail_cache_displayed = slot;
+      menu_driver_load_image(&load_image_info);
+   }
+
+   menu_thumbnail_cache_trim();
+
+end:
+   if (img)
+   {
+      image_texture_free(img);
+      free(img);
+   }
+   free(user_data);
+}
+
+static int menu_thumbnail_cache_load(const char *path)
+{
+   unsigned i;
+   char *tag = NULL;
+   int slot = -1;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+   {
+      if (!menu_thumbnail_cache[i].path)
+      {
+         slot = i;
+         break;
+      }
+   }
+
+   if (slot < 0)
+   {
+      slot = menu_thumbnail_cache_lru();
+      if (slot < 0)
+      {
+         RARCH_WARN("[Thumbnails]: Cache full, not loading \"%s\".\n", path);
+         return -1;
+      }
+      menu_thumbnail_cache_remove(slot);
+   }
+
+   tag = strdup(path);
+
+   if (!task_push_image_load_scaled(path,
+            menu_thumbnail_cache_width, menu_thumbnail_cache_height,
+            menu_thumbnail_cache_handle_upload, tag))
+   {
+      free(tag);
+      return -1;
+   }
+
+   menu_thumbnail_cache[slot].path          = strdup(path);
+   menu_thumbnail_cache[slot].tag           = tag;
+   menu_thumbnail_cache[slot].target_width  = menu_thumbnail_cache_width;
+   menu_thumbnail_cache[slot].target_height = menu_thumbnail_cache_height;
+
+   return slot;
+}
+
+bool menu_thumbnail_cache_request(const char *path,
+      menu_thumbnail_t *thumbnail)
+{
+   menu_thumbnail_cache_entry_t *entry = NULL;
+   int slot                            = -1;
+
+   if (string_is_empty(path))
+      return false;
+
+   strlcpy(menu_thumbnail_cache_wanted, path,
+         sizeof(menu_thumbnail_cache_wanted));
+   menu_thumbnail_cache_gen++;
+   menu_thumbnail_cache_cancel_stale();
+
+   slot = menu_thumbnail_cache_find(path);
+
+   if (slot >= 0 && menu_thumbnail_cache_too_small(slot))
+   {
+      menu_thumbnail_cache_remove(slot);
+      slot = -1;
+   }
+
+   if (slot < 0)
+      slot = menu_thumbnail_cache_load(path);
+
+   if (slot < 0)
+      return false;
+
+   entry             = &menu_thumbnail_cache[slot];
+   entry->generation = menu_thumbnail_cache_gen;
+
+   if (entry->tag)
+      return false;
+
+   entry->last_used               = ++menu_thumbnail_cache_clock;
+   menu_thumbnail_cache_displayed = slot;
+
+   if (thumbnail)
+   {
+      thumbnail->texture = entry->texture;
+      thumbnail->width   = entry->width;
+      thumbnail->height  = entry->height;
+   }
+
+   return true;
+}
+
+void menu_thumbnail_cache_prefetch(const char *path)
+{
+   int slot = -1;
+
+   if (string_is_empty(path))
+      return;
+
+   slot = menu_thumbnail_cache_find(path);
+
+   if (slot >= 0 && menu_thumbnail_cache_too_small(slot))
+   {
+      menu_thumbnail_cache_remove(slot);
+      slot = -1;
+   }
+
+   if (slot < 0)
+      slot = menu_thumbnail_cache_load(path);
+
+   if (slot >= 0)
+      menu_thumbnail_cache[slot].generation = menu_thumbnail_cache_gen;
+}
+
+void menu_thumbnail_cache_set_size(unsigned width, unsigned height)
+{
+   menu_thumbnail_cache_width  = width;
+   menu_thumbnail_cache_height = height;
+}
+
+void menu_thumbnail_cache_cancel(void)
+{
+   menu_thumbnail_cache_wanted[0] = '\0';
+   menu_thumbnail_cache_displayed = -1;
+   menu_thumbnail_cache_trim();
+}
+
+void menu_thumbnail_cache_free(void)
+{
+   unsigned i;
+
+   for (i = 0; i < MENU_THUMBNAIL_CACHE_MAX_ENTRIES; i++)
+      if (menu_thumbnail_cache[i].path)
+         menu_thumbnail_cache_remove(i);
+
+   menu_thumbnail_cache_wanted[0] = '\0';
+   menu_thumbnail_cache_displayed = -1;
+   menu_thumbnail_cache_used      = 0;
+}
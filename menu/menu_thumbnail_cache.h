@@ -0,0 +1,96 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_THUMBNAIL_CACHE_H
+#define _MENU_THUMBNAIL_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Maximum amount of thumbnails kept uploaded or in flight. */
+#define MENU_THUMBNAIL_CACHE_MAX_ENTRIES 64
+
+/* Handed to the menu driver's load_image callback
+ * with MENU_IMAGE_THUMBNAIL. The texture is owned by
+ * the cache and must not be unloaded by the driver. */
+typedef struct menu_thumbnail
+{
+   uintptr_t texture;
+   unsigned width;
+   unsigned height;
+} menu_thumbnail_t;
+
+/**
+ * menu_thumbnail_cache_request:
+ * @path                    : path of the thumbnail to display.
+ * @thumbnail               : filled in if the thumbnail is cached.
+ *
+ * Makes @path the thumbnail the menu wants to display. If it is
+ * not cached yet, it is loaded in the background and handed to the
+ * menu driver through load_image once uploaded, unless another
+ * thumbnail was requested in the meantime. Loads that have not
+ * been requested or prefetched recently are cancelled.
+ *
+ * Returns: true if @thumbnail was filled in right away.
+ **/
+bool menu_thumbnail_cache_request(const char *path,
+      menu_thumbnail_t *thumbnail);
+
+/**
+ * menu_thumbnail_cache_prefetch:
+ * @path                    : path of a thumbnail likely to be
+ *                            requested soon.
+ *
+ * Loads @path into the cache without displaying it.
+ **/
+void menu_thumbnail_cache_prefetch(const char *path);
+
+/**
+ * menu_thumbnail_cache_set_size:
+ * @width                   : width thumbnails are displayed at,
+ *                            0 if unknown.
+ * @height                  : height thumbnails are displayed at,
+ *                            0 if unknown.
+ *
+ * Lets thumbnails be decoded at a reduced size that still
+ * covers the displayed one. Cached thumbnails decoded for a
+ * smaller size are reloaded when requested again.
+ **/
+void menu_thumbnail_cache_set_size(unsigned width, unsigned height);
+
+/**
+ * menu_thumbnail_cache_cancel:
+ *
+ * Nothing is displayed anymore; a pending request
+ * won't be handed to the menu driver.
+ **/
+void menu_thumbnail_cache_cancel(void);
+
+/**
+ * menu_thumbnail_cache_free:
+ *
+ * Unloads every cached texture and cancels pending loads.
+ * Must be called before the video context goes away.
+ **/
+void menu_thumbnail_cache_free(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -255,7 +255,7 @@ void filebrowser_parse(void *data, unsigned type_data)
          }
 
          items_found++;
-         menu_entries_append_enum(info->list, path, label,
+         menu_entries_append_enum_lazy(info->list, path, label,
                enum_idx,
                file_type, 0, 0);
       }
@@ -21,6 +21,7 @@
 #include <compat/strl.h>
 #include <retro_endianness.h>
 #include <streams/file_stream.h>
+#include <streams/trans_stream.h>
 
 #include "configuration.h"
 #include "movie.h"
@@ -33,9 +34,21 @@
 #include "command.h"
 #include "file_path_special.h"
 
+/* Frames per BSV2 segment, each of which starts with a state */
+#define BSV2_KEYFRAME_INTERVAL      300
+
+/* Segments between states stored whole rather than as deltas */
+#define BSV2_FULL_KEYFRAME_INTERVAL 8
+
+/* Largest keyframe interval we'll play back, about 18 minutes at 60 fps.
+ * A segment's per-frame table is allocated from it. */
+#define BSV2_MAX_KEYFRAME_INTERVAL  65536
+
 struct bsv_movie
 {
    RFILE *file;
+   unsigned version;
+   uint32_t content_crc;
 
    /* A ring buffer keeping track of positions
     * in the file for each frame. */
@@ -51,6 +64,39 @@ struct bsv_movie
    bool playback;
    bool first_rewind;
    bool did_rewind;
+
+   /* BSV2 */
+   const struct trans_stream_backend *deflate;
+   void *deflate_stream;
+   void *inflate_stream;
+   uint32_t interval;
+   uint32_t frame;            /* Next frame to run */
+   uint32_t frame_count;      /* Frames in the movie, when playing back */
+   bool seek_pending;
+   uint32_t seek_frame;
+
+   uint32_t *seg_offsets;
+   size_t seg_count;
+   size_t seg_cap;
+
+   /* The segment being played back or recorded */
+   uint32_t seg_index;
+   uint32_t seg_frames;
+   uint32_t *frame_words;     /* First input word of each of its frames */
+   int16_t *words;
+   size_t num_words;
+   size_t words_size;
+   size_t input_ptr;
+   size_t input_end;
+
+   /* States at the start of this segment and the previous one */
+   uint8_t *key_state;
+   uint8_t *prev_key;
+
+   uint8_t *tmp;
+   size_t tmp_size;
+   uint8_t *zbuf;
+   size_t zbuf_size;
 };
 
 struct bsv_state
@@ -70,11 +116,652 @@ struct bsv_state
 static bsv_movie_t     *bsv_movie_state_handle = NULL;
 static struct bsv_state bsv_movie_state;
 
+/* BSV2
+ *
+ * The header is BSV1's followed by the keyframe interval, the number of
+ * frames and segments, and the file offset of the segment index (0 until
+ * recording finishes).
+ *
+ * The movie is split into segments of BSV2_KEYFRAME_INTERVAL frames. Each
+ * segment starts with a 7 word header (magic, first frame, frames, flags,
+ * stored state size, raw input size, stored input size), then the state at
+ * its first frame, then its input. Every BSV2_FULL_KEYFRAME_INTERVAL
+ * segments the state is stored whole, otherwise XORed with the previous
+ * segment's. The input is a 16-bit word count for each frame followed by
+ * the words. States and input are deflated.
+ *
+ * The index is one 32-bit offset per segment, so any frame can be reached
+ * by decoding at most BSV2_FULL_KEYFRAME_INTERVAL states and replaying at
+ * most BSV2_KEYFRAME_INTERVAL frames.
+ */
+
+#define BSV2_HEADER_WORDS             8
+#define BSV2_SEGMENT_WORDS            7
+#define BSV2_SEGMENT_FULL_STATE       (1 << 0)
+
+static void *bsv2_reserve(uint8_t **buf, size_t *cap, size_t size)
+{
+   if (*cap < size)
+   {
+      size_t new_cap   = MAX(size, *cap * 2);
+      uint8_t *new_buf = (uint8_t*)realloc(*buf, new_cap);
+      if (!new_buf)
+         return NULL;
+      *buf = new_buf;
+      *cap = new_cap;
+   }
+   return *buf;
+}
+
+/* Deflate or inflate all of in, which must fit in out. */
+static bool bsv2_transcode(bsv_movie_t *handle, bool compress,
+      const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size,
+      uint32_t *out_len)
+{
+   uint32_t rd                                = 0;
+   uint32_t wn                                = 0;
+   enum trans_stream_error error              = TRANS_STREAM_ERROR_NONE;
+   const struct trans_stream_backend *backend = compress
+      ? handle->deflate : handle->deflate->reverse;
+   void **stream                              = compress
+      ? &handle->deflate_stream : &handle->inflate_stream;
+
+   backend->set_in(*stream, in, (uint32_t)in_size);
+   backend->set_out(*stream, out, (uint32_t)out_size);
+
+   if (!backend->trans(*stream, true, &rd, &wn, &error)
+         || error != TRANS_STREAM_ERROR_NONE)
+   {
+      /* The stream was left mid-way, start the next one afresh */
+      backend->stream_free(*stream);
+      *stream = backend->stream_new();
+      return false;
+   }
+
+   *out_len = wn;
+   return true;
+}
+
+static size_t bsv2_deflate_bound(size_t size)
+{
+   return size + size / 8 + 64;
+}
+
+static bool bsv2_read_segment_header(bsv_movie_t *handle, uint32_t seg,
+      uint32_t *seg_header)
+{
+   unsigned i;
+
+   if (seg >= handle->seg_count)
+      return false;
+
+   if (filestream_seek(handle->file, handle->seg_offsets[seg], SEEK_SET) != 0)
+      return false;
+
+   if (filestream_read(handle->file, seg_header,
+            BSV2_SEGMENT_WORDS * sizeof(uint32_t))
+         != BSV2_SEGMENT_WORDS * sizeof(uint32_t))
+      return false;
+
+   /* Like the file's magic, this shows up as BSEG in a hex editor */
+   seg_header[0] = swap_if_little32(seg_header[0]);
+   for (i = 1; i < BSV2_SEGMENT_WORDS; i++)
+      seg_header[i] = swap_if_big32(seg_header[i]);
+
+   return seg_header[0] == BSV2_SEGMENT_MAGIC
+      && seg_header[1] == seg * handle->interval;
+}
+
+static bool bsv2_add_segment_offset(bsv_movie_t *handle, uint32_t offset)
+{
+   if (handle->seg_count == handle->seg_cap)
+   {
+      size_t new_cap       = handle->seg_cap ? handle->seg_cap * 2 : 64;
+      uint32_t *new_offsets = (uint32_t*)realloc(handle->seg_offsets,
+            new_cap * sizeof(uint32_t));
+
+      if (!new_offsets)
+         return false;
+
+      handle->seg_offsets = new_offsets;
+      handle->seg_cap     = new_cap;
+   }
+
+   handle->seg_offsets[handle->seg_count++] = offset;
+   return true;
+}
+
+/**
+ * bsv2_decode_keyframe:
+ * @handle            : movie handle
+ * @seg               : segment whose state to decode
+ * @out               : state_size bytes to decode it to
+ *
+ * Decode the state at the start of a segment, starting from the last
+ * segment which stores it whole.
+ **/
+static bool bsv2_decode_keyframe(bsv_movie_t *handle, uint32_t seg,
+      uint8_t *out)
+{
+   uint32_t k;
+   uint32_t base = seg - (seg % BSV2_FULL_KEYFRAME_INTERVAL);
+
+   if (!handle->state_size)
+      return true;
+
+   for (k = base; k <= seg; k++)
+   {
+      uint32_t seg_header[BSV2_SEGMENT_WORDS];
+      bool full;
+      uint32_t len     = 0;
+      uint8_t *target  = (k == base) ? out : handle->tmp;
+
+      if (!bsv2_read_segment_header(handle, k, seg_header))
+         return false;
+
+      full = (seg_header[3] & BSV2_SEGMENT_FULL_STATE) != 0;
+      if (full != (k == base))
+         return false;
+
+      if (!bsv2_reserve(&handle->zbuf, &handle->zbuf_size, seg_header[4]))
+         return false;
+
+      if (filestream_read(handle->file, handle->zbuf, seg_header[4])
+            != seg_header[4])
+         return false;
+
+      if (!bsv2_transcode(handle, false, handle->zbuf, seg_header[4],
+               target, handle->state_size, &len) || len != handle->state_size)
+         return false;
+
+      if (k != base)
+      {
+         size_t i;
+         for (i = 0; i < handle->state_size; i++)
+            out[i] ^= handle->tmp[i];
+      }
+   }
+
+   return true;
+}
+
+/**
+ * bsv2_load_segment:
+ * @handle            : movie handle
+ * @seg               : segment whose input to load
+ *
+ * Read a segment's input into memory.
+ **/
+static bool bsv2_load_segment(bsv_movie_t *handle, uint32_t seg)
+{
+   uint32_t seg_header[BSV2_SEGMENT_WORDS];
+   uint32_t i;
+   uint32_t len         = 0;
+   uint32_t num_words   = 0;
+   const uint8_t *raw   = NULL;
+
+   if (!bsv2_read_segment_header(handle, seg, seg_header))
+      return false;
+
+   if (seg_header[2] > handle->interval
+         || seg_header[5] < seg_header[2] * 2
+         || !bsv2_reserve(&handle->zbuf, &handle->zbuf_size, seg_header[6])
+         || !bsv2_reserve(&handle->tmp, &handle->tmp_size, seg_header[5]))
+      return false;
+
+   if (filestream_seek(handle->file, seg_header[4], SEEK_CUR) != 0)
+      return false;
+
+   if (filestream_read(handle->file, handle->zbuf, seg_header[6])
+         != seg_header[6])
+      return false;
+
+   if (!bsv2_transcode(handle, false, handle->zbuf, seg_header[6],
+            handle->tmp, seg_header[5], &len) || len != seg_header[5])
+      return false;
+
+   raw = handle->tmp;
+
+   handle->frame_words[0] = 0;
+   for (i = 0; i < seg_header[2]; i++)
+   {
+      num_words += raw[i * 2] | (raw[i * 2 + 1] << 8);
+      handle->frame_words[i + 1] = num_words;
+   }
+
+   if (seg_header[5] != seg_header[2] * 2 + num_words * 2)
+      return false;
+
+   if (!bsv2_reserve((uint8_t**)&handle->words, &handle->words_size,
+            num_words * sizeof(int16_t)))
+      return false;
+
+   raw += seg_header[2] * 2;
+   for (i = 0; i < num_words; i++)
+      handle->words[i] = (int16_t)(raw[i * 2] | (raw[i * 2 + 1] << 8));
+
+   handle->num_words  = num_words;
+   handle->seg_index  = seg;
+   handle->seg_frames = seg_header[2];
+
+   return true;
+}
+
+/**
+ * bsv2_write_segment:
+ * @handle            : movie handle
+ *
+ * Write out the segment being recorded.
+ **/
+static bool bsv2_write_segment(bsv_movie_t *handle)
+{
+   uint32_t seg_header[BSV2_SEGMENT_WORDS];
+   size_t i;
+   uint8_t *raw;
+   uint32_t state_len  = 0;
+   uint32_t input_len  = 0;
+   size_t raw_size     = handle->seg_frames * 2 + handle->num_words * 2;
+   bool full           = (handle->seg_index % BSV2_FULL_KEYFRAME_INTERVAL) == 0;
+   size_t state_bound  = handle->state_size
+      ? bsv2_deflate_bound(handle->state_size) : 0;
+   ssize_t pos         = filestream_tell(handle->file);
+
+   if (pos < 0
+         || !bsv2_reserve(&handle->tmp, &handle->tmp_size,
+            MAX(handle->state_size, raw_size))
+         || !bsv2_reserve(&handle->zbuf, &handle->zbuf_size,
+            state_bound + bsv2_deflate_bound(raw_size)))
+      return false;
+
+   if (handle->state_size)
+   {
+      const uint8_t *state = handle->key_state;
+
+      if (!full)
+      {
+         for (i = 0; i < handle->state_size; i++)
+            handle->tmp[i] = handle->key_state[i] ^ handle->prev_key[i];
+         state = handle->tmp;
+      }
+
+      if (!bsv2_transcode(handle, true, state, handle->state_size,
+               handle->zbuf, state_bound, &state_len))
+         return false;
+   }
+
+   raw = handle->tmp;
+   for (i = 0; i < handle->seg_frames; i++)
+   {
+      uint32_t count = handle->frame_words[i + 1] - handle->frame_words[i];
+      *raw++ = (uint8_t)count;
+      *raw++ = (uint8_t)(count >> 8);
+   }
+   for (i = 0; i < handle->num_words; i++)
+   {
+      *raw++ = (uint8_t)handle->words[i];
+      *raw++ = (uint8_t)((uint16_t)handle->words[i] >> 8);
+   }
+
+   if (!bsv2_transcode(handle, true, handle->tmp, raw_size,
+            handle->zbuf + state_len, bsv2_deflate_bound(raw_size),
+            &input_len))
+      return false;
+
+   seg_header[0] = swap_if_little32(BSV2_SEGMENT_MAGIC);
+   seg_header[1] = swap_if_big32(handle->seg_index * handle->interval);
+   seg_header[2] = swap_if_big32(handle->seg_frames);
+   seg_header[3] = swap_if_big32(full ? BSV2_SEGMENT_FULL_STATE : 0);
+   seg_header[4] = swap_if_big32(state_len);
+   seg_header[5] = swap_if_big32((uint32_t)raw_size);
+   seg_header[6] = swap_if_big32(input_len);
+
+   if (filestream_write(handle->file, seg_header, sizeof(seg_header))
+         != sizeof(seg_header))
+      return false;
+
+   if (filestream_write(handle->file, handle->zbuf, state_len + input_len)
+         != state_len + input_len)
+      return false;
+
+   handle->seg_count = handle->seg_index;
+   return bsv2_add_segment_offset(handle, (uint32_t)pos);
+}
+
+/* Write the rest of a recording, the index and the final header. */
+static void bsv2_finish_record(bsv_movie_t *handle)
+{
+   uint32_t header[BSV2_HEADER_WORDS];
+   size_t i;
+   ssize_t pos;
+
+   if (handle->seg_frames && !bsv2_write_segment(handle))
+      RARCH_ERR("Could not write the end of the BSV2 movie.\n");
+
+   pos = filestream_tell(handle->file);
+   if (pos < 0)
+      return;
+
+   for (i = 0; i < handle->seg_count; i++)
+   {
+      uint32_t offset = swap_if_big32(handle->seg_offsets[i]);
+      filestream_write(handle->file, &offset, sizeof(offset));
+   }
+
+   header[MAGIC_INDEX]       = swap_if_little32(BSV2_MAGIC);
+   header[SERIALIZER_INDEX]  = 0;
+   header[CRC_INDEX]         = swap_if_big32(handle->content_crc);
+   header[STATE_SIZE_INDEX]  = swap_if_big32((uint32_t)handle->state_size);
+   header[INTERVAL_INDEX]    = swap_if_big32(handle->interval);
+   header[FRAMES_INDEX]      = swap_if_big32(handle->frame);
+   header[SEGMENTS_INDEX]    = swap_if_big32((uint32_t)handle->seg_count);
+   header[SEGMENT_INDEX_POS] = swap_if_big32((uint32_t)pos);
+
+   filestream_seek(handle->file, 0, SEEK_SET);
+   filestream_write(handle->file, header, sizeof(header));
+}
+
+static bool bsv2_init_common(bsv_movie_t *handle)
+{
+   handle->deflate        = trans_stream_get_zlib_deflate_backend();
+   if (!handle->deflate)
+      return false;
+
+   handle->deflate_stream = handle->deflate->stream_new();
+   handle->inflate_stream = handle->deflate->reverse->stream_new();
+   handle->frame_words    = (uint32_t*)calloc(handle->interval + 1,
+         sizeof(uint32_t));
+
+   if (!handle->deflate_stream || !handle->inflate_stream
+         || !handle->frame_words)
+      return false;
+
+   if (handle->state_size)
+   {
+      handle->key_state = (uint8_t*)malloc(handle->state_size);
+      handle->prev_key  = (uint8_t*)malloc(handle->state_size);
+      if (!handle->key_state || !handle->prev_key
+            || !bsv2_reserve(&handle->tmp, &handle->tmp_size,
+               handle->state_size))
+         return false;
+   }
+
+   return true;
+}
+
+static bool bsv2_init_playback(bsv_movie_t *handle, uint32_t *header)
+{
+   uint32_t i;
+   uint32_t index_pos = swap_if_big32(header[SEGMENT_INDEX_POS]);
+   uint32_t segments  = swap_if_big32(header[SEGMENTS_INDEX]);
+
+   handle->version     = 2;
+   handle->state_size  = swap_if_big32(header[STATE_SIZE_INDEX]);
+   handle->interval    = swap_if_big32(header[INTERVAL_INDEX]);
+   handle->frame_count = swap_if_big32(header[FRAMES_INDEX]);
+
+   /* The interval sizes our buffers, so don't take it on trust. A finished
+    * movie can be shorter than one interval, but only one we'd record with. */
+   if (!handle->interval || handle->interval > BSV2_MAX_KEYFRAME_INTERVAL
+         || (index_pos && handle->interval > handle->frame_count
+            && handle->interval > BSV2_KEYFRAME_INTERVAL)
+         || (index_pos
+            && segments > handle->frame_count / handle->interval + 1))
+   {
+      RARCH_ERR("BSV2 movie has an invalid keyframe interval (%u).\n",
+            handle->interval);
+      return false;
+   }
+
+   if (!bsv2_init_common(handle))
+   {
+      RARCH_ERR("Could not set up BSV2 movie playback.\n");
+      return false;
+   }
+
+   if (index_pos)
+   {
+      if (filestream_seek(handle->file, index_pos, SEEK_SET) != 0)
+         return false;
+
+      for (i = 0; i < segments; i++)
+      {
+         uint32_t offset;
+         if (filestream_read(handle->file, &offset, sizeof(offset))
+               != sizeof(offset)
+               || !bsv2_add_segment_offset(handle, swap_if_big32(offset)))
+            return false;
+      }
+   }
+   else
+   {
+      /* The recording never finished, find the segments it did write */
+      uint32_t offset    = BSV2_HEADER_WORDS * sizeof(uint32_t);
+
+      handle->frame_count = 0;
+
+      for (;;)
+      {
+         uint32_t seg_header[BSV2_SEGMENT_WORDS];
+
+         if (!bsv2_add_segment_offset(handle, offset))
+            return false;
+
+         if (!bsv2_read_segment_header(handle,
+                  (uint32_t)handle->seg_count - 1, seg_header)
+               || seg_header[2] > handle->interval)
+         {
+            handle->seg_count--;
+            break;
+         }
+
+         handle->frame_count += seg_header[2];
+         offset += sizeof(seg_header) + seg_header[4] + seg_header[6];
+
+         if (seg_header[2] < handle->interval)
+            break;
+      }
+
+      RARCH_WARN("BSV2 movie is incomplete, playing the first %u frames.\n",
+            handle->frame_count);
+   }
+
+   if (!handle->seg_count)
+      return false;
+
+   if (!bsv2_load_segment(handle, 0)
+         || !bsv2_decode_keyframe(handle, 0, handle->key_state))
+   {
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_STATE_FROM_MOVIE));
+      return false;
+   }
+
+   if (handle->state_size)
+   {
+      retro_ctx_size_info_t info;
+
+      core_serialize_size(&info);
+
+      if (info.size == handle->state_size)
+      {
+         retro_ctx_serialize_info_t serial_info;
+
+         serial_info.data_const = handle->key_state;
+         serial_info.size       = handle->state_size;
+         core_unserialize(&serial_info);
+      }
+      else
+         RARCH_WARN("%s\n",
+               msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
+   }
+
+   return true;
+}
+
+static bool bsv2_init_record(bsv_movie_t *handle)
+{
+   uint32_t header[BSV2_HEADER_WORDS] = {0};
+
+   handle->version    = 2;
+   handle->interval   = BSV2_KEYFRAME_INTERVAL;
+
+   if (!bsv2_init_common(handle))
+      return false;
+
+   /* Filled in when recording finishes */
+   header[MAGIC_INDEX]      = swap_if_little32(BSV2_MAGIC);
+   header[CRC_INDEX]        = swap_if_big32(handle->content_crc);
+   header[STATE_SIZE_INDEX] = swap_if_big32((uint32_t)handle->state_size);
+   header[INTERVAL_INDEX]   = swap_if_big32(handle->interval);
+
+   return filestream_write(handle->file, header, sizeof(header))
+      == sizeof(header);
+}
+
+/**
+ * bsv2_goto_frame:
+ * @handle            : movie handle
+ * @frame             : frame to continue from
+ *
+ * Move the input cursor to the start of a frame. When recording, this
+ * discards everything recorded from that frame on.
+ **/
+static bool bsv2_goto_frame(bsv_movie_t *handle, uint32_t frame)
+{
+   uint32_t seg   = frame / handle->interval;
+   uint32_t local = frame % handle->interval;
+
+   if (handle->playback)
+   {
+      if (seg != handle->seg_index && !bsv2_load_segment(handle, seg))
+         return false;
+   }
+   else if (seg != handle->seg_index)
+   {
+      /* Back into a segment already written, which we pick up again
+       * as if it had never been finished */
+      if (!bsv2_load_segment(handle, seg)
+            || !bsv2_decode_keyframe(handle, seg, handle->key_state))
+         return false;
+
+      if (seg % BSV2_FULL_KEYFRAME_INTERVAL
+            && !bsv2_decode_keyframe(handle, seg - 1, handle->prev_key))
+         return false;
+
+      if (filestream_seek(handle->file, handle->seg_offsets[seg],
+               SEEK_SET) != 0)
+         return false;
+
+      handle->seg_count = seg;
+   }
+
+   if (!handle->playback)
+   {
+      handle->seg_frames = local;
+      handle->num_words  = handle->frame_words[local];
+   }
+
+   handle->frame = frame;
+   return true;
+}
+
+static void bsv2_set_frame_start(bsv_movie_t *handle)
+{
+   if (handle->playback)
+   {
+      uint32_t local;
+
+      if (handle->frame >= handle->frame_count)
+         return;
+
+      if (handle->frame / handle->interval != handle->seg_index
+            && !bsv2_load_segment(handle, handle->frame / handle->interval))
+      {
+         RARCH_ERR("Could not read BSV2 movie input at frame %u.\n",
+               handle->frame);
+         handle->frame_count = handle->frame;
+         return;
+      }
+
+      local             = handle->frame % handle->interval;
+      handle->input_ptr = handle->frame_words[local];
+      handle->input_end = handle->frame_words[local + 1];
+   }
+   else if (!handle->seg_frames && handle->state_size)
+   {
+      retro_ctx_serialize_info_t serial_info;
+
+      /* First frame of a segment, keep the state it starts from */
+      serial_info.data = handle->key_state;
+      serial_info.size = handle->state_size;
+      core_serialize(&serial_info);
+   }
+}
+
+static void bsv2_set_frame_end(bsv_movie_t *handle)
+{
+   handle->frame++;
+
+   if (handle->playback)
+      return;
+
+   handle->seg_frames++;
+   handle->frame_words[handle->seg_frames] = (uint32_t)handle->num_words;
+
+   if (handle->seg_frames == handle->interval)
+   {
+      uint8_t *key = handle->key_state;
+
+      if (!bsv2_write_segment(handle))
+         RARCH_ERR("Could not write BSV2 movie segment %u.\n",
+               handle->seg_index);
+
+      handle->key_state  = handle->prev_key;
+      handle->prev_key   = key;
+      handle->seg_index++;
+      handle->seg_frames = 0;
+      handle->num_words  = 0;
+   }
+}
+
+static bool bsv2_get_input(bsv_movie_t *handle, int16_t *bsv_data)
+{
+   if (handle->frame >= handle->frame_count)
+      return false;
+
+   /* A frame which polls more than was recorded gets no input */
+   if (handle->input_ptr < handle->input_end)
+      *bsv_data = handle->words[handle->input_ptr++];
+   else
+      *bsv_data = 0;
+
+   return true;
+}
+
+static void bsv2_set_input(bsv_movie_t *handle, int16_t bsv_data)
+{
+   if (!bsv2_reserve((uint8_t**)&handle->words, &handle->words_size,
+            (handle->num_words + 1) * sizeof(int16_t)))
+      return;
+
+   handle->words[handle->num_words++] = bsv_data;
+}
+
+static void bsv2_frame_rewind(bsv_movie_t *handle)
+{
+   uint32_t back = handle->first_rewind ? 1 : 2;
+
+   handle->did_rewind = true;
+
+   if (!bsv2_goto_frame(handle, handle->frame > back
+            ? handle->frame - back : 0))
+      RARCH_ERR("Could not rewind BSV2 movie.\n");
+}
 static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size       = 0;
    uint32_t content_crc      = 0;
-   uint32_t header[4]        = {0};
+   uint32_t header[BSV2_HEADER_WORDS] = {0};
+   bool is_bsv2              = false;
    RFILE *file               = filestream_open(path, RFILE_MODE_READ, -1);
 
    if (!file)
@@ -89,7 +776,10 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
    filestream_read(handle->file, header, sizeof(uint32_t) * 4);
    /* Compatibility with old implementation that
     * used incorrect documentation. */
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
+   is_bsv2 = swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC;
+
+   if (!is_bsv2
+         && swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
          && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
    {
       RARCH_ERR("%s\n", msg_hash_to_str(MSG_MOVIE_FILE_IS_NOT_A_VALID_BSV1_FILE));
@@ -102,6 +792,14 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
       if (swap_if_big32(header[CRC_INDEX]) != content_crc)
          RARCH_WARN("%s.\n", msg_hash_to_str(MSG_CRC32_CHECKSUM_MISMATCH));
 
+   if (is_bsv2)
+   {
+      if (filestream_read(handle->file, header + 4, sizeof(uint32_t) * 4)
+            != sizeof(uint32_t) * 4)
+         return false;
+      return bsv2_init_playback(handle, header);
+   }
+
    state_size = swap_if_big32(header[STATE_SIZE_INDEX]);
 
 #if 0
@@ -141,7 +839,8 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
                msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
    }
 
-   handle->min_file_pos = sizeof(header) + state_size;
+   handle->min_file_pos = sizeof(uint32_t) * 4 + state_size;
+   handle->version      = 1;
 
    return true;
 }
@@ -152,7 +851,10 @@ static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
    uint32_t state_size       = 0;
    uint32_t content_crc      = 0;
    uint32_t header[4]        = {0};
-   RFILE *file               = filestream_open(path, RFILE_MODE_WRITE, -1);
+   /* BSV2 reads back what it wrote when rewinding */
+   bool is_bsv2              = trans_stream_get_zlib_deflate_backend() != NULL;
+   RFILE *file               = filestream_open(path,
+         is_bsv2 ? RFILE_MODE_READ_WRITE : RFILE_MODE_WRITE, -1);
 
    if (!file)
    {
@@ -164,6 +866,17 @@ static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
 
    content_crc              = content_get_crc();
 
+   if (is_bsv2)
+   {
+      core_serialize_size(&info);
+
+      handle->content_crc   = content_crc;
+      handle->state_size    = info.size;
+      return bsv2_init_record(handle);
+   }
+
+   handle->version          = 1;
+
    /* This value is supposed to show up as
     * BSV1 in a HEX editor, big-endian. */
    header[MAGIC_INDEX]      = swap_if_little32(BSV_MAGIC);
@@ -210,8 +923,23 @@ static void bsv_movie_free(bsv_movie_t *handle)
    if (!handle)
       return;
 
+   if (handle->version == 2 && !handle->playback && handle->file)
+      bsv2_finish_record(handle);
+
    filestream_close(handle->file);
 
+   if (handle->deflate_stream)
+      handle->deflate->stream_free(handle->deflate_stream);
+   if (handle->inflate_stream)
+      handle->deflate->reverse->stream_free(handle->inflate_stream);
+
+   free(handle->seg_offsets);
+   free(handle->frame_words);
+   free(handle->words);
+   free(handle->key_state);
+   free(handle->prev_key);
+   free(handle->tmp);
+   free(handle->zbuf);
    free(handle->state);
    free(handle->frame_pos);
    free(handle);
@@ -234,6 +962,10 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path,
    else if (!bsv_movie_init_record(handle, path))
       goto error;
 
+   /* BSV2 finds frames through its segment index */
+   if (handle->version == 2)
+      return handle;
+
    /* Just pick something really large 
     * ~1 million frames rewind should do the trick. */
    if (!(frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
@@ -251,10 +983,61 @@ error:
    return NULL;
 }
 
+/**
+ * bsv2_seek:
+ * @handle            : movie handle
+ *
+ * Restore the state at the start of the segment holding the frame to seek
+ * to, then run the frames up to it without output.
+ **/
+static bool bsv2_seek(bsv_movie_t *handle)
+{
+   uint32_t frame = handle->seek_frame;
+   uint32_t start = frame - (frame % handle->interval);
+
+   handle->seek_pending = false;
+
+   if (!bsv2_decode_keyframe(handle, start / handle->interval,
+            handle->key_state) || !bsv2_goto_frame(handle, start))
+   {
+      RARCH_ERR("Could not seek to frame %u of the movie.\n", frame);
+      return false;
+   }
+
+   if (handle->state_size)
+   {
+      retro_ctx_serialize_info_t serial_info;
+
+      serial_info.data_const = handle->key_state;
+      serial_info.size       = handle->state_size;
+      core_unserialize(&serial_info);
+   }
+
+   core_set_silent_callbacks(true);
+   while (handle->frame < frame)
+   {
+      bsv2_set_frame_start(handle);
+      core_run();
+      bsv_movie_set_frame_end();
+   }
+   core_set_silent_callbacks(false);
+
+   return true;
+}
+
 /* Used for rewinding while playback/record. */
 void bsv_movie_set_frame_start(void)
 {
-   if (bsv_movie_state_handle)
+   if (!bsv_movie_state_handle)
+      return;
+
+   if (bsv_movie_state_handle->version == 2)
+   {
+      if (bsv_movie_state_handle->seek_pending)
+         bsv2_seek(bsv_movie_state_handle);
+      bsv2_set_frame_start(bsv_movie_state_handle);
+   }
+   else
       bsv_movie_state_handle->frame_pos[bsv_movie_state_handle->frame_ptr] 
          = filestream_tell(bsv_movie_state_handle->file);
 }
@@ -264,9 +1047,12 @@ void bsv_movie_set_frame_end(void)
    if (!bsv_movie_state_handle)
       return;
 
-   bsv_movie_state_handle->frame_ptr    = 
-      (bsv_movie_state_handle->frame_ptr + 1) 
-      & bsv_movie_state_handle->frame_mask;
+   if (bsv_movie_state_handle->version == 2)
+      bsv2_set_frame_end(bsv_movie_state_handle);
+   else
+      bsv_movie_state_handle->frame_ptr = 
+         (bsv_movie_state_handle->frame_ptr + 1) 
+         & bsv_movie_state_handle->frame_mask;
 
    bsv_movie_state_handle->first_rewind = 
       !bsv_movie_state_handle->did_rewind;
@@ -275,6 +1061,12 @@ void bsv_movie_set_frame_end(void)
 
 static void bsv_movie_frame_rewind(bsv_movie_t *handle)
 {
+   if (handle->version == 2)
+   {
+      bsv2_frame_rewind(handle);
+      return;
+   }
+
    handle->did_rewind = true;
 
    if (     (handle->frame_ptr <= 1) 
@@ -387,6 +1179,9 @@ bool bsv_movie_init(void)
 
 bool bsv_movie_get_input(int16_t *bsv_data)
 {
+   if (bsv_movie_state_handle->version == 2)
+      return bsv2_get_input(bsv_movie_state_handle, bsv_data);
+
    if (filestream_read(bsv_movie_state_handle->file, bsv_data, 1) != 1)
       return false;
 
@@ -447,6 +1242,12 @@ bool bsv_movie_ctl(enum bsv_ctl_state state, void *data)
          {
             int16_t *bsv_data = (int16_t*)data;
 
+            if (bsv_movie_state_handle->version == 2)
+            {
+               bsv2_set_input(bsv_movie_state_handle, *bsv_data);
+               break;
+            }
+
             *bsv_data = swap_if_big16(*bsv_data);
             filestream_write(bsv_movie_state_handle->file, bsv_data, 1);
          }
@@ -482,6 +1283,29 @@ bool bsv_movie_init_handle(const char *path,
    return true;
 }
 
+
+/**
+ * bsv_movie_seek:
+ * @frame             : frame of the movie being played back
+ *
+ * Continue playback from any frame. This may be requested from inside the
+ * core's frame, so the seek itself happens before the next one starts.
+ *
+ * Returns: true if the movie can seek to @frame, otherwise false.
+ **/
+bool bsv_movie_seek(unsigned frame)
+{
+   bsv_movie_t *handle = bsv_movie_state_handle;
+
+   if (!handle || !handle->playback || handle->version != 2
+         || frame >= handle->frame_count)
+      return false;
+
+   handle->seek_pending = true;
+   handle->seek_frame   = frame;
+   return true;
+}
+
 void bsv_movie_deinit(void)
 {
    if (!bsv_movie_state_handle)
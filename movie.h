@@ -26,12 +26,20 @@
 RETRO_BEGIN_DECLS
 
 #define BSV_MAGIC          0x42535631
+#define BSV2_MAGIC         0x42535632
+#define BSV2_SEGMENT_MAGIC 0x42534547
 
 #define MAGIC_INDEX        0
 #define SERIALIZER_INDEX   1
 #define CRC_INDEX          2
 #define STATE_SIZE_INDEX   3
 
+/* BSV2 only */
+#define INTERVAL_INDEX     4
+#define FRAMES_INDEX       5
+#define SEGMENTS_INDEX     6
+#define SEGMENT_INDEX_POS  7
+
 typedef struct bsv_movie bsv_movie_t;
 
 enum rarch_movie_type
@@ -82,6 +90,8 @@ bool bsv_movie_check(void);
 
 bool bsv_movie_init_handle(const char *path, enum rarch_movie_type type);
 
+bool bsv_movie_seek(unsigned frame);
+
 RETRO_END_DECLS
 
 #endif
@@ -667,6 +667,7 @@ enum msg_hash_enums
    MENU_LABEL(VIDEO_SOFT_FILTER),
    MENU_LABEL(VIDEO_MAX_SWAPCHAIN_IMAGES),
    MENU_LABEL(VIDEO_GPU_SCREENSHOT),
+   MENU_LABEL(SCREENSHOT_FAST_COMPRESSION),
    MENU_LABEL(VIDEO_BLACK_FRAME_INSERTION),
    MENU_LABEL(VIDEO_FRAME_DELAY),
    MENU_LABEL(VIDEO_VSYNC),
@@ -1104,6 +1105,7 @@ enum msg_hash_enums
    MENU_LABEL(FRAME_ADVANCE),
    MENU_LABEL(FPS_SHOW),
    MENU_LABEL(FRAMECOUNT_SHOW),
+   MENU_LABEL(MENU_STATS_SHOW),
    MENU_LABEL(MOVIE_RECORD_TOGGLE),
    MENU_ENUM_LABEL_L_X_PLUS,
    MENU_ENUM_LABEL_L_X_MINUS,
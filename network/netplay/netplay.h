@@ -50,9 +50,38 @@ enum rarch_netplay_ctl_state
    RARCH_NETPLAY_CTL_DISCONNECT,
    RARCH_NETPLAY_CTL_FINISHED_NAT_TRAVERSAL,
    RARCH_NETPLAY_CTL_DESYNC_PUSH,
-   RARCH_NETPLAY_CTL_DESYNC_POP
+   RARCH_NETPLAY_CTL_DESYNC_POP,
+   RARCH_NETPLAY_CTL_GET_STATS
 };
 
+/* Rollback statistics, see RARCH_NETPLAY_CTL_GET_STATS */
+typedef struct netplay_stats
+{
+   /* Number of rollbacks and frames re-simulated by them */
+   uint64_t rollbacks;
+   uint64_t replayed_frames;
+
+   /* Replayed frames whose state was never serialized */
+   uint64_t skipped_serializations;
+
+   /* Total time spent replaying, in microseconds */
+   retro_time_t replay_time;
+
+   /* Frames rewound by the last and the deepest rollback */
+   unsigned rollback_depth_last;
+   unsigned rollback_depth_max;
+
+   /* Running averages of one replayed core_run and
+    * core_serialize, in microseconds */
+   retro_time_t run_time_avg;
+   retro_time_t serialize_time_avg;
+
+   unsigned input_latency_frames;
+
+   /* Input frames which arrived over UDP ahead of TCP */
+   uint64_t udp_input_frames;
+} netplay_stats_t;
+
 int16_t input_state_net(unsigned port, unsigned device,
       unsigned idx, unsigned id);
 
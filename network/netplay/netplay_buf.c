@@ -61,6 +61,7 @@ bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size)
       return false;
    sbuf->bufsz = size;
    sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->io = NULL;
    return true;
 }
 
@@ -119,31 +120,9 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
    sbuf->start = sbuf->read = sbuf->end = 0;
 }
 
-/**
- * netplay_send
- *
- * Queue the given data for sending.
- */
-bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
-   size_t len)
+/* Copy data into the buffer, which must have room for it */
+static void buf_put(struct socket_buffer *sbuf, const void *buf, size_t len)
 {
-   if (buf_remaining(sbuf) < len)
-   {
-      /* Need to force a blocking send */
-      if (!netplay_send_flush(sbuf, sockfd, true))
-         return false;
-   }
-
-   if (buf_remaining(sbuf) < len)
-   {
-      /* Can only be that this is simply too big for our buffer, in which case
-       * we just need to do a blocking send */
-      if (!socket_send_all_blocking(sockfd, buf, len, false))
-         return false;
-      return true;
-   }
-
-   /* Copy it into our buffer */
    if (sbuf->bufsz - sbuf->end < len)
    {
       /* Half at a time */
@@ -161,19 +140,115 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
       sbuf->end += len;
 
    }
+}
 
-   return true;
+/* Copy up to len unread bytes out of the buffer */
+static size_t buf_get(struct socket_buffer *sbuf, void *buf, size_t len)
+{
+   size_t recvd;
+
+   if (sbuf->end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
+   {
+      size_t unread = buf_unread(sbuf);
+      if (len <= unread)
+      {
+         memcpy(buf, sbuf->data + sbuf->read, len);
+         sbuf->read += len;
+         if (sbuf->read >= sbuf->bufsz)
+            sbuf->read = 0;
+         recvd = len;
+
+      }
+      else
+      {
+         memcpy(buf, sbuf->data + sbuf->read, unread);
+         sbuf->read += unread;
+         if (sbuf->read >= sbuf->bufsz)
+            sbuf->read = 0;
+         recvd = unread;
+
+      }
+
+   }
+   else
+   {
+      /* Our read goes around the edge */
+      size_t chunka = sbuf->bufsz - sbuf->read,
+             pchunklen = len - chunka,
+             chunkb = (pchunklen >= sbuf->end) ? sbuf->end : pchunklen;
+      memcpy(buf, sbuf->data + sbuf->read, chunka);
+      memcpy((unsigned char *) buf + chunka, sbuf->data, chunkb);
+      sbuf->read = chunkb;
+      recvd = chunka + chunkb;
+
+   }
+
+   return recvd;
+}
+
+/* Receive into one contiguous free region of the buffer */
+static ssize_t buf_fill_region(int sockfd, unsigned char *data, size_t len)
+{
+   bool error = false;
+   ssize_t recvd;
+
+   /* A zero-length receive would look like a hangup */
+   if (len == 0)
+      return 0;
+
+   recvd = socket_receive_all_nonblocking(sockfd, &error, data, len);
+   if (recvd < 0 || error)
+      return -1;
+   return recvd;
 }
 
 /**
- * netplay_send_flush
+ * netplay_socket_buffer_fill
  *
- * Flush unsent data in the given socket buffer, blocking to do so if
- * requested.
+ * Receive whatever the socket has into the buffer, without blocking.
  *
- * Returns false only on socket failures, true otherwise.
+ * Returns number of bytes received, or -1 on error.
  */
-bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+ssize_t netplay_socket_buffer_fill(struct socket_buffer *sbuf, int sockfd)
+{
+   ssize_t recvd, total = 0;
+
+   if (sbuf->end >= sbuf->start)
+   {
+      recvd = buf_fill_region(sockfd, sbuf->data + sbuf->end,
+         sbuf->bufsz - sbuf->end - ((sbuf->start == 0) ? 1 : 0));
+      if (recvd < 0)
+         return -1;
+      sbuf->end += recvd;
+      total += recvd;
+      if (sbuf->end >= sbuf->bufsz)
+      {
+         sbuf->end = 0;
+         recvd = buf_fill_region(sockfd, sbuf->data, sbuf->start - 1);
+         if (recvd < 0)
+            return -1;
+         sbuf->end += recvd;
+         total += recvd;
+
+      }
+
+   }
+   else
+   {
+      recvd = buf_fill_region(sockfd, sbuf->data + sbuf->end,
+         sbuf->start - sbuf->end - 1);
+      if (recvd < 0)
+         return -1;
+      sbuf->end += recvd;
+      total += recvd;
+
+   }
+
+   return total;
+}
+
+/* Send what's buffered, blocking to do so if requested */
+static bool buf_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 {
    ssize_t sent;
 
@@ -211,7 +286,7 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
          if (!socket_send_all_blocking(sockfd, sbuf->data + sbuf->start, sbuf->bufsz - sbuf->start, true))
             return false;
          sbuf->start = 0;
-         return netplay_send_flush(sbuf, sockfd, true);
+         return buf_flush(sbuf, sockfd, true);
 
       }
       else
@@ -224,7 +299,7 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
          if (sbuf->start >= sbuf->bufsz)
          {
             sbuf->start = 0;
-            return netplay_send_flush(sbuf, sockfd, false);
+            return buf_flush(sbuf, sockfd, false);
 
          }
 
@@ -236,92 +311,220 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 }
 
 /**
- * netplay_recv
+ * netplay_socket_buffer_drain
  *
- * Receive buffered or fresh data.
+ * Send as much of the buffer as the socket takes, without blocking.
  *
- * Returns number of bytes returned, which may be short or 0, or -1 on error.
+ * Returns false only on socket failures, true otherwise.
  */
-ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
-   size_t len, bool block)
+bool netplay_socket_buffer_drain(struct socket_buffer *sbuf, int sockfd)
 {
-   bool error;
-   ssize_t recvd;
-   
-   /* Receive whatever we can into the buffer */
-   if (sbuf->end >= sbuf->start)
+   return buf_flush(sbuf, sockfd, false);
+}
+
+/**
+ * netplay_socket_buffer_used
+ *
+ * How many bytes are waiting in the buffer?
+ */
+size_t netplay_socket_buffer_used(struct socket_buffer *sbuf)
+{
+   return buf_used(sbuf);
+}
+
+/**
+ * netplay_socket_buffer_remaining
+ *
+ * How many more bytes fit in the buffer?
+ */
+size_t netplay_socket_buffer_remaining(struct socket_buffer *sbuf)
+{
+   return buf_remaining(sbuf);
+}
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+/* With an IO thread, sending is copying into the buffer, waiting for the
+ * thread to make room if it's full */
+static bool buf_send_threaded(struct socket_buffer *sbuf, const void *buf,
+   size_t len)
+{
+   struct netplay_io_conn *io = sbuf->io;
+   const unsigned char *data  = (const unsigned char *) buf;
+   bool ret                   = true;
+
+   slock_lock(io->lock);
+   while (len)
    {
-      error = false;
-      recvd = socket_receive_all_nonblocking(sockfd, &error,
-         sbuf->data + sbuf->end, sbuf->bufsz - sbuf->end -
-         ((sbuf->start == 0) ? 1 : 0));
-      if (recvd < 0 || error)
-         return -1;
-      sbuf->end += recvd;
-      if (sbuf->end >= sbuf->bufsz)
+      size_t chunk = buf_remaining(sbuf);
+
+      if (io->error)
       {
-         sbuf->end = 0;
-         error = false;
-         recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data, sbuf->start - 1);
-         if (recvd < 0 || error)
-            return -1;
-         sbuf->end += recvd;
+         ret = false;
+         break;
+      }
 
+      if (chunk == 0)
+      {
+         netplay_io_thread_wake(io->thread);
+         scond_wait(io->cond, io->lock);
+         continue;
       }
 
+      if (chunk > len)
+         chunk = len;
+      buf_put(sbuf, data, chunk);
+      data += chunk;
+      len  -= chunk;
    }
-   else
+   slock_unlock(io->lock);
+
+   return ret;
+}
+
+static bool buf_flush_threaded(struct socket_buffer *sbuf, bool block)
+{
+   struct netplay_io_conn *io = sbuf->io;
+   bool ret;
+
+   slock_lock(io->lock);
+   if (!io->error && buf_used(sbuf))
    {
-      error = false;
-      recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data + sbuf->end, sbuf->start - sbuf->end - 1);
-      if (recvd < 0 || error)
-         return -1;
-      sbuf->end += recvd;
+      netplay_io_thread_wake(io->thread);
+      if (block)
+         while (!io->error && buf_used(sbuf))
+            scond_wait(io->cond, io->lock);
+   }
+   ret = !io->error;
+   slock_unlock(io->lock);
+
+   return ret;
+}
+
+static ssize_t buf_recv_threaded(struct socket_buffer *sbuf, void *buf,
+   size_t len, bool block)
+{
+   struct netplay_io_conn *io = sbuf->io;
+   ssize_t recvd;
+
+   slock_lock(io->lock);
 
+   /* What's already here can still be read after the socket fails, but a
+    * short read then would never complete */
+   if (io->error && buf_unread(sbuf) < len)
+   {
+      slock_unlock(io->lock);
+      return -1;
    }
 
-   /* Now copy it into the reader */
-   if (sbuf->end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
+   recvd = buf_get(sbuf, buf, len);
+
+   if (block)
    {
-      size_t unread = buf_unread(sbuf);
-      if (len <= unread)
+      while (recvd < (ssize_t) len)
       {
-         memcpy(buf, sbuf->data + sbuf->read, len);
-         sbuf->read += len;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = len;
-
+         bool full = (buf_remaining(sbuf) == 0);
+         sbuf->start = sbuf->read;
+         if (io->error)
+         {
+            recvd = -1;
+            break;
+         }
+         if (full)
+            netplay_io_thread_wake(io->thread);
+         scond_wait(io->cond, io->lock);
+         recvd += buf_get(sbuf, (unsigned char *) buf + recvd, len - recvd);
       }
-      else
-      {
-         memcpy(buf, sbuf->data + sbuf->read, unread);
-         sbuf->read += unread;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = unread;
+      sbuf->start = sbuf->read;
+   }
 
-      }
+   slock_unlock(io->lock);
 
-   }
-   else
+   return recvd;
+}
+#endif
+
+/**
+ * netplay_send
+ *
+ * Queue the given data for sending.
+ */
+bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
+   size_t len)
+{
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+      return buf_send_threaded(sbuf, buf, len);
+#endif
+
+   if (buf_remaining(sbuf) < len)
    {
-      /* Our read goes around the edge */
-      size_t chunka = sbuf->bufsz - sbuf->read,
-             pchunklen = len - chunka,
-             chunkb = (pchunklen >= sbuf->end) ? sbuf->end : pchunklen;
-      memcpy(buf, sbuf->data + sbuf->read, chunka);
-      memcpy((unsigned char *) buf + chunka, sbuf->data, chunkb);
-      sbuf->read = chunkb;
-      recvd = chunka + chunkb;
+      /* Need to force a blocking send */
+      if (!buf_flush(sbuf, sockfd, true))
+         return false;
+   }
 
+   if (buf_remaining(sbuf) < len)
+   {
+      /* Can only be that this is simply too big for our buffer, in which case
+       * we just need to do a blocking send */
+      if (!socket_send_all_blocking(sockfd, buf, len, false))
+         return false;
+      return true;
    }
 
+   /* Copy it into our buffer */
+   buf_put(sbuf, buf, len);
+
+   return true;
+}
+
+/**
+ * netplay_send_flush
+ *
+ * Flush unsent data in the given socket buffer, blocking to do so if
+ * requested.
+ *
+ * Returns false only on socket failures, true otherwise.
+ */
+bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+{
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+      return buf_flush_threaded(sbuf, block);
+#endif
+
+   return buf_flush(sbuf, sockfd, block);
+}
+
+/**
+ * netplay_recv
+ *
+ * Receive buffered or fresh data.
+ *
+ * Returns number of bytes returned, which may be short or 0, or -1 on error.
+ */
+ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
+   size_t len, bool block)
+{
+   ssize_t recvd;
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+      return buf_recv_threaded(sbuf, buf, len, block);
+#endif
+
+   /* Receive whatever we can into the buffer */
+   if (netplay_socket_buffer_fill(sbuf, sockfd) < 0)
+      return -1;
+
+   /* Now copy it into the reader */
+   recvd = buf_get(sbuf, buf, len);
+
    /* Perhaps block for more data */
    if (block)
    {
       sbuf->start = sbuf->read;
-      if (recvd < 0 || recvd < (ssize_t) len)
+      if (recvd < (ssize_t) len)
       {
          if (!socket_receive_all_blocking(sockfd, (unsigned char *) buf + recvd, len - recvd))
             return -1;
@@ -341,9 +544,40 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
  */
 void netplay_recv_reset(struct socket_buffer *sbuf)
 {
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+   {
+      slock_lock(sbuf->io->lock);
+      sbuf->read = sbuf->start;
+      slock_unlock(sbuf->io->lock);
+      return;
+   }
+#endif
+
    sbuf->read = sbuf->start;
 }
 
+/**
+ * netplay_recv_pending
+ *
+ * Is there received data in our recv buffer which hasn't been read yet?
+ */
+bool netplay_recv_pending(struct socket_buffer *sbuf)
+{
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+   {
+      bool pending;
+      slock_lock(sbuf->io->lock);
+      pending = buf_unread(sbuf) > 0;
+      slock_unlock(sbuf->io->lock);
+      return pending;
+   }
+#endif
+
+   return buf_unread(sbuf) > 0;
+}
+
 /**
  * netplay_recv_flush
  *
@@ -352,5 +586,42 @@ void netplay_recv_reset(struct socket_buffer *sbuf)
  */
 void netplay_recv_flush(struct socket_buffer *sbuf)
 {
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+   {
+      /* The IO thread stops reading while we're full, so it needs to hear
+       * that there's room again */
+      bool full;
+      slock_lock(sbuf->io->lock);
+      full = (buf_remaining(sbuf) == 0);
+      if (full && sbuf->start != sbuf->read)
+         netplay_io_thread_wake(sbuf->io->thread);
+      sbuf->start = sbuf->read;
+      slock_unlock(sbuf->io->lock);
+      return;
+   }
+#endif
+
    sbuf->start = sbuf->read;
 }
+
+/**
+ * netplay_recv_failed
+ *
+ * Has the IO thread seen this buffer's socket fail?
+ */
+bool netplay_recv_failed(struct socket_buffer *sbuf)
+{
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (sbuf->io)
+   {
+      bool failed;
+      slock_lock(sbuf->io->lock);
+      failed = sbuf->io->error;
+      slock_unlock(sbuf->io->lock);
+      return failed;
+   }
+#endif
+
+   return false;
+}
@@ -31,6 +31,7 @@
 #include "netplay_private.h"
 
 #include "../../configuration.h"
+#include "../../gfx/video_driver.h"
 #include "../../input/input_driver.h"
 #include "../../tasks/tasks_internal.h"
 #include "../../file_path_special.h"
@@ -162,12 +163,7 @@ static bool get_self_input_state(netplay_t *netplay)
    }
 
    /* And send this input to our peers */
-   for (i = 0; i < netplay->connections_size; i++)
-   {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
-         netplay_send_cur_input(netplay, &netplay->connections[i]);
-   }
+   netplay_send_cur_input_all(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -240,9 +236,14 @@ static bool netplay_poll(void)
     * network latency */
    if (netplay_data->frame_run_time_avg || netplay_data->stateless_mode)
    {
-      /* FIXME: Using fixed 60fps for this calculation */
+      struct retro_system_av_info *av_info = video_viewport_get_system_av_info();
+      retro_time_t frame_time   = (av_info && av_info->timing.fps > 0.0) ?
+                                  (retro_time_t)(1000000.0 / av_info->timing.fps) :
+                                  16666;
+      /* frame_run_time_avg includes a serialize per frame, which is what
+       * replaying frames we may still rewind to costs */
       unsigned frames_per_frame = netplay_data->frame_run_time_avg ?
-                                  (16666/netplay_data->frame_run_time_avg) :
+                                  (unsigned)(frame_time/netplay_data->frame_run_time_avg) :
                                    0;
       unsigned frames_ahead = (netplay_data->run_frame_count > netplay_data->unread_frame_count) ?
                               (netplay_data->run_frame_count - netplay_data->unread_frame_count) :
@@ -634,7 +635,8 @@ static void netplay_announce(void)
       "game_name=%s&game_crc=%08X&port=%d"
       "&has_password=%d&has_spectate_password=%d&force_mitm=%d&retroarch_version=%s&frontend=%s",
       username, corename, coreversion, gamename, content_crc,
-      settings->uints.netplay_port,
+      netplay_data && netplay_data->relay ? netplay_data->relay_port
+         : settings->uints.netplay_port,
       *settings->paths.netplay_password ? 1 : 0,
       *settings->paths.netplay_spectate_password ? 1 : 0,
       settings->bools.netplay_use_mitm_server,
@@ -791,9 +793,15 @@ bool netplay_pre_frame(netplay_t *netplay)
 
    if (settings->bools.netplay_public_announce)
    {
-      reannounce++;
-      if ((netplay->is_server || is_mitm) && (reannounce % 600 == 0))
-         netplay_announce();
+      /* Through a relay, we've nothing to announce until our room is open */
+      if (netplay->relay && !netplay->relay_port)
+         reannounce = -1;
+      else
+      {
+         reannounce++;
+         if ((netplay->is_server || is_mitm) && (reannounce % 600 == 0))
+            netplay_announce();
+      }
    }
    else
    {
@@ -1236,7 +1244,9 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
          msg_hash_to_str(MSG_WAITING_FOR_CLIENT),
          0, 180, false);
 
-      if (settings->bools.netplay_public_announce)
+      /* Through a relay, we announce once we know our room's port */
+      if (settings->bools.netplay_public_announce &&
+            string_is_empty(settings->paths.netplay_relay_server))
          netplay_announce();
    }
 
@@ -1250,6 +1260,9 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
          settings->ints.netplay_check_frames,
          &cbs,
          settings->bools.netplay_nat_traversal,
+         settings->bools.netplay_udp_input &&
+            !settings->bools.netplay_use_mitm_server,
+         settings->paths.netplay_relay_server,
          settings->paths.username,
          quirks);
 
@@ -1316,6 +1329,11 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
          case RARCH_NETPLAY_CTL_IS_CONNECTED:
             ret = false;
             goto done;
+
+         case RARCH_NETPLAY_CTL_GET_STATS:
+            /* No session, nothing to report */
+            ret = false;
+            goto done;
          default:
             goto done;
       }
@@ -1383,6 +1401,20 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
                netplay_load_savestate(netplay_data, NULL, true);
          }
          break;
+      case RARCH_NETPLAY_CTL_GET_STATS:
+         {
+            netplay_stats_t *stats = (netplay_stats_t*)data;
+            if (!stats)
+            {
+               ret = false;
+               goto done;
+            }
+            *stats                      = netplay_data->stats;
+            stats->run_time_avg         = netplay_data->replay_run_time_avg;
+            stats->serialize_time_avg   = netplay_data->replay_serialize_time_avg;
+            stats->input_latency_frames = netplay_data->input_latency_frames;
+         }
+         goto done;
       default:
       case RARCH_NETPLAY_CTL_NONE:
          ret = false;
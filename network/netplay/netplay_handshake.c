@@ -208,7 +208,8 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(netplay_impl_magic());
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED |
+         (netplay->udp_input ? NETPLAY_CAP_UDP_INPUT : 0));
    header[3] = 0;
 
    if (netplay->is_server &&
@@ -235,6 +236,38 @@ bool netplay_handshake_init_send(netplay_t *netplay,
    return true;
 }
 
+/**
+ * netplay_handshake_udp_info
+ *
+ * Offer our UDP input channel to a connection which advertised support for it
+ * (server only). The token identifies their datagrams, since we only learn
+ * their UDP address from the first one they send.
+ */
+static bool netplay_handshake_udp_info(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t token;
+
+   if (netplay->udp_fd < 0)
+      return true;
+
+   if (simple_rand_next == 1)
+      simple_srand((unsigned int) time(NULL));
+   connection->udp_token = simple_rand_uint32();
+   if (connection->udp_token == 0) connection->udp_token = 1;
+   connection->udp = true;
+   connection->udp_addr_known = false;
+
+   token = htonl(connection->udp_token);
+   if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP_INFO,
+            &token, sizeof(token)) ||
+       !netplay_send_flush(&connection->send_packet_buffer, connection->fd,
+            false))
+      return false;
+
+   return true;
+}
+
 struct nick_buf_s
 {
    uint32_t cmd[2];
@@ -348,6 +381,8 @@ bool netplay_handshake_init(netplay_t *netplay,
 
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
+   connection->udp_supported = netplay->udp_input &&
+      (compression & NETPLAY_CAP_UDP_INPUT);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
    if (compression & NETPLAY_COMPRESSION_ZLIB)
@@ -620,6 +655,11 @@ bool netplay_handshake_sync(netplay_t *netplay,
    }
    autosave_unlock();
 
+   /* Offer the UDP input channel if they can use it */
+   if (connection->udp_supported &&
+         !netplay_handshake_udp_info(netplay, connection))
+      return false;
+
    /* Now we're ready! */
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
@@ -25,6 +25,7 @@
 
 #include <boolean.h>
 #include <compat/strl.h>
+#include <string/stdstring.h>
 
 #include "netplay_private.h"
 
@@ -168,11 +169,11 @@ static bool init_tcp_socket(netplay_t *netplay, void *direct_host,
 #ifdef HAVE_INET6
    if (!direct_host && !server && res->ai_family == AF_INET6)
    {
-      struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) res->ai_addr;
-#if defined(_MSC_VER) && _MSC_VER <= 1200
-	  IN6ADDR_SETANY(sin6);
+      struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) res->ai_addr;
+#if defined(_MSC_VER) && _MSC_VER <= 1200
+	  IN6ADDR_SETANY(sin6);
 #else
-      sin6->sin6_addr           = in6addr_any;
+      sin6->sin6_addr           = in6addr_any;
 #endif
    }
 #endif
@@ -222,15 +223,246 @@ static bool init_tcp_socket(netplay_t *netplay, void *direct_host,
    return ret;
 }
 
+/* The server's UDP input socket shares the TCP port number. The client opens
+ * its socket once the server offers the channel. Failing to open it isn't
+ * fatal; we simply stay on TCP. */
+static void init_udp_socket(netplay_t *netplay)
+{
+   struct sockaddr_storage addr;
+   socklen_t addr_size = sizeof(addr);
+   int fd;
+
+   if (getsockname(netplay->listen_fd, (struct sockaddr*)&addr, &addr_size) < 0)
+      goto error;
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      goto error;
+
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+   if (addr.ss_family == AF_INET6)
+   {
+      int on = 0;
+      if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on, sizeof(on)) < 0)
+         RARCH_WARN("Failed to listen on both IPv6 and IPv4\n");
+   }
+#endif
+
+   if (bind(fd, (struct sockaddr*)&addr, addr_size) < 0 ||
+         !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      goto error;
+   }
+
+   netplay->udp_fd = fd;
+   return;
+
+error:
+   RARCH_WARN("Failed to open the netplay UDP input socket, using TCP only.\n");
+   netplay->udp_input = false;
+}
+
+/* Host through a relay: start connecting our control connection. We learn our
+ * room in netplay_relay_poll, once the relay answers. */
+static bool init_relay_socket(netplay_t *netplay, const char *relay,
+      uint16_t port)
+{
+   struct addrinfo *addr = NULL;
+   int fd                = socket_init((void **) &addr, port, relay,
+         SOCKET_TYPE_STREAM);
+
+   if (fd < 0)
+      goto error;
+
+   memcpy(&netplay->relay_addr, addr->ai_addr, addr->ai_addrlen);
+   netplay->relay_addr_size = (socklen_t)addr->ai_addrlen;
+
+   /* Don't hold up the frontend while the relay answers. If the connection
+    * fails, it'll show up when we go to use it. */
+   if (!socket_nonblock(fd))
+      goto error;
+   socket_connect(fd, (void*)addr, false);
+
+   freeaddrinfo_retro(addr);
+
+   RARCH_LOG("[netplay] Opening a room on netplay relay %s.\n", relay);
+
+   /* Clients reach us through the relay, so neither UDP input nor NAT
+    * traversal apply */
+   netplay->listen_fd       = fd;
+   netplay->relay           = true;
+   netplay->relay_connected = false;
+   netplay->relay_port      = 0;
+   netplay->udp_input       = false;
+   netplay->nat_traversal   = false;
+   return true;
+
+error:
+   if (addr)
+      freeaddrinfo_retro(addr);
+   if (fd >= 0)
+      socket_close(fd);
+   RARCH_ERR("Failed to open a room on netplay relay %s.\n", relay);
+   return false;
+}
+
+/* We've lost our control connection, so we can't take any more clients */
+static void netplay_relay_lost(netplay_t *netplay)
+{
+   RARCH_ERR("Lost the connection to the netplay relay.\n");
+   socket_close(netplay->listen_fd);
+   netplay->listen_fd = -1;
+}
+
+/**
+ * netplay_relay_poll
+ * @netplay              : pointer to netplay object
+ *
+ * Move our control connection to the relay along without blocking: finish
+ * connecting, ask for a room, and read which port it's on.
+ *
+ * Returns: true once our room is open.
+ */
+bool netplay_relay_poll(netplay_t *netplay)
+{
+   fd_set wfds, efds, rfds;
+   struct timeval tmp_tv = {0};
+   uint32_t header[3];
+   ssize_t peeked;
+   int fd = netplay->listen_fd;
+
+   if (netplay->relay_port)
+      return true;
+
+   if (!netplay->relay_connected)
+   {
+      int error          = 0;
+      socklen_t err_size = sizeof(error);
+
+      FD_ZERO(&wfds);
+      FD_ZERO(&efds);
+      FD_SET(fd, &wfds);
+      FD_SET(fd, &efds);
+      if (socket_select(fd + 1, NULL, &wfds, &efds, &tmp_tv) <= 0)
+         return false;
+
+      if (FD_ISSET(fd, &efds) ||
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *) &error,
+             &err_size) < 0 || error)
+      {
+         netplay_relay_lost(netplay);
+         return false;
+      }
+
+      header[0] = htonl(NETPLAY_RELAY_MAGIC);
+      header[1] = htonl(NETPLAY_RELAY_CMD_HOST);
+
+      /* Our socket buffer is empty, so this goes in one piece */
+      if (socket_send_all_nonblocking(fd, header, 2*sizeof(uint32_t), true)
+            != 2*sizeof(uint32_t))
+      {
+         netplay_relay_lost(netplay);
+         return false;
+      }
+
+      netplay->relay_connected = true;
+   }
+
+   /* Wait until the whole reply is here */
+   FD_ZERO(&rfds);
+   FD_SET(fd, &rfds);
+   if (socket_select(fd + 1, &rfds, NULL, NULL, &tmp_tv) <= 0)
+      return false;
+
+   peeked = recv(fd, (char *) header, sizeof(header), MSG_PEEK);
+   if (peeked > 0 && peeked < (ssize_t) sizeof(header))
+      return false;
+
+   if (peeked <= 0 ||
+       !socket_receive_all_blocking(fd, header, sizeof(header)) ||
+       ntohl(header[0]) != NETPLAY_RELAY_MAGIC ||
+       ntohl(header[1]) != NETPLAY_RELAY_CMD_ROOM ||
+       !ntohl(header[2]))
+   {
+      netplay_relay_lost(netplay);
+      return false;
+   }
+
+   netplay->relay_port = (uint16_t)ntohl(header[2]);
+   RARCH_LOG("[netplay] Hosting through netplay relay, room port %u.\n",
+         (unsigned)netplay->relay_port);
+   return true;
+}
+
+/**
+ * netplay_relay_accept
+ * @netplay              : pointer to netplay object
+ * @id                   : the client's id and token, which the new
+ *                         connection must start by sending in
+ *                         NETPLAY_RELAY_CMD_LINK
+ *
+ * Read a new client announcement from the relay's control connection and
+ * start opening the connection which will carry it.
+ *
+ * Returns: the new socket, or -1 on failure.
+ */
+int netplay_relay_accept(netplay_t *netplay, uint32_t *id)
+{
+   uint32_t announce[3];
+   ssize_t peeked;
+   int fd;
+
+   /* Wait until the whole announcement is here */
+   peeked = recv(netplay->listen_fd, (char *) announce, sizeof(announce),
+         MSG_PEEK);
+   if (peeked > 0 && peeked < (ssize_t) sizeof(announce))
+      return -1;
+
+   if (peeked <= 0 ||
+       !socket_receive_all_blocking(netplay->listen_fd, announce,
+            sizeof(announce)) ||
+       ntohl(announce[0]) != NETPLAY_RELAY_CMD_CLIENT)
+   {
+      netplay_relay_lost(netplay);
+      return -1;
+   }
+
+   fd = socket(netplay->relay_addr.ss_family, SOCK_STREAM, 0);
+   if (fd < 0)
+      return -1;
+
+   /* As with our control connection, a failure shows up on first use */
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return -1;
+   }
+   connect(fd, (struct sockaddr *) &netplay->relay_addr,
+         netplay->relay_addr_size);
+
+   id[0] = ntohl(announce[1]);
+   id[1] = ntohl(announce[2]);
+   return fd;
+}
+
 static bool init_socket(netplay_t *netplay, void *direct_host,
-      const char *server, uint16_t port)
+      const char *server, const char *relay, uint16_t port)
 {
    if (!network_init())
       return false;
 
-   if (!init_tcp_socket(netplay, direct_host, server, port))
+   if (netplay->is_server && !string_is_empty(relay))
+   {
+      if (!init_relay_socket(netplay, relay, port))
+         return false;
+   }
+   else if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
+   if (netplay->is_server && netplay->udp_input)
+      init_udp_socket(netplay);
+
    if (netplay->is_server && netplay->nat_traversal)
       netplay_init_nat_traversal(netplay);
 
@@ -253,10 +485,20 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
       {
          if (connection->send_packet_buffer.data)
          {
-            if (!netplay_resize_socket_buffer(&connection->send_packet_buffer,
-                  packet_buffer_size) ||
-                !netplay_resize_socket_buffer(&connection->recv_packet_buffer,
-                  packet_buffer_size))
+            bool resized;
+#ifdef HAVE_NETPLAY_IO_THREAD
+            if (netplay->io_thread)
+               netplay_io_thread_lock(netplay->io_thread);
+#endif
+            resized = netplay_resize_socket_buffer(
+                  &connection->send_packet_buffer, packet_buffer_size) &&
+               netplay_resize_socket_buffer(
+                  &connection->recv_packet_buffer, packet_buffer_size);
+#ifdef HAVE_NETPLAY_IO_THREAD
+            if (netplay->io_thread)
+               netplay_io_thread_unlock(netplay->io_thread);
+#endif
+            if (!resized)
                return false;
          }
          else
@@ -299,7 +541,12 @@ bool netplay_init_serialization(netplay_t *netplay)
       }
    }
 
-   netplay->zbuffer_size = netplay->state_size * 2;
+   /* Room for a state that doesn't compress at all, which deflate grows by
+    * its block headers and zlib wrapper (deflateBound for stored blocks).
+    * Relative to a tiny state that's a lot. */
+   netplay->zbuffer_size = netplay->state_size
+      + ((netplay->state_size + 7) >> 3)
+      + ((netplay->state_size + 63) >> 6) + 11;
    netplay->zbuffer = (uint8_t *) calloc(netplay->zbuffer_size, 1);
    if (!netplay->zbuffer)
    {
@@ -410,6 +657,8 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp_input            : If true, offer the UDP input channel.
+ * @relay                : If set, host through this netplay relay.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -420,14 +669,16 @@ static bool netplay_init_buffers(netplay_t *netplay)
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks)
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp_input,
+   const char *relay, const char *nick, uint64_t quirks)
 {
    netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
    if (!netplay)
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
+   netplay->udp_input            = udp_input;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->connected_players    = 0;
@@ -460,7 +711,7 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
          ? nick : RARCH_DEFAULT_NICK,
          sizeof(netplay->nick));
 
-   if (!init_socket(netplay, direct_host, server, port))
+   if (!init_socket(netplay, direct_host, server, relay, port))
    {
       free(netplay);
       return NULL;
@@ -493,12 +744,27 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
          goto error;
    }
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+   netplay->io_thread = netplay_io_thread_new();
+   if (!netplay->io_thread)
+      RARCH_WARN("[netplay] Cannot start IO thread, doing socket IO inline.\n");
+   else if (!netplay->is_server &&
+         !netplay_io_thread_attach(netplay->io_thread, &netplay->connections[0]))
+   {
+      netplay_io_thread_free(netplay->io_thread);
+      netplay->io_thread = NULL;
+   }
+#endif
+
    return netplay;
 
 error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -516,9 +782,38 @@ void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   if (netplay->stats.rollbacks)
+      RARCH_LOG("[netplay] %u rollbacks (last %u, deepest %u frames), "
+            "%u frames replayed at %.1f frames/s, "
+            "%u serializations skipped. "
+            "Replayed frame: run %u us, serialize %u us.\n",
+            (unsigned)netplay->stats.rollbacks,
+            netplay->stats.rollback_depth_last,
+            netplay->stats.rollback_depth_max,
+            (unsigned)netplay->stats.replayed_frames,
+            netplay->stats.replay_time ?
+               netplay->stats.replayed_frames * 1000000.0 /
+               netplay->stats.replay_time : 0.0,
+            (unsigned)netplay->stats.skipped_serializations,
+            (unsigned)netplay->replay_run_time_avg,
+            (unsigned)netplay->replay_serialize_time_avg);
+
+   if (netplay->stats.udp_input_frames)
+      RARCH_LOG("[netplay] %u input frames arrived early over UDP.\n",
+            (unsigned)netplay->stats.udp_input_frames);
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+   /* Takes every connection back before we close them */
+   if (netplay->io_thread)
+      netplay_io_thread_free(netplay->io_thread);
+#endif
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -116,8 +116,13 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    RARCH_LOG("%s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false);
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+   if (netplay->io_thread)
+      netplay_io_thread_detach(netplay->io_thread, connection);
+#endif
    socket_close(connection->fd);
    connection->active = false;
+   connection->udp    = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
@@ -188,14 +193,14 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay,
-   struct netplay_connection *only, struct netplay_connection *except,
-   uint32_t frame, uint32_t player, uint32_t *state)
-{
-   uint32_t buffer[2 + WORDS_PER_FRAME];
-   size_t i;
+/* Largest encoding of one frame of input: every player's INPUT, plus either
+ * a NOINPUT or our own INPUT */
+#define CUR_INPUT_MAX_WORDS ((MAX_USERS + 1) * (2 + WORDS_PER_FRAME))
 
+/* Encode an INPUT command, returning the number of words used */
+static size_t encode_input_frame(uint32_t *buffer,
+   uint32_t frame, uint32_t player, const uint32_t *state)
+{
    buffer[0] = htonl(NETPLAY_CMD_INPUT);
    buffer[1] = htonl(WORDS_PER_FRAME * sizeof(uint32_t));
    buffer[2] = htonl(frame);
@@ -203,6 +208,18 @@ static bool send_input_frame(netplay_t *netplay,
    buffer[4] = htonl(state[0]);
    buffer[5] = htonl(state[1]);
    buffer[6] = htonl(state[2]);
+   return 2 + WORDS_PER_FRAME;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay,
+   struct netplay_connection *only, struct netplay_connection *except,
+   uint32_t frame, uint32_t player, uint32_t *state)
+{
+   uint32_t buffer[2 + WORDS_PER_FRAME];
+   size_t i;
+
+   encode_input_frame(buffer, frame, player, state);
 
    if (only)
    {
@@ -233,46 +250,153 @@ static bool send_input_frame(netplay_t *netplay,
    return true;
 }
 
+/* Append up to NETPLAY_UDP_REDUNDANCY frames of a player's real input, ending
+ * with the given frame, to a UDP datagram */
+static size_t netplay_udp_add_block(netplay_t *netplay, uint32_t *buffer,
+   size_t words, uint32_t player, uint32_t player_word,
+   size_t ptr, uint32_t frame)
+{
+   uint32_t count = 0;
+   uint32_t *block = buffer + words;
+
+   while (count < NETPLAY_UDP_REDUNDANCY && count <= frame)
+   {
+      struct delta_frame *dframe = &netplay->buffer[ptr];
+      if (!dframe->used || dframe->frame != frame - count ||
+            !dframe->have_real[player])
+         break;
+      count++;
+      ptr = PREV_PTR(ptr);
+   }
+
+   if (!count)
+      return words;
+
+   block[0] = htonl(player_word);
+   block[1] = htonl(frame - count + 1);
+   block[2] = htonl(count);
+   block += 3;
+
+   /* Oldest first */
+   while (count--)
+   {
+      struct delta_frame *dframe;
+      ptr    = NEXT_PTR(ptr);
+      dframe = &netplay->buffer[ptr];
+      block[0] = htonl(dframe->real_input_state[player][0]);
+      block[1] = htonl(dframe->real_input_state[player][1]);
+      block[2] = htonl(dframe->real_input_state[player][2]);
+      block += WORDS_PER_INPUT;
+   }
+
+   buffer[2] = htonl(ntohl(buffer[2]) + 1);
+   return block - buffer;
+}
+
 /**
- * netplay_send_cur_input
+ * netplay_udp_send_input
  *
- * Send the current input frame to a given connection.
- *
- * Returns true if successful, false otherwise.
+ * Send the recent input of every player this connection should hear about
+ * over UDP. This duplicates the TCP input stream, so losing a datagram only
+ * costs prediction.
  */
-bool netplay_send_cur_input(netplay_t *netplay,
+static void netplay_udp_send_input(netplay_t *netplay,
    struct netplay_connection *connection)
 {
-   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+   size_t words = 3;
    uint32_t player;
 
+   if (netplay->udp_fd < 0 || !connection->udp || !connection->udp_addr_known)
+      return;
+
+   buffer[0] = htonl(NETPLAY_UDP_MAGIC);
+   buffer[1] = htonl(connection->udp_token);
+   buffer[2] = 0;
+
    if (netplay->is_server)
    {
-      /* Send the other players' input data */
+      /* Everyone else's input, as far as we've reached it ourself */
       for (player = 0; player < MAX_USERS; player++)
       {
+         size_t ptr;
+         uint32_t frame;
+
+         if (!(netplay->connected_players & (1<<player)) ||
+               (netplay->connected_slaves & (1<<player)))
+            continue;
          if (connection->mode == NETPLAY_CONNECTION_PLAYING &&
                connection->player == player)
             continue;
+         if (!netplay->read_frame_count[player])
+            continue;
+
+         ptr   = PREV_PTR(netplay->read_ptr[player]);
+         frame = netplay->read_frame_count[player] - 1;
+         if (frame > netplay->self_frame_count)
+         {
+            ptr   = netplay->self_ptr;
+            frame = netplay->self_frame_count;
+         }
+         words = netplay_udp_add_block(netplay, buffer, words, player, player,
+               ptr, frame);
+      }
+   }
+
+   /* And our own. A client sends even an empty datagram, as that's how the
+    * server learns its address. */
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+      words = netplay_udp_add_block(netplay, buffer, words, netplay->self_player,
+            (netplay->is_server ? NETPLAY_CMD_INPUT_BIT_SERVER : 0) |
+               netplay->self_player,
+            netplay->self_ptr, netplay->self_frame_count);
+
+   if (netplay->is_server && words == 3)
+      return;
+
+   /* Best effort, any failure is covered by TCP */
+   sendto(netplay->udp_fd, (const char *) buffer, words * sizeof(uint32_t), 0,
+         (struct sockaddr *) &connection->udp_addr, connection->udp_addr_size);
+}
+
+/**
+ * netplay_encode_cur_input
+ *
+ * Encode the current input frame as it should be sent to a peer who is
+ * playing as skip_player, or to a peer who isn't playing if skip_player is
+ * MAX_USERS.
+ *
+ * Returns the number of words used.
+ */
+static size_t netplay_encode_cur_input(netplay_t *netplay,
+   uint32_t skip_player, uint32_t *buffer)
+{
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   size_t words = 0;
+   uint32_t player;
+
+   if (netplay->is_server)
+   {
+      /* Send the other players' input data */
+      for (player = 0; player < MAX_USERS; player++)
+      {
+         if (player == skip_player)
+            continue;
          if ((netplay->connected_players & (1<<player)))
          {
             if (dframe->have_real[player])
-            {
-               if (!send_input_frame(netplay, connection, NULL,
-                        netplay->self_frame_count, player,
-                        dframe->real_input_state[player]))
-                  return false;
-            }
+               words += encode_input_frame(buffer + words,
+                     netplay->self_frame_count, player,
+                     dframe->real_input_state[player]);
          }
       }
 
       /* If we're not playing, send a NOINPUT */
       if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
       {
-         uint32_t payload = htonl(netplay->self_frame_count);
-         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
-               &payload, sizeof(payload)))
-            return false;
+         buffer[words++] = htonl(NETPLAY_CMD_NOINPUT);
+         buffer[words++] = htonl(sizeof(uint32_t));
+         buffer[words++] = htonl(netplay->self_frame_count);
       }
 
    }
@@ -281,20 +405,89 @@ bool netplay_send_cur_input(netplay_t *netplay,
    if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING ||
        netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
    {
-      if (!send_input_frame(netplay, connection, NULL,
+      words += encode_input_frame(buffer + words,
             netplay->self_frame_count,
             (netplay->is_server ? NETPLAY_CMD_INPUT_BIT_SERVER : 0) | netplay->self_player,
-            dframe->self_state))
-         return false;
+            dframe->self_state);
+   }
+
+   return words;
+}
+
+/* Send an already encoded input frame to a connection */
+static bool netplay_send_encoded_input(netplay_t *netplay,
+   struct netplay_connection *connection, const uint32_t *buffer,
+   size_t words)
+{
+   if (words && !netplay_send(&connection->send_packet_buffer, connection->fd,
+            buffer, words * sizeof(uint32_t)))
+   {
+      netplay_hangup(netplay, connection);
+      return false;
    }
 
    if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
          false))
       return false;
 
+   netplay_udp_send_input(netplay, connection);
+
    return true;
 }
 
+/**
+ * netplay_send_cur_input
+ *
+ * Send the current input frame to a given connection.
+ *
+ * Returns true if successful, false otherwise.
+ */
+bool netplay_send_cur_input(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t buffer[CUR_INPUT_MAX_WORDS];
+   size_t words = netplay_encode_cur_input(netplay,
+         connection->mode == NETPLAY_CONNECTION_PLAYING ?
+            connection->player : MAX_USERS,
+         buffer);
+
+   return netplay_send_encoded_input(netplay, connection, buffer, words);
+}
+
+/**
+ * netplay_send_cur_input_all
+ *
+ * Send the current input frame to every connected peer. Everyone who isn't
+ * playing receives the same data, so it's encoded once and fanned out.
+ */
+void netplay_send_cur_input_all(netplay_t *netplay)
+{
+   uint32_t shared[CUR_INPUT_MAX_WORDS];
+   size_t shared_words = 0;
+   bool shared_encoded = false;
+   size_t i;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active || connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      if (connection->mode == NETPLAY_CONNECTION_PLAYING)
+      {
+         netplay_send_cur_input(netplay, connection);
+         continue;
+      }
+
+      if (!shared_encoded)
+      {
+         shared_words   = netplay_encode_cur_input(netplay, MAX_USERS, shared);
+         shared_encoded = true;
+      }
+      netplay_send_encoded_input(netplay, connection, shared, shared_words);
+   }
+}
+
 /**
  * netplay_send_raw_cmd
  *
@@ -469,6 +662,175 @@ recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), \
 if (recvd >= 0 && recvd < (ssize_t) (sz)) goto shrt; \
 else if (recvd < 0)
 
+/**
+ * netplay_udp_init_client
+ *
+ * The server offered us its UDP input channel. It listens on the same port as
+ * TCP, so open a socket aimed at our TCP peer.
+ */
+static void netplay_udp_init_client(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token)
+{
+   connection->udp_addr_size = sizeof(connection->udp_addr);
+   if (getpeername(connection->fd, (struct sockaddr *) &connection->udp_addr,
+            &connection->udp_addr_size) < 0)
+      goto error;
+
+   if (netplay->udp_fd < 0)
+   {
+      int fd = socket(connection->udp_addr.ss_family, SOCK_DGRAM, 0);
+      if (fd < 0)
+         goto error;
+      if (!socket_nonblock(fd))
+      {
+         socket_close(fd);
+         goto error;
+      }
+      netplay->udp_fd = fd;
+   }
+
+   connection->udp_token      = token;
+   connection->udp_addr_known = true;
+   connection->udp            = true;
+   RARCH_LOG("[netplay] Sending input over UDP.\n");
+   return;
+
+error:
+   RARCH_WARN("Failed to open the netplay UDP input socket, using TCP only.\n");
+}
+
+/**
+ * netplay_udp_read_input
+ *
+ * Take a frame of input from a UDP datagram if it's the next one we need from
+ * that player. Returns false if it isn't, so the rest of the block is
+ * skipped.
+ */
+static bool netplay_udp_read_input(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t player, uint32_t frame,
+   const uint32_t *state)
+{
+   struct delta_frame *dframe;
+   unsigned i;
+
+   if (frame != netplay->read_frame_count[player])
+      return frame < netplay->read_frame_count[player];
+
+   dframe = &netplay->buffer[netplay->read_ptr[player]];
+   if (!netplay_delta_frame_ready(netplay, dframe, frame))
+      return false;
+
+   for (i = 0; i < WORDS_PER_INPUT; i++)
+      dframe->real_input_state[player][i] = ntohl(state[i]);
+   dframe->have_real[player] = true;
+
+   netplay->read_ptr[player] = NEXT_PTR(netplay->read_ptr[player]);
+   netplay->read_frame_count[player]++;
+   netplay->stats.udp_input_frames++;
+
+   /* Forward it on over TCP, as we would have when it arrived there. The
+    * client only advances its server pointer from TCP, which keeps mode
+    * changes and the like in order. */
+   if (netplay->is_server && dframe->frame <= netplay->self_frame_count)
+      send_input_frame(netplay, NULL, connection, frame,
+         player, dframe->real_input_state[player]);
+
+   return true;
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Read every pending UDP input datagram. Anything unexpected is silently
+ * dropped, as TCP will deliver it anyway.
+ */
+static void netplay_udp_poll(netplay_t *netplay, bool *had_input)
+{
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+   struct sockaddr_storage addr;
+   socklen_t addr_size;
+   ssize_t recvd;
+
+   for (;;)
+   {
+      struct netplay_connection *connection = NULL;
+      uint32_t token, blocks;
+      size_t words, pos = 3;
+      size_t i;
+
+      addr_size = sizeof(addr);
+      recvd     = recvfrom(netplay->udp_fd, (char *) buffer, sizeof(buffer), 0,
+            (struct sockaddr *) &addr, &addr_size);
+      if (recvd <= 0)
+         break;
+
+      words = recvd / sizeof(uint32_t);
+      if (words < 3 || ntohl(buffer[0]) != NETPLAY_UDP_MAGIC)
+         continue;
+
+      token  = ntohl(buffer[1]);
+      blocks = ntohl(buffer[2]);
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *sc = &netplay->connections[i];
+         if (sc->active && sc->udp && sc->udp_token == token &&
+               sc->mode >= NETPLAY_CONNECTION_CONNECTED)
+         {
+            connection = sc;
+            break;
+         }
+      }
+      if (!connection)
+         continue;
+
+      /* The server replies wherever the client's datagrams come from */
+      if (netplay->is_server)
+      {
+         memcpy(&connection->udp_addr, &addr, sizeof(addr));
+         connection->udp_addr_size  = addr_size;
+         connection->udp_addr_known = true;
+      }
+
+      while (blocks-- && pos + 3 <= words)
+      {
+         uint32_t player_word = ntohl(buffer[pos]);
+         uint32_t frame       = ntohl(buffer[pos + 1]);
+         uint32_t count       = ntohl(buffer[pos + 2]);
+         uint32_t player      = player_word & ~NETPLAY_CMD_INPUT_BIT_SERVER;
+         const uint32_t *state = buffer + pos + 3;
+         bool valid;
+
+         pos += 3;
+         if (count > NETPLAY_UDP_REDUNDANCY ||
+               pos + count * WORDS_PER_INPUT > words)
+            break;
+         pos += count * WORDS_PER_INPUT;
+
+         if (netplay->is_server)
+            valid = connection->mode == NETPLAY_CONNECTION_PLAYING &&
+               player == connection->player;
+         else
+            valid = !(netplay->self_mode == NETPLAY_CONNECTION_PLAYING &&
+               player == netplay->self_player);
+         if (!valid || player >= MAX_USERS ||
+               !(netplay->connected_players & (1<<player)) ||
+               (netplay->connected_slaves & (1<<player)))
+            continue;
+
+         for (; count; count--, frame++, state += WORDS_PER_INPUT)
+         {
+            uint32_t read_frame_count = netplay->read_frame_count[player];
+            if (!netplay_udp_read_input(netplay, connection, player, frame,
+                     state))
+               break;
+            if (netplay->read_frame_count[player] != read_frame_count)
+               *had_input = true;
+         }
+      }
+   }
+}
+
 static bool netplay_get_cmd(netplay_t *netplay,
    struct netplay_connection *connection, bool *had_input)
 {
@@ -553,7 +915,16 @@ static bool netplay_get_cmd(netplay_t *netplay,
             {
                if (buffer[0] < netplay->read_frame_count[player])
                {
-                  /* We already had this, so ignore the new transmission */
+                  /* We already had this (possibly over UDP), so ignore the
+                   * new transmission. The server's own input still marks
+                   * the end of its data for the frame. */
+                  if (!netplay->is_server &&
+                      (buffer[1] & NETPLAY_CMD_INPUT_BIT_SERVER) &&
+                      buffer[0] == netplay->server_frame_count)
+                  {
+                     netplay->server_ptr = NEXT_PTR(netplay->server_ptr);
+                     netplay->server_frame_count++;
+                  }
                   break;
                }
                else if (buffer[0] > netplay->read_frame_count[player])
@@ -606,6 +977,32 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP_INFO:
+         {
+            uint32_t token;
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP_INFO from a client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(token))
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP_INFO received an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&token, sizeof(token))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_UDP_INFO payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            netplay_udp_init_client(netplay, connection, ntohl(token));
+            break;
+         }
+
       case NETPLAY_CMD_NOINPUT:
          {
             uint32_t frame;
@@ -1121,6 +1518,17 @@ static bool netplay_get_cmd(netplay_t *netplay,
             buffer[0] = ntohl(buffer[0]);
             buffer[1] = ntohl(buffer[1]);
 
+            /* Learn how often the server checks, so replays know which
+             * frames to keep the state of */
+            if (buffer[0] > netplay->crc_last_frame &&
+                netplay->crc_last_frame)
+            {
+               uint32_t interval = buffer[0] - netplay->crc_last_frame;
+               if (!netplay->crc_interval || interval < netplay->crc_interval)
+                  netplay->crc_interval = interval;
+            }
+            netplay->crc_last_frame = buffer[0];
+
             /* Received a CRC for some frame. If we still have it, check if it
              * matched. This approach could be improved with some quick modular
              * arithmetic. */
@@ -1467,22 +1875,74 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
    if (max_fd == 0)
       return 0;
 
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
+
    netplay->timeout_cnt = 0;
 
    do
    { 
+      fd_set ready;
+      struct timeval ready_tv = {0};
+      bool ready_known;
+      bool selecting = false;
+#ifdef HAVE_NETPLAY_IO_THREAD
+      unsigned activity = 0;
+
+      /* Read before looking at the buffers, so nothing that arrives after
+       * we've looked is missed when we wait */
+      if (netplay->io_thread)
+         activity = netplay_io_thread_activity(netplay->io_thread);
+#endif
+
       had_input = false;
 
       netplay->timeout_cnt++;
 
+      /* Find every socket with something to read in one call, rather than
+       * trying a receive on each connection in turn. Those the IO thread
+       * reads are already in their buffers. */
+      FD_ZERO(&ready);
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (connection->active && !connection->recv_packet_buffer.io)
+         {
+            FD_SET(connection->fd, &ready);
+            selecting = true;
+         }
+      }
+      if (netplay->udp_fd >= 0)
+      {
+         FD_SET(netplay->udp_fd, &ready);
+         selecting = true;
+      }
+      ready_known = selecting &&
+         socket_select(max_fd, &ready, NULL, NULL, &ready_tv) >= 0;
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection->active && !netplay_get_cmd(netplay, connection, &had_input))
+         if (!connection->active)
+            continue;
+         if (connection->recv_packet_buffer.io)
+         {
+            if (!netplay_recv_pending(&connection->recv_packet_buffer) &&
+                  !netplay_recv_failed(&connection->recv_packet_buffer))
+               continue;
+         }
+         else if (ready_known && !FD_ISSET(connection->fd, &ready) &&
+               !netplay_recv_pending(&connection->recv_packet_buffer))
+            continue;
+         if (!netplay_get_cmd(netplay, connection, &had_input))
             netplay_hangup(netplay, connection);
       }
 
+      if (netplay->udp_fd >= 0 &&
+            (!ready_known || FD_ISSET(netplay->udp_fd, &ready)))
+         netplay_udp_poll(netplay, &had_input);
+
       if (block)
       {
          netplay_update_unread_ptr(netplay);
@@ -1494,20 +1954,31 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
          /* If we're supposed to block but we didn't have enough input, wait for it */
          if (!had_input)
          {
-            fd_set fds;
-            struct timeval tv = {0};
-            tv.tv_usec = RETRY_MS * 1000;
-
-            FD_ZERO(&fds);
-            for (i = 0; i < netplay->connections_size; i++)
+#ifdef HAVE_NETPLAY_IO_THREAD
+            /* Every connection is the IO thread's, so wait for it. Input
+             * sent over UDP also comes over TCP, so this can't miss any. */
+            if (netplay->io_thread)
+               netplay_io_thread_wait(netplay->io_thread, activity, RETRY_MS);
+            else
+#endif
             {
-               struct netplay_connection *connection = &netplay->connections[i];
-               if (connection->active)
-                  FD_SET(connection->fd, &fds);
-            }
+               fd_set fds;
+               struct timeval tv = {0};
+               tv.tv_usec = RETRY_MS * 1000;
 
-            if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
-               return -1;
+               FD_ZERO(&fds);
+               for (i = 0; i < netplay->connections_size; i++)
+               {
+                  struct netplay_connection *connection = &netplay->connections[i];
+                  if (connection->active)
+                     FD_SET(connection->fd, &fds);
+               }
+               if (netplay->udp_fd >= 0)
+                  FD_SET(netplay->udp_fd, &fds);
+
+               if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
+                  return -1;
+            }
 
             RARCH_LOG("Network is stalling at frame %u, count %u of %d ...\n",
                   netplay->run_frame_count, netplay->timeout_cnt, MAX_RETRIES);
@@ -0,0 +1,486 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netplay_private.h"
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define IO_THREAD_MAX_EVENTS 64
+
+/* epoll data for the wakeup eventfd; connections count up from 1 */
+#define IO_THREAD_WAKE_ID 0
+
+struct netplay_io_thread
+{
+   sthread_t *thread;
+
+   int epoll_fd;
+   int wake_fd;
+
+   /* Held by the thread while it services connections, and by the main
+    * thread while it adds, removes, moves or resizes them */
+   slock_t *lock;
+   struct netplay_io_conn **conns;
+   size_t conns_count, conns_size;
+   uint32_t next_id;
+
+   /* Guards the fields below */
+   slock_t *signal_lock;
+   scond_t *signal_cond;
+   unsigned activity;
+   bool wake_pending;
+   bool quit;
+};
+
+static void netplay_io_thread_epoll(struct netplay_io_thread *thread,
+      struct netplay_io_conn *io, uint32_t events)
+{
+   struct epoll_event ev;
+   int op = EPOLL_CTL_MOD;
+
+   if (events == io->events)
+      return;
+
+   /* Idle sockets leave the set entirely, as a hangup would otherwise be
+    * reported over and over */
+   if (events == 0)
+      op = EPOLL_CTL_DEL;
+   else if (io->events == 0)
+      op = EPOLL_CTL_ADD;
+
+   ev.events   = events;
+   ev.data.u64 = io->id;
+   if (epoll_ctl(thread->epoll_fd, op, io->fd, &ev) < 0 && op != EPOLL_CTL_DEL)
+   {
+      slock_lock(io->lock);
+      io->error = true;
+      scond_broadcast(io->cond);
+      slock_unlock(io->lock);
+      events = 0;
+   }
+
+   io->events = events;
+}
+
+/* Do whatever reading and writing a connection can take. Returns true if
+ * the main thread has something new to look at. */
+static bool netplay_io_thread_service(struct netplay_io_thread *thread,
+      struct netplay_io_conn *io)
+{
+   uint32_t events = 0;
+   bool activity   = false;
+   bool changed    = false;
+
+   slock_lock(io->lock);
+
+   if (!io->error && (io->revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+         netplay_socket_buffer_remaining(io->recv) > 0)
+   {
+      ssize_t recvd = netplay_socket_buffer_fill(io->recv, io->fd);
+      if (recvd < 0)
+         io->error = true;
+      else if (recvd > 0)
+         activity = true;
+   }
+
+   /* The socket is usually writable, so don't wait for epoll to say so */
+   if (!io->error && netplay_socket_buffer_used(io->send) > 0)
+   {
+      size_t used = netplay_socket_buffer_used(io->send);
+      if (!netplay_socket_buffer_drain(io->send, io->fd))
+         io->error = true;
+      else if (netplay_socket_buffer_used(io->send) != used)
+         changed = true;
+   }
+
+   if (io->error)
+      activity = true;
+   else
+   {
+      if (netplay_socket_buffer_remaining(io->recv) > 0)
+         events |= EPOLLIN;
+      if (netplay_socket_buffer_used(io->send) > 0)
+         events |= EPOLLOUT;
+   }
+
+   io->revents = 0;
+   if (activity || changed)
+      scond_broadcast(io->cond);
+
+   slock_unlock(io->lock);
+
+   netplay_io_thread_epoll(thread, io, events);
+
+   return activity;
+}
+
+static void netplay_io_thread_loop(void *data)
+{
+   struct netplay_io_thread *thread = (struct netplay_io_thread*)data;
+   struct epoll_event events[IO_THREAD_MAX_EVENTS];
+   size_t j;
+
+   for (;;)
+   {
+      int ready, i;
+      bool quit, activity = false;
+
+      ready = epoll_wait(thread->epoll_fd, events, IO_THREAD_MAX_EVENTS, -1);
+      if (ready < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         RARCH_ERR("[netplay] IO thread cannot wait for sockets.\n");
+         break;
+      }
+
+      for (i = 0; i < ready; i++)
+      {
+         if (events[i].data.u64 == IO_THREAD_WAKE_ID)
+         {
+            uint64_t count;
+            if (read(thread->wake_fd, &count, sizeof(count)) < 0) { }
+         }
+      }
+
+      /* Only once the wakeup is consumed and before looking at any buffer,
+       * so that data queued after this always gets another wakeup */
+      slock_lock(thread->signal_lock);
+      quit                 = thread->quit;
+      thread->wake_pending = false;
+      slock_unlock(thread->signal_lock);
+
+      if (quit)
+         break;
+
+      slock_lock(thread->lock);
+
+      /* The connection may have been detached since */
+      for (i = 0; i < ready; i++)
+      {
+         uint64_t id = events[i].data.u64;
+
+         for (j = 0; id != IO_THREAD_WAKE_ID && j < thread->conns_count; j++)
+         {
+            if (thread->conns[j]->id == id)
+            {
+               thread->conns[j]->revents = events[i].events;
+               break;
+            }
+         }
+      }
+
+      for (j = 0; j < thread->conns_count; j++)
+         if (netplay_io_thread_service(thread, thread->conns[j]))
+            activity = true;
+
+      slock_unlock(thread->lock);
+
+      if (activity)
+      {
+         slock_lock(thread->signal_lock);
+         thread->activity++;
+         scond_broadcast(thread->signal_cond);
+         slock_unlock(thread->signal_lock);
+      }
+   }
+
+   /* Whatever stopped us, nobody should wait on us any longer */
+   slock_lock(thread->lock);
+   for (j = 0; j < thread->conns_count; j++)
+   {
+      struct netplay_io_conn *io = thread->conns[j];
+      slock_lock(io->lock);
+      io->error = true;
+      scond_broadcast(io->cond);
+      slock_unlock(io->lock);
+   }
+   slock_unlock(thread->lock);
+}
+
+/**
+ * netplay_io_thread_new
+ *
+ * Start a thread to do the socket IO of our connections.
+ */
+struct netplay_io_thread *netplay_io_thread_new(void)
+{
+   struct epoll_event ev;
+   struct netplay_io_thread *thread = (struct netplay_io_thread*)
+      calloc(1, sizeof(*thread));
+
+   if (!thread)
+      return NULL;
+
+   thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   thread->wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   thread->lock        = slock_new();
+   thread->signal_lock = slock_new();
+   thread->signal_cond = scond_new();
+
+   if (thread->epoll_fd < 0 || thread->wake_fd < 0 || !thread->lock ||
+         !thread->signal_lock || !thread->signal_cond)
+      goto error;
+
+   ev.events   = EPOLLIN;
+   ev.data.u64 = IO_THREAD_WAKE_ID;
+   if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, thread->wake_fd, &ev) < 0)
+      goto error;
+
+   thread->thread = sthread_create(netplay_io_thread_loop, thread);
+   if (!thread->thread)
+      goto error;
+
+   return thread;
+
+error:
+   if (thread->epoll_fd >= 0)
+      close(thread->epoll_fd);
+   if (thread->wake_fd >= 0)
+      close(thread->wake_fd);
+   if (thread->lock)
+      slock_free(thread->lock);
+   if (thread->signal_lock)
+      slock_free(thread->signal_lock);
+   if (thread->signal_cond)
+      scond_free(thread->signal_cond);
+   free(thread);
+   return NULL;
+}
+
+static void netplay_io_conn_free(struct netplay_io_conn *io)
+{
+   io->send->io = io->recv->io = NULL;
+   slock_free(io->lock);
+   scond_free(io->cond);
+   free(io);
+}
+
+/**
+ * netplay_io_thread_free
+ *
+ * Stop the IO thread, handing every connection back to the main thread.
+ */
+void netplay_io_thread_free(struct netplay_io_thread *thread)
+{
+   size_t i;
+
+   slock_lock(thread->signal_lock);
+   thread->quit = true;
+   slock_unlock(thread->signal_lock);
+   netplay_io_thread_wake(thread);
+   sthread_join(thread->thread);
+
+   for (i = 0; i < thread->conns_count; i++)
+      netplay_io_conn_free(thread->conns[i]);
+   free(thread->conns);
+
+   close(thread->epoll_fd);
+   close(thread->wake_fd);
+   slock_free(thread->lock);
+   slock_free(thread->signal_lock);
+   scond_free(thread->signal_cond);
+   free(thread);
+}
+
+/**
+ * netplay_io_thread_attach
+ *
+ * Hand a connection's socket to the IO thread. Its socket buffers must be
+ * initialized.
+ */
+bool netplay_io_thread_attach(struct netplay_io_thread *thread,
+   struct netplay_connection *connection)
+{
+   struct netplay_io_conn *io = (struct netplay_io_conn*)
+      calloc(1, sizeof(*io));
+
+   if (!io)
+      return false;
+
+   io->lock = slock_new();
+   io->cond = scond_new();
+   if (!io->lock || !io->cond)
+      goto error;
+
+   io->thread = thread;
+   io->fd     = connection->fd;
+
+   slock_lock(thread->lock);
+
+   if (thread->conns_count == thread->conns_size)
+   {
+      size_t new_size = thread->conns_size ? thread->conns_size * 2 : 4;
+      struct netplay_io_conn **new_conns = (struct netplay_io_conn**)
+         realloc(thread->conns, new_size * sizeof(*new_conns));
+      if (!new_conns)
+      {
+         slock_unlock(thread->lock);
+         goto error;
+      }
+      thread->conns      = new_conns;
+      thread->conns_size = new_size;
+   }
+
+   io->id = ++thread->next_id;
+   if (io->id == IO_THREAD_WAKE_ID)
+      io->id = ++thread->next_id;
+   thread->conns[thread->conns_count++] = io;
+
+   connection->send_packet_buffer.io = connection->recv_packet_buffer.io = io;
+   netplay_io_thread_moved(connection, 1);
+
+   slock_unlock(thread->lock);
+
+   /* Anything already queued goes out now, and we start listening */
+   netplay_io_thread_wake(thread);
+
+   return true;
+
+error:
+   if (io->lock)
+      slock_free(io->lock);
+   if (io->cond)
+      scond_free(io->cond);
+   free(io);
+   return false;
+}
+
+/**
+ * netplay_io_thread_detach
+ *
+ * Take a connection back from the IO thread. Must be done before closing its
+ * socket or freeing its socket buffers.
+ */
+void netplay_io_thread_detach(struct netplay_io_thread *thread,
+   struct netplay_connection *connection)
+{
+   size_t i;
+   struct netplay_io_conn *io = connection->send_packet_buffer.io;
+
+   if (!io)
+      return;
+
+   slock_lock(thread->lock);
+   for (i = 0; i < thread->conns_count; i++)
+   {
+      if (thread->conns[i] == io)
+      {
+         thread->conns[i] = thread->conns[--thread->conns_count];
+         break;
+      }
+   }
+   netplay_io_thread_epoll(thread, io, 0);
+   slock_unlock(thread->lock);
+
+   netplay_io_conn_free(io);
+}
+
+/**
+ * netplay_io_thread_lock
+ *
+ * Keep the IO thread away from every socket buffer, so that they can be
+ * moved or resized.
+ */
+void netplay_io_thread_lock(struct netplay_io_thread *thread)
+{
+   slock_lock(thread->lock);
+}
+
+/**
+ * netplay_io_thread_unlock
+ */
+void netplay_io_thread_unlock(struct netplay_io_thread *thread)
+{
+   slock_unlock(thread->lock);
+}
+
+/**
+ * netplay_io_thread_moved
+ *
+ * Tell the IO thread where the socket buffers of these connections now live.
+ * Must be called with the IO thread locked.
+ */
+void netplay_io_thread_moved(struct netplay_connection *connections,
+   size_t count)
+{
+   size_t i;
+
+   for (i = 0; i < count; i++)
+   {
+      struct netplay_io_conn *io = connections[i].send_packet_buffer.io;
+
+      if (!io)
+         continue;
+
+      io->send = &connections[i].send_packet_buffer;
+      io->recv = &connections[i].recv_packet_buffer;
+   }
+}
+
+/**
+ * netplay_io_thread_wake
+ *
+ * Have the IO thread look at every connection again.
+ */
+void netplay_io_thread_wake(struct netplay_io_thread *thread)
+{
+   slock_lock(thread->signal_lock);
+   if (!thread->wake_pending)
+   {
+      uint64_t one = 1;
+      thread->wake_pending = true;
+      if (write(thread->wake_fd, &one, sizeof(one)) < 0) { }
+   }
+   slock_unlock(thread->signal_lock);
+}
+
+/**
+ * netplay_io_thread_activity
+ *
+ * A counter which moves whenever the IO thread receives data or sees a socket
+ * fail.
+ */
+unsigned netplay_io_thread_activity(struct netplay_io_thread *thread)
+{
+   unsigned activity;
+   slock_lock(thread->signal_lock);
+   activity = thread->activity;
+   slock_unlock(thread->signal_lock);
+   return activity;
+}
+
+/**
+ * netplay_io_thread_wait
+ *
+ * Wait up to timeout_ms for the activity counter to move on from seen.
+ */
+void netplay_io_thread_wait(struct netplay_io_thread *thread, unsigned seen,
+   unsigned timeout_ms)
+{
+   slock_lock(thread->signal_lock);
+   if (thread->activity == seen)
+      scond_wait_timeout(thread->signal_cond, thread->signal_lock,
+            (int64_t)timeout_ms * 1000);
+   slock_unlock(thread->signal_lock);
+}
+
+#endif
@@ -25,6 +25,15 @@
 #include <features/features_cpu.h>
 #include <streams/trans_stream.h>
 
+/* Socket reads and writes go through a thread waiting on epoll */
+#if defined(HAVE_THREADS) && defined(__linux__)
+#define HAVE_NETPLAY_IO_THREAD
+#endif
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+#include <rthreads/rthreads.h>
+#endif
+
 #include "../../msg_hash.h"
 #include "../../verbosity.h"
 
@@ -48,6 +57,10 @@
 
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
+
+/* Running average over roughly the last 8 samples */
+#define NETPLAY_TIME_AVG(avg, sample) \
+   ((avg) ? ((avg) * 7 + (sample)) / 8 : (sample))
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -89,6 +102,30 @@
 #define NETPLAY_COMPRESSION_SUPPORTED 0
 #endif
 
+/* Capabilities advertised alongside the compression flags in the header.
+ * Older implementations mask these off. */
+#define NETPLAY_CAP_UDP_INPUT (1U<<16)
+
+/* UDP input channel. Every datagram carries the last NETPLAY_UDP_REDUNDANCY
+ * frames of each player's input, so a lost datagram is covered by the next
+ * one. TCP remains authoritative; UDP only makes real input available early. */
+#define NETPLAY_UDP_MAGIC      0x52415544 /* RAUD */
+#define NETPLAY_UDP_REDUNDANCY 6
+#define NETPLAY_UDP_MAX_WORDS  (3 + MAX_USERS * \
+   (3 + NETPLAY_UDP_REDUNDANCY * WORDS_PER_INPUT))
+
+/* Relay (tools/ranetrelay) protocol. A host opens a control connection with
+ * HOST and is told the port of its room. For every client that connects to
+ * the room, the relay sends CLIENT with an id and a random token on the control
+ * connection, and the host opens a new connection which it starts with LINK,
+ * the id and the token. The relay then splices the two. All words are in
+ * network byte order. */
+#define NETPLAY_RELAY_MAGIC      0x5241524C /* RARL */
+#define NETPLAY_RELAY_CMD_HOST   1 /* host -> relay: magic, HOST */
+#define NETPLAY_RELAY_CMD_ROOM   2 /* relay -> host: magic, ROOM, port */
+#define NETPLAY_RELAY_CMD_CLIENT 3 /* relay -> host: CLIENT, id, token */
+#define NETPLAY_RELAY_CMD_LINK   4 /* host -> relay: magic, LINK, id, token */
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -134,6 +171,9 @@ enum netplay_cmd
    /* Report player mode refused */
    NETPLAY_CMD_MODE_REFUSED   = 0x0027,
 
+   /* Offer the UDP input channel (server only, only if advertised) */
+   NETPLAY_CMD_UDP_INFO       = 0x0028,
+
    /* Loading and synchronization */
 
    /* Send the CRC hash of a frame's state */
@@ -275,8 +315,35 @@ struct socket_buffer
    size_t bufsz;
    size_t start, end;
    size_t read;
+
+   /* Set while the IO thread services the socket behind this buffer */
+   struct netplay_io_conn *io;
 };
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+/* A connection whose socket is read and written by the IO thread. The main
+ * thread only copies into and out of the connection's socket buffers. */
+struct netplay_io_conn
+{
+   /* Guards both socket buffers and the fields below */
+   slock_t *lock;
+
+   /* Signalled when data arrives, the send buffer drains or the socket fails */
+   scond_t *cond;
+
+   struct netplay_io_thread *thread;
+   struct socket_buffer *send, *recv;
+   int fd;
+
+   /* Has the socket failed or been closed by the peer? */
+   bool error;
+
+   /* IO thread only: our epoll registration and the last events seen */
+   uint32_t id;
+   uint32_t events, revents;
+};
+#endif
+
 /* Each connection gets a connection struct */
 struct netplay_connection
 {
@@ -315,6 +382,17 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* Did this peer advertise the UDP input channel? */
+   bool udp_supported;
+
+   /* Is the UDP input channel up? Datagrams are only accepted with the
+    * matching token, and the server learns the peer's address from them. */
+   bool udp;
+   uint32_t udp_token;
+   bool udp_addr_known;
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_size;
+
    /* Is this player paused? */
    bool paused;
 
@@ -380,6 +458,21 @@ struct netplay
    /* TCP port (only set if serving) */
    uint16_t tcp_port;
 
+   /* Thread doing the reads and writes on our connections, if any */
+   struct netplay_io_thread *io_thread;
+
+   /* UDP input channel: is it enabled, and our socket if it's open */
+   bool udp_input;
+   int udp_fd;
+
+   /* Are we hosting through a relay? If so, listen_fd is our control
+    * connection to it, and new connections are opened to relay_addr. Our
+    * room's port is 0 until the relay has told us it. */
+   bool relay, relay_connected;
+   uint16_t relay_port;
+   struct sockaddr_storage relay_addr;
+   socklen_t relay_addr_size;
+
    /* NAT traversal info (if NAT traversal is used and serving) */
    bool nat_traversal, nat_traversal_task_oustanding;
    struct natt_status nat_traversal_state;
@@ -486,6 +579,17 @@ struct netplay
    int frame_run_time_ptr;
    retro_time_t frame_run_time_sum, frame_run_time_avg;
 
+   /* Replays only serialize frames that may become rollback targets, so the
+    * cost of running and of serializing a frame are tracked separately */
+   retro_time_t replay_run_time_avg, replay_serialize_time_avg;
+
+   /* Frames between two CRCs from the server, as seen by a client, so
+    * replays know which confirmed frames may still be checked */
+   uint32_t crc_interval;
+   uint32_t crc_last_frame;
+
+   netplay_stats_t stats;
+
    /* Latency frames and limits */
    unsigned input_latency_frames;
 
@@ -576,6 +680,13 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
  */
 void netplay_recv_reset(struct socket_buffer *sbuf);
 
+/**
+ * netplay_recv_pending
+ *
+ * Is there received data in our recv buffer which hasn't been read yet?
+ */
+bool netplay_recv_pending(struct socket_buffer *sbuf);
+
 /**
  * netplay_recv_flush
  *
@@ -584,6 +695,129 @@ void netplay_recv_reset(struct socket_buffer *sbuf);
  */
 void netplay_recv_flush(struct socket_buffer *sbuf);
 
+/**
+ * netplay_recv_failed
+ *
+ * Has the IO thread seen this buffer's socket fail?
+ */
+bool netplay_recv_failed(struct socket_buffer *sbuf);
+
+/**
+ * netplay_socket_buffer_fill
+ *
+ * Receive whatever the socket has into the buffer, without blocking.
+ *
+ * Returns number of bytes received, or -1 on error.
+ */
+ssize_t netplay_socket_buffer_fill(struct socket_buffer *sbuf, int sockfd);
+
+/**
+ * netplay_socket_buffer_drain
+ *
+ * Send as much of the buffer as the socket takes, without blocking.
+ *
+ * Returns false only on socket failures, true otherwise.
+ */
+bool netplay_socket_buffer_drain(struct socket_buffer *sbuf, int sockfd);
+
+/**
+ * netplay_socket_buffer_used
+ *
+ * How many bytes are waiting in the buffer?
+ */
+size_t netplay_socket_buffer_used(struct socket_buffer *sbuf);
+
+/**
+ * netplay_socket_buffer_remaining
+ *
+ * How many more bytes fit in the buffer?
+ */
+size_t netplay_socket_buffer_remaining(struct socket_buffer *sbuf);
+
+
+/***************************************************************
+ * NETPLAY-IO-THREAD.C
+ **************************************************************/
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+/**
+ * netplay_io_thread_new
+ *
+ * Start a thread to do the socket IO of our connections.
+ */
+struct netplay_io_thread *netplay_io_thread_new(void);
+
+/**
+ * netplay_io_thread_free
+ *
+ * Stop the IO thread, handing every connection back to the main thread.
+ */
+void netplay_io_thread_free(struct netplay_io_thread *thread);
+
+/**
+ * netplay_io_thread_attach
+ *
+ * Hand a connection's socket to the IO thread. Its socket buffers must be
+ * initialized.
+ */
+bool netplay_io_thread_attach(struct netplay_io_thread *thread,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_io_thread_detach
+ *
+ * Take a connection back from the IO thread. Must be done before closing its
+ * socket or freeing its socket buffers.
+ */
+void netplay_io_thread_detach(struct netplay_io_thread *thread,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_io_thread_lock
+ *
+ * Keep the IO thread away from every socket buffer, so that they can be
+ * moved or resized.
+ */
+void netplay_io_thread_lock(struct netplay_io_thread *thread);
+
+/**
+ * netplay_io_thread_unlock
+ */
+void netplay_io_thread_unlock(struct netplay_io_thread *thread);
+
+/**
+ * netplay_io_thread_moved
+ *
+ * Tell the IO thread where the socket buffers of these connections now live.
+ * Must be called with the IO thread locked.
+ */
+void netplay_io_thread_moved(struct netplay_connection *connections,
+   size_t count);
+
+/**
+ * netplay_io_thread_wake
+ *
+ * Have the IO thread look at every connection again.
+ */
+void netplay_io_thread_wake(struct netplay_io_thread *thread);
+
+/**
+ * netplay_io_thread_activity
+ *
+ * A counter which moves whenever the IO thread receives data or sees a socket
+ * fail.
+ */
+unsigned netplay_io_thread_activity(struct netplay_io_thread *thread);
+
+/**
+ * netplay_io_thread_wait
+ *
+ * Wait up to timeout_ms for the activity counter to move on from seen.
+ */
+void netplay_io_thread_wait(struct netplay_io_thread *thread, unsigned seen,
+   unsigned timeout_ms);
+#endif
+
 
 /***************************************************************
  * NETPLAY-DELTA.C
@@ -698,6 +932,8 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp_input            : If true, offer the UDP input channel.
+ * @relay                : If set, host through this netplay relay.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -708,8 +944,33 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks);
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp_input,
+   const char *relay, const char *nick, uint64_t quirks);
+
+/**
+ * netplay_relay_poll
+ * @netplay              : pointer to netplay object
+ *
+ * Move our control connection to the relay along without blocking: finish
+ * connecting, ask for a room, and read which port it's on.
+ *
+ * Returns: true once our room is open.
+ */
+bool netplay_relay_poll(netplay_t *netplay);
+
+/**
+ * netplay_relay_accept
+ * @netplay              : pointer to netplay object
+ * @id                   : the client's id and token, which the new
+ *                         connection must start by sending in
+ *                         NETPLAY_RELAY_CMD_LINK
+ *
+ * Read a new client announcement from the relay's control connection and
+ * start opening the connection which will carry it.
+ *
+ * Returns: the new socket, or -1 on failure.
+ */
+int netplay_relay_accept(netplay_t *netplay, uint32_t *id);
 
 /**
  * netplay_free
@@ -749,6 +1010,14 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_send_cur_input_all
+ *
+ * Send the current input frame to every connected peer. Everyone who isn't
+ * playing receives the same data, so it's encoded once and fanned out.
+ */
+void netplay_send_cur_input_all(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -185,6 +185,26 @@ static void netplay_handle_frame_hash(netplay_t *netplay, struct delta_frame *de
    }
 }
 
+/**
+ * netplay_frame_hash_needs_state
+ * @netplay              : pointer to netplay object
+ * @delta                : frame to check
+ *
+ * Whether a CRC of this frame's state may be sent or checked.
+ */
+static bool netplay_frame_hash_needs_state(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   if (netplay->is_server)
+      return netplay->check_frames &&
+         delta->frame % abs(netplay->check_frames) == 0;
+
+   /* Until we know how often the server sends CRCs, any frame may be
+    * checked once its CRC arrives */
+   return delta->crc || !netplay->crc_interval ||
+      delta->frame % netplay->crc_interval == 0;
+}
+
 /**
  * netplay_sync_pre_frame
  * @netplay              : pointer to netplay object
@@ -243,7 +263,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
          netplay->stall = NETPLAY_STALL_NO_CONNECTION;
    }
 
-   if (netplay->is_server)
+   if (netplay->is_server && netplay->listen_fd >= 0)
    {
       fd_set fds;
       struct timeval tmp_tv = {0};
@@ -252,6 +272,11 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
       socklen_t addr_size;
       struct netplay_connection *connection;
       size_t connection_num;
+      uint32_t link_id[2] = {0};
+
+      /* Through a relay, we can't take anyone until our room is open */
+      if (netplay->relay && !netplay_relay_poll(netplay))
+         goto process;
 
       /* Check for a connection */
       FD_ZERO(&fds);
@@ -260,7 +285,10 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
           FD_ISSET(netplay->listen_fd, &fds))
       {
          addr_size = sizeof(their_addr);
-         new_fd = accept(netplay->listen_fd, (struct sockaddr*)&their_addr, &addr_size);
+         if (netplay->relay)
+            new_fd = netplay_relay_accept(netplay, link_id);
+         else
+            new_fd = accept(netplay->listen_fd, (struct sockaddr*)&their_addr, &addr_size);
          if (new_fd < 0)
          {
             RARCH_ERR("%s\n", msg_hash_to_str(MSG_NETPLAY_FAILED));
@@ -316,20 +344,37 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
             else
             {
                size_t new_connections_size = netplay->connections_size * 2;
-               struct netplay_connection *new_connections = (struct netplay_connection*)
+               struct netplay_connection *new_connections;
+
+#ifdef HAVE_NETPLAY_IO_THREAD
+               /* The IO thread works on the socket buffers in place */
+               if (netplay->io_thread)
+                  netplay_io_thread_lock(netplay->io_thread);
+#endif
+               new_connections = (struct netplay_connection*)
                   realloc(netplay->connections,
                      new_connections_size*sizeof(struct netplay_connection));
+               if (new_connections != NULL)
+               {
+                  memset(new_connections + netplay->connections_size, 0,
+                     netplay->connections_size * sizeof(struct netplay_connection));
+#ifdef HAVE_NETPLAY_IO_THREAD
+                  netplay_io_thread_moved(new_connections,
+                     netplay->connections_size);
+#endif
+                  netplay->connections = new_connections;
+                  netplay->connections_size = new_connections_size;
+               }
+#ifdef HAVE_NETPLAY_IO_THREAD
+               if (netplay->io_thread)
+                  netplay_io_thread_unlock(netplay->io_thread);
+#endif
                if (new_connections == NULL)
                {
                   socket_close(new_fd);
                   goto process;
                }
 
-               memset(new_connections + netplay->connections_size, 0,
-                  netplay->connections_size * sizeof(struct netplay_connection));
-               netplay->connections = new_connections;
-               netplay->connections_size = new_connections_size;
-
             }
          }
          connection = &netplay->connections[connection_num];
@@ -352,6 +397,31 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
             goto process;
          }
 
+#ifdef HAVE_NETPLAY_IO_THREAD
+         if (netplay->io_thread &&
+             !netplay_io_thread_attach(netplay->io_thread, connection))
+         {
+            netplay_deinit_socket_buffer(&connection->send_packet_buffer);
+            netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+            connection->active = false;
+            socket_close(new_fd);
+            goto process;
+         }
+#endif
+
+         /* A connection through the relay first says which client it carries.
+          * It's probably still connecting, so this waits in our buffer. */
+         if (netplay->relay)
+         {
+            uint32_t link[4];
+            link[0] = htonl(NETPLAY_RELAY_MAGIC);
+            link[1] = htonl(NETPLAY_RELAY_CMD_LINK);
+            link[2] = htonl(link_id[0]);
+            link[3] = htonl(link_id[1]);
+            netplay_send(&connection->send_packet_buffer, new_fd, link,
+                  sizeof(link));
+         }
+
          netplay_handshake_init_send(netplay, connection);
 
       }
@@ -446,12 +516,21 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
         netplay->other_frame_count < netplay->run_frame_count))
    {
       retro_ctx_serialize_info_t serial_info;
+      retro_time_t replay_start = cpu_features_get_time_usec();
+      unsigned depth = (netplay->run_frame_count > netplay->other_frame_count) ?
+                       (netplay->run_frame_count - netplay->other_frame_count) :
+                       0;
 
       /* Replay frames. */
       netplay->is_replay = true;
       netplay->replay_ptr = netplay->other_ptr;
       netplay->replay_frame_count = netplay->other_frame_count;
 
+      netplay->stats.rollbacks++;
+      netplay->stats.rollback_depth_last = depth;
+      if (depth > netplay->stats.rollback_depth_max)
+         netplay->stats.rollback_depth_max = depth;
+
       if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
          /* Make sure we're initialized before we start loading things */
          netplay_wait_and_init_serialization(netplay);
@@ -474,14 +553,30 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          serial_info.size       = netplay->state_size;
          serial_info.data_const = NULL;
 
-         start = cpu_features_get_time_usec();
+         /* Frames before unread_frame_count have all their real input, so
+          * we never rewind to them again. Their state is only needed if
+          * it's going to be CRC checked. */
+         if (netplay->replay_frame_count >= netplay->unread_frame_count ||
+               netplay_frame_hash_needs_state(netplay, ptr))
+         {
+            start = cpu_features_get_time_usec();
+
+            /* Remember the current state */
+            memset(serial_info.data, 0, serial_info.size);
+            core_serialize(&serial_info);
+
+            tm = cpu_features_get_time_usec() - start;
+            netplay->replay_serialize_time_avg = NETPLAY_TIME_AVG(
+                  netplay->replay_serialize_time_avg, tm);
+         }
+         else
+            netplay->stats.skipped_serializations++;
 
-         /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
+         start = cpu_features_get_time_usec();
+
          /* Re-simulate this frame's input */
          netplay_simulate_input(netplay, netplay->replay_ptr, true);
 
@@ -507,8 +602,13 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          }
 #endif
 
-         /* Get our time window */
+         /* Get our time window. Frames we may rewind to always need a
+          * serialize, so count one even when this one was skipped. */
          tm = cpu_features_get_time_usec() - start;
+         netplay->replay_run_time_avg = NETPLAY_TIME_AVG(
+               netplay->replay_run_time_avg, tm);
+         tm += netplay->replay_serialize_time_avg;
+         netplay->stats.replayed_frames++;
          netplay->frame_run_time_sum -= netplay->frame_run_time[netplay->frame_run_time_ptr];
          netplay->frame_run_time[netplay->frame_run_time_ptr] = tm;
          netplay->frame_run_time_sum += tm;
@@ -519,6 +619,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 
       /* Average our time */
       netplay->frame_run_time_avg = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
+      netplay->stats.replay_time += cpu_features_get_time_usec() - replay_start;
 
       if (netplay->unread_frame_count < netplay->run_frame_count)
       {
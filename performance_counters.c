@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -24,6 +25,8 @@
 #endif
 
 #include <compat/strl.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
 
 #include "performance_counters.h"
 
@@ -32,15 +35,59 @@
 
 #ifdef _WIN32
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+#define PERF_TRACE_LOG_FMT "[PERF]: %-12s p50 %6I64u us, p99 %6I64u us, max %6I64u us.\n"
+#define PERF_TRACE_EVENT_FMT "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%I64u,\"dur\":%I64u,\"args\":{\"frame\":%I64u}}"
 #else
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+#define PERF_TRACE_LOG_FMT "[PERF]: %-12s p50 %6llu us, p99 %6llu us, max %6llu us.\n"
+#define PERF_TRACE_EVENT_FMT "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,\"args\":{\"frame\":%llu}}"
 #endif
 
+typedef struct perf_trace_frame
+{
+   retro_time_t begin;
+   retro_time_t end;
+   retro_time_t stage[PERF_TRACE_STAGE_LAST];
+} perf_trace_frame_t;
+
+typedef struct perf_trace_event
+{
+   retro_time_t begin;
+   retro_time_t end;
+   uint64_t frame;
+   unsigned stage;
+} perf_trace_event_t;
+
+static const char *perf_trace_stage_names[PERF_TRACE_STAGE_LAST] = {
+   "input_poll",
+   "core_run",
+   "video_filter",
+   "video_frame",
+   "audio_flush",
+   "swap"
+};
+
 static struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
 static struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
 static unsigned perf_ptr_libretro;
 
+/* Only written from the main thread; the frame and event
+ * counters only grow, so each ring keeps the most recent
+ * PERF_TRACE_MAX_* entries without any locking. */
+static perf_trace_frame_t *perf_trace_frames;
+static perf_trace_event_t *perf_trace_events;
+static uint64_t perf_trace_frame_count;
+static uint64_t perf_trace_event_count;
+static retro_time_t perf_trace_stage_start[PERF_TRACE_STAGE_LAST];
+/* Time spent in stages nested inside each open stage, and the
+ * open stages from outermost to innermost */
+static retro_time_t perf_trace_stage_child[PERF_TRACE_STAGE_LAST];
+static unsigned perf_trace_stack[PERF_TRACE_STAGE_LAST];
+static unsigned perf_trace_depth;
+static bool perf_trace_in_frame;
+static char perf_trace_path[PATH_MAX_LENGTH];
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    return perf_counters_rarch;
@@ -120,6 +167,239 @@ void retro_perf_log(void)
    log_counters(perf_counters_libretro, perf_ptr_libretro);
 }
 
+void performance_trace_frame_begin(bool enable)
+{
+   perf_trace_frame_t *frame = NULL;
+
+   perf_trace_in_frame       = false;
+
+   if (!enable && string_is_empty(perf_trace_path))
+      return;
+
+   if (!perf_trace_frames)
+   {
+      perf_trace_frames = (perf_trace_frame_t*)
+         calloc(PERF_TRACE_MAX_FRAMES, sizeof(*perf_trace_frames));
+      perf_trace_events = (perf_trace_event_t*)
+         calloc(PERF_TRACE_MAX_EVENTS, sizeof(*perf_trace_events));
+
+      if (!perf_trace_frames || !perf_trace_events)
+      {
+         performance_trace_free();
+         return;
+      }
+   }
+
+   frame = &perf_trace_frames[
+      perf_trace_frame_count & (PERF_TRACE_MAX_FRAMES - 1)];
+   memset(frame, 0, sizeof(*frame));
+   memset(perf_trace_stage_start, 0, sizeof(perf_trace_stage_start));
+   perf_trace_depth    = 0;
+
+   frame->begin        = cpu_features_get_time_usec();
+   perf_trace_in_frame = true;
+}
+
+void performance_trace_frame_end(void)
+{
+   if (!perf_trace_in_frame)
+      return;
+
+   perf_trace_frames[perf_trace_frame_count
+      & (PERF_TRACE_MAX_FRAMES - 1)].end = cpu_features_get_time_usec();
+   perf_trace_frame_count++;
+   perf_trace_in_frame = false;
+}
+
+void performance_trace_stage_begin(enum perf_trace_stage stage)
+{
+   if (!perf_trace_in_frame || perf_trace_stage_start[stage])
+      return;
+
+   perf_trace_stage_start[stage]     = cpu_features_get_time_usec();
+   perf_trace_stage_child[stage]     = 0;
+   perf_trace_stack[perf_trace_depth++] = stage;
+}
+
+void performance_trace_stage_end(enum perf_trace_stage stage)
+{
+   retro_time_t now, elapsed;
+   perf_trace_event_t *event = NULL;
+
+   if (!perf_trace_in_frame || !perf_trace_stage_start[stage])
+      return;
+
+   /* Close anything left open inside this stage along with it */
+   while (perf_trace_stack[perf_trace_depth - 1] != (unsigned)stage)
+      perf_trace_stage_start[perf_trace_stack[--perf_trace_depth]] = 0;
+   perf_trace_depth--;
+
+   now   = cpu_features_get_time_usec();
+   event = &perf_trace_events[
+      perf_trace_event_count++ & (PERF_TRACE_MAX_EVENTS - 1)];
+
+   event->begin = perf_trace_stage_start[stage];
+   event->end   = now;
+   event->frame = perf_trace_frame_count;
+   event->stage = stage;
+
+   /* The frame keeps self time, so nested stages aren't counted
+    * twice; the events keep the whole span */
+   elapsed = now - event->begin;
+   if (perf_trace_depth)
+      perf_trace_stage_child[perf_trace_stack[perf_trace_depth - 1]]
+         += elapsed;
+
+   perf_trace_frames[perf_trace_frame_count
+      & (PERF_TRACE_MAX_FRAMES - 1)].stage[stage]
+      += elapsed - perf_trace_stage_child[stage];
+   perf_trace_stage_start[stage] = 0;
+}
+
+void performance_trace_set_path(const char *path)
+{
+   if (string_is_empty(path))
+      perf_trace_path[0] = '\0';
+   else
+      strlcpy(perf_trace_path, path, sizeof(perf_trace_path));
+}
+
+static int perf_trace_time_cmp(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+
+   return (x > y) - (x < y);
+}
+
+static void perf_trace_log_times(const char *name,
+      retro_time_t *times, size_t count)
+{
+   if (!count)
+      return;
+
+   qsort(times, count, sizeof(*times), perf_trace_time_cmp);
+
+   RARCH_LOG(PERF_TRACE_LOG_FMT, name,
+         (uint64_t)times[(count - 1) * 50 / 100],
+         (uint64_t)times[(count - 1) * 99 / 100],
+         (uint64_t)times[count - 1]);
+}
+
+static void perf_trace_write(const char *path,
+      uint64_t first, uint64_t count)
+{
+   uint64_t i;
+   const char *sep           = "";
+   retro_time_t origin       = perf_trace_frames[
+      first & (PERF_TRACE_MAX_FRAMES - 1)].begin;
+   uint64_t first_event      = 0;
+   FILE *file                = fopen(path, "w");
+
+   if (!file)
+   {
+      RARCH_ERR("[PERF]: Failed to write trace to \"%s\".\n", path);
+      return;
+   }
+
+   if (perf_trace_event_count > PERF_TRACE_MAX_EVENTS)
+      first_event = perf_trace_event_count - PERF_TRACE_MAX_EVENTS;
+
+   fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+
+   for (i = first; i < first + count; i++)
+   {
+      const perf_trace_frame_t *frame = &perf_trace_frames[
+         i & (PERF_TRACE_MAX_FRAMES - 1)];
+
+      fprintf(file, PERF_TRACE_EVENT_FMT, sep, "frame",
+            (unsigned long long)(frame->begin - origin),
+            (unsigned long long)(frame->end - frame->begin),
+            (unsigned long long)i);
+      sep = ",";
+   }
+
+   for (i = first_event; i < perf_trace_event_count; i++)
+   {
+      const perf_trace_event_t *event = &perf_trace_events[
+         i & (PERF_TRACE_MAX_EVENTS - 1)];
+
+      if (event->frame < first)
+         continue;
+
+      fprintf(file, PERF_TRACE_EVENT_FMT, sep,
+            perf_trace_stage_names[event->stage],
+            (unsigned long long)(event->begin - origin),
+            (unsigned long long)(event->end - event->begin),
+            (unsigned long long)event->frame);
+   }
+
+   fputs("\n]}\n", file);
+   fclose(file);
+
+   RARCH_LOG("[PERF]: Wrote trace of %u frames to \"%s\".\n",
+         (unsigned)count, path);
+}
+
+void performance_trace_log(void)
+{
+   unsigned stage;
+   uint64_t i;
+   retro_time_t *times = NULL;
+   uint64_t count      = perf_trace_frame_count;
+   uint64_t first      = 0;
+
+   if (!perf_trace_frames || !count)
+      return;
+
+   if (count > PERF_TRACE_MAX_FRAMES)
+   {
+      first = count - PERF_TRACE_MAX_FRAMES;
+      count = PERF_TRACE_MAX_FRAMES;
+   }
+
+   times = (retro_time_t*)malloc(count * sizeof(*times));
+   if (!times)
+      return;
+
+   RARCH_LOG("[PERF]: Frame times over the last %u frames, "
+         "stages exclusive of stages nested in them:\n",
+         (unsigned)count);
+
+   /* Frame pacing: time between consecutive frame starts */
+   for (i = 1; i < count; i++)
+      times[i - 1] = perf_trace_frames[(first + i)
+         & (PERF_TRACE_MAX_FRAMES - 1)].begin
+         - perf_trace_frames[(first + i - 1)
+         & (PERF_TRACE_MAX_FRAMES - 1)].begin;
+   perf_trace_log_times("frame", times, (size_t)(count - 1));
+
+   for (stage = 0; stage < PERF_TRACE_STAGE_LAST; stage++)
+   {
+      for (i = 0; i < count; i++)
+         times[i] = perf_trace_frames[(first + i)
+            & (PERF_TRACE_MAX_FRAMES - 1)].stage[stage];
+      perf_trace_log_times(perf_trace_stage_names[stage],
+            times, (size_t)count);
+   }
+
+   free(times);
+
+   if (!string_is_empty(perf_trace_path))
+      perf_trace_write(perf_trace_path, first, count);
+}
+
+void performance_trace_free(void)
+{
+   free(perf_trace_frames);
+   free(perf_trace_events);
+   perf_trace_frames      = NULL;
+   perf_trace_events      = NULL;
+   perf_trace_frame_count = 0;
+   perf_trace_event_count = 0;
+   perf_trace_in_frame    = false;
+}
+
 void rarch_timer_tick(rarch_timer_t *timer)
 {
    if (!timer)
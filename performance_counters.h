@@ -30,6 +30,26 @@ RETRO_BEGIN_DECLS
 #define MAX_COUNTERS 64
 #endif
 
+/* Both must be powers of two. */
+#ifndef PERF_TRACE_MAX_FRAMES
+#define PERF_TRACE_MAX_FRAMES 4096
+#endif
+
+#ifndef PERF_TRACE_MAX_EVENTS
+#define PERF_TRACE_MAX_EVENTS 32768
+#endif
+
+enum perf_trace_stage
+{
+   PERF_TRACE_STAGE_INPUT_POLL = 0,
+   PERF_TRACE_STAGE_CORE_RUN,
+   PERF_TRACE_STAGE_VIDEO_FILTER,
+   PERF_TRACE_STAGE_VIDEO_FRAME,
+   PERF_TRACE_STAGE_AUDIO_FLUSH,
+   PERF_TRACE_STAGE_SWAP,
+   PERF_TRACE_STAGE_LAST
+};
+
 typedef struct rarch_timer
 {
    int64_t current;
@@ -89,6 +109,50 @@ void rarch_perf_register(struct retro_perf_counter *perf);
  **/
 #define performance_counter_stop_plus(is_perfcnt_enable, perf) performance_counter_stop_internal(is_perfcnt_enable, perf)
 
+/**
+ * performance_trace_frame_begin:
+ * @enable             : whether performance counters are enabled.
+ *
+ * Starts a new frame in the stage trace. Tracing is active
+ * while @enable is set or a trace file was requested.
+ **/
+void performance_trace_frame_begin(bool enable);
+
+void performance_trace_frame_end(void);
+
+/**
+ * performance_trace_stage_begin:
+ * @stage              : runloop stage being entered.
+ *
+ * Timestamps a runloop stage of the current frame. Stages
+ * may nest and may run several times per frame, in which
+ * case their times add up. A stage's time excludes the
+ * stages nested in it. Must be called from the main
+ * thread; the rings are single-writer and take no locks.
+ **/
+void performance_trace_stage_begin(enum perf_trace_stage stage);
+
+void performance_trace_stage_end(enum perf_trace_stage stage);
+
+/**
+ * performance_trace_set_path:
+ * @path               : file to write the trace to, or NULL.
+ *
+ * Forces tracing on and makes performance_trace_log() write
+ * the recorded frames as Chrome trace-event JSON to @path.
+ **/
+void performance_trace_set_path(const char *path);
+
+/**
+ * performance_trace_log:
+ *
+ * Logs p50/p99/max times of every stage over the recorded
+ * frames and writes the trace file, if any.
+ **/
+void performance_trace_log(void);
+
+void performance_trace_free(void);
+
 void rarch_timer_tick(rarch_timer_t *timer);
 
 bool rarch_timer_is_running(rarch_timer_t *timer);
@@ -104,6 +104,7 @@
 #include "core.h"
 #include "configuration.h"
 #include "list_special.h"
+#include "performance_counters.h"
 #include "managers/core_option_manager.h"
 #include "managers/cheat_manager.h"
 #include "managers/state_manager.h"
@@ -153,7 +154,9 @@ enum
    RA_OPT_VERSION,
    RA_OPT_EOF_EXIT,
    RA_OPT_LOG_FILE,
-   RA_OPT_MAX_FRAMES
+   RA_OPT_MAX_FRAMES,
+   RA_OPT_PERF_TRACE,
+   RA_OPT_BENCHMARK
 };
 
 enum  runloop_state
@@ -242,6 +245,10 @@ static msg_queue_t *runloop_msg_queue                      = NULL;
 
 static unsigned runloop_pending_windowed_scale             = 0;
 static unsigned runloop_max_frames                         = 0;
+static unsigned runloop_benchmark_frames                   = 0;
+static unsigned runloop_benchmark_count                    = 0;
+static retro_time_t runloop_benchmark_start                = 0;
+static retro_time_t *runloop_benchmark_times               = NULL;
 
 static retro_usec_t runloop_frame_time_last                = 0;
 static retro_time_t frame_limit_minimum_time               = 0.0;
@@ -561,7 +568,17 @@ static void retroarch_print_help(const char *arg0)
          "Not relevant for all platforms.");
    puts("      --max-frames=NUMBER\n"
         "                        Runs for the specified number of frames, "
-        "then exits.\n");
+        "then exits.");
+   puts("      --benchmark=NUMBER\n"
+        "                        Runs the specified number of frames as fast "
+        "as possible with null\n"
+        "                        drivers, then reports throughput and "
+        "savestate cost.\n"
+        "                        Combine with --bsvplay for deterministic "
+        "input.");
+   puts("      --perf-trace=FILE\n"
+        "                        Times every runloop stage and writes the "
+        "last frames as Chrome trace-event JSON to FILE on exit.\n");
 }
 
 #define FFMPEG_RECORD_ARG "r:"
@@ -634,6 +651,8 @@ static void retroarch_parse_input(int argc, char *argv[])
       { "features",     0, NULL, RA_OPT_FEATURES },
       { "subsystem",    1, NULL, RA_OPT_SUBSYSTEM },
       { "max-frames",   1, NULL, RA_OPT_MAX_FRAMES },
+      { "perf-trace",   1, NULL, RA_OPT_PERF_TRACE },
+      { "benchmark",    1, NULL, RA_OPT_BENCHMARK },
       { "eof-exit",     0, NULL, RA_OPT_EOF_EXIT },
       { "version",      0, NULL, RA_OPT_VERSION },
 #ifdef HAVE_FILE_LOGGER
@@ -1020,6 +1039,15 @@ static void retroarch_parse_input(int argc, char *argv[])
             runloop_max_frames  = (unsigned)strtoul(optarg, NULL, 10);
             break;
 
+         case RA_OPT_PERF_TRACE:
+            performance_trace_set_path(optarg);
+            break;
+
+         case RA_OPT_BENCHMARK:
+            runloop_benchmark_frames = (unsigned)strtoul(optarg, NULL, 10);
+            runloop_max_frames       = runloop_benchmark_frames;
+            break;
+
          case RA_OPT_SUBSYSTEM:
             path_set(RARCH_PATH_SUBSYSTEM, optarg);
             break;
@@ -1216,6 +1244,121 @@ static void retroarch_main_init_media(void)
    }
 }
 
+/* Benchmarks run unthrottled, with nothing to present to
+ * and without touching the user's configuration. */
+static void retroarch_benchmark_init(void)
+{
+   settings_t *settings = config_get_ptr();
+
+   strlcpy(settings->arrays.video_driver, "null",
+         sizeof(settings->arrays.video_driver));
+   strlcpy(settings->arrays.audio_driver, "null",
+         sizeof(settings->arrays.audio_driver));
+   strlcpy(settings->arrays.input_driver, "null",
+         sizeof(settings->arrays.input_driver));
+   strlcpy(settings->arrays.input_joypad_driver, "null",
+         sizeof(settings->arrays.input_joypad_driver));
+
+   settings->bools.video_vsync         = false;
+   settings->bools.video_threaded      = false;
+   settings->bools.audio_sync          = false;
+   settings->bools.config_save_on_exit = false;
+   settings->floats.fastforward_ratio  = 0.0f;
+   settings->uints.video_frame_delay   = 0;
+
+   free(runloop_benchmark_times);
+   runloop_benchmark_times = (retro_time_t*)
+      calloc(runloop_benchmark_frames, sizeof(*runloop_benchmark_times));
+   runloop_benchmark_count = 0;
+   runloop_benchmark_start = 0;
+}
+
+static int retroarch_benchmark_time_cmp(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+
+   return (x > y) - (x < y);
+}
+
+static void retroarch_benchmark_report(void)
+{
+   unsigned i;
+   retro_ctx_size_info_t size_info;
+   unsigned count                   = runloop_benchmark_count;
+   retro_time_t elapsed             = cpu_features_get_time_usec()
+      - runloop_benchmark_start;
+   retro_time_t *times              = runloop_benchmark_times;
+   struct retro_system_av_info *av  = video_viewport_get_system_av_info();
+
+   runloop_benchmark_times          = NULL;
+   runloop_benchmark_frames         = 0;
+
+   if (!times || !count || elapsed <= 0)
+   {
+      free(times);
+      return;
+   }
+
+   printf("Benchmark: %u frames in %.3f s, %.1f FPS",
+         count, elapsed / 1000000.0, count * 1000000.0 / elapsed);
+   if (av && av->timing.fps > 0.0)
+      printf(" (%.2fx realtime)",
+            count * 1000000.0 / elapsed / av->timing.fps);
+   printf(".\n");
+
+   qsort(times, count, sizeof(*times), retroarch_benchmark_time_cmp);
+   printf("Benchmark: core_run min %u us, p50 %u us, p99 %u us, "
+         "max %u us.\n",
+         (unsigned)times[0],
+         (unsigned)times[(count - 1) * 50 / 100],
+         (unsigned)times[(count - 1) * 99 / 100],
+         (unsigned)times[count - 1]);
+   free(times);
+
+   size_info.size = 0;
+   core_serialize_size(&size_info);
+
+   if (size_info.size)
+   {
+      retro_ctx_serialize_info_t serial_info;
+      retro_time_t serialize_time   = 0;
+      retro_time_t unserialize_time = 0;
+      const unsigned iterations     = 100;
+      void *state                   = malloc(size_info.size);
+
+      if (!state)
+         return;
+
+      serial_info.data       = state;
+      serial_info.data_const = state;
+      serial_info.size       = size_info.size;
+
+      for (i = 0; i < iterations; i++)
+      {
+         retro_time_t start = cpu_features_get_time_usec();
+         if (!core_serialize(&serial_info))
+            break;
+         serialize_time    += cpu_features_get_time_usec() - start;
+
+         start              = cpu_features_get_time_usec();
+         if (!core_unserialize(&serial_info))
+            break;
+         unserialize_time  += cpu_features_get_time_usec() - start;
+      }
+
+      if (i == iterations)
+         printf("Benchmark: savestate %u bytes, serialize %.1f us, "
+               "unserialize %.1f us.\n",
+               (unsigned)size_info.size,
+               (double)serialize_time / iterations,
+               (double)unserialize_time / iterations);
+      free(state);
+   }
+
+   fflush(stdout);
+}
+
 /**
  * retroarch_main_init:
  * @argc                 : Count of (commandline) arguments.
@@ -1263,6 +1406,9 @@ bool retroarch_main_init(int argc, char *argv[])
    retroarch_validate_cpu_features();
    config_load();
 
+   if (runloop_benchmark_frames)
+      retroarch_benchmark_init();
+
    rarch_ctl(RARCH_CTL_TASK_INIT, NULL);
 
    retroarch_main_init_media();
@@ -1722,6 +1868,9 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
                sizeof(struct retro_frame_time_callback));
          runloop_frame_time_last           = 0;
          runloop_max_frames                = 0;
+         runloop_benchmark_frames          = 0;
+         free(runloop_benchmark_times);
+         runloop_benchmark_times           = NULL;
          break;
       case RARCH_CTL_STATE_FREE:
          runloop_perfcnt_enable            = false;
@@ -2275,6 +2424,19 @@ void runloop_get_status(bool *is_paused, bool *is_idle,
    *is_perfcnt_enable = runloop_perfcnt_enable;
 }
 
+size_t runloop_msg_queue_size(void)
+{
+   size_t size;
+#ifdef HAVE_THREADS
+   runloop_msg_queue_lock();
+#endif
+   size = msg_queue_size(runloop_msg_queue);
+#ifdef HAVE_THREADS
+   runloop_msg_queue_unlock();
+#endif
+   return size;
+}
+
 bool runloop_msg_queue_pull(const char **ret)
 {
 #ifdef HAVE_THREADS
@@ -2497,6 +2659,9 @@ static enum runloop_state runloop_check_state(
 
       if (time_to_exit(trig_quit_key))
       {
+         if (runloop_benchmark_times)
+            retroarch_benchmark_report();
+
          if (runloop_exec)
             runloop_exec = false;
 
@@ -2633,6 +2798,10 @@ static enum runloop_state runloop_check_state(
 
    if (menu_driver_is_alive())
    {
+      /* Nothing changed on screen, no need to spin */
+      if (menu_display_get_idle())
+         return RUNLOOP_STATE_POLLED_AND_SLEEP;
+
       if (!settings->bools.menu_throttle_framerate && !settings->floats.fastforward_ratio)
          return RUNLOOP_STATE_MENU_ITERATE;
 
@@ -3102,6 +3271,8 @@ int runloop_iterate(unsigned *sleep_ms)
          break;
    }
 
+   performance_trace_frame_begin(runloop_perfcnt_enable);
+
    if (runloop_autosave)
       autosave_lock();
 
@@ -3126,7 +3297,25 @@ int runloop_iterate(unsigned *sleep_ms)
    if ((settings->uints.video_frame_delay > 0) && !input_nonblock_state)
       retro_sleep(settings->uints.video_frame_delay);
 
-   core_run();
+   performance_trace_stage_begin(PERF_TRACE_STAGE_CORE_RUN);
+
+   if (runloop_benchmark_times
+         && runloop_benchmark_count < runloop_benchmark_frames)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+
+      if (!runloop_benchmark_start)
+         runloop_benchmark_start = start;
+
+      core_run();
+
+      runloop_benchmark_times[runloop_benchmark_count++] =
+         cpu_features_get_time_usec() - start;
+   }
+   else
+      core_run();
+
+   performance_trace_stage_end(PERF_TRACE_STAGE_CORE_RUN);
 
 #ifdef HAVE_CHEEVOS
    if (runloop_check_cheevos())
@@ -3151,6 +3340,8 @@ int runloop_iterate(unsigned *sleep_ms)
    if (runloop_autosave)
       autosave_unlock();
 
+   performance_trace_frame_end();
+
    if (settings->floats.fastforward_ratio)
       end:
    {
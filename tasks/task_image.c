@@ -46,6 +46,8 @@ struct nbio_image_handle
    bool is_blocking_on_processing;
    bool is_finished;
    int processing_final_state;
+   unsigned target_width;
+   unsigned target_height;
    unsigned processing_pos_increment;
    unsigned pos_increment;
    size_t size;
@@ -194,6 +196,9 @@ static int cb_nbio_image_menu_thumbnail(void *data, size_t len)
    image->size                     = len;
    image->cb                       = &cb_image_menu_thumbnail;
 
+   image_transfer_set_target_size(image->handle, image->type,
+         image->target_width, image->target_height);
+
    ptr                             = nbio_get_ptr(nbio->handle, &len);
 
    image_transfer_set_buffer_ptr(image->handle, image->type, ptr);
@@ -287,6 +292,13 @@ bool task_image_load_handler(retro_task_t *task)
 }
 
 bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_scaled(fullpath, 0, 0, cb, user_data);
+}
+
+bool task_push_image_load_scaled(const char *fullpath,
+      unsigned width, unsigned height,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
@@ -324,6 +336,8 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    image->is_blocking_on_processing  = false;
    image->is_finished                = false;
    image->processing_final_state     = 0;
+   image->target_width               = width;
+   image->target_height              = height;
    image->processing_pos_increment   = 0;
    image->pos_increment              = 0;
    image->size                       = 0;
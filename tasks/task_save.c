@@ -14,6 +14,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <string.h>
@@ -21,6 +22,10 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#ifndef _XBOX
+#include <windows.h>
+#include <encodings/utf.h>
+#endif
 #else
 #include <unistd.h>
 #endif
@@ -30,6 +35,8 @@
 #include <retro_assert.h>
 #include <lists/string_list.h>
 #include <streams/file_stream.h>
+#include <streams/trans_stream.h>
+#include <encodings/crc32.h>
 #include <rthreads/rthreads.h>
 #include <file/file_path.h>
 #include <retro_miscellaneous.h>
@@ -48,12 +55,48 @@
 #include "../configuration.h"
 #include "../gfx/video_driver.h"
 #include "../msg_hash.h"
+#include "../paths.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
 #include "tasks_internal.h"
 
 #define SAVE_STATE_CHUNK 4096
 
+/* Savestate container, see content_state_info_t. Integers are
+ * little-endian.
+ *
+ *   0  magic, "RASTATE\0"
+ *   8  version
+ *  12  flags
+ *  16  state size, uncompressed
+ *  20  state size, as stored
+ *  24  CRC32 of the uncompressed state
+ *  28  CRC32 of the content
+ *  32  time saved, 64-bit seconds since the epoch
+ *  40  core name, 64 bytes NUL padded
+ * 104  core version, 32 bytes NUL padded
+ * 136  content name, 128 bytes NUL padded
+ * 264  the state
+ */
+#define STATE_FILE_MAGIC            "RASTATE"
+#define STATE_FILE_VERSION          1
+#define STATE_FILE_HEADER_SIZE      264
+#define STATE_FILE_FLAG_COMPRESSED  (1U << 0)
+#define STATE_FILE_FLAG_THUMBNAIL   (1U << 1)
+
+/* Compressed states are streamed in chunks of this size */
+#define STATE_FILE_CHUNK (64 * 1024)
+
+/* SRAM is compared and written in blocks of this size ... */
+#define AUTOSAVE_BLOCK_SIZE (64 * 1024)
+
+/* ... and at most this much is compared per hold of the lock, which the
+ * runloop needs every frame */
+#define AUTOSAVE_SLICE_SIZE (1024 * 1024)
+
+/* Passes over SRAM before a snapshot is put off until the next interval */
+#define AUTOSAVE_SNAPSHOT_TRIES 4
+
 static struct string_list *task_save_files = NULL;
 
 struct ram_type
@@ -94,6 +137,18 @@ typedef struct
    int state_slot;
    bool thumbnail_enable;
    bool has_valid_framebuffer;
+
+   /* Saving: write the container with a compressed state.
+    * Loading: the file has a container header. */
+   bool container;
+   bool compressed;
+   uint32_t crc;
+   ssize_t stored_size;
+   ssize_t bytes_stored;
+   uint8_t header[STATE_FILE_HEADER_SIZE];
+   const struct trans_stream_backend *zbackend;
+   void *zstream;
+   uint8_t *zbuf;
 } save_task_state_t;
 
 typedef save_task_state_t load_task_data_t;
@@ -106,6 +161,9 @@ static struct save_state_buf undo_save_buf;
  * Can be restored with undo_load_state(). */
 static struct save_state_buf undo_load_buf;
 
+/* Bumped whenever a state is saved, loaded or restored */
+static unsigned state_serial = 0;
+
 #ifdef HAVE_THREADS
 typedef struct autosave autosave_t;
 
@@ -124,6 +182,19 @@ struct autosave
    void *buffer;
    const void *retro_buffer;
    const char *path;
+
+   /* Blocks of buffer which changed since they were last written */
+   size_t num_blocks;
+   uint8_t *dirty;
+
+   /* Does the file match buffer, apart from the dirty blocks? Until it does,
+    * we rewrite it whole. */
+   bool synced;
+
+   /* Bumped whenever the lock is released by the runloop, which the core
+    * may have written to SRAM under */
+   unsigned generation;
+
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
@@ -132,6 +203,180 @@ struct autosave
 
 static struct autosave_st autosave_state;
 
+/**
+ * autosave_snapshot:
+ * @save            : pointer to autosave object
+ *
+ * Copy the blocks of SRAM which changed since the last snapshot, taking the
+ * lock for one slice at a time. If the core ran between two slices the pass
+ * is started over, so the snapshot never mixes blocks from different frames.
+ *
+ * Returns: number of blocks which are now dirty, or 0 if no pass got
+ * through undisturbed, in which case they are left for the next interval.
+ **/
+static size_t autosave_snapshot(autosave_t *save)
+{
+   unsigned tries;
+   size_t blocks_per_slice = AUTOSAVE_SLICE_SIZE / AUTOSAVE_BLOCK_SIZE;
+
+   for (tries = 0; tries < AUTOSAVE_SNAPSHOT_TRIES; tries++)
+   {
+      size_t i;
+      unsigned generation = 0;
+      size_t dirty_blocks = 0;
+      bool changed        = false;
+
+      for (i = 0; i < save->num_blocks && !changed; )
+      {
+         size_t end = MIN(i + blocks_per_slice, save->num_blocks);
+
+         slock_lock(save->lock);
+
+         if (i == 0)
+            generation = save->generation;
+         else
+            changed    = (save->generation != generation);
+
+         for (; i < end && !changed; i++)
+         {
+            size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+            size_t len    = MIN(AUTOSAVE_BLOCK_SIZE, save->bufsize - offset);
+            uint8_t *buf  = (uint8_t*)save->buffer + offset;
+            const uint8_t *retro_buf = (const uint8_t*)save->retro_buffer + offset;
+
+            if (memcmp(buf, retro_buf, len) != 0)
+            {
+               memcpy(buf, retro_buf, len);
+               save->dirty[i] = 1;
+            }
+
+            if (save->dirty[i])
+               dirty_blocks++;
+         }
+
+         slock_unlock(save->lock);
+      }
+
+      if (!changed)
+         return dirty_blocks;
+   }
+
+   return 0;
+}
+
+/**
+ * autosave_replace_file:
+ * @tmp_path        : path to the freshly written file
+ * @path            : path to the save file
+ *
+ * Move @tmp_path over @path in one step.
+ *
+ * Returns: true on success.
+ **/
+static bool autosave_replace_file(const char *tmp_path, const char *path)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   /* rename() won't replace an existing file here */
+   bool ret           = false;
+   wchar_t *tmp_wide  = utf8_to_utf16_string_alloc(tmp_path);
+   wchar_t *path_wide = utf8_to_utf16_string_alloc(path);
+
+   if (tmp_wide && path_wide)
+      ret = MoveFileExW(tmp_wide, path_wide,
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+   free(tmp_wide);
+   free(path_wide);
+
+   return ret;
+#else
+#ifdef _XBOX
+   if (path_file_exists(path))
+      path_file_remove(path);
+#endif
+   return rename(tmp_path, path) == 0;
+#endif
+}
+
+/**
+ * autosave_write_all:
+ * @save            : pointer to autosave object
+ *
+ * Write the whole snapshot to a temporary file and move it over the save
+ * file, so a crash never leaves a half written save behind.
+ *
+ * Returns: true on success.
+ **/
+static bool autosave_write_all(autosave_t *save)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   bool failed = false;
+   RFILE *file = NULL;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", save->path);
+
+   file = filestream_open(tmp_path, RFILE_MODE_WRITE, -1);
+   if (!file)
+      return false;
+
+   failed |= ((size_t)filestream_write(file, save->buffer, save->bufsize) != save->bufsize);
+   failed |= (filestream_flush(file) != 0);
+   failed |= (filestream_close(file) != 0);
+
+   if (failed || !autosave_replace_file(tmp_path, save->path))
+   {
+      path_file_remove(tmp_path);
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * autosave_write_dirty:
+ * @save            : pointer to autosave object
+ *
+ * Write only the dirty blocks into the existing save file, one run of
+ * adjacent blocks at a time.
+ *
+ * Returns: true on success.
+ **/
+static bool autosave_write_dirty(autosave_t *save)
+{
+   size_t i;
+   bool failed = false;
+   RFILE *file = filestream_open(save->path,
+         RFILE_MODE_READ_WRITE | RFILE_HINT_UNBUFFERED, -1);
+
+   if (!file)
+      return false;
+
+   for (i = 0; i < save->num_blocks && !failed; )
+   {
+      size_t start, offset, len;
+
+      if (!save->dirty[i])
+      {
+         i++;
+         continue;
+      }
+
+      for (start = i; i < save->num_blocks && save->dirty[i]; i++);
+
+      offset = start * AUTOSAVE_BLOCK_SIZE;
+      len    = MIN(i * AUTOSAVE_BLOCK_SIZE, save->bufsize) - offset;
+
+      failed |= (filestream_seek(file, (ssize_t)offset, SEEK_SET) < 0);
+      failed |= !failed && ((size_t)filestream_write(file,
+               (const uint8_t*)save->buffer + offset, len) != len);
+   }
+
+   failed |= (filestream_flush(file) != 0);
+   failed |= (filestream_close(file) != 0);
+
+   return !failed;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -145,40 +390,35 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      bool differ;
-
-      slock_lock(save->lock);
-      differ = string_is_not_equal_fast(save->buffer, save->retro_buffer,
-            save->bufsize);
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      slock_unlock(save->lock);
+      size_t dirty_blocks = autosave_snapshot(save);
 
-      if (differ)
+      if (dirty_blocks)
       {
-         /* Should probably deal with this more elegantly. */
-         RFILE *file = filestream_open(save->path, RFILE_MODE_WRITE, -1);
+         bool written;
 
-         if (file)
+         /* Avoid spamming down stderr ... */
+         if (first_log)
          {
-            bool failed = false;
-
-            /* Avoid spamming down stderr ... */
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
-                     save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            failed |= ((size_t)filestream_write(file, save->buffer, save->bufsize) != save->bufsize);
-            failed |= (filestream_flush(file) != 0);
-            failed |= (filestream_close(file) != 0);
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
+                  save->path, save->interval);
+            first_log = false;
          }
+         else
+            RARCH_LOG("SRAM changed ... autosaving %u of %u blocks ...\n",
+                  (unsigned)dirty_blocks, (unsigned)save->num_blocks);
+
+         /* Patching is only worthwhile while most of the file is unchanged */
+         if (save->synced && dirty_blocks * 4 <= save->num_blocks)
+            written = autosave_write_dirty(save);
+         else
+            written = autosave_write_all(save);
+
+         /* After a failed patch the file's contents are unknown */
+         save->synced = written;
+         if (written)
+            memset(save->dirty, 0, save->num_blocks);
+         else
+            RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
       }
 
       slock_lock(save->cond_lock);
@@ -220,8 +460,12 @@ static autosave_t *autosave_new(const char *path,
    handle->buffer                = malloc(size);
    handle->retro_buffer          = data;
    handle->path                  = path;
+   handle->num_blocks            = (size + AUTOSAVE_BLOCK_SIZE - 1) / AUTOSAVE_BLOCK_SIZE;
+   handle->dirty                 = (uint8_t*)calloc(handle->num_blocks, 1);
+   handle->synced                = false;
+   handle->generation            = 0;
 
-   if (!handle->buffer)
+   if (!handle->buffer || !handle->dirty)
       goto error;
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
@@ -235,7 +479,13 @@ static autosave_t *autosave_new(const char *path,
 
 error:
    if (handle)
+   {
+      if (handle->buffer)
+         free(handle->buffer);
+      if (handle->dirty)
+         free(handle->dirty);
       free(handle);
+   }
    return NULL;
 }
 
@@ -260,6 +510,10 @@ static void autosave_free(autosave_t *handle)
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
+
+   if (handle->dirty)
+      free(handle->dirty);
+   handle->dirty = NULL;
 }
 
 
@@ -369,7 +623,10 @@ void autosave_unlock(void)
    {
       autosave_t *handle = autosave_state.list[i];
       if (handle)
+      {
+         handle->generation++;
          slock_unlock(handle->lock);
+      }
    }
 #endif
 }
@@ -502,9 +759,275 @@ bool content_undo_load_state(void)
    return ret;
 }
 
+static void state_file_put32(uint8_t *p, uint32_t val)
+{
+   p[0] = (uint8_t)(val);
+   p[1] = (uint8_t)(val >> 8);
+   p[2] = (uint8_t)(val >> 16);
+   p[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t state_file_get32(const uint8_t *p)
+{
+   return (uint32_t)p[0]         | ((uint32_t)p[1] << 8) |
+         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * state_file_header_init:
+ * @state : the save task
+ *
+ * Decide whether the state is saved in the container, and if so fill in
+ * its header as far as it is known before the state is written.
+ **/
+static void state_file_header_init(save_task_state_t *state)
+{
+   uint64_t now;
+   uint32_t flags              = STATE_FILE_FLAG_COMPRESSED;
+   uint8_t *header             = state->header;
+   const char *content_path    = path_get(RARCH_PATH_BASENAME);
+   settings_t *settings        = config_get_ptr();
+   rarch_system_info_t *system = runloop_get_system_info();
+
+   state->zbackend  = trans_stream_get_zlib_deflate_backend();
+   state->container = settings->bools.savestate_file_compression
+      && state->zbackend;
+
+   if (!state->container)
+      return;
+
+   if (state->thumbnail_enable)
+      flags |= STATE_FILE_FLAG_THUMBNAIL;
+
+   now = (uint64_t)time(NULL);
+
+   memset(header, 0, STATE_FILE_HEADER_SIZE);
+   memcpy(header, STATE_FILE_MAGIC, sizeof(STATE_FILE_MAGIC));
+   state_file_put32(header + 8,  STATE_FILE_VERSION);
+   state_file_put32(header + 12, flags);
+   state_file_put32(header + 16, (uint32_t)state->size);
+   state_file_put32(header + 28, content_get_crc());
+   state_file_put32(header + 32, (uint32_t)now);
+   state_file_put32(header + 36, (uint32_t)(now >> 32));
+
+   if (system && !string_is_empty(system->info.library_name))
+      strlcpy((char*)header + 40, system->info.library_name, 64);
+   if (system && !string_is_empty(system->info.library_version))
+      strlcpy((char*)header + 104, system->info.library_version, 32);
+   if (!string_is_empty(content_path))
+      strlcpy((char*)header + 136, path_basename(content_path), 128);
+}
+
+/**
+ * state_file_header_parse:
+ * @header : the first STATE_FILE_HEADER_SIZE bytes of a state file
+ * @info   : where to put what the header says
+ *
+ * Returns: false if the file has no container header.
+ **/
+static bool state_file_header_parse(const uint8_t *header,
+      content_state_info_t *info)
+{
+   uint32_t flags;
+
+   if (memcmp(header, STATE_FILE_MAGIC, sizeof(STATE_FILE_MAGIC)) != 0
+         || state_file_get32(header + 8) != STATE_FILE_VERSION)
+      return false;
+
+   flags               = state_file_get32(header + 12);
+   info->compressed    = (flags & STATE_FILE_FLAG_COMPRESSED) ? true : false;
+   info->has_thumbnail = (flags & STATE_FILE_FLAG_THUMBNAIL)  ? true : false;
+   info->size          = state_file_get32(header + 16);
+   info->stored_size   = state_file_get32(header + 20);
+   info->crc           = state_file_get32(header + 24);
+   info->content_crc   = state_file_get32(header + 28);
+   info->timestamp     = (int64_t)(state_file_get32(header + 32)
+         | ((uint64_t)state_file_get32(header + 36) << 32));
+
+   memcpy(info->core_name,    header + 40,  sizeof(info->core_name)    - 1);
+   memcpy(info->core_version, header + 104, sizeof(info->core_version) - 1);
+   memcpy(info->content_name, header + 136, sizeof(info->content_name) - 1);
+   info->core_name[sizeof(info->core_name) - 1]       = '\0';
+   info->core_version[sizeof(info->core_version) - 1] = '\0';
+   info->content_name[sizeof(info->content_name) - 1] = '\0';
+
+   return true;
+}
+
+static void task_save_state_free_stream(save_task_state_t *state)
+{
+   if (state->zstream)
+      state->zbackend->stream_free(state->zstream);
+   state->zstream = NULL;
+
+   if (state->zbuf)
+      free(state->zbuf);
+   state->zbuf    = NULL;
+}
+
+/**
+ * task_save_compress_begin:
+ * @state : the save task
+ *
+ * Set up compression and write a placeholder header, which
+ * task_save_compress_end() completes.
+ *
+ * Returns: true on success.
+ **/
+static bool task_save_compress_begin(save_task_state_t *state)
+{
+   state->zstream = state->zbackend->stream_new();
+   state->zbuf    = (uint8_t*)malloc(STATE_FILE_CHUNK);
+
+   if (!state->zstream || !state->zbuf)
+      return false;
+
+   /* States are big and saved while the user plays, so favour speed */
+   state->zbackend->define(state->zstream, "level", 1);
+
+   return filestream_write(state->file, state->header,
+         STATE_FILE_HEADER_SIZE) == STATE_FILE_HEADER_SIZE;
+}
+
+/**
+ * task_save_compress:
+ * @state : the save task
+ * @in    : the next part of the state
+ * @len   : its length
+ * @flush : whether this is the last part
+ *
+ * Compress part of the state and write it out.
+ *
+ * Returns: true on success.
+ **/
+static bool task_save_compress(save_task_state_t *state,
+      const uint8_t *in, uint32_t len, bool flush)
+{
+   enum trans_stream_error error = TRANS_STREAM_ERROR_NONE;
+
+   state->crc = encoding_crc32(state->crc, in, len);
+   state->zbackend->set_in(state->zstream, in, len);
+
+   do
+   {
+      uint32_t rd = 0;
+      uint32_t wn = 0;
+
+      state->zbackend->set_out(state->zstream, state->zbuf, STATE_FILE_CHUNK);
+
+      if (!state->zbackend->trans(state->zstream, flush, &rd, &wn, &error)
+            && error != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      if ((uint32_t)filestream_write(state->file, state->zbuf, wn) != wn)
+         return false;
+
+      state->bytes_stored += wn;
+   } while (error == TRANS_STREAM_ERROR_BUFFER_FULL
+         || (flush && error != TRANS_STREAM_ERROR_NONE));
+
+   return true;
+}
+
+static bool task_save_compress_end(save_task_state_t *state)
+{
+   state_file_put32(state->header + 20, (uint32_t)state->bytes_stored);
+   state_file_put32(state->header + 24, state->crc);
+
+   if (filestream_seek(state->file, 0, SEEK_SET) != 0)
+      return false;
+
+   return filestream_write(state->file, state->header,
+         STATE_FILE_HEADER_SIZE) == STATE_FILE_HEADER_SIZE;
+}
+
+/**
+ * task_load_container_begin:
+ * @state : the load task
+ *
+ * If the file being loaded starts with a container header, prepare to read
+ * the state that follows it. Otherwise leave the file at its start to be
+ * read raw.
+ *
+ * Returns: false if the file can't be loaded.
+ **/
+static bool task_load_container_begin(save_task_state_t *state)
+{
+   content_state_info_t info;
+
+   if (state->size < STATE_FILE_HEADER_SIZE
+         || filestream_read(state->file, state->header,
+            STATE_FILE_HEADER_SIZE) != STATE_FILE_HEADER_SIZE
+         || !state_file_header_parse(state->header, &info))
+   {
+      filestream_rewind(state->file);
+      return true;
+   }
+
+   if ((ssize_t)info.stored_size > state->size - STATE_FILE_HEADER_SIZE
+         || (!info.compressed && info.stored_size != info.size))
+      return false;
+
+   state->container   = true;
+   state->compressed  = info.compressed;
+   state->size        = info.size;
+   state->stored_size = info.stored_size;
+
+   if (!state->compressed)
+      return true;
+
+   state->zbackend    = trans_stream_get_zlib_inflate_backend();
+   if (!state->zbackend)
+      return false;
+
+   state->zstream     = state->zbackend->stream_new();
+   state->zbuf        = (uint8_t*)malloc(STATE_FILE_CHUNK);
+
+   return state->zstream && state->zbuf;
+}
+
+/**
+ * task_load_decompress:
+ * @state : the load task
+ * @len   : how much of the stored state to read
+ *
+ * Read and decompress the next part of the state.
+ *
+ * Returns: true on success.
+ **/
+static bool task_load_decompress(save_task_state_t *state, ssize_t len)
+{
+   uint32_t rd                   = 0;
+   uint32_t wn                   = 0;
+   enum trans_stream_error error = TRANS_STREAM_ERROR_NONE;
+   uint8_t *out                  = (uint8_t*)state->data + state->bytes_read;
+   bool last                     = (state->bytes_stored + len == state->stored_size);
+
+   if (filestream_read(state->file, state->zbuf, len) != len)
+      return false;
+
+   state->zbackend->set_in(state->zstream, state->zbuf, (uint32_t)len);
+   state->zbackend->set_out(state->zstream, out,
+         (uint32_t)(state->size - state->bytes_read));
+
+   if (!state->zbackend->trans(state->zstream, last, &rd, &wn, &error))
+      return false;
+
+   state->crc           = encoding_crc32(state->crc, out, wn);
+   state->bytes_read   += wn;
+   state->bytes_stored += len;
+
+   /* All of the input must be used, and the last of it must end the
+    * stream exactly where the state ends */
+   return rd == (uint32_t)len && (!last
+         || (error == TRANS_STREAM_ERROR_NONE && state->bytes_read == state->size));
+}
+
 static void undo_save_state_cb(void *task_data,
                                void *user_data, const char *error)
 {
+   state_serial++;
+
    /* Wipe the save file buffer as it's intended to be one use only */
    undo_save_buf.path[0] = '\0';
    undo_save_buf.size    = 0;
@@ -530,6 +1053,7 @@ static void task_save_handler_finished(retro_task_t *task,
    task_set_finished(task, true);
 
    filestream_close(state->file);
+   task_save_state_free_stream(state);
 
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
@@ -560,6 +1084,7 @@ static void task_save_handler(retro_task_t *task)
 {
    int written;
    ssize_t remaining;
+   bool failed              = false;
    save_task_state_t *state = (save_task_state_t*)task->state;
 
    if (!state->file)
@@ -568,11 +1093,33 @@ static void task_save_handler(retro_task_t *task)
 
       if (!state->file)
          return;
+
+      if (state->container)
+         failed = !task_save_compress_begin(state);
    }
 
-   remaining       = MIN(state->size - state->written, SAVE_STATE_CHUNK);
-   written         = (int)filestream_write(state->file,
-         (uint8_t*)state->data + state->written, remaining);
+   if (state->container)
+   {
+      bool last;
+
+      remaining    = MIN(state->size - state->written, STATE_FILE_CHUNK);
+      last         = (state->written + remaining == state->size);
+
+      if (!failed)
+         failed    = !task_save_compress(state,
+               (const uint8_t*)state->data + state->written,
+               (uint32_t)remaining, last);
+      if (!failed && last)
+         failed    = !task_save_compress_end(state);
+
+      written      = failed ? 0 : (int)remaining;
+   }
+   else
+   {
+      remaining    = MIN(state->size - state->written, SAVE_STATE_CHUNK);
+      written      = (int)filestream_write(state->file,
+            (uint8_t*)state->data + state->written, remaining);
+   }
 
    state->written += written;
 
@@ -661,6 +1208,8 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    state->state_slot             = settings->ints.state_slot;
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 
+   state_file_header_init(state);
+
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
@@ -711,6 +1260,7 @@ static void task_load_handler_finished(retro_task_t *task,
 
    if (state->file)
       filestream_close(state->file);
+   task_save_state_free_stream(state);
 
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
@@ -732,6 +1282,7 @@ static void task_load_handler_finished(retro_task_t *task,
 static void task_load_handler(retro_task_t *task)
 {
    ssize_t remaining, bytes_read;
+   bool done                = false;
    save_task_state_t *state = (save_task_state_t*)task->state;
 
    if (!state->file)
@@ -751,19 +1302,46 @@ static void task_load_handler(retro_task_t *task)
 
       filestream_rewind(state->file);
 
+      if (!task_load_container_begin(state))
+         goto error;
+
       state->data = malloc(state->size + 1);
 
       if (!state->data)
          goto error;
    }
 
-   remaining          = MIN(state->size - state->bytes_read, SAVE_STATE_CHUNK);
-   bytes_read         = filestream_read(state->file,
-         (uint8_t*)state->data + state->bytes_read, remaining);
-   state->bytes_read += bytes_read;
+   if (state->compressed)
+   {
+      remaining          = MIN(state->stored_size - state->bytes_stored, STATE_FILE_CHUNK);
+      bytes_read         = task_load_decompress(state, remaining) ? remaining : -1;
+      done               = (state->bytes_stored == state->stored_size);
+
+      if (state->stored_size > 0)
+         task_set_progress(task, (state->bytes_stored / (float)state->stored_size) * 100);
+   }
+   else
+   {
+      remaining          = MIN(state->size - state->bytes_read, SAVE_STATE_CHUNK);
+      bytes_read         = filestream_read(state->file,
+            (uint8_t*)state->data + state->bytes_read, remaining);
+      if (state->container && bytes_read > 0)
+         state->crc      = encoding_crc32(state->crc,
+               (const uint8_t*)state->data + state->bytes_read, bytes_read);
+      state->bytes_read += bytes_read;
+      done               = (state->bytes_read == state->size);
+
+      if (state->size > 0)
+         task_set_progress(task, (state->bytes_read / (float)state->size) * 100);
+   }
 
-   if (state->size > 0)
-      task_set_progress(task, (state->bytes_read / (float)state->size) * 100);
+   if (done && state->container
+         && state->crc != state_file_get32(state->header + 24))
+   {
+      RARCH_ERR("Savestate \"%s\" is corrupt, its CRC doesn't match.\n",
+            state->path);
+      bytes_read = -1;
+   }
 
    if (task_get_cancelled(task) || bytes_read != remaining)
    {
@@ -791,7 +1369,7 @@ static void task_load_handler(retro_task_t *task)
       return;
    }
 
-   if (state->bytes_read == state->size)
+   if (done)
    {
       char *msg = (char*)malloc(1024 * sizeof(char));
 
@@ -856,6 +1434,8 @@ static void content_load_state_cb(void *task_data,
    struct sram_block *blocks   = NULL;
    settings_t *settings        = config_get_ptr();
 
+   state_serial++;
+
    RARCH_LOG("%s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_STATE),
          load_data->path);
@@ -998,6 +1578,8 @@ static void save_state_cb(void *task_data,
    save_task_state_t *state = (save_task_state_t*)task_data;
    char               *path = strdup(state->path);
 
+   state_serial++;
+
    if (state->thumbnail_enable)
       take_screenshot(path, true, state->has_valid_framebuffer);
 
@@ -1030,6 +1612,8 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    state->state_slot       = settings->ints.state_slot;
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 
+   state_file_header_init(state);
+
    task->type              = TASK_TYPE_BLOCKING;
    task->state             = state;
    task->handler           = task_save_handler;
@@ -1259,6 +1843,42 @@ error:
    return false;
 }
 
+/**
+ * content_get_state_info:
+ * @path      : path of a savestate file.
+ * @info      : where to put what its header says.
+ *
+ * Describe a savestate without reading the state itself.
+ *
+ * Returns: false if the file has no container header.
+ **/
+bool content_get_state_info(const char *path, content_state_info_t *info)
+{
+   uint8_t header[STATE_FILE_HEADER_SIZE];
+   bool ret    = false;
+   RFILE *file = filestream_open(path, RFILE_MODE_READ, -1);
+
+   if (!file)
+      return false;
+
+   if (filestream_read(file, header, sizeof(header)) == sizeof(header))
+      ret = state_file_header_parse(header, info);
+
+   filestream_close(file);
+   return ret;
+}
+
+/**
+ * content_get_state_serial:
+ *
+ * Returns: a number which changes whenever a state has been saved, loaded
+ * or restored, so anything describing states knows to look again.
+ **/
+unsigned content_get_state_serial(void)
+{
+   return state_serial;
+}
+
 bool content_rename_state(const char *origin, const char *dest)
 {
    int ret = 0;
@@ -65,6 +65,7 @@ struct screenshot_task_state
 {
    bool bgr24;
    bool silence;
+   bool fast_compression;
    bool is_idle;
    bool is_paused;
    bool history_list_enable;
@@ -135,12 +136,14 @@ static void task_screenshot_handler(retro_task_t *task)
 
    scaler_ctx_gen_reset(&state->scaler);
 
-   ret = rpng_save_image_bgr24(
+   ret = rpng_save_image_bgr24_mode(
          state->filename,
          state->out_buffer,
          state->width,
          state->height,
-         state->width * 3
+         state->width * 3,
+         state->fast_compression
+         ? RPNG_SAVE_MODE_FAST : RPNG_SAVE_MODE_QUALITY
          );
 
    free(state->out_buffer);
@@ -222,6 +225,7 @@ static bool screenshot_dump(
    state->userbuf             = userbuf;
    state->silence             = savestate;
    state->history_list_enable = settings->bools.history_list_enable;
+   state->fast_compression    = settings->bools.screenshot_fast_compression;
    state->pixel_format_type   = video_driver_get_pixel_format();
 
    if (savestate)
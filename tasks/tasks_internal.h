@@ -123,6 +123,12 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port);
 bool task_push_image_load(const char *fullpath,
       retro_task_callback_t cb, void *userdata);
 
+/* Like task_push_image_load, but the image may be decoded
+ * at a reduced size that still covers width x height. */
+bool task_push_image_load_scaled(const char *fullpath,
+      unsigned width, unsigned height,
+      retro_task_callback_t cb, void *userdata);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -0,0 +1,51 @@
+#!/bin/sh
+# Playback throughput benchmark for the FFmpeg core. Plays a video with
+# --benchmark, which runs the core flat out on null drivers, and reports how
+# much faster than realtime it played, along with the frame rate each stage
+# of the core's decode pipeline reached while it was busy.
+#
+# Use: bench.sh <retroarch> <ffmpeg core> [video] [frames]
+#
+# Without a video, a 1080p60 H.264 sample is made with the ffmpeg command.
+# The core always runs at 60 frames per second of media, so frames sets how
+# many seconds are played: 60 per 3600.
+
+RETROARCH="$1"
+CORE="$2"
+VIDEO="$3"
+FRAMES="${4:-3600}"
+DIR="$(mktemp -d)"
+
+if [ -z "$RETROARCH" ] || [ -z "$CORE" ]; then
+   echo "Use: $0 <retroarch> <ffmpeg core> [video] [frames]" >&2
+   exit 2
+fi
+
+if [ -z "$VIDEO" ]; then
+   VIDEO="$DIR/sample.mkv"
+   SECONDS_NEEDED=$((FRAMES / 60 + 10))
+   if ! ffmpeg -v error -f lavfi -i testsrc2=size=1920x1080:rate=60 \
+         -f lavfi -i sine=frequency=440:sample_rate=48000 \
+         -t "$SECONDS_NEEDED" -c:v libx264 -preset veryfast -pix_fmt yuv420p \
+         -c:a aac "$VIDEO"; then
+      echo "Couldn't make a sample video, give one instead." >&2
+      rm -rf "$DIR"
+      exit 2
+   fi
+fi
+
+# The core shuts down at the end of the video, so a short one ends the
+# benchmark early and is reported over fewer frames
+"$RETROARCH" -v --benchmark="$FRAMES" -L "$CORE" "$VIDEO" \
+   > "$DIR/bench.out" 2> "$DIR/bench.log"
+RESULT=$?
+
+grep "^Benchmark:" "$DIR/bench.out"
+grep -h "\[FFmpeg\]: Video" "$DIR/bench.log"
+
+if [ $RESULT -ne 0 ] || ! grep -q "^Benchmark:" "$DIR/bench.out"; then
+   echo "The benchmark didn't finish. Logs are in $DIR."
+   exit 1
+fi
+
+rm -rf "$DIR"
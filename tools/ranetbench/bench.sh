@@ -0,0 +1,68 @@
+#!/bin/sh
+# Spectator fan-out benchmark. Runs a netplay host and connects a growing
+# number of spectators to it, first with the host running as fast as it will
+# go, then at 60 frames per second. Each run reports how fast the host ran,
+# how its frames were spaced, and how far apart the first and last spectator
+# received each frame.
+#
+# Use: bench.sh <retroarch> <core> [spectator counts...]
+#
+# Any core that runs without content will do, such as the one in
+# tools/ranetloss.
+
+RETROARCH="$1"
+CORE="$2"
+HERE="$(cd "$(dirname "$0")" && pwd)"
+DIR="$(mktemp -d)"
+PORT=55545
+SECONDS_PER_RUN=5
+
+if [ -z "$RETROARCH" ] || [ -z "$CORE" ]; then
+   echo "Use: $0 <retroarch> <core> [spectator counts...]" >&2
+   exit 2
+fi
+shift 2
+COUNTS="${*:-1 8 32 64}"
+
+make -s -C "$HERE" || exit 2
+
+cat > "$DIR/host.cfg" <<CFG
+video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+config_save_on_exit = false
+savefile_directory = "$DIR"
+savestate_directory = "$DIR"
+netplay_ip_port = $PORT
+netplay_public_announce = false
+netplay_nat_traversal = false
+netplay_check_frames = 0
+CFG
+
+for ratio in 0 1; do
+   if [ $ratio -eq 0 ]; then
+      echo "Unthrottled:"
+   else
+      echo "60 frames per second:"
+   fi
+   cp "$DIR/host.cfg" "$DIR/run.cfg"
+   echo "fastforward_ratio = \"$ratio.000000\"" >> "$DIR/run.cfg"
+
+   for n in $COUNTS; do
+      "$RETROARCH" --config "$DIR/run.cfg" -L "$CORE" --host -v \
+         2> "$DIR/host.log" &
+      HOST=$!
+      sleep 1
+      "$HERE/ranetbench" -P $PORT -n "$n" -t $SECONDS_PER_RUN
+      RESULT=$?
+      kill $HOST
+      wait $HOST 2> /dev/null
+      if [ $RESULT -ne 0 ]; then
+         echo "Logs are in $DIR."
+         exit 1
+      fi
+      echo
+   done
+done
+
+rm -rf "$DIR"
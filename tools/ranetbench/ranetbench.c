@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2017 The RetroArch team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "compat/getopt.h"
+#include "net/net_socket.h"
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+
+/* How many recent frames we track the arrival of */
+#define BENCH_FRAMES 4096
+
+/* How long we let the spectators catch up after connecting before measuring */
+#define BENCH_WARMUP_US 1000000
+
+/* A spectator, and where it is in the command stream */
+struct bench_client
+{
+   int fd;
+
+   /* The command header, then the first two words of the payload */
+   uint32_t words[4];
+   size_t words_len;
+
+   /* What's left of the current payload to read past */
+   size_t skip;
+
+   unsigned long bytes;
+};
+
+/* When a frame of the host's input first and last arrived */
+struct bench_frame
+{
+   uint32_t frame;
+   unsigned clients;
+   int64_t first, last;
+};
+
+static struct bench_client *clients;
+static size_t clients_count = 16;
+static struct bench_frame frames[BENCH_FRAMES];
+
+struct bench_samples
+{
+   int64_t *values;
+   size_t count, size;
+};
+
+/* Spreads of complete frames, and the interval between frames at the first
+ * client */
+static struct bench_samples spreads, intervals;
+static int64_t last_arrival, measure_start;
+/* The newest frame any spectator had when we started measuring, and since */
+static uint32_t first_frame, last_frame;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: ranetbench [options]\n"
+      "Options:\n"
+      "    -H|--host <address>:  Netplay host. Defaults to localhost.\n"
+      "    -P|--port <port>:     Netplay port. Defaults to 55435.\n"
+      "    -n|--clients <n>:     Number of spectators to connect. Defaults to\n"
+      "                          16.\n"
+      "    -t|--time <seconds>:  How long to measure for. Defaults to 10.\n"
+      "\n");
+}
+
+static int64_t now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Connect and go through the handshake as a spectator, as ranetplayer does */
+static int client_connect(const char *host, int port, unsigned num)
+{
+   struct addrinfo *addr = NULL;
+   uint32_t buf[8], cmd[2];
+   uint32_t *payload;
+   size_t size;
+   int fd;
+
+   if ((fd = socket_init((void **) &addr, port, host,
+               SOCKET_TYPE_STREAM)) < 0)
+      return -1;
+
+   if (socket_connect(fd, addr, false) < 0)
+      goto error;
+   freeaddrinfo_retro(addr);
+   addr = NULL;
+
+   /* Echo the header */
+   if (!socket_receive_all_blocking(fd, buf, 4 * sizeof(uint32_t)) ||
+         buf[3] ||
+         !socket_send_all_blocking(fd, buf, 4 * sizeof(uint32_t), true))
+      goto error;
+
+   /* Nickname */
+   cmd[0] = htonl(NETPLAY_CMD_NICK);
+   cmd[1] = htonl(NETPLAY_NICK_LEN);
+   memset(buf, 0, sizeof(buf));
+   snprintf((char *) buf, NETPLAY_NICK_LEN, "RANetbench%u", num);
+   if (!socket_send_all_blocking(fd, cmd, sizeof(cmd), true) ||
+         !socket_send_all_blocking(fd, buf, NETPLAY_NICK_LEN, true))
+      goto error;
+
+   /* Their nickname, INFO (which we echo) and SYNC */
+   while (1)
+   {
+      if (!socket_receive_all_blocking(fd, cmd, sizeof(cmd)))
+         goto error;
+      size    = ntohl(cmd[1]);
+      payload = (uint32_t *) malloc(size ? size : 1);
+      if (!payload || !socket_receive_all_blocking(fd, payload, size))
+      {
+         free(payload);
+         goto error;
+      }
+
+      if (ntohl(cmd[0]) == NETPLAY_CMD_INFO &&
+            (!socket_send_all_blocking(fd, cmd, sizeof(cmd), true) ||
+             !socket_send_all_blocking(fd, payload, size, true)))
+      {
+         free(payload);
+         goto error;
+      }
+      free(payload);
+
+      if (ntohl(cmd[0]) == NETPLAY_CMD_SYNC)
+         break;
+   }
+
+   if (!socket_nonblock(fd))
+      goto error;
+   return fd;
+
+error:
+   if (addr)
+      freeaddrinfo_retro(addr);
+   socket_close(fd);
+   return -1;
+}
+
+static void record_sample(struct bench_samples *samples, int64_t value)
+{
+   if (samples->count == samples->size)
+   {
+      size_t new_size     = samples->size ? samples->size * 2 : 4096;
+      int64_t *new_values = (int64_t *) realloc(samples->values,
+            new_size * sizeof(int64_t));
+      if (!new_values)
+         return;
+      samples->values = new_values;
+      samples->size   = new_size;
+   }
+
+   samples->values[samples->count++] = value;
+}
+
+/* The host's input for a frame reached a client */
+static void frame_arrived(size_t i, uint32_t frame, int64_t now)
+{
+   struct bench_frame *bf = &frames[frame % BENCH_FRAMES];
+
+   if (now < measure_start)
+      return;
+
+   if (bf->frame != frame || !bf->clients)
+   {
+      bf->frame   = frame;
+      bf->clients = 0;
+      bf->first   = now;
+   }
+   if (!first_frame)
+      first_frame = frame;
+   if (frame > last_frame)
+      last_frame = frame;
+
+   bf->last = now;
+   if (++bf->clients == clients_count)
+      record_sample(&spreads, bf->last - bf->first);
+
+   if (i == 0)
+   {
+      if (last_arrival)
+         record_sample(&intervals, now - last_arrival);
+      last_arrival = now;
+   }
+}
+
+/* Read what's waiting from a client. False if it's gone. */
+static bool client_read(size_t i, int64_t now)
+{
+   struct bench_client *client = &clients[i];
+   unsigned char buf[65536];
+   size_t pos = 0;
+   ssize_t got = recv(client->fd, (char *) buf, sizeof(buf), 0);
+
+   if (got <= 0)
+      return false;
+   if (now >= measure_start)
+      client->bytes += got;
+
+   while (pos < (size_t) got)
+   {
+      size_t take;
+
+      if (client->skip)
+      {
+         take          = (size_t) got - pos;
+         if (take > client->skip)
+            take = client->skip;
+         client->skip -= take;
+         pos          += take;
+         continue;
+      }
+
+      /* The command header, then up to two words of its payload */
+      if (client->words_len < 2 * sizeof(uint32_t))
+         take = 2 * sizeof(uint32_t) - client->words_len;
+      else
+      {
+         size_t size = ntohl(client->words[1]);
+         size_t have = client->words_len - 2 * sizeof(uint32_t);
+         take        = 4 * sizeof(uint32_t) - client->words_len;
+         if (size - have < take)
+            take = size - have;
+      }
+      if (take > (size_t) got - pos)
+         take = (size_t) got - pos;
+      memcpy((char *) client->words + client->words_len, buf + pos, take);
+      client->words_len += take;
+      pos               += take;
+
+      if (client->words_len < 2 * sizeof(uint32_t))
+         continue;
+      {
+         uint32_t cmd  = ntohl(client->words[0]);
+         size_t size   = ntohl(client->words[1]);
+         size_t have   = client->words_len - 2 * sizeof(uint32_t);
+
+         if (have < size && have < 2 * sizeof(uint32_t))
+            continue;
+
+         if (cmd == NETPLAY_CMD_INPUT && have >= 2 * sizeof(uint32_t) &&
+               (ntohl(client->words[3]) & NETPLAY_CMD_INPUT_BIT_SERVER))
+            frame_arrived(i, ntohl(client->words[2]), now);
+
+         client->skip      = size - have;
+         client->words_len = 0;
+      }
+   }
+
+   return true;
+}
+
+static int cmp_sample(const void *a, const void *b)
+{
+   int64_t x = *(const int64_t *) a;
+   int64_t y = *(const int64_t *) b;
+   return (x > y) - (x < y);
+}
+
+static void report(const char *name, struct bench_samples *samples)
+{
+   int64_t *values = samples->values;
+   size_t count    = samples->count;
+
+   if (!count)
+   {
+      printf("%s: no samples\n", name);
+      return;
+   }
+
+   qsort(values, count, sizeof(*values), cmp_sample);
+   printf("%s: p50 %u us, p99 %u us, max %u us\n", name,
+         (unsigned) values[count / 2],
+         (unsigned) values[(count * 99) / 100],
+         (unsigned) values[count - 1]);
+}
+
+int main(int argc, char **argv)
+{
+   struct pollfd *fds;
+   const char *host = "localhost";
+   int port         = RARCH_DEFAULT_PORT;
+   int seconds      = 10;
+   int64_t end;
+   unsigned long bytes = 0;
+   size_t i;
+
+   const struct option opt[] = {
+      {"host",       1, NULL, 'H'},
+      {"port",       1, NULL, 'P'},
+      {"clients",    1, NULL, 'n'},
+      {"time",       1, NULL, 't'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c;
+
+      c = getopt_long(argc, argv, "H:P:n:t:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'H':
+            host = optarg;
+            break;
+
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         case 'n':
+            clients_count = (size_t) atoi(optarg);
+            break;
+
+         case 't':
+            seconds = atoi(optarg);
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!clients_count || seconds <= 0)
+   {
+      usage();
+      return 1;
+   }
+
+#ifdef SIGPIPE
+   signal(SIGPIPE, SIG_IGN);
+#endif
+
+   clients = (struct bench_client *) calloc(clients_count, sizeof(*clients));
+   fds     = (struct pollfd *) calloc(clients_count, sizeof(*fds));
+   if (!clients || !fds)
+   {
+      perror("calloc");
+      return 1;
+   }
+
+   for (i = 0; i < clients_count; i++)
+   {
+      if ((clients[i].fd = client_connect(host, port, (unsigned) i)) < 0)
+      {
+         fprintf(stderr, "Failed to connect spectator %u.\n", (unsigned) i);
+         return 1;
+      }
+      fds[i].fd     = clients[i].fd;
+      fds[i].events = POLLIN;
+   }
+
+   measure_start = now_us() + BENCH_WARMUP_US;
+   end           = measure_start + (int64_t) seconds * 1000000;
+
+   while (1)
+   {
+      int64_t now = now_us();
+
+      if (now >= end)
+         break;
+
+      if (poll(fds, clients_count, (int) ((end - now) / 1000) + 1) < 0)
+      {
+         perror("poll");
+         return 1;
+      }
+
+      now = now_us();
+      for (i = 0; i < clients_count; i++)
+      {
+         if (!(fds[i].revents & (POLLIN|POLLHUP|POLLERR)))
+            continue;
+         if (!client_read(i, now))
+         {
+            fprintf(stderr, "Spectator %u was disconnected.\n", (unsigned) i);
+            return 1;
+         }
+      }
+   }
+
+   for (i = 0; i < clients_count; i++)
+   {
+      bytes += clients[i].bytes;
+      socket_close(clients[i].fd);
+   }
+
+   printf("%u spectators: host ran %.1f frames/s, %.1f KiB/s per spectator\n",
+         (unsigned) clients_count,
+         (double) (last_frame - first_frame) / seconds,
+         (double) bytes / clients_count / seconds / 1024);
+   report("Host frame interval", &intervals);
+   report("Fan-out spread", &spreads);
+
+   free(spreads.values);
+   free(intervals.values);
+   free(clients);
+   free(fds);
+   return 0;
+}
@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2017 The RetroArch team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "compat/getopt.h"
+#include "net/net_socket.h"
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+
+/* Largest datagram we'll pass on. Netplay's are far smaller. */
+#define LOSS_DGRAM_SIZE 2048
+
+/* Most datagrams or TCP reads we'll hold at once */
+#define LOSS_QUEUE_SIZE 4096
+
+/* Most network gamepads we'll drive */
+#define LOSS_MAX_INPUTS 4
+
+/* How often we change a button on each network gamepad */
+#define LOSS_INPUT_MS 16
+
+/* Mirrors input_remote.c */
+struct remote_message
+{
+   uint16_t state;
+   int port;
+   int device;
+   int index;
+   int id;
+};
+
+/* A TCP read or a datagram waiting for its delivery time */
+struct loss_packet
+{
+   int64_t due;
+   uint32_t seq;
+   size_t start, len;
+   unsigned char *data;
+};
+
+struct loss_queue
+{
+   struct loss_packet packets[LOSS_QUEUE_SIZE];
+   size_t count;
+
+   /* For datagrams: the next sequence number, and the last one delivered */
+   uint32_t next_seq, last_seq;
+};
+
+/* One direction of traffic */
+struct loss_dir
+{
+   const char *name;
+   struct loss_queue tcp, udp;
+   unsigned long datagrams, dropped, reordered;
+};
+
+static int loss_percent = 25;
+static int jitter_ms    = 30;
+static int delay_ms     = 40;
+
+static volatile sig_atomic_t quit;
+
+static int input_fd = -1;
+static struct sockaddr_storage input_addrs[LOSS_MAX_INPUTS];
+static socklen_t input_addr_sizes[LOSS_MAX_INPUTS];
+static uint16_t input_states[LOSS_MAX_INPUTS];
+static size_t inputs;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: ranetloss [options]\n"
+      "Options:\n"
+      "    -P|--port <port>:        Port to listen on. Defaults to 55436.\n"
+      "    -H|--host <address>:     Netplay host to forward to. Defaults to\n"
+      "                             127.0.0.1.\n"
+      "    -p|--host-port <port>:   Port of the netplay host. Defaults to\n"
+      "                             55435.\n"
+      "    -l|--loss <percent>:     Percentage of datagrams to drop. Defaults\n"
+      "                             to 25.\n"
+      "    -j|--jitter <ms>:        Maximum random delay added to each\n"
+      "                             datagram, which reorders them. Defaults\n"
+      "                             to 30.\n"
+      "    -d|--delay <ms>:         Delay added to the TCP stream in each\n"
+      "                             direction. Defaults to 40.\n"
+      "    -i|--input <port>:       Press random buttons on the network\n"
+      "                             gamepad at this local port. May be given\n"
+      "                             up to 4 times.\n"
+      "\n");
+}
+
+static int64_t now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool queue_push(struct loss_queue *queue, int64_t due,
+   const void *data, size_t len)
+{
+   struct loss_packet *packet;
+
+   if (queue->count == LOSS_QUEUE_SIZE)
+      return false;
+
+   packet        = &queue->packets[queue->count];
+   packet->data  = (unsigned char *) malloc(len);
+   if (!packet->data)
+      return false;
+   memcpy(packet->data, data, len);
+   packet->due   = due;
+   packet->seq   = queue->next_seq++;
+   packet->start = 0;
+   packet->len   = len;
+   queue->count++;
+   return true;
+}
+
+static void queue_remove(struct loss_queue *queue, size_t i)
+{
+   free(queue->packets[i].data);
+   memmove(queue->packets + i, queue->packets + i + 1,
+         (queue->count - i - 1) * sizeof(struct loss_packet));
+   queue->count--;
+}
+
+static void queue_clear(struct loss_queue *queue)
+{
+   while (queue->count)
+      queue_remove(queue, queue->count - 1);
+   queue->next_seq = queue->last_seq = 0;
+}
+
+/* How long until something in the queue is due, or -1 if it's empty */
+static int queue_timeout(const struct loss_queue *queue, int64_t now)
+{
+   size_t i;
+   int64_t first = -1;
+
+   for (i = 0; i < queue->count; i++)
+      if (first < 0 || queue->packets[i].due < first)
+         first = queue->packets[i].due;
+
+   if (first < 0)
+      return -1;
+   return first > now ? (int) (first - now) : 0;
+}
+
+static int min_timeout(int a, int b)
+{
+   if (a < 0)
+      return b;
+   if (b < 0)
+      return a;
+   return a < b ? a : b;
+}
+
+/* Pass on the TCP stream in order, as far as it's due. False on error. */
+static bool tcp_flush(struct loss_queue *queue, int fd, int64_t now)
+{
+   while (queue->count && queue->packets[0].due <= now)
+   {
+      struct loss_packet *packet = &queue->packets[0];
+      ssize_t sent = socket_send_all_nonblocking(fd,
+            packet->data + packet->start, packet->len - packet->start, true);
+
+      if (sent < 0)
+         return false;
+
+      packet->start += sent;
+      if (packet->start < packet->len)
+         break;
+      queue_remove(queue, 0);
+   }
+
+   return true;
+}
+
+/* Send every due datagram, in whatever order the jitter put them in */
+static void udp_flush(struct loss_dir *dir, int fd,
+   const struct sockaddr_storage *addr, socklen_t addr_size, int64_t now)
+{
+   size_t i = 0;
+
+   while (i < dir->udp.count)
+   {
+      struct loss_packet *packet = &dir->udp.packets[i];
+
+      if (packet->due > now)
+      {
+         i++;
+         continue;
+      }
+
+      if (packet->seq < dir->udp.last_seq)
+         dir->reordered++;
+      else
+         dir->udp.last_seq = packet->seq;
+
+      sendto(fd, (const char *) packet->data, packet->len, 0,
+            (const struct sockaddr *) addr, addr_size);
+      queue_remove(&dir->udp, i);
+   }
+}
+
+/* Take a datagram from one side, and maybe deliver it to the other later */
+static void udp_read(struct loss_dir *dir, int fd,
+   struct sockaddr_storage *from, socklen_t *from_size, int64_t now)
+{
+   unsigned char buf[LOSS_DGRAM_SIZE];
+   struct sockaddr_storage addr;
+   socklen_t addr_size;
+   ssize_t got;
+
+   for (;;)
+   {
+      addr_size = sizeof(addr);
+      got       = recvfrom(fd, (char *) buf, sizeof(buf), 0,
+            (struct sockaddr *) &addr, &addr_size);
+      if (got <= 0)
+         return;
+
+      if (from)
+      {
+         memcpy(from, &addr, sizeof(addr));
+         *from_size = addr_size;
+      }
+
+      dir->datagrams++;
+      if (rand() % 100 < loss_percent)
+      {
+         dir->dropped++;
+         dir->udp.next_seq++;
+         continue;
+      }
+
+      queue_push(&dir->udp,
+            now + (jitter_ms ? rand() % (jitter_ms + 1) : 0), buf, got);
+   }
+}
+
+/* Take what's readable from one side of the TCP stream */
+static bool tcp_read(struct loss_dir *dir, int fd, int64_t now)
+{
+   unsigned char buf[65536];
+   ssize_t got = recv(fd, (char *) buf, sizeof(buf), 0);
+
+   if (got <= 0)
+      return false;
+
+   return queue_push(&dir->tcp, now + delay_ms, buf, got);
+}
+
+static void dir_report(struct loss_dir *dir)
+{
+   fprintf(stderr, "%s: %lu datagrams, %lu dropped, %lu reordered.\n",
+         dir->name, dir->datagrams, dir->dropped, dir->reordered);
+   queue_clear(&dir->tcp);
+   queue_clear(&dir->udp);
+   dir->datagrams = dir->dropped = dir->reordered = 0;
+}
+
+/* Flip a random button on every network gamepad we drive */
+static void input_send(void)
+{
+   size_t i;
+
+   for (i = 0; i < inputs; i++)
+   {
+      struct remote_message msg;
+      int id = rand() % 16;
+
+      input_states[i] ^= 1 << id;
+      memset(&msg, 0, sizeof(msg));
+      msg.state  = (input_states[i] >> id) & 1;
+      msg.device = RETRO_DEVICE_JOYPAD;
+      msg.id     = id;
+      sendto(input_fd, (const char *) &msg, sizeof(msg), 0,
+            (const struct sockaddr *) &input_addrs[i], input_addr_sizes[i]);
+   }
+}
+
+static void quit_handler(int sig)
+{
+   (void)sig;
+   quit = 1;
+}
+
+static int open_udp(uint16_t port, const char *server,
+   struct sockaddr_storage *addr, socklen_t *addr_size)
+{
+   struct addrinfo *ai = NULL;
+   int fd = socket_init((void **) &ai, port, server, SOCKET_TYPE_DATAGRAM);
+
+   if (fd < 0)
+      return -1;
+
+   if (addr)
+   {
+      /* Just resolving the host's address */
+      memcpy(addr, ai->ai_addr, ai->ai_addrlen);
+      *addr_size = (socklen_t) ai->ai_addrlen;
+      freeaddrinfo_retro(ai);
+      socket_close(fd);
+
+      if ((fd = socket_init((void **) &ai, 0, NULL,
+               SOCKET_TYPE_DATAGRAM)) < 0)
+         return -1;
+   }
+
+   if (!socket_bind(fd, ai) || !socket_nonblock(fd))
+   {
+      freeaddrinfo_retro(ai);
+      socket_close(fd);
+      return -1;
+   }
+
+   freeaddrinfo_retro(ai);
+   return fd;
+}
+
+int main(int argc, char **argv)
+{
+   static struct loss_dir up, down;
+   struct addrinfo *addr;
+   struct sockaddr_storage host_udp_addr, client_udp_addr;
+   socklen_t host_udp_addr_size, client_udp_addr_size = 0;
+   const char *host = "127.0.0.1";
+   int port         = RARCH_DEFAULT_PORT + 1;
+   int host_port    = RARCH_DEFAULT_PORT;
+   int listen_fd, udp_listen_fd, udp_host_fd;
+   int client_fd    = -1;
+   int host_fd      = -1;
+   int64_t next_input;
+
+   const struct option opt[] = {
+      {"port",       1, NULL, 'P'},
+      {"host",       1, NULL, 'H'},
+      {"host-port",  1, NULL, 'p'},
+      {"loss",       1, NULL, 'l'},
+      {"jitter",     1, NULL, 'j'},
+      {"delay",      1, NULL, 'd'},
+      {"input",      1, NULL, 'i'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c;
+
+      c = getopt_long(argc, argv, "P:H:p:l:j:d:i:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         case 'H':
+            host = optarg;
+            break;
+
+         case 'p':
+            host_port = atoi(optarg);
+            break;
+
+         case 'l':
+            loss_percent = atoi(optarg);
+            break;
+
+         case 'j':
+            jitter_ms = atoi(optarg);
+            break;
+
+         case 'd':
+            delay_ms = atoi(optarg);
+            break;
+
+         case 'i':
+            if (inputs == LOSS_MAX_INPUTS)
+            {
+               usage();
+               return 1;
+            }
+            {
+               int fd = open_udp((uint16_t) atoi(optarg), "127.0.0.1",
+                     &input_addrs[inputs], &input_addr_sizes[inputs]);
+               if (fd < 0)
+               {
+                  perror("input");
+                  return 1;
+               }
+               if (input_fd < 0)
+                  input_fd = fd;
+               else
+                  socket_close(fd);
+            }
+            inputs++;
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+#ifdef SIGPIPE
+   signal(SIGPIPE, SIG_IGN);
+#endif
+
+   signal(SIGINT, quit_handler);
+   signal(SIGTERM, quit_handler);
+
+   srand((unsigned) time(NULL));
+   up.name   = "Client to host";
+   down.name = "Host to client";
+
+   /* Netplay's UDP channel shares the TCP port number, so we listen on both */
+   if ((listen_fd = socket_init((void **) &addr, port, NULL,
+               SOCKET_TYPE_STREAM)) < 0)
+   {
+      perror("socket");
+      return 1;
+   }
+
+   if (!socket_bind(listen_fd, addr) || listen(listen_fd, 1) < 0)
+   {
+      perror("bind");
+      return 1;
+   }
+   freeaddrinfo_retro(addr);
+
+   udp_listen_fd = open_udp(port, NULL, NULL, NULL);
+   udp_host_fd   = open_udp(host_port, host, &host_udp_addr,
+         &host_udp_addr_size);
+   if (udp_listen_fd < 0 || udp_host_fd < 0)
+   {
+      perror("udp");
+      return 1;
+   }
+
+   next_input = now_ms();
+
+   fprintf(stderr, "Forwarding port %d to %s:%d, dropping %d%% of datagrams.\n",
+         port, host, host_port, loss_percent);
+
+   while (!quit)
+   {
+      struct pollfd fds[5];
+      int64_t now;
+      int timeout;
+      size_t nfds = 0;
+
+      fds[nfds].fd       = listen_fd;
+      fds[nfds++].events = client_fd < 0 ? POLLIN : 0;
+      fds[nfds].fd       = udp_listen_fd;
+      fds[nfds++].events = POLLIN;
+      fds[nfds].fd       = udp_host_fd;
+      fds[nfds++].events = POLLIN;
+      if (client_fd >= 0)
+      {
+         fds[nfds].fd       = client_fd;
+         fds[nfds++].events = POLLIN | (down.tcp.count ? POLLOUT : 0);
+         fds[nfds].fd       = host_fd;
+         fds[nfds++].events = POLLIN | (up.tcp.count ? POLLOUT : 0);
+      }
+
+      now     = now_ms();
+      timeout = min_timeout(
+            min_timeout(queue_timeout(&up.tcp, now),
+               queue_timeout(&down.tcp, now)),
+            min_timeout(queue_timeout(&up.udp, now),
+               queue_timeout(&down.udp, now)));
+      if (inputs)
+         timeout = min_timeout(timeout,
+               next_input > now ? (int) (next_input - now) : 0);
+
+      if (poll(fds, nfds, timeout) < 0)
+      {
+         if (quit)
+            break;
+         perror("poll");
+         return 1;
+      }
+      now = now_ms();
+
+      if (inputs && now >= next_input)
+      {
+         input_send();
+         next_input = now + LOSS_INPUT_MS;
+      }
+
+      if (fds[0].revents & POLLIN)
+      {
+         struct addrinfo *ai = NULL;
+
+         client_fd = accept(listen_fd, NULL, NULL);
+         host_fd   = socket_init((void **) &ai, host_port, host,
+               SOCKET_TYPE_STREAM);
+         if (client_fd < 0 || host_fd < 0 ||
+               socket_connect(host_fd, ai, false) < 0 ||
+               !socket_nonblock(client_fd) || !socket_nonblock(host_fd))
+         {
+            perror("connect");
+            if (client_fd >= 0)
+               socket_close(client_fd);
+            if (host_fd >= 0)
+               socket_close(host_fd);
+            client_fd = host_fd = -1;
+         }
+         if (ai)
+            freeaddrinfo_retro(ai);
+         continue;
+      }
+
+      if (fds[1].revents & POLLIN)
+         udp_read(&up, udp_listen_fd, &client_udp_addr,
+               &client_udp_addr_size, now);
+      if (fds[2].revents & POLLIN)
+         udp_read(&down, udp_host_fd, NULL, NULL, now);
+
+      udp_flush(&up, udp_host_fd, &host_udp_addr, host_udp_addr_size, now);
+      if (client_udp_addr_size)
+         udp_flush(&down, udp_listen_fd, &client_udp_addr,
+               client_udp_addr_size, now);
+
+      if (client_fd < 0)
+         continue;
+
+      if (((fds[3].revents & POLLIN) && !tcp_read(&up, client_fd, now)) ||
+          ((fds[4].revents & POLLIN) && !tcp_read(&down, host_fd, now)) ||
+          !tcp_flush(&up.tcp, host_fd, now) ||
+          !tcp_flush(&down.tcp, client_fd, now))
+      {
+         fprintf(stderr, "Connection closed.\n");
+         dir_report(&up);
+         dir_report(&down);
+         socket_close(client_fd);
+         socket_close(host_fd);
+         client_fd = host_fd = -1;
+         client_udp_addr_size = 0;
+      }
+   }
+
+   dir_report(&up);
+   dir_report(&down);
+   return 0;
+}
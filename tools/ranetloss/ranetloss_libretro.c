@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2017 The RetroArch team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* A core which remembers the input it ran each frame with. Rollbacks replay
+ * frames, so what's left at the end is what netplay finally settled on. On
+ * unload, the input of each frame is written to the file named by
+ * RANETLOSS_LOG, starting from the frame we were last brought up to date at,
+ * since a client only joins a host's session partway through. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+
+#define MAX_FRAMES 65536
+#define WIDTH      16
+#define HEIGHT     16
+
+struct frame_log
+{
+   uint16_t input[2];
+};
+
+static retro_environment_t environ_cb;
+static retro_video_refresh_t video_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_input_state_t input_state_cb;
+
+static uint32_t frame;
+static struct frame_log *frames;
+static uint32_t frames_min, frames_max;
+static uint32_t framebuf[WIDTH * HEIGHT];
+
+static uint16_t read_pad(unsigned port)
+{
+   uint16_t pad = 0;
+   unsigned id;
+
+   for (id = 0; id < 16; id++)
+      if (input_state_cb(port, RETRO_DEVICE_JOYPAD, 0, id))
+         pad |= 1 << id;
+   return pad;
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+   bool no_game = true;
+
+   environ_cb = cb;
+   environ_cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_game);
+}
+
+void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+void retro_set_audio_sample(retro_audio_sample_t cb) { (void)cb; }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { audio_batch_cb = cb; }
+void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+void retro_set_input_state(retro_input_state_t cb) { input_state_cb = cb; }
+
+void retro_init(void)
+{
+   frames = (struct frame_log *) calloc(MAX_FRAMES, sizeof(*frames));
+}
+
+void retro_deinit(void)
+{
+   const char *path = getenv("RANETLOSS_LOG");
+   FILE *log;
+   uint32_t i;
+
+   if (frames && path && (log = fopen(path, "w")))
+   {
+      for (i = frames_min; i < frames_max; i++)
+         fprintf(log, "%u %04x %04x\n", (unsigned) i,
+               frames[i].input[0], frames[i].input[1]);
+      fclose(log);
+   }
+
+   free(frames);
+   frames     = NULL;
+   frames_min = frames_max = 0;
+}
+
+unsigned retro_api_version(void)
+{
+   return RETRO_API_VERSION;
+}
+
+void retro_set_controller_port_device(unsigned port, unsigned device)
+{
+   (void)port;
+   (void)device;
+}
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->library_name     = "ranetloss";
+   info->library_version  = "1";
+   info->need_fullpath    = false;
+   info->valid_extensions = "";
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->timing.fps            = 60.0;
+   info->timing.sample_rate    = 48000.0;
+   info->geometry.base_width   = WIDTH;
+   info->geometry.base_height  = HEIGHT;
+   info->geometry.max_width    = WIDTH;
+   info->geometry.max_height   = HEIGHT;
+   info->geometry.aspect_ratio = 1.0f;
+}
+
+void retro_reset(void)
+{
+   frame = 0;
+}
+
+void retro_run(void)
+{
+   static int16_t silence[1600];
+   uint16_t input[2];
+
+   input_poll_cb();
+   input[0] = read_pad(0);
+   input[1] = read_pad(1);
+
+   /* Replays after a rollback overwrite what we predicted */
+   if (frames && frame < MAX_FRAMES)
+   {
+      frames[frame].input[0] = input[0];
+      frames[frame].input[1] = input[1];
+      if (frame >= frames_max)
+         frames_max = frame + 1;
+   }
+   frame++;
+
+   framebuf[0] = input[0] | (input[1] << 16);
+   video_cb(framebuf, WIDTH, HEIGHT, WIDTH * sizeof(uint32_t));
+   audio_batch_cb(silence, 800);
+}
+
+bool retro_load_game(const struct retro_game_info *info)
+{
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+
+   (void)info;
+   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+      return false;
+
+   retro_reset();
+   return true;
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num)
+{
+   (void)type;
+   (void)info;
+   (void)num;
+   return false;
+}
+
+void retro_unload_game(void)
+{
+}
+
+unsigned retro_get_region(void)
+{
+   return RETRO_REGION_NTSC;
+}
+
+size_t retro_serialize_size(void)
+{
+   return sizeof(frame);
+}
+
+bool retro_serialize(void *data, size_t size)
+{
+   if (size < sizeof(frame))
+      return false;
+   memcpy(data, &frame, sizeof(frame));
+   return true;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+   if (size < sizeof(frame))
+      return false;
+   memcpy(&frame, data, sizeof(frame));
+
+   /* A rollback goes back to a frame we ran. Anything else means we've
+    * joined a session, and what we ran before is meaningless. */
+   if (frame > frames_max)
+      frames_min = frame;
+   return true;
+}
+
+void *retro_get_memory_data(unsigned id)
+{
+   (void)id;
+   return NULL;
+}
+
+size_t retro_get_memory_size(unsigned id)
+{
+   (void)id;
+   return 0;
+}
+
+void retro_cheat_reset(void)
+{
+}
+
+void retro_cheat_set(unsigned index, bool enabled, const char *code)
+{
+   (void)index;
+   (void)enabled;
+   (void)code;
+}
@@ -0,0 +1,107 @@
+#!/bin/sh
+# Loopback test for the netplay UDP input channel. Runs a host and a client
+# with the ranetloss core, connected through ranetloss, which drops, delays
+# and reorders their datagrams and drives both with random input. Passes if
+# both peers ended up running every frame they shared with the same input,
+# and some of it arrived over UDP.
+#
+# Use: test.sh <retroarch> [frames] [loss percent]
+
+RETROARCH="$1"
+FRAMES="${2:-1800}"
+LOSS="${3:-25}"
+HERE="$(cd "$(dirname "$0")" && pwd)"
+DIR="$(mktemp -d)"
+HOST_PORT=55535
+PROXY_PORT=55536
+
+if [ -z "$RETROARCH" ]; then
+   echo "Use: $0 <retroarch> [frames] [loss percent]" >&2
+   exit 2
+fi
+
+make -s -C "$HERE" || exit 2
+
+for side in host client; do
+   if [ "$side" = host ]; then
+      port=$HOST_PORT remote_port=55600
+   else
+      port=$PROXY_PORT remote_port=55610
+   fi
+   cat > "$DIR/$side.cfg" <<EOF
+video_driver = "null"
+audio_driver = "null"
+input_driver = "null"
+config_save_on_exit = false
+savefile_directory = "$DIR"
+savestate_directory = "$DIR"
+network_remote_enable = true
+network_remote_enable_user_p1 = true
+network_remote_base_port = $remote_port
+netplay_ip_port = $port
+netplay_public_announce = false
+netplay_nat_traversal = false
+netplay_udp_input = true
+netplay_check_frames = 0
+netplay_start_as_spectator = false
+fastforward_ratio = "1.000000"
+input_menu_toggle_gamepad_combo = "0"
+EOF
+done
+
+"$HERE/ranetloss" -P $PROXY_PORT -p $HOST_PORT -l "$LOSS" \
+   -i 55600 -i 55610 2> "$DIR/ranetloss.log" &
+PROXY=$!
+
+RANETLOSS_LOG="$DIR/host.frames" "$RETROARCH" --config "$DIR/host.cfg" -v \
+   -L "$HERE/ranetloss_libretro.so" --host \
+   --max-frames="$FRAMES" 2> "$DIR/host.log" &
+HOST=$!
+sleep 1
+
+RANETLOSS_LOG="$DIR/client.frames" "$RETROARCH" --config "$DIR/client.cfg" -v \
+   -L "$HERE/ranetloss_libretro.so" --connect 127.0.0.1 \
+   --max-frames="$FRAMES" 2> "$DIR/client.log" &
+CLIENT=$!
+
+wait $HOST
+wait $CLIENT
+kill $PROXY 2> /dev/null
+wait $PROXY 2> /dev/null
+
+cat "$DIR/ranetloss.log"
+grep -h "arrived early over UDP" "$DIR/host.log" "$DIR/client.log"
+
+# Compare the frames both logged, from when the host first saw the client's
+# input. Whoever finished first stopped confirming the other's input, so the
+# last of those may still be predictions.
+awk 'NR == FNR { host[$1] = $0; next } $1 in host { print host[$1], $2, $3 }' \
+   "$DIR/host.frames" "$DIR/client.frames" |
+   awk 'playing || $3 != "0000" { playing = 1; print }' > "$DIR/joined"
+COMMON=$(($(wc -l < "$DIR/joined") - 120))
+head -n "$COMMON" "$DIR/joined" > "$DIR/common" 2> /dev/null
+
+RESULT=0
+if [ "$COMMON" -lt $((FRAMES / 2)) ]; then
+   echo "FAIL: the peers only played $COMMON frames together."
+   RESULT=1
+elif ! grep -q "Sending input over UDP" "$DIR/client.log"; then
+   echo "FAIL: the UDP input channel never came up."
+   RESULT=1
+elif awk '$2 != $4 || $3 != $5 { print; bad = 1 } END { exit !bad }' \
+      "$DIR/common" | head -n 5 | grep .; then
+   echo "FAIL: the peers diverged (frame, host's input, client's input)."
+   RESULT=1
+elif ! grep -q "arrived early over UDP" "$DIR/host.log" "$DIR/client.log"; then
+   echo "FAIL: no input arrived over UDP."
+   RESULT=1
+else
+   echo "PASS: $COMMON frames converged."
+fi
+
+if [ $RESULT -eq 0 ]; then
+   rm -rf "$DIR"
+else
+   echo "Logs are in $DIR."
+fi
+exit $RESULT
@@ -0,0 +1,635 @@
+/*
+ * Copyright (c) 2017 The RetroArch team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION
+ * OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "compat/getopt.h"
+#include "net/net_socket.h"
+
+/* Only for #defines */
+#include "../../network/netplay/netplay_private.h"
+
+/* How much we'll read from one side before the other side takes it */
+#define RELAY_BUF_SIZE 65536
+
+/* Seconds a connection to our port may take to say what it is, and a client
+ * may wait for its host to link it */
+#define RELAY_PENDING_TIMEOUT 10
+
+#define NO_CONN ((size_t) -1)
+
+enum relay_conn_type
+{
+   RELAY_NONE = 0,
+   RELAY_LISTEN,  /* Our own port */
+   RELAY_PENDING, /* Connected to our port, header not yet read */
+   RELAY_CONTROL, /* A host's control connection, one per room */
+   RELAY_ROOM,    /* A room's port */
+   RELAY_CLIENT,  /* A client connected to a room */
+   RELAY_LINK     /* The host's end of a client's connection */
+};
+
+struct relay_conn
+{
+   enum relay_conn_type type;
+   int fd;
+
+   /* The room's control connection, for everything but RELAY_LISTEN and
+    * RELAY_PENDING */
+   size_t room;
+
+   /* The other half of a spliced client/link pair */
+   size_t peer;
+
+   /* Client id and the random token only its host is told, to match a link
+    * to its client */
+   uint32_t id, token;
+
+   /* When a pending connection or unlinked client arrived */
+   time_t since;
+
+   /* Header of a pending connection */
+   uint32_t header[4];
+   size_t header_len;
+
+   /* Data read from this connection which the peer hasn't taken yet */
+   unsigned char *buf;
+   size_t buf_start, buf_end;
+
+   /* Our own messages to a host's control connection, waiting for it to be
+    * writable */
+   unsigned char *out;
+   size_t out_len, out_size;
+};
+
+static struct relay_conn *conns;
+static size_t conns_size;
+static uint32_t next_client_id = 1;
+static size_t rooms_open;
+static FILE *urandom;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: ranetrelay [options]\n"
+      "Options:\n"
+      "    -P|--port <port>:     Relay port, to which hosts connect. Defaults\n"
+      "                          to 55435.\n"
+      "\n");
+}
+
+static size_t conn_add(enum relay_conn_type type, int fd)
+{
+   size_t i;
+   struct relay_conn *conn;
+
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return NO_CONN;
+   }
+
+   for (i = 0; i < conns_size; i++)
+      if (conns[i].type == RELAY_NONE)
+         break;
+
+   if (i == conns_size)
+   {
+      size_t new_size = conns_size ? conns_size * 2 : 64;
+      struct relay_conn *new_conns = (struct relay_conn *)
+         realloc(conns, new_size * sizeof(struct relay_conn));
+      if (!new_conns)
+      {
+         perror("realloc");
+         socket_close(fd);
+         return NO_CONN;
+      }
+      memset(new_conns + conns_size, 0,
+            (new_size - conns_size) * sizeof(struct relay_conn));
+      conns      = new_conns;
+      conns_size = new_size;
+   }
+
+   conn             = &conns[i];
+   memset(conn, 0, sizeof(*conn));
+   conn->type       = type;
+   conn->fd         = fd;
+   conn->room       = NO_CONN;
+   conn->peer       = NO_CONN;
+   conn->since      = time(NULL);
+   return i;
+}
+
+static void conn_close(size_t i)
+{
+   struct relay_conn *conn = &conns[i];
+
+   if (conn->type == RELAY_NONE)
+      return;
+
+   socket_close(conn->fd);
+   free(conn->buf);
+   free(conn->out);
+   memset(conn, 0, sizeof(*conn));
+   conn->fd = -1;
+}
+
+/* Close a client or link along with the other half of its pair */
+static void pair_close(size_t i)
+{
+   size_t peer = conns[i].peer;
+   conn_close(i);
+   if (peer != NO_CONN)
+      conn_close(peer);
+}
+
+/* Close a room along with everyone in it */
+static void room_close(size_t control)
+{
+   size_t i;
+
+   for (i = 0; i < conns_size; i++)
+      if (i != control && conns[i].type != RELAY_NONE &&
+            conns[i].room == control)
+         conn_close(i);
+   conn_close(control);
+
+   rooms_open--;
+   fprintf(stderr, "Room %u closed, %u open.\n",
+         (unsigned) control, (unsigned) rooms_open);
+}
+
+/* Queue a message to a control connection. We never block on a host, so it
+ * goes out when poll says the connection is writable. */
+static bool conn_queue(size_t i, const void *data, size_t len)
+{
+   struct relay_conn *conn = &conns[i];
+
+   if (conn->out_size - conn->out_len < len)
+   {
+      size_t new_size = conn->out_size ? conn->out_size * 2 : 64;
+      unsigned char *new_out;
+
+      while (new_size - conn->out_len < len)
+         new_size *= 2;
+      new_out = (unsigned char *) realloc(conn->out, new_size);
+      if (!new_out)
+         return false;
+      conn->out      = new_out;
+      conn->out_size = new_size;
+   }
+
+   memcpy(conn->out + conn->out_len, data, len);
+   conn->out_len += len;
+   return true;
+}
+
+/* Write as much of what we've queued to a connection as it will take */
+static bool conn_flush(size_t i)
+{
+   struct relay_conn *conn = &conns[i];
+   ssize_t sent;
+
+   if (!conn->out_len)
+      return true;
+
+   sent = socket_send_all_nonblocking(conn->fd, conn->out, conn->out_len,
+         true);
+   if (sent < 0)
+      return false;
+
+   memmove(conn->out, conn->out + sent, conn->out_len - sent);
+   conn->out_len -= sent;
+   return true;
+}
+
+/* Open a room for a host on a fresh port */
+static bool room_open(size_t control)
+{
+   uint32_t reply[3];
+   struct sockaddr_storage addr;
+   socklen_t addr_size = sizeof(addr);
+   struct addrinfo *ai = NULL;
+   size_t room;
+   unsigned short port;
+   int fd = socket_init((void **) &ai, 0, NULL, SOCKET_TYPE_STREAM);
+
+   if (fd < 0)
+      return false;
+
+   if (!socket_bind(fd, ai) || listen(fd, 64) < 0 ||
+       getsockname(fd, (struct sockaddr *) &addr, &addr_size) < 0)
+   {
+      freeaddrinfo_retro(ai);
+      socket_close(fd);
+      return false;
+   }
+   freeaddrinfo_retro(ai);
+
+   if (addr.ss_family == AF_INET6)
+      port = ntohs(((struct sockaddr_in6 *) &addr)->sin6_port);
+   else
+      port = ntohs(((struct sockaddr_in *) &addr)->sin_port);
+
+   room = conn_add(RELAY_ROOM, fd);
+   if (room == NO_CONN)
+      return false;
+   conns[room].room = control;
+
+   conns[control].type = RELAY_CONTROL;
+   conns[control].room = control;
+
+   reply[0] = htonl(NETPLAY_RELAY_MAGIC);
+   reply[1] = htonl(NETPLAY_RELAY_CMD_ROOM);
+   reply[2] = htonl(port);
+   if (!conn_queue(control, reply, sizeof(reply)))
+   {
+      conn_close(room);
+      return false;
+   }
+
+   rooms_open++;
+   fprintf(stderr, "Room %u opened on port %hu, %u open.\n",
+         (unsigned) control, port, (unsigned) rooms_open);
+   return true;
+}
+
+/* Read the header of a new connection to our port */
+static void pending_read(size_t i)
+{
+   struct relay_conn *conn = &conns[i];
+   size_t j;
+   ssize_t got = recv(conn->fd, (char *) conn->header + conn->header_len,
+         sizeof(conn->header) - conn->header_len, 0);
+
+   if (got <= 0)
+   {
+      conn_close(i);
+      return;
+   }
+   conn->header_len += got;
+
+   if (conn->header_len < 2 * sizeof(uint32_t))
+      return;
+
+   if (ntohl(conn->header[0]) != NETPLAY_RELAY_MAGIC)
+   {
+      conn_close(i);
+      return;
+   }
+
+   switch (ntohl(conn->header[1]))
+   {
+      case NETPLAY_RELAY_CMD_HOST:
+         if (!room_open(i))
+         {
+            fprintf(stderr, "Failed to open a room.\n");
+            conn_close(i);
+         }
+         return;
+
+      case NETPLAY_RELAY_CMD_LINK:
+         if (conn->header_len < sizeof(conn->header))
+            return;
+
+         /* Find the client this belongs to. Ids are easily guessed, so it
+          * also takes the token only the client's host was told. */
+         for (j = 0; j < conns_size; j++)
+         {
+            if (conns[j].type == RELAY_CLIENT &&
+                  conns[j].peer == NO_CONN &&
+                  conns[j].id == ntohl(conn->header[2]) &&
+                  conns[j].token == ntohl(conn->header[3]))
+            {
+               conn->type    = RELAY_LINK;
+               conn->room    = conns[j].room;
+               conn->peer    = j;
+               conns[j].peer = i;
+               return;
+            }
+         }
+         conn_close(i);
+         return;
+
+      default:
+         conn_close(i);
+         return;
+   }
+}
+
+/* Accept a client into a room and ask the host for a link */
+static void room_accept(size_t room)
+{
+   uint32_t announce[3];
+   size_t control = conns[room].room;
+   size_t client;
+   int fd = accept(conns[room].fd, NULL, NULL);
+
+   if (fd < 0)
+      return;
+
+   client = conn_add(RELAY_CLIENT, fd);
+   if (client == NO_CONN)
+      return;
+   conns[client].room = control;
+   conns[client].id   = next_client_id++;
+
+   if (fread(&conns[client].token, sizeof(conns[client].token), 1,
+            urandom) != 1)
+   {
+      conn_close(client);
+      return;
+   }
+
+   announce[0] = htonl(NETPLAY_RELAY_CMD_CLIENT);
+   announce[1] = htonl(conns[client].id);
+   announce[2] = htonl(conns[client].token);
+   if (!conn_queue(control, announce, sizeof(announce)))
+      room_close(control);
+}
+
+/* Write what peer has read to conn */
+static bool pair_flush(size_t i)
+{
+   struct relay_conn *conn = &conns[i];
+   struct relay_conn *peer = &conns[conn->peer];
+   ssize_t sent;
+
+   if (peer->buf_start == peer->buf_end)
+      return true;
+
+   sent = socket_send_all_nonblocking(conn->fd, peer->buf + peer->buf_start,
+         peer->buf_end - peer->buf_start, true);
+   if (sent < 0)
+      return false;
+
+   peer->buf_start += sent;
+   if (peer->buf_start == peer->buf_end)
+      peer->buf_start = peer->buf_end = 0;
+   return true;
+}
+
+/* Read from one half of a pair and pass it on to the other */
+static bool pair_read(size_t i)
+{
+   struct relay_conn *conn = &conns[i];
+   ssize_t got;
+
+   if (!conn->buf)
+   {
+      conn->buf = (unsigned char *) malloc(RELAY_BUF_SIZE);
+      if (!conn->buf)
+         return false;
+   }
+
+   got = recv(conn->fd, (char *) conn->buf + conn->buf_end,
+         RELAY_BUF_SIZE - conn->buf_end, 0);
+   if (got <= 0)
+      return false;
+   conn->buf_end += got;
+
+   return pair_flush(conn->peer);
+}
+
+/* Drop connections which never said what they are, and clients whose host
+ * never linked them. Returns whether any are still waiting. */
+static bool pending_expire(void)
+{
+   size_t i;
+   bool waiting = false;
+   time_t now   = time(NULL);
+
+   for (i = 0; i < conns_size; i++)
+   {
+      struct relay_conn *conn = &conns[i];
+
+      if (conn->type != RELAY_PENDING &&
+            !(conn->type == RELAY_CLIENT && conn->peer == NO_CONN))
+         continue;
+
+      if (now - conn->since >= RELAY_PENDING_TIMEOUT)
+         conn_close(i);
+      else
+         waiting = true;
+   }
+
+   return waiting;
+}
+
+int main(int argc, char **argv)
+{
+   struct addrinfo *addr;
+   struct pollfd *fds = NULL;
+   size_t *fd_conns   = NULL;
+   size_t fds_size    = 0;
+   size_t listener;
+   int port           = RARCH_DEFAULT_PORT;
+   int fd;
+
+   const struct option opt[] = {
+      {"port",       1, NULL, 'P'},
+      {NULL,         0, NULL, 0}
+   };
+
+   while (1)
+   {
+      int c;
+
+      c = getopt_long(argc, argv, "P:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+#ifdef SIGPIPE
+   signal(SIGPIPE, SIG_IGN);
+#endif
+
+   /* Link tokens must be unguessable */
+   urandom = fopen("/dev/urandom", "rb");
+   if (!urandom)
+   {
+      perror("/dev/urandom");
+      return 1;
+   }
+
+   /* Open our port */
+   if ((fd = socket_init((void **) &addr, port, NULL, SOCKET_TYPE_STREAM)) < 0)
+   {
+      perror("socket");
+      return 1;
+   }
+
+   if (!socket_bind(fd, addr) || listen(fd, 1024) < 0)
+   {
+      perror("bind");
+      return 1;
+   }
+   freeaddrinfo_retro(addr);
+
+   listener = conn_add(RELAY_LISTEN, fd);
+   if (listener == NO_CONN)
+      return 1;
+
+   fprintf(stderr, "Relaying on port %d.\n", port);
+
+   while (1)
+   {
+      size_t i, nfds = 0;
+      bool waiting   = pending_expire();
+
+      /* Gather everything we're waiting on */
+      if (fds_size < conns_size)
+      {
+         fds      = (struct pollfd *) realloc(fds, conns_size * sizeof(*fds));
+         fd_conns = (size_t *) realloc(fd_conns, conns_size * sizeof(*fd_conns));
+         if (!fds || !fd_conns)
+         {
+            perror("realloc");
+            return 1;
+         }
+         fds_size = conns_size;
+      }
+
+      for (i = 0; i < conns_size; i++)
+      {
+         struct relay_conn *conn = &conns[i];
+         short events            = 0;
+
+         switch (conn->type)
+         {
+            case RELAY_NONE:
+               continue;
+
+            case RELAY_CLIENT:
+            case RELAY_LINK:
+               /* Clients wait in the kernel until their link arrives, and
+                * each side waits while the other is backed up */
+               if (conn->peer == NO_CONN)
+                  break;
+               if (conn->buf_start == conn->buf_end)
+                  events |= POLLIN;
+               if (conns[conn->peer].buf_start != conns[conn->peer].buf_end)
+                  events |= POLLOUT;
+               break;
+
+            case RELAY_CONTROL:
+               events = POLLIN;
+               if (conn->out_len)
+                  events |= POLLOUT;
+               break;
+
+            default:
+               events = POLLIN;
+               break;
+         }
+
+         fds[nfds].fd      = conn->fd;
+         fds[nfds].events  = events;
+         fds[nfds].revents = 0;
+         fd_conns[nfds++]  = i;
+      }
+
+      /* While anyone is waiting, wake up now and then to expire them */
+      if (poll(fds, nfds, waiting ? 1000 : -1) < 0)
+      {
+         perror("poll");
+         return 1;
+      }
+
+      for (i = 0; i < nfds; i++)
+      {
+         size_t ci               = fd_conns[i];
+         struct relay_conn *conn = &conns[ci];
+         short revents           = fds[i].revents;
+
+         /* Skip anything closed or replaced earlier in this pass */
+         if (!revents || conn->type == RELAY_NONE || conn->fd != fds[i].fd)
+            continue;
+
+         switch (conn->type)
+         {
+            case RELAY_LISTEN:
+               fd = accept(conn->fd, NULL, NULL);
+               if (fd >= 0)
+                  conn_add(RELAY_PENDING, fd);
+               break;
+
+            case RELAY_PENDING:
+               pending_read(ci);
+               break;
+
+            case RELAY_CONTROL:
+            {
+               /* Hosts don't talk on the control connection, so anything
+                * to read can only be them leaving */
+               char discard[64];
+               if ((revents & (POLLERR|POLLNVAL)) ||
+                   ((revents & POLLIN) &&
+                    recv(conn->fd, discard, sizeof(discard), 0) <= 0) ||
+                   ((revents & POLLOUT) && !conn_flush(ci)))
+                  room_close(ci);
+               break;
+            }
+
+            case RELAY_ROOM:
+               room_accept(ci);
+               break;
+
+            case RELAY_CLIENT:
+            case RELAY_LINK:
+               if ((revents & (POLLERR|POLLNVAL)) ||
+                   ((revents & POLLHUP) && !(revents & POLLIN)))
+               {
+                  pair_close(ci);
+                  break;
+               }
+               if (conn->peer == NO_CONN)
+                  break;
+               if ((revents & POLLOUT) && !pair_flush(ci))
+               {
+                  pair_close(ci);
+                  break;
+               }
+               if ((revents & POLLIN) && !pair_read(ci))
+                  pair_close(ci);
+               break;
+
+            default:
+               break;
+         }
+      }
+   }
+
+   return 0;
+}